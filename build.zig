@@ -215,6 +215,7 @@ pub fn build(b: *std.Build) !void {
         .CASE_INSENSITIVE_FILENAME = is_darwin or is_windows,
         .HAVE_SYS_UIO_H = modern_unix,
         .HAVE_READV = modern_unix,
+        .HAVE_SYS_MMAN_H = modern_unix,
         .HAVE_DIRFD_AND_FLOCK = modern_unix,
         .HAVE_FORKPTY = modern_unix and !is_darwin, // also on Darwin but we lack the headers :(
         .HAVE_BE64TOH = modern_unix and !is_darwin,
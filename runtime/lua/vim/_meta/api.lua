@@ -32,6 +32,10 @@ function vim.api.nvim__buf_stats(buffer) end
 --- - bufnr: (number) buffer id in floating window
 function vim.api.nvim__complete_set(index, opts) end
 
+--- For testing. Evicts the glyphs not shown anymore from the cache, like when
+--- it is full.
+function vim.api.nvim__evict_glyph_cache() end
+
 --- @return string
 function vim.api.nvim__get_lib_dir() end
 
@@ -86,7 +90,7 @@ function vim.api.nvim__id_float(flt) end
 --- @return any[]
 function vim.api.nvim__inspect_cell(grid, row, col) end
 
---- For testing. The condition in schar_cache_clear_if_full is hard to
+--- For testing. The condition in schar_cache_evict_if_full is hard to
 --- reach, so this function can be used to force a cache clear in a test.
 function vim.api.nvim__invalidate_glyph_cache() end
 
@@ -695,6 +699,23 @@ function vim.api.nvim_buf_line_count(buffer) end
 --- @return integer # Id of the created/updated extmark
 function vim.api.nvim_buf_set_extmark(buffer, ns_id, line, col, opts) end
 
+--- Creates many new extmarks at once.
+---
+--- Like calling `nvim_buf_set_extmark()` for each item of {marks}, but much
+--- faster when adding many marks (such as for highlighting a whole buffer), as
+--- the marks are added to the buffer together. All items are checked first:
+--- if any item is invalid, no extmark is created.
+---
+--- @param buffer integer Buffer id, or 0 for current buffer
+--- @param ns_id integer Namespace id from `nvim_create_namespace()`
+--- @param marks any[][] List of `[line, col, opts]` items, where `line` and `col` are
+---              the position of the mark as for `nvim_buf_set_extmark()`. The
+---              optional `opts` dict takes the same keys as the {opts} of
+---              `nvim_buf_set_extmark()`, except for `id` and `ephemeral`.
+---              Items sorted by position are added fastest.
+--- @return integer[] # Ids of the created extmarks, in the order of {marks}
+function vim.api.nvim_buf_set_extmarks(buffer, ns_id, marks) end
+
 --- Sets a buffer-local `mapping` for the given mode.
 ---
 ---
@@ -4010,6 +4010,29 @@ vim.o.lrm = vim.o.langremap
 vim.go.langremap = vim.o.langremap
 vim.go.lrm = vim.go.langremap
 
+--- When editing a file of at least this many Mbyte, the buffer is
+--- backed by a private memory mapping of the file instead of reading all
+--- lines into memory.  Lines are used where they are in the mapping, so
+--- opening and browsing a huge log file does not take time or memory
+--- proportional to its size.  Only lines that are changed or added are
+--- moved into memory, the other lines stay in the mapping.  All lines are
+--- moved into memory when a swap file is written for the changed buffer,
+--- set 'noswapfile' to avoid that.
+--- Only used for a file that is valid UTF-8 (unless 'binary' is set) and
+--- has "unix" 'fileformat', when 'undofile' is off.  Otherwise, or when
+--- zero (the default), the file is read as usual.
+--- Note: Changes made to the file by another program may show up in the
+--- lines that are still mapped.  When the size or modification time of
+--- the file changes, all lines are moved into memory the next time the
+--- buffer is used, lines beyond the new end of the file are empty.
+--- Only available on systems that support mmap().
+---
+--- @type integer
+vim.o.largefilesize = 0
+vim.o.lfs = vim.o.largefilesize
+vim.go.largefilesize = vim.o.largefilesize
+vim.go.lfs = vim.go.largefilesize
+
 --- The value of this option influences when the last window will have a
 --- status line:
 --- 	0: never
@@ -4463,6 +4486,20 @@ vim.o.mmp = vim.o.maxmempattern
 vim.go.maxmempattern = vim.o.maxmempattern
 vim.go.mmp = vim.go.maxmempattern
 
+--- When 'swapfile' is off, the text of a buffer is only kept in memory.
+--- When the text of such a buffer takes more than this many Kbyte, the
+--- blocks of text that were not used recently are compressed.  They are
+--- uncompressed again when they are used.  This reduces the memory used
+--- for many large buffers, at the cost of some CPU time.
+--- Zero (the default) disables compressing.  Otherwise the value must be
+--- at least 64.  How much memory is saved is reported by nvim__stats().
+---
+--- @type integer
+vim.o.memcompress = 0
+vim.o.mcm = vim.o.memcompress
+vim.go.memcompress = vim.o.memcompress
+vim.go.mcm = vim.go.memcompress
+
 --- Maximum number of matches shown for the search count status `shm-S`
 --- When the number of matches exceeds this value, Vim shows ">" instead
 --- of the exact count to keep searching fast.
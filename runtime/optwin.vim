@@ -1003,6 +1003,8 @@ call <SID>AddOption("patchmode", gettext("keep oldest version of a file; specifi
 call <SID>OptionG("pm", &pm)
 call <SID>AddOption("fsync", gettext("forcibly sync the file to disk after writing it"))
 call <SID>BinOptionG("fs", &fs)
+call <SID>AddOption("largefilesize", gettext("minimal size in Mbyte of a file to map into memory instead of reading it"))
+call append("$", " \tset lfs=" . &lfs)
 
 
 call <SID>Header(gettext("the swap file"))
@@ -1015,6 +1017,8 @@ call <SID>AddOption("updatecount", gettext("number of characters typed to cause
 call append("$", " \tset uc=" . &uc)
 call <SID>AddOption("updatetime", gettext("time in msec after which the swap file will be updated"))
 call append("$", " \tset ut=" . &ut)
+call <SID>AddOption("memcompress", gettext("memory in Kbyte of text kept uncompressed without a swap file"))
+call append("$", " \tset mcm=" . &mcm)
 
 
 call <SID>Header(gettext("command line editing"))
@@ -28,6 +28,7 @@
 --- @field lua_only true?
 --- @field textlock_allow_cmdwin true?
 --- @field textlock true?
+--- @field readonly true?
 --- @field remote_impl true?
 --- @field compositor_impl true?
 --- @field client_impl true?
@@ -196,6 +197,7 @@ local fattr = (
   + attr('FUNC_API_LUA_ONLY', 'lua_only')
   + attr('FUNC_API_TEXTLOCK_ALLOW_CMDWIN', 'textlock_allow_cmdwin')
   + attr('FUNC_API_TEXTLOCK', 'textlock')
+  + attr('FUNC_API_READONLY', 'readonly')
   + attr('FUNC_API_REMOTE_IMPL', 'remote_impl')
   + attr('FUNC_API_COMPOSITOR_IMPL', 'compositor_impl')
   + attr('FUNC_API_CLIENT_IMPL', 'client_impl')
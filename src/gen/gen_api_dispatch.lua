@@ -667,6 +667,8 @@ for n, name in ipairs(hashorder) do
       .. tostring(fn.fast)
       .. ', .ret_alloc = '
       .. tostring(not not fn.ret_alloc)
+      .. ', .readonly = '
+      .. tostring(not not fn.readonly)
       .. '},\n'
   )
 end
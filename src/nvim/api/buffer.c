@@ -69,7 +69,7 @@
 /// @param[out] err Error details, if any
 /// @return Line count, or 0 for unloaded buffer. |api-buffer|
 Integer nvim_buf_line_count(Buffer buffer, Error *err)
-  FUNC_API_SINCE(1)
+  FUNC_API_SINCE(1) FUNC_API_READONLY
 {
   buf_T *buf = find_buffer_by_handle(buffer, err);
 
@@ -253,7 +253,7 @@ ArrayOf(String) nvim_buf_get_lines(uint64_t channel_id,
                                    Arena *arena,
                                    lua_State *lstate,
                                    Error *err)
-  FUNC_API_SINCE(1)
+  FUNC_API_SINCE(1) FUNC_API_READONLY
 {
   Array rv = ARRAY_DICT_INIT;
   buf_T *buf = find_buffer_by_handle(buffer, err);
@@ -408,21 +408,15 @@ void nvim_buf_set_lines(uint64_t channel_id, Buffer buffer, Integer start, Integ
     }
 
     // Now we may need to insert the remaining new old_len
-    for (size_t i = to_replace; i < new_len; i++) {
-      int64_t lnum = start + (int64_t)i - 1;
-
-      VALIDATE(lnum < MAXLNUM, "%s", "Index out of bounds", {
-        goto end;
-      });
-
-      if (ml_append_buf(buf, (linenr_T)lnum, lines[i], 0, false) == FAIL) {
-        api_set_error(err, kErrorTypeException, "Failed to insert line");
+    if (to_replace < new_len) {
+      if (!append_lines(buf, start + (int64_t)to_replace - 1, lines + to_replace,
+                        new_len - to_replace, arena, err)) {
         goto end;
       }
-
-      inserted_bytes += (bcount_t)strlen(lines[i]) + 1;
-
-      extra++;
+      for (size_t i = to_replace; i < new_len; i++) {
+        inserted_bytes += (bcount_t)strlen(lines[i]) + 1;
+      }
+      extra += (ptrdiff_t)(new_len - to_replace);
     }
 
     // Adjust marks. Invalidate any which lie in the
@@ -639,19 +633,12 @@ void nvim_buf_set_text(uint64_t channel_id, Buffer buffer, Integer start_row, In
     }
 
     // Now we may need to insert the remaining new old_len
-    for (size_t i = to_replace; i < new_len; i++) {
-      int64_t lnum = start_row + (int64_t)i - 1;
-
-      VALIDATE((lnum < MAXLNUM), "%s", "Index out of bounds", {
-        goto end;
-      });
-
-      if (ml_append_buf(buf, (linenr_T)lnum, lines[i], 0, false) == FAIL) {
-        api_set_error(err, kErrorTypeException, "Failed to insert line");
+    if (to_replace < new_len) {
+      if (!append_lines(buf, start_row + (int64_t)to_replace - 1, lines + to_replace,
+                        new_len - to_replace, arena, err)) {
         goto end;
       }
-
-      extra++;
+      extra += (ptrdiff_t)(new_len - to_replace);
     }
 
     colnr_T col_extent = (colnr_T)(end_col
@@ -706,7 +693,7 @@ ArrayOf(String) nvim_buf_get_text(uint64_t channel_id, Buffer buffer,
                                   Integer end_row, Integer end_col,
                                   Dict(empty) *opts,
                                   Arena *arena, lua_State *lstate, Error *err)
-  FUNC_API_SINCE(9)
+  FUNC_API_SINCE(9) FUNC_API_READONLY
 {
   Array rv = ARRAY_DICT_INIT;
 
@@ -792,7 +779,7 @@ end:
 /// @param[out] err   Error details, if any
 /// @return Integer byte offset, or -1 for unloaded buffer.
 Integer nvim_buf_get_offset(Buffer buffer, Integer index, Error *err)
-  FUNC_API_SINCE(5)
+  FUNC_API_SINCE(5) FUNC_API_READONLY
 {
   buf_T *buf = find_buffer_by_handle(buffer, err);
   if (!buf) {
@@ -818,7 +805,7 @@ Integer nvim_buf_get_offset(Buffer buffer, Integer index, Error *err)
 /// @param[out] err   Error details, if any
 /// @return Variable value
 Object nvim_buf_get_var(Buffer buffer, String name, Arena *arena, Error *err)
-  FUNC_API_SINCE(1)
+  FUNC_API_SINCE(1) FUNC_API_READONLY
 {
   buf_T *buf = find_buffer_by_handle(buffer, err);
 
@@ -836,7 +823,7 @@ Object nvim_buf_get_var(Buffer buffer, String name, Arena *arena, Error *err)
 ///
 /// @return `b:changedtick` value.
 Integer nvim_buf_get_changedtick(Buffer buffer, Error *err)
-  FUNC_API_SINCE(2)
+  FUNC_API_SINCE(2) FUNC_API_READONLY
 {
   const buf_T *const buf = find_buffer_by_handle(buffer, err);
 
@@ -932,7 +919,7 @@ void nvim_buf_del_var(Buffer buffer, String name, Error *err)
 /// @param[out] err   Error details, if any
 /// @return Buffer name
 String nvim_buf_get_name(Buffer buffer, Error *err)
-  FUNC_API_SINCE(1)
+  FUNC_API_SINCE(1) FUNC_API_READONLY
 {
   String rv = STRING_INIT;
   buf_T *buf = find_buffer_by_handle(buffer, err);
@@ -993,7 +980,7 @@ void nvim_buf_set_name(Buffer buffer, String name, Error *err)
 /// @param buffer Buffer id, or 0 for current buffer
 /// @return true if the buffer is valid and loaded, false otherwise.
 Boolean nvim_buf_is_loaded(Buffer buffer)
-  FUNC_API_SINCE(5)
+  FUNC_API_SINCE(5) FUNC_API_READONLY
 {
   Error stub = ERROR_INIT;
   buf_T *buf = find_buffer_by_handle(buffer, &stub);
@@ -1047,7 +1034,7 @@ void nvim_buf_delete(Buffer buffer, Dict(buf_delete) *opts, Error *err)
 /// @param buffer Buffer id, or 0 for current buffer
 /// @return true if the buffer is valid, false otherwise.
 Boolean nvim_buf_is_valid(Buffer buffer)
-  FUNC_API_SINCE(1)
+  FUNC_API_SINCE(1) FUNC_API_READONLY
 {
   Error stub = ERROR_INIT;
   Boolean ret = find_buffer_by_handle(buffer, &stub) != NULL;
@@ -1143,7 +1130,7 @@ Boolean nvim_buf_set_mark(Buffer buffer, String name, Integer line, Integer col,
 /// @see |nvim_buf_set_mark()|
 /// @see |nvim_buf_del_mark()|
 ArrayOf(Integer, 2) nvim_buf_get_mark(Buffer buffer, String name, Arena *arena, Error *err)
-  FUNC_API_SINCE(1)
+  FUNC_API_SINCE(1) FUNC_API_READONLY
 {
   Array rv = ARRAY_DICT_INIT;
   buf_T *buf = find_buffer_by_handle(buffer, err);
@@ -1255,6 +1242,27 @@ Dict nvim__buf_stats(Buffer buffer, Arena *arena, Error *err)
   return rv;
 }
 
+/// Append "count" lines after line "lnum" of "buf" at once.
+///
+/// @return  false when the lines could not be appended, "err" is set then.
+static bool append_lines(buf_T *buf, int64_t lnum, char **lines, size_t count, Arena *arena,
+                         Error *err)
+{
+  VALIDATE((lnum + (int64_t)count - 1 < MAXLNUM), "%s", "Index out of bounds", {
+    return false;
+  });
+
+  String *items = arena_alloc(arena, count * sizeof(String), true);
+  for (size_t i = 0; i < count; i++) {
+    items[i] = cbuf_as_string(lines[i], strlen(lines[i]));
+  }
+  if (ml_append_lines(buf, (linenr_T)lnum, items, count, 0) == FAIL) {
+    api_set_error(err, kErrorTypeException, "Failed to insert line");
+    return false;
+  }
+  return true;
+}
+
 // Check if deleting lines made the cursor position invalid.
 // Changed lines from `lo` to `hi`; added `extra` lines (negative if deleted).
 static void fix_cursor(win_T *win, linenr_T lo, linenr_T hi, linenr_T extra)
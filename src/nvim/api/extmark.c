@@ -207,7 +207,7 @@ static Array extmark_to_array(MTPair extmark, bool id, bool add_dict, bool hl_na
 Tuple(Integer, Integer, *DictAs(extmark_details))
 nvim_buf_get_extmark_by_id(Buffer buffer, Integer ns_id, Integer id, Dict(get_extmark) * opts,
                            Arena *arena, Error *err)
-  FUNC_API_SINCE(7)
+  FUNC_API_SINCE(7) FUNC_API_READONLY
 {
   Array rv = ARRAY_DICT_INIT;
 
@@ -295,7 +295,7 @@ ArrayOf(DictAs(get_extmark_item)) nvim_buf_get_extmarks(Buffer buffer, Integer n
                                                         Object end,
                                                         Dict(get_extmarks) *opts, Arena *arena,
                                                         Error *err)
-  FUNC_API_SINCE(7)
+  FUNC_API_SINCE(7) FUNC_API_READONLY
 {
   Array rv = ARRAY_DICT_INIT;
 
@@ -530,6 +530,106 @@ ArrayOf(DictAs(get_extmark_item)) nvim_buf_get_extmarks(Buffer buffer, Integer n
 Integer nvim_buf_set_extmark(Buffer buffer, Integer ns_id, Integer line, Integer col,
                              Dict(set_extmark) *opts, Error *err)
   FUNC_API_SINCE(7)
+{
+  buf_T *buf = find_buffer_by_handle(buffer, err);
+  if (!buf) {
+    return 0;
+  }
+
+  return set_extmark(buf, ns_id, line, col, opts, NULL, err);
+}
+
+/// Creates many new extmarks at once.
+///
+/// Like calling |nvim_buf_set_extmark()| for each item of {marks}, but much
+/// faster when adding many marks (such as for highlighting a whole buffer), as
+/// the marks are added to the buffer together. All items are checked first:
+/// if any item is invalid, no extmark is created.
+///
+/// @param buffer Buffer id, or 0 for current buffer
+/// @param ns_id Namespace id from |nvim_create_namespace()|
+/// @param marks List of `[line, col, opts]` items, where `line` and `col` are
+///              the position of the mark as for |nvim_buf_set_extmark()|. The
+///              optional `opts` dict takes the same keys as the {opts} of
+///              |nvim_buf_set_extmark()|, except for `id` and `ephemeral`.
+///              Items sorted by position are added fastest.
+/// @param[out] err Error details, if any
+/// @return Ids of the created extmarks, in the order of {marks}
+ArrayOf(Integer) nvim_buf_set_extmarks(Buffer buffer, Integer ns_id, ArrayOf(Array) marks,
+                                       Arena *arena, Error *err)
+  FUNC_API_SINCE(14)
+{
+  buf_T *buf = find_buffer_by_handle(buffer, err);
+  if (!buf) {
+    return (Array)ARRAY_DICT_INIT;
+  }
+
+  VALIDATE_INT(ns_initialized((uint32_t)ns_id), "ns_id", ns_id, {
+    return (Array)ARRAY_DICT_INIT;
+  });
+
+  ExtmarkPutArray batch = KV_INITIAL_VALUE;
+  kv_resize(batch, marks.size);
+  for (size_t i = 0; i < marks.size; i++) {
+    Object item = marks.items[i];
+    VALIDATE_EXP((item.type == kObjectTypeArray && item.data.array.size >= 2
+                  && item.data.array.size <= 3), "marks item", "[line, col, opts] Array", NULL, {
+      goto error;
+    });
+    Array a = item.data.array;
+    VALIDATE_T("line", kObjectTypeInteger, a.items[0].type, {
+      goto error;
+    });
+    VALIDATE_T("col", kObjectTypeInteger, a.items[1].type, {
+      goto error;
+    });
+
+    Dict(set_extmark) opts[1] = { KEYDICT_INIT };
+    if (a.size == 3) {
+      // Also allow an empty Array, which is how an empty Lua table arrives.
+      VALIDATE_EXP((a.items[2].type == kObjectTypeDict
+                    || (a.items[2].type == kObjectTypeArray && a.items[2].data.array.size == 0)),
+                   "opts", api_typename(kObjectTypeDict), api_typename(a.items[2].type), {
+        goto error;
+      });
+      if (a.items[2].type == kObjectTypeDict
+          && !api_dict_to_keydict(opts, DictHash(set_extmark), a.items[2].data.dict, err)) {
+        goto error;
+      }
+    }
+    VALIDATE(!HAS_KEY(opts, set_extmark, id) && !opts->ephemeral, "%s",
+             "cannot use 'id' or 'ephemeral' with nvim_buf_set_extmarks", {
+      goto error;
+    });
+
+    set_extmark(buf, ns_id, a.items[0].data.integer, a.items[1].data.integer, opts, &batch, err);
+    if (ERROR_SET(err)) {
+      goto error;
+    }
+  }
+
+  uint32_t *ids = xmalloc(kv_size(batch) * sizeof(*ids));
+  extmark_set_many(buf, (uint32_t)ns_id, batch.items, kv_size(batch), ids);
+  Array rv = arena_array(arena, kv_size(batch));
+  for (size_t i = 0; i < kv_size(batch); i++) {
+    ADD_C(rv, INTEGER_OBJ(ids[i]));
+  }
+  xfree(ids);
+  kv_destroy(batch);
+  return rv;
+
+error:
+  for (size_t i = 0; i < kv_size(batch); i++) {
+    decor_free(kv_A(batch, i).decor);
+  }
+  kv_destroy(batch);
+  return (Array)ARRAY_DICT_INIT;
+}
+
+/// Implementation of nvim_buf_set_extmark(). With a non-NULL "batch" the mark
+/// is only checked and added to "batch", for extmark_set_many().
+static Integer set_extmark(buf_T *buf, Integer ns_id, Integer line, Integer col,
+                           Dict(set_extmark) *opts, ExtmarkPutArray *batch, Error *err)
 {
   DecorHighlightInline hl = DECOR_HIGHLIGHT_INLINE_INIT;
   // TODO(bfredl): in principle signs with max one (1) hl group and max 4 bytes of text.
@@ -541,11 +641,6 @@ Integer nvim_buf_set_extmark(Buffer buffer, Integer ns_id, Integer line, Integer
   bool has_hl = false;
   bool has_hl_multiple = false;
 
-  buf_T *buf = find_buffer_by_handle(buffer, err);
-  if (!buf) {
-    goto error;
-  }
-
   VALIDATE_INT(ns_initialized((uint32_t)ns_id), "ns_id", ns_id, {
     goto error;
   });
@@ -929,6 +1024,22 @@ Integer nvim_buf_set_extmark(Buffer buffer, Integer ns_id, Integer line, Integer
       decor_flags |= MT_FLAG_DECOR_HL;
     }
 
+    if (batch != NULL) {
+      kv_push(*batch, ((ExtmarkPut){
+        .row = (int)line,
+        .col = (colnr_T)col,
+        .end_row = line2,
+        .end_col = col2,
+        .decor = decor,
+        .decor_flags = decor_flags,
+        .right_gravity = right_gravity,
+        .end_right_gravity = opts->end_right_gravity,
+        .no_undo = !GET_BOOL_OR_TRUE(opts, set_extmark, undo_restore),
+        .invalidate = opts->invalidate,
+      }));
+      return 0;
+    }
+
     extmark_set(buf, (uint32_t)ns_id, &id, (int)line, (colnr_T)col, line2, col2,
                 decor, decor_flags, right_gravity, opts->end_right_gravity,
                 !GET_BOOL_OR_TRUE(opts, set_extmark, undo_restore),
@@ -20,6 +20,8 @@ struct MsgpackRpcRequestHandler {
               ///< be put in the event queue, for safe handling later.
   bool ret_alloc;  ///< return value is allocated and should be freed using api_free_object
                    ///< otherwise it uses arena and/or static memory
+  bool readonly;  ///< Function does not change any state.  Consecutive calls can be
+                  ///< handled together, see "pipeline" in |nvim_set_client_info()|.
 };
 
 extern const MsgpackRpcRequestHandler method_handlers[];
@@ -1,5 +1,6 @@
 #include <assert.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -22,7 +23,11 @@
 #include "nvim/event/defs.h"
 #include "nvim/event/loop.h"
 #include "nvim/event/multiqueue.h"
+#include "nvim/event/time.h"
 #include "nvim/event/wstream.h"
+#ifndef MSWIN
+# include "nvim/event/shm_unix.h"
+#endif
 #include "nvim/globals.h"
 #include "nvim/grid.h"
 #include "nvim/highlight.h"
@@ -37,11 +42,41 @@
 #include "nvim/msgpack_rpc/packer.h"
 #include "nvim/msgpack_rpc/packer_defs.h"
 #include "nvim/option.h"
+#include "nvim/os/time.h"
 #include "nvim/types_defs.h"
 #include "nvim/ui.h"
 
 #define BUF_POS(ui) ((size_t)((ui)->packer.ptr - (ui)->packer.startptr))
 
+/// Kinds of operations in a "grid_line_bin" event, see |ui-binary-grid|.
+enum {
+  kBinOpSkip = 0,
+  kBinOpAttr = 1,
+  kBinOpCells = 2,
+  kBinOpRepeat = 3,
+};
+/// Room needed for any operation with its text.
+#define BIN_OP_MAX_SIZE (2 * 5 + 1 + MAX_SCHAR_SIZE)
+/// Maximum count of a kBinOpCells operation, which uses a two byte header.
+#define BIN_CELLS_MAX ((1 << 12) - 1)
+
+/// The cells an ext_binary_grid client has in a grid.  An attr of -1 means
+/// that the cell is not known.
+typedef struct {
+  int rows, cols;
+  schar_T *chars;
+  sattr_T *attrs;
+  bool *wrap;
+} BinaryGrid;
+
+/// State of a "grid_line_bin" event being packed.
+typedef struct {
+  char *lenpos;  ///< position of the bin32 header of the data
+  char *cells_pos;  ///< header of the open kBinOpCells operation, or NULL
+  uint32_t ncells;  ///< number of cells in that operation
+  sattr_T attr;  ///< attr of the next cells
+} BinaryLine;
+
 #include "api/ui.c.generated.h"
 #include "ui_events_remote.generated.h"  // IWYU pragma: export
 
@@ -77,7 +112,25 @@ static void mpack_str_small(char **buf, const char *str, size_t len)
 static void remote_ui_destroy(RemoteUI *ui)
   FUNC_ATTR_NONNULL_ALL
 {
-  xfree(ui->packer.startptr);
+  if (!ui->packer_in_shm) {
+    xfree(ui->packer.startptr);
+  }
+  BinaryGrid *bgrid;
+  map_foreach_value(&ui->binary_grids, bgrid, {
+    binary_grid_free(bgrid);
+  });
+  map_destroy(int, &ui->binary_grids);
+#ifndef MSWIN
+  if (ui->shm) {
+    shm_stream_close(ui->shm);
+  }
+#endif
+  if (ui->frame_timer) {
+    time_watcher_stop(ui->frame_timer);
+    // A timer event which is already queued must not use "ui".
+    ui->frame_timer->data = NULL;
+    time_watcher_close(ui->frame_timer, frame_timer_close_cb);
+  }
   XFREE_CLEAR(ui->term_name);
   xfree(ui);
 }
@@ -119,6 +172,26 @@ void remote_ui_free_all_mem(void)
 }
 #endif
 
+/// Moves the glyphs of the cells that ext_binary_grid clients have to the
+/// new generation of the glyph cache, see schar_cache_evict_start().
+void remote_ui_keep_glyphs(void)
+{
+  RemoteUI *ui;
+  map_foreach_value(&connected_uis, ui, {
+    binary_grids_keep_glyphs(ui, true);
+  });
+}
+
+/// Forgets the cells that ext_binary_grid clients have after the glyph cache
+/// was cleared, their glyphs may come back for other text.
+void remote_ui_forget_glyphs(void)
+{
+  RemoteUI *ui;
+  map_foreach_value(&connected_uis, ui, {
+    binary_grids_keep_glyphs(ui, false);
+  });
+}
+
 /// Wait until UI has connected.
 ///
 /// @param only_stdio UI is expected to connect on stdio.
@@ -180,12 +253,17 @@ void nvim_ui_attach(uint64_t channel_id, Integer width, Integer height, Dict opt
   for (size_t i = 0; i < options.size; i++) {
     ui_set_option(ui, true, options.items[i].key, options.items[i].value, err);
     if (ERROR_SET(err)) {
+#ifndef MSWIN
+      if (ui->shm) {
+        shm_stream_close(ui->shm);
+      }
+#endif
       xfree(ui);
       return;
     }
   }
 
-  if (ui->ui_ext[kUIHlState] || ui->ui_ext[kUIMultigrid]) {
+  if (ui->ui_ext[kUIHlState] || ui->ui_ext[kUIMultigrid] || ui->ui_ext[kUIBinaryGrid]) {
     ui->ui_ext[kUILinegrid] = true;
   }
 
@@ -423,6 +501,57 @@ static void ui_set_option(RemoteUI *ui, bool init, String name, Object value, Er
     return;
   }
 
+  if (strequal(name.data, "shm")) {
+    VALIDATE_T("shm", kObjectTypeArray, value.type, {
+      return;
+    });
+    Array fds = value.data.array;
+    VALIDATE((fds.size == 3), "%s", "shm must be [fd, doorbell_fd, wakeup_fd]", {
+      return;
+    });
+    for (size_t i = 0; i < 3; i++) {
+      VALIDATE_T("shm fd", kObjectTypeInteger, fds.items[i].type, {
+        return;
+      });
+      VALIDATE_INT((fds.items[i].data.integer >= 0 && fds.items[i].data.integer <= INT_MAX),
+                   "shm fd", fds.items[i].data.integer, {
+        return;
+      });
+    }
+    VALIDATE((init && !ui->shm), "%s", "shm can only be set by nvim_ui_attach", {
+      return;
+    });
+#ifdef MSWIN
+    api_set_error(err, kErrorTypeValidation, "shm is not supported on this system");
+#else
+    const char *errmsg = NULL;
+    ui->shm = shm_stream_open(&main_loop, (int)fds.items[0].data.integer,
+                              (int)fds.items[1].data.integer, (int)fds.items[2].data.integer,
+                              &errmsg);
+    if (!ui->shm) {
+      api_set_error(err, kErrorTypeValidation, "%s", errmsg);
+    }
+#endif
+    return;
+  }
+
+  if (strequal(name.data, "frame_interval")) {
+    VALIDATE_T("frame_interval", kObjectTypeInteger, value.type, {
+      return;
+    });
+    VALIDATE_INT((value.data.integer >= 0 && value.data.integer <= 1000), "frame_interval",
+                 value.data.integer, {
+      return;
+    });
+    ui->frame_interval = value.data.integer;
+    if (ui->frame_interval == 0 && ui->frame_pending) {
+      time_watcher_stop(ui->frame_timer);
+      ui->frame_pending = false;
+      remote_ui_flush(ui);
+    }
+    return;
+  }
+
   if (strequal(name.data, "stdin_tty")) {
     VALIDATE_T("stdin_tty", kObjectTypeBoolean, value.type, {
       return;
@@ -456,10 +585,10 @@ static void ui_set_option(RemoteUI *ui, bool init, String name, Object value, Er
         return;
       });
       bool boolval = value.data.boolean;
-      if (!init && i == kUILinegrid && boolval != ui->ui_ext[i]) {
+      if (!init && (i == kUILinegrid || i == kUIBinaryGrid) && boolval != ui->ui_ext[i]) {
         // There shouldn't be a reason for a UI to do this ever
         // so explicitly don't support this.
-        api_set_error(err, kErrorTypeValidation, "ext_linegrid option cannot be changed");
+        api_set_error(err, kErrorTypeValidation, "%s option cannot be changed", ui_ext_names[i]);
       }
       ui->ui_ext[i] = boolval;
       if (!init) {
@@ -583,7 +712,15 @@ static void flush_event(RemoteUI *ui)
 
 static void ui_alloc_buf(RemoteUI *ui)
 {
-  ui->packer.startptr = alloc_block();
+  char *ring = NULL;
+#ifndef MSWIN
+  // Pack directly into the shared memory when there is room.
+  if (ui->shm) {
+    ring = shm_stream_reserve(ui->shm, UI_BUF_SIZE);
+  }
+#endif
+  ui->packer_in_shm = ring != NULL;
+  ui->packer.startptr = ring ? ring : alloc_block();
   ui->packer.ptr = ui->packer.startptr;
   ui->packer.endptr = ui->packer.startptr + UI_BUF_SIZE;
 }
@@ -640,6 +777,9 @@ static void ui_flush_callback(PackerBuffer *packer)
 
 void remote_ui_grid_clear(RemoteUI *ui, Integer grid)
 {
+  if (ui->ui_ext[kUIBinaryGrid]) {
+    binary_grid_clear(ui, (int)grid);
+  }
   MAXSIZE_TEMP_ARRAY(args, 1);
   if (ui->ui_ext[kUILinegrid]) {
     ADD_C(args, INTEGER_OBJ(grid));
@@ -650,6 +790,9 @@ void remote_ui_grid_clear(RemoteUI *ui, Integer grid)
 
 void remote_ui_grid_resize(RemoteUI *ui, Integer grid, Integer width, Integer height)
 {
+  if (ui->ui_ext[kUIBinaryGrid]) {
+    binary_grid_resize(ui, (int)grid, (int)width, (int)height);
+  }
   MAXSIZE_TEMP_ARRAY(args, 3);
   if (ui->ui_ext[kUILinegrid]) {
     ADD_C(args, INTEGER_OBJ(grid));
@@ -665,6 +808,9 @@ void remote_ui_grid_resize(RemoteUI *ui, Integer grid, Integer width, Integer he
 void remote_ui_grid_scroll(RemoteUI *ui, Integer grid, Integer top, Integer bot, Integer left,
                            Integer right, Integer rows, Integer cols)
 {
+  if (ui->ui_ext[kUIBinaryGrid]) {
+    binary_grid_scroll(ui, (int)grid, (int)top, (int)bot, (int)left, (int)right, (int)rows);
+  }
   if (ui->ui_ext[kUILinegrid]) {
     MAXSIZE_TEMP_ARRAY(args, 7);
     ADD_C(args, INTEGER_OBJ(grid));
@@ -820,7 +966,9 @@ void remote_ui_raw_line(RemoteUI *ui, Integer grid, Integer row, Integer startco
   // to not only use FIXSTR (only up to 0x20 bytes)
   STATIC_ASSERT(MAX_SCHAR_SIZE - 1 < 0x20, "SCHAR doesn't fit in fixstr");
 
-  if (ui->ui_ext[kUILinegrid]) {
+  if (ui->ui_ext[kUIBinaryGrid]) {
+    binary_line(ui, grid, row, startcol, endcol, clearcol, clearattr, flags, chunk, attrs);
+  } else if (ui->ui_ext[kUILinegrid]) {
     prepare_call(ui, "grid_line");
 
     char **buf = &ui->packer.ptr;
@@ -929,6 +1077,260 @@ void remote_ui_raw_line(RemoteUI *ui, Integer grid, Integer row, Integer startco
   }
 }
 
+static void binary_grid_free(BinaryGrid *bgrid)
+{
+  xfree(bgrid->chars);
+  xfree(bgrid->attrs);
+  xfree(bgrid->wrap);
+  xfree(bgrid);
+}
+
+/// Forgets what the client has in "count" cells from "off".
+static void binary_grid_invalidate(BinaryGrid *bgrid, size_t off, size_t count)
+{
+  for (size_t i = 0; i < count; i++) {
+    bgrid->attrs[off + i] = -1;
+  }
+}
+
+/// Moves the glyphs in the binary grids of "ui" to the new generation of the
+/// glyph cache when "keep" is true, forgets all their cells otherwise.
+static void binary_grids_keep_glyphs(RemoteUI *ui, bool keep)
+{
+  BinaryGrid *bgrid;
+  map_foreach_value(&ui->binary_grids, bgrid, {
+    size_t ncells = (size_t)bgrid->rows * (size_t)bgrid->cols;
+    if (keep) {
+      schar_cache_keep_buf(bgrid->chars, ncells);
+    } else {
+      binary_grid_invalidate(bgrid, 0, ncells);
+    }
+  });
+}
+
+static void binary_grid_resize(RemoteUI *ui, int handle, int width, int height)
+{
+  BinaryGrid *bgrid = pmap_get(int)(&ui->binary_grids, handle);
+  if (!bgrid) {
+    bgrid = xcalloc(1, sizeof(BinaryGrid));
+    pmap_put(int)(&ui->binary_grids, handle, bgrid);
+  }
+  // The client may or may not keep the old contents.
+  size_t ncells = (size_t)width * (size_t)height;
+  bgrid->rows = height;
+  bgrid->cols = width;
+  bgrid->chars = xrealloc(bgrid->chars, MAX(ncells, 1) * sizeof(schar_T));
+  bgrid->attrs = xrealloc(bgrid->attrs, MAX(ncells, 1) * sizeof(sattr_T));
+  bgrid->wrap = xrealloc(bgrid->wrap, MAX((size_t)height, 1) * sizeof(bool));
+  binary_grid_invalidate(bgrid, 0, ncells);
+  memset(bgrid->wrap, 0, (size_t)height * sizeof(bool));
+}
+
+static void binary_grid_clear(RemoteUI *ui, int handle)
+{
+  BinaryGrid *bgrid = pmap_get(int)(&ui->binary_grids, handle);
+  if (!bgrid) {
+    return;
+  }
+  size_t ncells = (size_t)bgrid->cols * (size_t)bgrid->rows;
+  for (size_t i = 0; i < ncells; i++) {
+    bgrid->chars[i] = schar_from_ascii(' ');
+    bgrid->attrs[i] = 0;
+  }
+  memset(bgrid->wrap, 0, (size_t)bgrid->rows * sizeof(bool));
+}
+
+/// Moves the cells like the client does for "grid_scroll".  The rows which
+/// are scrolled into the region have undefined contents.
+static void binary_grid_scroll(RemoteUI *ui, int handle, int top, int bot, int left, int right,
+                               int rows)
+{
+  BinaryGrid *bgrid = pmap_get(int)(&ui->binary_grids, handle);
+  if (!bgrid) {
+    return;
+  }
+  if (top < 0 || bot > bgrid->rows || left < 0 || right > bgrid->cols || left >= right) {
+    binary_grid_invalidate(bgrid, 0, (size_t)bgrid->rows * (size_t)bgrid->cols);
+    return;
+  }
+  size_t width = (size_t)(right - left);
+  bool full_width = right == bgrid->cols;
+  int count = MIN(abs(rows), bot - top);
+  int step = rows > 0 ? 1 : -1;
+  int first = rows > 0 ? top : bot - 1;
+  for (int i = 0; i < bot - top - count; i++) {
+    int dst = first + i * step;
+    int src = dst + rows;
+    size_t doff = (size_t)dst * (size_t)bgrid->cols + (size_t)left;
+    size_t soff = (size_t)src * (size_t)bgrid->cols + (size_t)left;
+    memmove(bgrid->chars + doff, bgrid->chars + soff, width * sizeof(schar_T));
+    memmove(bgrid->attrs + doff, bgrid->attrs + soff, width * sizeof(sattr_T));
+    if (full_width) {
+      bgrid->wrap[dst] = bgrid->wrap[src];
+    }
+  }
+  int vacated = rows > 0 ? bot - count : top;
+  for (int i = 0; i < count; i++) {
+    size_t off = (size_t)(vacated + i) * (size_t)bgrid->cols + (size_t)left;
+    binary_grid_invalidate(bgrid, off, width);
+  }
+}
+
+static void binary_varint(char **buf, uint32_t val)
+{
+  while (val >= 0x80) {
+    mpack_w(buf, 0x80 | (val & 0x7f));
+    val >>= 7;
+  }
+  mpack_w(buf, val);
+}
+
+/// Packs the text of a cell: an ASCII character as itself, anything else as
+/// 0x80 plus the length, followed by the bytes.
+static void binary_text(char **buf, schar_T sc)
+{
+  char *size_byte = (*buf)++;
+  size_t len = schar_get_adv(buf, sc);
+  if (len == 1 && (uint8_t)size_byte[1] < 0x80) {
+    size_byte[0] = size_byte[1];
+    (*buf)--;
+  } else {
+    *size_byte = (char)(0x80 | len);
+  }
+}
+
+static void binary_close_cells(BinaryLine *line)
+{
+  if (line->cells_pos) {
+    // A two byte varint, also when a single byte would do.
+    uint32_t val = (line->ncells << 2) | kBinOpCells;
+    line->cells_pos[0] = (char)(0x80 | (val & 0x7f));
+    line->cells_pos[1] = (char)(val >> 7);
+    line->cells_pos = NULL;
+  }
+}
+
+static void binary_line_start(RemoteUI *ui, BinaryLine *line, Integer grid, Integer row,
+                              Integer col)
+{
+  prepare_call(ui, "grid_line_bin");
+  char **buf = &ui->packer.ptr;
+  mpack_array(buf, 5);
+  mpack_uint(buf, (uint32_t)grid);
+  mpack_uint(buf, (uint32_t)row);
+  mpack_uint(buf, (uint32_t)col);
+  line->lenpos = *buf;
+  mpack_w(buf, 0xc6);
+  *buf += 4;
+  line->cells_pos = NULL;
+  line->ncells = 0;
+  line->attr = 0;
+}
+
+static void binary_line_finish(RemoteUI *ui, BinaryLine *line, bool wrap)
+{
+  binary_close_cells(line);
+  char *pos = line->lenpos + 1;
+  mpack_w4(&pos, (uint32_t)(ui->packer.ptr - (line->lenpos + 5)));
+  mpack_bool(&ui->packer.ptr, wrap);
+}
+
+/// Packs a "grid_line_bin" event with the cells which differ from what the
+/// client has, see |ui-binary-grid|.  Nothing is sent when the line did not
+/// change.
+static void binary_line(RemoteUI *ui, Integer grid, Integer row, Integer startcol, Integer endcol,
+                        Integer clearcol, Integer clearattr, LineFlags flags, const schar_T *chunk,
+                        const sattr_T *attrs)
+{
+  BinaryGrid *bgrid = pmap_get(int)(&ui->binary_grids, (int)grid);
+  if (bgrid && (row >= bgrid->rows || clearcol > bgrid->cols)) {
+    bgrid = NULL;
+  }
+  schar_T *old_chars = bgrid ? bgrid->chars + row * bgrid->cols : NULL;
+  sattr_T *old_attrs = bgrid ? bgrid->attrs + row * bgrid->cols : NULL;
+  bool wrap = flags & kLineFlagWrap;
+  const schar_T space = schar_from_ascii(' ');
+
+  BinaryLine line = { 0 };
+  bool started = false;
+  uint32_t skip = 0;
+#define CELL_CHAR(c) ((c) < endcol ? chunk[(c) - startcol] : space)
+#define CELL_ATTR(c) ((c) < endcol ? attrs[(c) - startcol] : (sattr_T)clearattr)
+  for (Integer col = startcol; col < clearcol;) {
+    schar_T sc = CELL_CHAR(col);
+    sattr_T attr = CELL_ATTR(col);
+    if (old_attrs && old_chars[col] == sc && old_attrs[col] == attr) {
+      skip++;
+      col++;
+      continue;
+    }
+
+    if (!started || UI_BUF_SIZE - BUF_POS(ui) < 2 * BIN_OP_MAX_SIZE + 1
+        || ui->ncells_pending >= 500) {
+      if (started) {
+        binary_line_finish(ui, &line, false);
+        ui_flush_buf(ui, false);
+      }
+      binary_line_start(ui, &line, grid, row, col);
+      started = true;
+      skip = 0;
+    }
+
+    char **buf = &ui->packer.ptr;
+    if (skip) {
+      binary_close_cells(&line);
+      binary_varint(buf, (skip << 2) | kBinOpSkip);
+      skip = 0;
+    }
+    if (attr != line.attr) {
+      binary_close_cells(&line);
+      binary_varint(buf, ((uint32_t)attr << 2) | kBinOpAttr);
+      line.attr = attr;
+    }
+
+    Integer n = 1;
+    while (col + n < clearcol && CELL_CHAR(col + n) == sc && CELL_ATTR(col + n) == attr) {
+      n++;
+    }
+    if (n >= 3) {
+      binary_close_cells(&line);
+      binary_varint(buf, ((uint32_t)n << 2) | kBinOpRepeat);
+    } else {
+      n = 1;
+      if (!line.cells_pos || line.ncells == BIN_CELLS_MAX) {
+        binary_close_cells(&line);
+        line.cells_pos = *buf;
+        *buf += 2;
+        line.ncells = 0;
+      }
+      line.ncells++;
+    }
+    binary_text(buf, sc);
+
+    if (old_attrs) {
+      for (Integer i = col; i < col + n; i++) {
+        old_chars[i] = sc;
+        old_attrs[i] = attr;
+      }
+    }
+    ui->ncells_pending += (size_t)MIN(n, 2);
+    col += n;
+  }
+#undef CELL_CHAR
+#undef CELL_ATTR
+
+  if (!started) {
+    if (bgrid && bgrid->wrap[row] == wrap) {
+      return;  // the client is up to date
+    }
+    binary_line_start(ui, &line, grid, row, startcol);
+  }
+  binary_line_finish(ui, &line, wrap);
+  if (bgrid) {
+    bgrid->wrap[row] = wrap;
+  }
+}
+
 /// Flush the internal packing buffer to the client.
 ///
 /// This might happen multiple times before the actual ui_flush, if the
@@ -947,8 +1349,24 @@ static void ui_flush_buf(RemoteUI *ui, bool incomplete_event)
     ui->nevents_pos = NULL;
   }
 
-  WBuffer *buf = wstream_new_buffer(ui->packer.startptr, BUF_POS(ui), 1, free_block);
-  rpc_write_raw(ui->channel_id, buf);
+  ui->frame_stats.bytes += BUF_POS(ui);
+  if (ui->packer_in_shm) {
+#ifndef MSWIN
+    shm_stream_commit(ui->shm, BUF_POS(ui));
+#endif
+    ui->packer_in_shm = false;
+  } else {
+    WBuffer *buf = wstream_new_buffer(ui->packer.startptr, BUF_POS(ui), 1, free_block);
+#ifndef MSWIN
+    if (ui->shm) {
+      shm_stream_write(ui->shm, buf);
+      buf = NULL;
+    }
+#endif
+    if (buf) {
+      rpc_write_raw(ui->channel_id, buf);
+    }
+  }
 
   ui->packer.startptr = NULL;
   ui->packer.ptr = NULL;
@@ -965,13 +1383,89 @@ static void ui_flush_buf(RemoteUI *ui, bool incomplete_event)
 void remote_ui_flush(RemoteUI *ui)
 {
   if (ui->nevents > 0 || ui->flushed_events) {
+    if (ui->frame_interval > 0 && frame_defer(ui)) {
+      return;
+    }
     if (!ui->ui_ext[kUILinegrid]) {
       remote_ui_cursor_goto(ui, ui->cursor_row, ui->cursor_col);
     }
     push_call(ui, "flush", (Array)ARRAY_DICT_INIT);
     ui_flush_buf(ui, false);
     ui->flushed_events = false;
+    ui->last_frame = os_hrtime();
+    ui->frame_stats.frames++;
+  }
+}
+
+/// @return  bytes sent to "ui" which the client did not read yet.
+static size_t ui_backlog(RemoteUI *ui)
+{
+#ifndef MSWIN
+  if (ui->shm) {
+    return shm_stream_backlog(ui->shm);
+  }
+#endif
+  Channel *chan = find_channel(ui->channel_id);
+  if (!chan || chan->streamtype == kChannelStreamInternal
+      || chan->streamtype == kChannelStreamStderr) {
+    return 0;
   }
+  return wstream_backlog(channel_instream(chan));
+}
+
+/// Decides whether the "flush" event of a UI with "frame_interval" has to
+/// wait, because the last frame was sent less than "frame_interval" ago or
+/// the client did not read it yet.  Then the events stay in the buffer (it is
+/// still sent when full), and the timer sends the "flush" event later, so
+/// that all the redraws in between make up a single frame.
+///
+/// @return  true if the "flush" event was deferred.
+static bool frame_defer(RemoteUI *ui)
+{
+  if (ui->frame_pending) {
+    ui->frame_stats.coalesced++;
+    return true;
+  }
+
+  uint64_t interval = (uint64_t)ui->frame_interval * 1000000;
+  uint64_t elapsed = os_hrtime() - ui->last_frame;
+  size_t backlog = ui_backlog(ui);
+  ui->frame_stats.max_backlog = MAX(ui->frame_stats.max_backlog, backlog);
+  uint64_t wait;
+  if (backlog > 0) {
+    ui->frame_stats.backlog_waits++;
+    wait = interval;
+  } else if (elapsed < interval) {
+    wait = interval - elapsed;
+  } else {
+    return false;
+  }
+
+  if (!ui->frame_timer) {
+    ui->frame_timer = xmalloc(sizeof(TimeWatcher));
+    time_watcher_init(&main_loop, ui->frame_timer, ui);
+    // Not a fast event: the frame must not be finished in the middle of a redraw.
+    ui->frame_timer->events = main_loop.events;
+  }
+  ui->frame_pending = true;
+  ui->frame_stats.coalesced++;
+  time_watcher_start(ui->frame_timer, frame_timer_cb, MAX(wait / 1000000, 1), 0);
+  return true;
+}
+
+static void frame_timer_cb(TimeWatcher *watcher, void *data)
+{
+  RemoteUI *ui = data;
+  if (!ui || !ui->frame_pending) {
+    return;
+  }
+  ui->frame_pending = false;
+  remote_ui_flush(ui);
+}
+
+static void frame_timer_close_cb(TimeWatcher *watcher, void *data)
+{
+  xfree(watcher);
 }
 
 void remote_ui_ui_send(RemoteUI *ui, String content)
@@ -1025,6 +1519,12 @@ static Array translate_firstarg(RemoteUI *ui, Array args, Arena *arena)
 void remote_ui_event(RemoteUI *ui, char *name, Array args)
 {
   Arena arena = ARENA_EMPTY;
+  if (ui->ui_ext[kUIBinaryGrid] && strequal(name, "grid_destroy")) {
+    BinaryGrid *bgrid = pmap_del(int)(&ui->binary_grids, (int)args.items[0].data.integer, NULL);
+    if (bgrid) {
+      binary_grid_free(bgrid);
+    }
+  }
   if (!ui->ui_ext[kUILinegrid]) {
     // the representation of highlights in cmdline changed, translate back
     // never consumes args
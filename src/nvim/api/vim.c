@@ -657,7 +657,7 @@ void nvim_set_current_dir(String dir, Error *err)
 /// @param[out] err Error details, if any
 /// @return Current line string
 String nvim_get_current_line(Arena *arena, Error *err)
-  FUNC_API_SINCE(1)
+  FUNC_API_SINCE(1) FUNC_API_READONLY
 {
   return buffer_get_line(curbuf->handle, curwin->w_cursor.lnum - 1, arena, err);
 }
@@ -732,7 +732,7 @@ void nvim_del_var(String name, Error *err)
 /// @param[out] err Error details, if any
 /// @return         Variable value
 Object nvim_get_vvar(String name, Arena *arena, Error *err)
-  FUNC_API_SINCE(1)
+  FUNC_API_SINCE(1) FUNC_API_READONLY
 {
   return dict_get_value(get_vimvar_dict(), name, arena, err);
 }
@@ -850,7 +850,7 @@ error:
 ///
 /// @return List of buffer ids
 ArrayOf(Buffer) nvim_list_bufs(Arena *arena)
-  FUNC_API_SINCE(1)
+  FUNC_API_SINCE(1) FUNC_API_READONLY
 {
   size_t n = 0;
 
@@ -871,7 +871,7 @@ ArrayOf(Buffer) nvim_list_bufs(Arena *arena)
 ///
 /// @return Buffer id
 Buffer nvim_get_current_buf(void)
-  FUNC_API_SINCE(1)
+  FUNC_API_SINCE(1) FUNC_API_READONLY
 {
   return curbuf->handle;
 }
@@ -899,7 +899,7 @@ void nvim_set_current_buf(Buffer buffer, Error *err)
 ///
 /// @return List of |window-ID|s
 ArrayOf(Window) nvim_list_wins(Arena *arena)
-  FUNC_API_SINCE(1)
+  FUNC_API_SINCE(1) FUNC_API_READONLY
 {
   size_t n = 0;
 
@@ -920,7 +920,7 @@ ArrayOf(Window) nvim_list_wins(Arena *arena)
 ///
 /// @return |window-ID|
 Window nvim_get_current_win(void)
-  FUNC_API_SINCE(1)
+  FUNC_API_SINCE(1) FUNC_API_READONLY
 {
   return curwin->handle;
 }
@@ -1175,7 +1175,7 @@ void nvim_chan_send(Integer chan, String data, Error *err)
 ///
 /// @return List of |tab-ID|s
 ArrayOf(Tabpage) nvim_list_tabpages(Arena *arena)
-  FUNC_API_SINCE(1)
+  FUNC_API_SINCE(1) FUNC_API_READONLY
 {
   size_t n = 0;
 
@@ -1196,7 +1196,7 @@ ArrayOf(Tabpage) nvim_list_tabpages(Arena *arena)
 ///
 /// @return |tab-ID|
 Tabpage nvim_get_current_tabpage(void)
-  FUNC_API_SINCE(1)
+  FUNC_API_SINCE(1) FUNC_API_READONLY
 {
   return curtab->handle;
 }
@@ -1599,6 +1599,10 @@ ArrayOf(Object, 2) nvim_get_api_info(uint64_t channel_id, Arena *arena)
 ///     - "license": License description ("Apache 2", "GPLv3", "MIT", …)
 ///     - "logo":    URI or path to image, preferably small logo or icon.
 ///                  .png or .svg format is preferred.
+///     - "pipeline": "readonly" handles consecutive requests which only get
+///                  information, like |nvim_buf_get_lines()|, together,
+///                  without checking for input in between, and writes
+///                  their responses together.
 ///
 /// @param[out] err Error details, if any
 void nvim_set_client_info(uint64_t channel_id, String name, Dict version, String type, Dict methods,
@@ -1740,13 +1744,20 @@ Float nvim__id_float(Float flt)
 /// @return Map of various internal stats.
 Dict nvim__stats(Arena *arena)
 {
-  Dict rv = arena_dict(arena, 6);
+  Dict rv = arena_dict(arena, 13);
   PUT_C(rv, "fsync", INTEGER_OBJ(g_stats.fsync));
   PUT_C(rv, "log_skip", INTEGER_OBJ(g_stats.log_skip));
   PUT_C(rv, "lua_refcount", INTEGER_OBJ(nlua_get_global_ref_count()));
+  PUT_C(rv, "memfile_compressed", INTEGER_OBJ(g_stats.mf_compressed));
+  PUT_C(rv, "memfile_compressed_raw", INTEGER_OBJ(g_stats.mf_compressed_raw));
   PUT_C(rv, "redraw", INTEGER_OBJ(g_stats.redraw));
   PUT_C(rv, "arena_alloc_count", INTEGER_OBJ((Integer)arena_alloc_count));
   PUT_C(rv, "ts_query_parse_count", INTEGER_OBJ((Integer)tslua_query_parse_count));
+  PUT_C(rv, "glyph_cache_hits", INTEGER_OBJ(g_stats.glyph_cache_hits));
+  PUT_C(rv, "glyph_cache_misses", INTEGER_OBJ(g_stats.glyph_cache_misses));
+  PUT_C(rv, "glyph_cache_evictions", INTEGER_OBJ(g_stats.glyph_cache_evictions));
+  PUT_C(rv, "glyph_cache_evicted", INTEGER_OBJ(g_stats.glyph_cache_evicted));
+  PUT_C(rv, "glyph_cache_size", INTEGER_OBJ((Integer)schar_cache_size()));
   return rv;
 }
 
@@ -1915,7 +1926,7 @@ void nvim__screenshot(String path)
   ui_call_screenshot(path);
 }
 
-/// For testing. The condition in schar_cache_clear_if_full is hard to
+/// For testing. The condition in schar_cache_evict_if_full is hard to
 /// reach, so this function can be used to force a cache clear in a test.
 void nvim__invalidate_glyph_cache(void)
 {
@@ -1923,6 +1934,15 @@ void nvim__invalidate_glyph_cache(void)
   must_redraw = UPD_CLEAR;
 }
 
+/// For testing. Evicts the glyphs not shown anymore from the cache, like when
+/// it is full.
+void nvim__evict_glyph_cache(void)
+{
+  if (schar_cache_evict()) {
+    must_redraw = UPD_CLEAR;
+  }
+}
+
 /// @nodoc
 Object nvim__unpack(String str, Arena *arena, Error *err)
   FUNC_API_FAST
@@ -34,7 +34,7 @@
 /// @param[out] err Error details, if any
 /// @return Buffer id
 Buffer nvim_win_get_buf(Window window, Error *err)
-  FUNC_API_SINCE(1)
+  FUNC_API_SINCE(1) FUNC_API_READONLY
 {
   win_T *win = find_window_by_handle(window, err);
 
@@ -77,7 +77,7 @@ void nvim_win_set_buf(Window window, Buffer buffer, Error *err)
 /// @param[out] err Error details, if any
 /// @return (row, col) tuple
 ArrayOf(Integer, 2) nvim_win_get_cursor(Window window, Arena *arena, Error *err)
-  FUNC_API_SINCE(1)
+  FUNC_API_SINCE(1) FUNC_API_READONLY
 {
   Array rv = ARRAY_DICT_INIT;
   win_T *win = find_window_by_handle(window, err);
@@ -154,7 +154,7 @@ void nvim_win_set_cursor(Window window, ArrayOf(Integer, 2) pos, Error *err)
 /// @param[out] err Error details, if any
 /// @return Height as a count of rows
 Integer nvim_win_get_height(Window window, Error *err)
-  FUNC_API_SINCE(1)
+  FUNC_API_SINCE(1) FUNC_API_READONLY
 {
   win_T *win = find_window_by_handle(window, err);
 
@@ -190,7 +190,7 @@ void nvim_win_set_height(Window window, Integer height, Error *err)
 /// @param[out] err Error details, if any
 /// @return Width as a count of columns
 Integer nvim_win_get_width(Window window, Error *err)
-  FUNC_API_SINCE(1)
+  FUNC_API_SINCE(1) FUNC_API_READONLY
 {
   win_T *win = find_window_by_handle(window, err);
 
@@ -228,7 +228,7 @@ void nvim_win_set_width(Window window, Integer width, Error *err)
 /// @param[out] err Error details, if any
 /// @return Variable value
 Object nvim_win_get_var(Window window, String name, Arena *arena, Error *err)
-  FUNC_API_SINCE(1)
+  FUNC_API_SINCE(1) FUNC_API_READONLY
 {
   win_T *win = find_window_by_handle(window, err);
 
@@ -280,7 +280,7 @@ void nvim_win_del_var(Window window, String name, Error *err)
 /// @param[out] err Error details, if any
 /// @return (row, col) tuple with the window position
 ArrayOf(Integer, 2) nvim_win_get_position(Window window, Arena *arena, Error *err)
-  FUNC_API_SINCE(1)
+  FUNC_API_SINCE(1) FUNC_API_READONLY
 {
   Array rv = ARRAY_DICT_INIT;
   win_T *win = find_window_by_handle(window, err);
@@ -300,7 +300,7 @@ ArrayOf(Integer, 2) nvim_win_get_position(Window window, Arena *arena, Error *er
 /// @param[out] err Error details, if any
 /// @return Tabpage that contains the window
 Tabpage nvim_win_get_tabpage(Window window, Error *err)
-  FUNC_API_SINCE(1)
+  FUNC_API_SINCE(1) FUNC_API_READONLY
 {
   Tabpage rv = 0;
   win_T *win = find_window_by_handle(window, err);
@@ -318,7 +318,7 @@ Tabpage nvim_win_get_tabpage(Window window, Error *err)
 /// @param[out] err Error details, if any
 /// @return Window number
 Integer nvim_win_get_number(Window window, Error *err)
-  FUNC_API_SINCE(1)
+  FUNC_API_SINCE(1) FUNC_API_READONLY
 {
   int rv = 0;
   win_T *win = find_window_by_handle(window, err);
@@ -338,7 +338,7 @@ Integer nvim_win_get_number(Window window, Error *err)
 /// @param window |window-ID|, or 0 for current window
 /// @return true if the window is valid, false otherwise
 Boolean nvim_win_is_valid(Window window)
-  FUNC_API_SINCE(1)
+  FUNC_API_SINCE(1) FUNC_API_READONLY
 {
   Error stub = ERROR_INIT;
   Boolean ret = find_window_by_handle(window, &stub) != NULL;
@@ -1251,6 +1251,11 @@ int buf_write(buf_T *buf, char *fname, char *sfname, linenr_T start, linenr_T en
 
   char *wfname = NULL;       // name of file to write to
 
+  // A buffer backed by a mapping of the file that is about to be truncated
+  // or overwritten must get its text into memory first.  This includes the
+  // written buffer itself when the file is not renamed for the backup.
+  ml_map_release_file(fname);
+
   // If the original file is being overwritten, there is a small chance that
   // we crash in the middle of writing. Therefore the file is preserved now.
   // This makes all block numbers positive so that recovery does not need
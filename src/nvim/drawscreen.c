@@ -479,12 +479,10 @@ int update_screen(void)
   display_tick++;  // let syntax code know we're in a next round of
                    // display updating
 
-  // glyph cache full, very rare
-  if (schar_cache_clear_if_full()) {
+  // glyph cache full, and evicting unused glyphs was not enough. Very rare.
+  if (schar_cache_evict_if_full()) {
     // must use CLEAR, as the contents of screen buffers cannot be
     // compared to their previous state here.
-    // TODO(bfredl): if start to cache schar_T values in places (like fcs/lcs)
-    // we need to revalidate these here as well!
     type = MAX(type, UPD_CLEAR);
   }
 
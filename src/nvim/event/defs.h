@@ -5,6 +5,7 @@
 #include <stdbool.h>
 #include <uv.h>
 
+#include "klib/kvec.h"
 #include "nvim/eval/typval_defs.h"
 #include "nvim/types_defs.h"
 
@@ -99,6 +100,9 @@ struct stream {
   stream_write_cb write_cb;
   size_t curmem;
   size_t maxmem;
+  bool coalesce;  ///< queue writes while one is in flight, see wstream_write()
+  bool writing;  ///< a write request is in flight
+  kvec_t(WBuffer *) queued;  ///< written together when the request completes
 };
 
 struct rstream {
@@ -117,6 +121,9 @@ struct rstream {
 
 #define ADDRESS_MAX_SIZE 256
 
+/// Shared memory ring for UI output, see shm_unix.c.
+typedef struct shm_stream ShmStream;
+
 typedef struct socket_watcher SocketWatcher;
 typedef void (*socket_cb)(SocketWatcher *watcher, int result, void *data);
 typedef void (*socket_close_cb)(SocketWatcher *watcher, void *data);
@@ -10,8 +10,96 @@
 #include "nvim/os/time.h"
 #include "nvim/types_defs.h"
 
+#ifdef _MSC_VER
+# include <intrin.h>
+#endif
+
 #include "event/loop.c.generated.h"
 
+enum { LOOP_RING_SIZE = 512, };  ///< must be a power of two
+/// Number of times loop_ring_get() spins on a cell before yielding the CPU.
+enum { LOOP_RING_SPINS = 64, };
+
+// Atomic operations for the ring, which are all sequentially consistent.
+#ifdef _MSC_VER
+static inline int64_t ring_load(int64_t *p)
+{
+  return _InterlockedCompareExchange64(p, 0, 0);
+}
+
+static inline void ring_store(int64_t *p, int64_t val)
+{
+  _InterlockedExchange64(p, val);
+}
+
+/// @return  true if "*p" was "*expected" and is now "val", otherwise false
+///          and "*expected" is set to the value of "*p".
+static inline bool ring_cas(int64_t *p, int64_t *expected, int64_t val)
+{
+  int64_t old = _InterlockedCompareExchange64(p, val, *expected);
+  if (old == *expected) {
+    return true;
+  }
+  *expected = old;
+  return false;
+}
+
+static inline int ring_flag_swap(int *p, int val)
+{
+  return (int)_InterlockedExchange((long *)p, val);
+}
+
+static inline int ring_flag_get(int *p)
+{
+  return (int)_InterlockedCompareExchange((long *)p, 0, 0);
+}
+#else
+static inline int64_t ring_load(int64_t *p)
+{
+  return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+}
+
+static inline void ring_store(int64_t *p, int64_t val)
+{
+  __atomic_store_n(p, val, __ATOMIC_SEQ_CST);
+}
+
+/// @return  true if "*p" was "*expected" and is now "val", otherwise false
+///          and "*expected" is set to the value of "*p".
+static inline bool ring_cas(int64_t *p, int64_t *expected, int64_t val)
+{
+  return __atomic_compare_exchange_n(p, expected, val, false, __ATOMIC_SEQ_CST,
+                                     __ATOMIC_SEQ_CST);
+}
+
+static inline int ring_flag_swap(int *p, int val)
+{
+  return __atomic_exchange_n(p, val, __ATOMIC_SEQ_CST);
+}
+
+static inline int ring_flag_get(int *p)
+{
+  return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+}
+#endif
+
+/// Waits a moment for another thread to put the event in a cell it claimed.
+/// Spins briefly, then gives up the CPU in case that thread is not running.
+static inline void ring_backoff(int *spins)
+{
+  if (++*spins < LOOP_RING_SPINS) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__ ("yield");
+#endif
+  } else {
+    uv_sleep(0);
+  }
+}
+
 void loop_init(Loop *loop, void *data)
 {
   uv_loop_init(&loop->uv);
@@ -22,6 +110,10 @@ void loop_init(Loop *loop, void *data)
   loop->events = multiqueue_new(loop_on_put, loop);
   loop->fast_events = multiqueue_new_child(loop->events);
   loop->thread_events = multiqueue_new(NULL, NULL);
+  loop->ring = (LoopRing){ .cells = xmalloc(LOOP_RING_SIZE * sizeof(LoopRingCell)) };
+  for (int i = 0; i < LOOP_RING_SIZE; i++) {
+    loop->ring.cells[i].seq = i;
+  }
   uv_mutex_init(&loop->mutex);
   uv_async_init(&loop->uv, &loop->async, async_cb);
   uv_signal_init(&loop->uv, &loop->children_watcher);
@@ -92,10 +184,79 @@ bool loop_poll_events(Loop *loop, int64_t ms)
 /// @see loop_schedule_deferred
 void loop_schedule_fast(Loop *loop, Event event)
 {
-  uv_mutex_lock(&loop->mutex);
-  multiqueue_put_event(loop->thread_events, event);
-  uv_async_send(&loop->async);
-  uv_mutex_unlock(&loop->mutex);
+  if (!loop_ring_put(loop, event)) {
+    uv_mutex_lock(&loop->mutex);
+    ring_flag_swap(&loop->ring.overflow, 1);
+    multiqueue_put_event(loop->thread_events, event);
+    uv_mutex_unlock(&loop->mutex);
+  }
+  // Wake up the loop thread only once for all the events put before it gets
+  // them, the other threads do not need to call into libuv.
+  if (ring_flag_swap(&loop->ring.wakeup, 1) == 0) {
+    uv_async_send(&loop->async);
+  }
+}
+
+/// Puts "event" in the ring of "loop", without taking a lock.
+///
+/// A position in the ring is claimed by increasing `head`. The event in a cell
+/// is ready to be read when the `seq` of the cell is one more than its
+/// position, and the cell can be reused when `seq` is its position in the next
+/// round.
+///
+/// @return  false if the ring is full, or the event must go to `thread_events`
+///          to stay after the events already there.
+static bool loop_ring_put(Loop *loop, Event event)
+{
+  LoopRing *ring = &loop->ring;
+  if (ring_flag_get(&ring->overflow)) {
+    return false;
+  }
+
+  int64_t pos = ring_load(&ring->head);
+  while (true) {
+    LoopRingCell *cell = &ring->cells[pos & (LOOP_RING_SIZE - 1)];
+    int64_t seq = ring_load(&cell->seq);
+    if (seq == pos) {
+      if (ring_cas(&ring->head, &pos, pos + 1)) {
+        cell->event = event;
+        ring_store(&cell->seq, pos + 1);
+        return true;
+      }
+    } else if (seq < pos) {
+      return false;  // full: the loop thread did not get this cell yet
+    } else {
+      pos = ring_load(&ring->head);  // another thread claimed this position
+    }
+  }
+}
+
+/// Moves events from the ring of "loop" to `fast_events`, up to the first
+/// cell that is not ready. The events at positions before "until" are
+/// waited for, if another thread is still putting them.
+///
+/// @param purge  drop the events instead
+static void loop_ring_get(Loop *loop, int64_t until, bool purge)
+{
+  LoopRing *ring = &loop->ring;
+  int spins = 0;
+  while (true) {
+    LoopRingCell *cell = &ring->cells[ring->tail & (LOOP_RING_SIZE - 1)];
+    if (ring_load(&cell->seq) != ring->tail + 1) {
+      if (ring->tail < until) {
+        ring_backoff(&spins);  // claimed but not put yet
+        continue;
+      }
+      break;
+    }
+    spins = 0;
+    Event event = cell->event;
+    ring_store(&cell->seq, ring->tail + LOOP_RING_SIZE);
+    ring->tail++;
+    if (!purge) {
+      multiqueue_put_event(loop->fast_events, event);
+    }
+  }
 }
 
 /// Schedules an event from another thread. Unlike loop_schedule_fast(), the
@@ -185,6 +346,7 @@ bool loop_close(Loop *loop, bool wait)
   multiqueue_free(loop->fast_events);
   multiqueue_free(loop->thread_events);
   multiqueue_free(loop->events);
+  XFREE_CLEAR(loop->ring.cells);
   kv_destroy(loop->children);
   return rv;
 }
@@ -192,7 +354,9 @@ bool loop_close(Loop *loop, bool wait)
 void loop_purge(Loop *loop)
 {
   uv_mutex_lock(&loop->mutex);
+  loop_ring_get(loop, ring_load(&loop->ring.head), true);
   multiqueue_purge_events(loop->thread_events);
+  ring_flag_swap(&loop->ring.overflow, 0);
   multiqueue_purge_events(loop->fast_events);
   uv_mutex_unlock(&loop->mutex);
 }
@@ -202,16 +366,29 @@ size_t loop_size(Loop *loop)
   uv_mutex_lock(&loop->mutex);
   size_t rv = multiqueue_size(loop->thread_events);
   uv_mutex_unlock(&loop->mutex);
-  return rv;
+  return rv + (size_t)(ring_load(&loop->ring.head) - loop->ring.tail);
 }
 
 static void async_cb(uv_async_t *handle)
 {
   Loop *l = handle->loop->data;
-  uv_mutex_lock(&l->mutex);
-  // Flush thread_events to fast_events for processing on main loop.
-  multiqueue_move_events(l->fast_events, l->thread_events);
-  uv_mutex_unlock(&l->mutex);
+  // Events put after this call uv_async_send() again.
+  ring_flag_swap(&l->ring.wakeup, 0);
+
+  // Flush the ring and thread_events to fast_events for processing on main
+  // loop. An event in thread_events comes after all the events in the ring
+  // that were claimed before it (by the same thread, or another one).
+  if (ring_flag_get(&l->ring.overflow)) {
+    // Wait for the claimed cells before taking the lock, the threads that
+    // put events in thread_events are blocked while it is held.
+    loop_ring_get(l, ring_load(&l->ring.head), false);
+    uv_mutex_lock(&l->mutex);
+    loop_ring_get(l, ring_load(&l->ring.head), false);
+    multiqueue_move_events(l->fast_events, l->thread_events);
+    ring_flag_swap(&l->ring.overflow, 0);
+    uv_mutex_unlock(&l->mutex);
+  }
+  loop_ring_get(l, 0, false);
 }
 
 static void timer_cb(uv_timer_t *handle)
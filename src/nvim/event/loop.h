@@ -1,16 +1,34 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <uv.h>
 
 #include "klib/kvec.h"
 #include "nvim/event/defs.h"  // IWYU pragma: keep
 #include "nvim/types_defs.h"  // IWYU pragma: keep
 
+typedef struct {
+  Event event;
+  int64_t seq;  ///< position the cell is ready for, accessed atomically
+} LoopRingCell;
+
+/// Bounded queue of events scheduled from other threads, which can be put by
+/// many threads at once without a lock. Only the loop thread gets events.
+typedef struct {
+  LoopRingCell *cells;
+  int64_t head;  ///< position of the next put, accessed atomically
+  int64_t tail;  ///< position of the next get, only used by the loop thread
+  int overflow;  ///< events were put in `thread_events`, accessed atomically
+  int wakeup;    ///< uv_async_send() was called, accessed atomically
+} LoopRing;
+
 struct loop {
   uv_loop_t uv;
   MultiQueue *events;
+  // Events from other threads, when `ring` is full. Protected by `mutex`.
   MultiQueue *thread_events;
+  LoopRing ring;
   // Immediate events.
   // - "Processed after exiting `uv_run()` (to avoid recursion), but before returning from
   //   `loop_poll_events()`." 502aee690c98
@@ -213,6 +213,34 @@ void rstream_consume(RStream *stream, size_t consumed)
   }
 }
 
+/// Takes the buffer away from "stream", for a reader which keeps pointers into
+/// the data it has read.  Must be called from the read callback.  The data
+/// after the first "consumed" bytes is moved to a new buffer, which the stream
+/// reads into from now on, and the callback returns the number of consumed
+/// bytes of the new buffer.
+///
+/// @return  the old buffer, free it with free_block().
+char *rstream_take_buffer(RStream *stream, size_t consumed)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_NONNULL_RET
+{
+  assert(consumed <= rstream_available(stream));
+  char *buf = stream->buffer;
+  const char *rest = stream->read_pos + consumed;
+  size_t remaining = (size_t)(stream->write_pos - rest);
+  stream->buffer = alloc_block();
+  memcpy(stream->buffer, rest, remaining);
+  stream->read_pos = stream->buffer;
+  stream->write_pos = stream->buffer + remaining;
+  return buf;
+}
+
+/// @return  the end of the memory the stream reads into.
+const char *rstream_buffer_end(RStream *stream)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_PURE
+{
+  return stream->buffer + ARENA_BLOCK_SIZE;
+}
+
 static void invoke_read_cb(RStream *stream, bool eof)
 {
   stream->did_eof |= eof;
@@ -0,0 +1,294 @@
+// Shared memory transport for UI output.
+//
+// A local UI can map a file (usually a memfd) into both processes and let
+// Nvim write the msgpack stream of "redraw" notifications into a ring buffer
+// in it, instead of sending it through the RPC channel.  This avoids the copy
+// into and out of the kernel and the syscall per write: the remote UI packs
+// the events directly into the ring (see shm_stream_reserve()) and the client
+// decodes them from there.
+//
+// The ring is mapped twice back to back, so that a reserved region is always
+// contiguous, even when it wraps around the end of the ring.
+//
+// Two fds are used for waking up the other side, they can be eventfds or
+// pipes.  Nvim writes eight bytes to the "doorbell" fd after publishing data
+// when the client said it is waiting for it.  The client writes anything to
+// the "wakeup" fd after consuming data when Nvim said it is waiting for
+// space.  Both sides first set their "waiting" flag and then check the ring
+// again, so no wakeup is lost.
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <uv.h>
+
+#include "klib/kvec.h"
+#include "nvim/event/defs.h"
+#include "nvim/event/loop.h"
+#include "nvim/event/shm_unix.h"
+#include "nvim/event/wstream.h"
+#include "nvim/log.h"
+#include "nvim/macros_defs.h"
+#include "nvim/memory.h"
+#include "nvim/types_defs.h"
+
+struct shm_stream {
+  ShmRingHeader *hdr;
+  char *data;  ///< the ring, mapped twice
+  uint64_t size;
+  uint64_t head;  ///< local copy of hdr->head
+  int doorbell_fd;
+  int wakeup_fd;
+  uv_poll_t poll;
+  bool reserved;  ///< shm_stream_reserve() was called without commit
+  kvec_t(WBuffer *) pending;  ///< waiting for space in the ring
+  size_t pending_off;  ///< bytes of the first pending buffer already written
+};
+
+#include "event/shm_unix.c.generated.h"
+
+/// Maps the ring in file "fd" and starts watching "wakeup_fd".  Takes
+/// ownership of "doorbell_fd" and "wakeup_fd", also when failing.  "fd" can be
+/// closed after this.
+///
+/// @param[out] errmsg  set to the reason when failing
+/// @return  the stream, or NULL on failure
+ShmStream *shm_stream_open(Loop *loop, int fd, int doorbell_fd, int wakeup_fd,
+                           const char **errmsg)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_WARN_UNUSED_RESULT
+{
+  int fl1 = fcntl(doorbell_fd, F_GETFL);
+  int fl2 = fcntl(wakeup_fd, F_GETFL);
+  if (fl1 == -1 || fl2 == -1) {
+    *errmsg = "invalid shm doorbell or wakeup fd";
+    goto fail;
+  }
+  (void)fcntl(doorbell_fd, F_SETFL, fl1 | O_NONBLOCK);
+  (void)fcntl(wakeup_fd, F_SETFL, fl2 | O_NONBLOCK);
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < SHM_RING_DATA_OFFSET) {
+    *errmsg = "cannot map shm file";
+    goto fail;
+  }
+
+  ShmRingHeader *hdr = mmap(NULL, sizeof(ShmRingHeader), PROT_READ | PROT_WRITE, MAP_SHARED,
+                            fd, 0);
+  if (hdr == MAP_FAILED) {
+    *errmsg = "cannot map shm file";
+    goto fail;
+  }
+  uint64_t size = hdr->size;
+  if (hdr->magic != SHM_RING_MAGIC || hdr->version != SHM_RING_VERSION) {
+    *errmsg = "invalid shm header";
+    goto fail_hdr;
+  }
+  if (size < SHM_RING_MIN_SIZE || (size & (size - 1)) != 0
+      || (uint64_t)st.st_size < SHM_RING_DATA_OFFSET + size || size > SIZE_MAX / 2) {
+    *errmsg = "invalid shm ring size";
+    goto fail_hdr;
+  }
+
+  // Reserve twice the size and map the ring in both halves.
+  char *data = mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (data == MAP_FAILED) {
+    *errmsg = "cannot map shm ring";
+    goto fail_hdr;
+  }
+  for (int i = 0; i < 2; i++) {
+    if (mmap(data + i * size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd,
+             SHM_RING_DATA_OFFSET) == MAP_FAILED) {
+      *errmsg = "cannot map shm ring";
+      munmap(data, 2 * size);
+      goto fail_hdr;
+    }
+  }
+
+  ShmStream *stream = xcalloc(1, sizeof(ShmStream));
+  stream->hdr = hdr;
+  stream->data = data;
+  stream->size = size;
+  stream->head = __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE);
+  stream->doorbell_fd = doorbell_fd;
+  stream->wakeup_fd = wakeup_fd;
+  kv_init(stream->pending);
+
+  if (uv_poll_init(&loop->uv, &stream->poll, wakeup_fd) != 0) {
+    *errmsg = "invalid shm wakeup fd";
+    kv_destroy(stream->pending);
+    xfree(stream);
+    munmap(data, 2 * size);
+    goto fail_hdr;
+  }
+  stream->poll.data = stream;
+  uv_poll_start(&stream->poll, UV_READABLE, wakeup_cb);
+  return stream;
+
+fail_hdr:
+  munmap(hdr, sizeof(ShmRingHeader));
+fail:
+  close(doorbell_fd);
+  if (wakeup_fd != doorbell_fd) {
+    close(wakeup_fd);
+  }
+  return NULL;
+}
+
+/// Unmaps the ring and closes the fds.  Data which did not fit in the ring is
+/// dropped.
+void shm_stream_close(ShmStream *stream)
+  FUNC_ATTR_NONNULL_ALL
+{
+  for (size_t i = 0; i < kv_size(stream->pending); i++) {
+    wstream_release_wbuffer(kv_A(stream->pending, i));
+  }
+  kv_destroy(stream->pending);
+  munmap(stream->data, 2 * stream->size);
+  munmap(stream->hdr, sizeof(ShmRingHeader));
+  stream->data = NULL;
+  stream->hdr = NULL;
+  uv_close((uv_handle_t *)&stream->poll, close_cb);
+}
+
+static void close_cb(uv_handle_t *handle)
+{
+  ShmStream *stream = handle->data;
+  close(stream->doorbell_fd);
+  close(stream->wakeup_fd);
+  xfree(stream);
+}
+
+/// @return  bytes waiting for space in the ring, which the client did not get
+///          yet.  The ring itself is bounded.
+size_t shm_stream_backlog(ShmStream *stream)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_PURE
+{
+  size_t size = 0;
+  for (size_t i = 0; i < kv_size(stream->pending); i++) {
+    size += kv_A(stream->pending, i)->size;
+  }
+  return size - stream->pending_off;
+}
+
+/// @return  free space in the ring.
+static size_t shm_space(ShmStream *stream)
+{
+  uint64_t used = stream->head - __atomic_load_n(&stream->hdr->tail, __ATOMIC_ACQUIRE);
+  // A misbehaving client can't make us write outside of the ring.
+  return used > stream->size ? 0 : (size_t)(stream->size - used);
+}
+
+/// Returns memory in the ring for writing "len" bytes directly, without
+/// making it visible to the client yet.  The region is always contiguous.
+///
+/// @return  NULL when there is not enough space, or earlier data still has to
+///          be written.
+char *shm_stream_reserve(ShmStream *stream, size_t len)
+  FUNC_ATTR_NONNULL_ALL
+{
+  assert(!stream->reserved);
+  if (kv_size(stream->pending) || shm_space(stream) < len) {
+    return NULL;
+  }
+  stream->reserved = true;
+  return stream->data + (stream->head & (stream->size - 1));
+}
+
+/// Publishes "len" bytes written to the memory returned by
+/// shm_stream_reserve().
+void shm_stream_commit(ShmStream *stream, size_t len)
+  FUNC_ATTR_NONNULL_ALL
+{
+  assert(stream->reserved);
+  stream->reserved = false;
+  shm_publish(stream, len);
+}
+
+/// Copies "buffer" to the ring, or queues it until there is space.  Takes
+/// ownership of "buffer".
+void shm_stream_write(ShmStream *stream, WBuffer *buffer)
+  FUNC_ATTR_NONNULL_ALL
+{
+  assert(!stream->reserved);
+  kv_push(stream->pending, buffer);
+  if (kv_size(stream->pending) == 1) {
+    flush_pending(stream);
+  }
+}
+
+static void shm_publish(ShmStream *stream, size_t len)
+{
+  if (len == 0) {
+    return;
+  }
+  stream->head += len;
+  __atomic_store_n(&stream->hdr->head, stream->head, __ATOMIC_SEQ_CST);
+  if (__atomic_exchange_n(&stream->hdr->reader_waiting, 0, __ATOMIC_SEQ_CST)) {
+    uint64_t one = 1;
+    if (write(stream->doorbell_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+      DLOG("shm doorbell: %s", strerror(errno));
+    }
+  }
+}
+
+/// Copies as much pending data to the ring as fits.  When not all of it
+/// fits, asks the client for a wakeup.
+static void flush_pending(ShmStream *stream)
+{
+  while (true) {
+    size_t done = 0;
+    while (done < kv_size(stream->pending)) {
+      WBuffer *buf = kv_A(stream->pending, done);
+      size_t len = MIN(buf->size - stream->pending_off, shm_space(stream));
+      if (len == 0) {
+        break;
+      }
+      memcpy(stream->data + (stream->head & (stream->size - 1)),
+             buf->data + stream->pending_off, len);
+      shm_publish(stream, len);
+      stream->pending_off += len;
+      if (stream->pending_off < buf->size) {
+        break;
+      }
+      wstream_release_wbuffer(buf);
+      stream->pending_off = 0;
+      done++;
+    }
+    size_t rest = kv_size(stream->pending) - done;
+    memmove(stream->pending.items, stream->pending.items + done, rest * sizeof(WBuffer *));
+    kv_size(stream->pending) = rest;
+    if (rest == 0) {
+      return;
+    }
+
+    __atomic_store_n(&stream->hdr->writer_waiting, 1, __ATOMIC_SEQ_CST);
+    if (shm_space(stream) == 0) {
+      return;  // wakeup_cb() continues
+    }
+    // The client made space before it could see the flag.
+    __atomic_store_n(&stream->hdr->writer_waiting, 0, __ATOMIC_SEQ_CST);
+  }
+}
+
+static void wakeup_cb(uv_poll_t *handle, int status, int events)
+{
+  ShmStream *stream = handle->data;
+  char buf[64];
+  ssize_t r;
+  while ((r = read(stream->wakeup_fd, buf, sizeof(buf))) > 0) {}
+  if (status < 0 || r == 0) {
+    // The client went away, the channel will be closed.
+    uv_poll_stop(handle);
+    return;
+  }
+  if (kv_size(stream->pending)) {
+    flush_pending(stream);
+  }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>  // IWYU pragma: keep
+#include <stdint.h>
+
+#include "nvim/event/defs.h"  // IWYU pragma: keep
+#include "nvim/types_defs.h"  // IWYU pragma: keep
+
+/// Written by the client in ShmRingHeader.magic ("NVSH").
+#define SHM_RING_MAGIC 0x4e565348U
+#define SHM_RING_VERSION 1
+/// Offset of the ring data in the shared file, a multiple of any page size.
+#define SHM_RING_DATA_OFFSET 65536
+/// Smallest allowed ring size.
+#define SHM_RING_MIN_SIZE 65536
+
+/// Header at the start of the shared file, see |ui-shm|.  "head" and "tail"
+/// are byte counts which only grow, the read position in the ring is
+/// "tail % size".  They are on separate cache lines, each is written by one
+/// side only.
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t size;  ///< size of the ring, a power of two
+  char pad0[48];
+  uint64_t head;  ///< bytes written by Nvim
+  char pad1[56];
+  uint64_t tail;  ///< bytes consumed by the client
+  char pad2[56];
+  uint32_t reader_waiting;  ///< the client waits for the data doorbell
+  uint32_t writer_waiting;  ///< Nvim waits for the space wakeup
+} ShmRingHeader;
+
+#include "event/shm_unix.h.generated.h"
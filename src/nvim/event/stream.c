@@ -4,6 +4,7 @@
 #include <uv.h>
 #include <uv/version.h>
 
+#include "klib/kvec.h"
 #include "nvim/event/defs.h"
 #include "nvim/event/loop.h"
 #include "nvim/event/stream.h"
@@ -90,6 +91,9 @@ void stream_init(Loop *loop, Stream *stream, int fd, uv_stream_t *uvstream)
   stream->maxmem = 0;
   stream->pending_reqs = 0;
   stream->write_cb = NULL;
+  stream->coalesce = false;
+  stream->writing = false;
+  kv_init(stream->queued);
   stream->close_cb = NULL;
   stream->internal_close_cb = NULL;
   stream->closed = false;
@@ -144,6 +148,9 @@ static void close_cb(uv_handle_t *handle)
   Stream *stream = handle->data;
   // Need to check if handle->data is NULL here as this callback may be called between
   // the handle's initialization and stream_init() (e.g. in socket_connect()).
+  if (stream) {
+    kv_destroy(stream->queued);
+  }
   if (stream && stream->close_cb) {
     stream->close_cb(stream, stream->close_cb_data);
   }
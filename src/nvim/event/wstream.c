@@ -1,8 +1,10 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <string.h>
 #include <uv.h>
 
+#include "klib/kvec.h"
 #include "nvim/event/defs.h"
 #include "nvim/event/stream.h"
 #include "nvim/event/wstream.h"
@@ -12,10 +14,14 @@
 
 #define DEFAULT_MAXMEM 1024 * 1024 * 2000
 
+/// Number of buffers written without allocating an array of uv_buf_t.
+#define WRITE_BUFS_STATIC 16
+
 typedef struct {
   Stream *stream;
-  WBuffer *buffer;
   uv_write_t uv_req;
+  size_t count;
+  WBuffer *buffers[];
 } WRequest;
 
 #include "event/wstream.c.generated.h"
@@ -61,6 +67,11 @@ void wstream_set_write_cb(Stream *stream, stream_write_cb cb, void *data)
 /// instance. This will fail if the write would cause the Stream use more
 /// memory than specified by `maxmem`.
 ///
+/// When `stream->coalesce` is set and a write is in flight, the buffer is
+/// queued and written together with others, with a single writev(), when the
+/// write completes.  Thus the replies to many requests handled in one loop
+/// iteration do not need a syscall each.
+///
 /// @param stream The `Stream` instance
 /// @param buffer The buffer which contains data to be written
 /// @return false if the write failed
@@ -71,11 +82,11 @@ bool wstream_write(Stream *stream, WBuffer *buffer)
   // This should not be called after a stream was freed
   assert(!stream->closed);
 
-  uv_buf_t uvbuf;
-  uvbuf.base = buffer->data;
-  uvbuf.len = UV_BUF_LEN(buffer->size);
-
   if (!stream->uvstream) {
+    uv_buf_t uvbuf;
+    uvbuf.base = buffer->data;
+    uvbuf.len = UV_BUF_LEN(buffer->size);
+
     uv_fs_t req;
 
     // Synchronous write
@@ -97,22 +108,77 @@ bool wstream_write(Stream *stream, WBuffer *buffer)
 
   stream->curmem += buffer->size;
 
-  WRequest *data = xmalloc(sizeof(WRequest));
+  if (stream->writing && stream->coalesce) {
+    kv_push(stream->queued, buffer);
+    return true;
+  }
+
+  if (!write_buffers(stream, &buffer, 1)) {
+    stream->curmem -= buffer->size;
+    goto err;
+  }
+  return true;
+
+err:
+  wstream_release_wbuffer(buffer);
+  return false;
+}
+
+/// Starts a write request for "count" buffers.
+///
+/// @return false if the request could not be started, the buffers are not
+///         released then.
+static bool write_buffers(Stream *stream, WBuffer **buffers, size_t count)
+{
+  WRequest *data = xmalloc(offsetof(WRequest, buffers) + count * sizeof(WBuffer *));
   data->stream = stream;
-  data->buffer = buffer;
+  data->count = count;
+  memcpy(data->buffers, buffers, count * sizeof(WBuffer *));
   data->uv_req.data = data;
 
-  if (uv_write(&data->uv_req, stream->uvstream, &uvbuf, 1, write_cb)) {
+  // uv_write() copies the array.
+  uv_buf_t static_bufs[WRITE_BUFS_STATIC];
+  uv_buf_t *uvbufs = count > WRITE_BUFS_STATIC ? xmalloc(count * sizeof(uv_buf_t)) : static_bufs;
+  for (size_t i = 0; i < count; i++) {
+    uvbufs[i].base = buffers[i]->data;
+    uvbufs[i].len = UV_BUF_LEN(buffers[i]->size);
+  }
+
+  int err = uv_write(&data->uv_req, stream->uvstream, uvbufs, (unsigned)count, write_cb);
+  if (uvbufs != static_bufs) {
+    xfree(uvbufs);
+  }
+  if (err) {
     xfree(data);
-    goto err;
+    return false;
   }
 
+  stream->writing = true;
   stream->pending_reqs++;
   return true;
+}
 
-err:
-  wstream_release_wbuffer(buffer);
-  return false;
+/// Releases the buffers which were queued while a write was in flight.
+static void release_queued(Stream *stream)
+{
+  for (size_t i = 0; i < kv_size(stream->queued); i++) {
+    WBuffer *buffer = kv_A(stream->queued, i);
+    stream->curmem -= buffer->size;
+    wstream_release_wbuffer(buffer);
+  }
+  kv_size(stream->queued) = 0;
+}
+
+/// @return  number of bytes written to "stream" which the kernel did not
+///          accept yet, i.e. how far the reader is behind.
+size_t wstream_backlog(Stream *stream)
+  FUNC_ATTR_NONNULL_ALL
+{
+  size_t size = stream->uvstream ? uv_stream_get_write_queue_size(stream->uvstream) : 0;
+  for (size_t i = 0; i < kv_size(stream->queued); i++) {
+    size += kv_A(stream->queued, i)->size;
+  }
+  return size;
 }
 
 /// Creates a WBuffer object for holding output data. Instances of this
@@ -142,20 +208,31 @@ WBuffer *wstream_new_buffer(char *data, size_t size, size_t refcount, wbuffer_da
 static void write_cb(uv_write_t *req, int status)
 {
   WRequest *data = req->data;
+  Stream *stream = data->stream;
 
-  data->stream->curmem -= data->buffer->size;
+  for (size_t i = 0; i < data->count; i++) {
+    stream->curmem -= data->buffers[i]->size;
+    wstream_release_wbuffer(data->buffers[i]);
+  }
 
-  wstream_release_wbuffer(data->buffer);
+  stream->writing = false;
+  if (kv_size(stream->queued) > 0) {
+    if (status == 0 && write_buffers(stream, stream->queued.items, kv_size(stream->queued))) {
+      kv_size(stream->queued) = 0;
+    } else {
+      release_queued(stream);
+    }
+  }
 
-  if (data->stream->write_cb) {
-    data->stream->write_cb(data->stream, data->stream->cb_data, status);
+  if (stream->write_cb) {
+    stream->write_cb(stream, stream->cb_data, status);
   }
 
-  data->stream->pending_reqs--;
+  stream->pending_reqs--;
 
-  if (data->stream->closed && data->stream->pending_reqs == 0) {
+  if (stream->closed && stream->pending_reqs == 0) {
     // Last pending write; free the stream.
-    stream_close_handle(data->stream);
+    stream_close_handle(stream);
   }
 
   xfree(data);
@@ -4662,10 +4662,16 @@ void ex_global(exarg_T *eap)
     }
   } else {
     int ndone = 0;
+    uint8_t *may_match = search_lines_may_match(curbuf, eap->line1, eap->line2, &regmatch);
     // pass 1: set marks for each (not) matching line
     for (lnum = eap->line1; lnum <= eap->line2 && !got_int; lnum++) {
       // a match on this line?
-      int match = vim_regexec_multi(&regmatch, curwin, curbuf, lnum, 0, NULL, NULL);
+      int match = 0;
+      if (may_match != NULL && may_match[lnum - eap->line1] == kLineHasMatch) {
+        match = 1;
+      } else if (may_match == NULL || may_match[lnum - eap->line1] != kLineNoMatch) {
+        match = vim_regexec_multi(&regmatch, curwin, curbuf, lnum, 0, NULL, NULL);
+      }
       if (regmatch.regprog == NULL) {
         break;  // re-compiling regprog failed
       }
@@ -4675,6 +4681,7 @@ void ex_global(exarg_T *eap)
       }
       line_breakcheck();
     }
+    xfree(may_match);
 
     // pass 2: execute the command for each line that has been marked
     if (got_int) {
@@ -106,6 +106,45 @@ revised:
   }
 }
 
+/// Create new extmarks in namespace "ns_id" for all "n" of "marks", as
+/// extmark_set() without an id does for one mark, but adding the marks to the
+/// marktree at once.
+///
+/// @param[out] ids  the ids of the new marks
+void extmark_set_many(buf_T *buf, uint32_t ns_id, ExtmarkPut *marks, size_t n, uint32_t *ids)
+{
+  if (n == 0) {
+    return;
+  }
+
+  uint32_t *ns = map_put_ref(uint32_t, uint32_t)(buf->b_extmark_ns, ns_id, NULL, NULL);
+  MTPair *pairs = xmalloc(n * sizeof(*pairs));
+  for (size_t i = 0; i < n; i++) {
+    ExtmarkPut *m = &marks[i];
+    ids[i] = ++*ns;
+    uint16_t flags = mt_flags(m->right_gravity, m->no_undo, m->invalidate, m->decor.ext)
+                     | m->decor_flags;
+    pairs[i] = (MTPair){
+      .start = { { m->row, m->col }, ns_id, ids[i], flags, m->decor.data },
+      .end_pos = { m->end_row, m->end_col },
+      .end_right_gravity = m->end_right_gravity,
+    };
+  }
+
+  marktree_put_many(buf->b_marktree, pairs, n);
+  xfree(pairs);
+  decor_state_invalidate(buf);
+
+  for (size_t i = 0; i < n; i++) {
+    ExtmarkPut *m = &marks[i];
+    if (m->decor_flags || m->decor.ext) {
+      int end_row = m->end_row > -1 ? m->end_row : m->row;
+      buf_put_decor(buf, m->decor, m->row, end_row);
+      decor_redraw(buf, m->row, end_row, m->col, m->decor);
+    }
+  }
+}
+
 static void extmark_setraw(buf_T *buf, uint64_t mark, int row, colnr_T col, bool invalid)
 {
   MarkTreeIter itr[1] = { 0 };
@@ -4,6 +4,7 @@
 #include <stdint.h>
 
 #include "klib/kvec.h"
+#include "nvim/decoration_defs.h"
 #include "nvim/extmark_defs.h"  // IWYU pragma: keep
 #include "nvim/macros_defs.h"
 #include "nvim/marktree_defs.h"
@@ -14,6 +15,21 @@ EXTERN int curbuf_splice_pending INIT( = 0);
 
 typedef kvec_t(MTPair) ExtmarkInfoArray;
 
+// a new extmark for extmark_set_many(), see extmark_set() for the fields
+typedef struct {
+  int row;
+  colnr_T col;
+  int end_row;
+  colnr_T end_col;
+  DecorInline decor;
+  uint16_t decor_flags;
+  bool right_gravity;
+  bool end_right_gravity;
+  bool no_undo;
+  bool invalidate;
+} ExtmarkPut;
+typedef kvec_t(ExtmarkPut) ExtmarkPutArray;
+
 // delete the columns between mincol and endcol
 typedef struct {
   int start_row;
@@ -16,6 +16,8 @@
 #include <uv.h>
 
 #include "auto/config.h"
+#include "klib/kvec.h"
+#include "nvim/api/private/defs.h"
 #include "nvim/ascii_defs.h"
 #include "nvim/autocmd.h"
 #include "nvim/autocmd_defs.h"
@@ -135,9 +137,13 @@ void filemess(buf_T *buf, char *name, char *s)
 
 /// Read lines from file "fname" into the buffer after line "from".
 ///
-/// 1. We allocate blocks with try_malloc, as big as possible.
+/// 1. We allocate blocks with try_malloc, as big as possible.  A block is
+///    reused for the next read() when it is big enough.
 /// 2. Each block is filled with characters from the file with a single read().
-/// 3. The lines are inserted in the buffer with ml_append().
+/// 3. The lines found in a block are inserted in the buffer at once with
+///    ml_append_lines().
+///
+/// A large file may be mapped into memory instead, see readfile_map().
 ///
 /// (caller must check that fname != NULL, unless READ_STDIN is used)
 ///
@@ -176,6 +182,8 @@ int readfile(char *fname, char *sfname, linenr_T from, linenr_T lines_to_skip,
   linenr_T lnum = from;
   char *ptr = NULL;              // pointer into read buffer
   char *buffer = NULL;           // read buffer
+  size_t buffer_size = 0;        // allocated size of "buffer"
+  kvec_t(String) new_lines = KV_INITIAL_VALUE;  // lines of the block not appended yet
   char *new_buffer = NULL;       // init to shut up gcc
   char *line_start = NULL;       // init to shut up gcc
   int wasempty;                         // buffer was empty before reading
@@ -184,6 +192,8 @@ int readfile(char *fname, char *sfname, linenr_T from, linenr_T lines_to_skip,
   uint8_t *p = NULL;
   off_T filesize = 0;
   bool skip_read = false;
+  bool try_map = false;                 // may map the file instead of reading it
+  bool mapped = false;                  // buffer is backed by a file mapping
   context_sha256_T sha_ctx;
   bool read_undo_file = false;
   int split = 0;  // number of split lines
@@ -732,6 +742,7 @@ retry:
       goto failed;
     }
     // Delete the previously read lines.
+    kv_size(new_lines) = 0;
     while (lnum > from) {
       ml_delete(lnum--);
     }
@@ -876,6 +887,12 @@ retry:
     if (read_undo_file) {
       sha256_start(&sha_ctx);
     }
+    // A large file read into an empty buffer may be mapped instead, this is
+    // decided once the first bytes have been checked.
+    try_map = (p_lfs > 0 && newfile && wasempty && from == 0
+               && lines_to_skip == 0 && lines_to_read == MAXLNUM
+               && !filtering && !read_stdin && !read_buffer && !read_fifo
+               && !read_undo_file && !(flags & READ_DUMMY) && !recoverymode);
   }
 
   while (!error && !got_int) {
@@ -885,10 +902,11 @@ retry:
     // up to max_unsigned characters (and other things).
     {
       if (!skip_read) {
-        // Use buffer >= 64K.  Add linerest to double the size if the
-        // line gets very long, to avoid a lot of copying. But don't
-        // read more than 1 Mbyte at a time, so we can be interrupted.
-        size = MIN(0x10000 + linerest, 0x100000);
+        // Use buffer >= 64K, after the first block 1 Mbyte to reduce the
+        // number of reads for a large file.  Add linerest to double the
+        // size if the line gets very long, to avoid a lot of copying. But
+        // don't read more than 1 Mbyte at a time, so we can be interrupted.
+        size = MIN((filesize > 0 ? 0x100000 : 0x10000) + linerest, 0x100000);
       }
 
       // Protect against the argument of lalloc() going negative.
@@ -897,21 +915,30 @@ retry:
         *ptr = NL;  // split line by inserting a NL
         size = 1;
       } else if (!skip_read) {
-        for (; size >= 10; size /= 2) {
-          new_buffer = verbose_try_malloc((size_t)size + (size_t)linerest + 1);
-          if (new_buffer) {
+        if (buffer != NULL && (size_t)size + (size_t)linerest + 1 <= buffer_size) {
+          // The previous buffer is big enough, keep using it.
+          new_buffer = buffer;
+        } else {
+          for (; size >= 10; size /= 2) {
+            new_buffer = verbose_try_malloc((size_t)size + (size_t)linerest + 1);
+            if (new_buffer) {
+              break;
+            }
+          }
+          if (new_buffer == NULL) {
+            error = true;
             break;
           }
-        }
-        if (new_buffer == NULL) {
-          error = true;
-          break;
+          buffer_size = (size_t)size + (size_t)linerest + 1;
         }
         if (linerest) {         // copy characters from the previous buffer
           memmove(new_buffer, ptr - linerest, (size_t)linerest);
         }
-        xfree(buffer);
-        buffer = new_buffer;
+        if (new_buffer != buffer) {
+          xfree(buffer);
+          buffer = new_buffer;
+        }
+        new_buffer = NULL;
         ptr = buffer + linerest;
         line_start = buffer;
 
@@ -1329,6 +1356,8 @@ retry:
 
         // Reading UTF-8: Check if the bytes are valid UTF-8.
         for (p = (uint8_t *)ptr;; p++) {
+          // Quickly skip over ASCII, it is always valid.
+          p = (uint8_t *)utf_skip_ascii((char *)p, (size_t)(((uint8_t *)ptr + size) - p));
           int todo = (int)(((uint8_t *)ptr + size) - p);
 
           if (todo <= 0) {
@@ -1471,6 +1500,26 @@ rewind_retry:
           set_fileformat(fileformat, OPT_LOCAL);
         }
       }
+
+      // The first bytes do not need conversion: the whole file may be mapped.
+      if (try_map) {
+        try_map = false;
+        if (fileformat == EOL_UNIX && fio_flags == 0 && iconv_fd == (iconv_t)-1
+            && tmpname == NULL && !curbuf->b_p_bomb && conv_restlen == 0
+            && conv_error == 0 && illegal_byte == 0
+            && readfile_map(curbuf, fd, &filesize)) {
+          mapped = true;
+          linerest = 0;
+          linecnt--;  // the empty line of the buffer is not kept
+          if (filesize > 0 && !readfile_map_has_eol(curbuf)) {
+            if (set_options) {
+              curbuf->b_p_eol = false;
+            }
+            read_no_eol_lnum = curbuf->b_ml.ml_line_count;
+          }
+          break;
+        }
+      }
     }
 
     // This loop is executed once for every character read.
@@ -1490,14 +1539,10 @@ rewind_retry:
           if (skip_count == 0) {
             *ptr = NUL;                     // end of line
             len = (colnr_T)(ptr - line_start + 1);
-            if (ml_append(lnum, line_start, len, newfile) == FAIL) {
-              error = true;
-              break;
-            }
+            kv_push(new_lines, ((String){ .data = line_start, .size = (size_t)len - 1 }));
             if (read_undo_file) {
               sha256_update(&sha_ctx, (uint8_t *)line_start, (size_t)len);
             }
-            lnum++;
             if (--read_count == 0) {
               error = true;                     // break loop
               line_start = ptr;                 // nothing left to write
@@ -1510,60 +1555,72 @@ rewind_retry:
         }
       }
     } else {
-      ptr--;
-      while (++ptr, --size >= 0) {
-        if ((c = *ptr) != NUL && c != NL) {        // catch most common case
-          continue;
+      // Let memchr() find the line breaks, it is a lot faster than looking
+      // at every byte here.
+      char *const end = ptr + size;
+      while (ptr < end) {
+        char *nl = memchr(ptr, NL, (size_t)(end - ptr));
+        if (nl == NULL) {
+          nl = end;
         }
-        if (c == NUL) {
-          *ptr = NL;            // NULs are replaced by newlines!
-        } else {
-          if (skip_count == 0) {
-            *ptr = NUL;                         // end of line
-            len = (colnr_T)(ptr - line_start + 1);
-            if (fileformat == EOL_DOS) {
-              if (ptr > line_start && ptr[-1] == CAR) {
-                // remove CR before NL
-                ptr[-1] = NUL;
-                len--;
-              } else if (ff_error != EOL_DOS) {
-                // Reading in Dos format, but no CR-LF found!
-                // When 'fileformats' includes "unix", delete all
-                // the lines read so far and start all over again.
-                // Otherwise give an error message later.
-                if (try_unix
-                    && !read_stdin
-                    && (read_buffer || vim_lseek(fd, 0, SEEK_SET) == 0)) {
-                  fileformat = EOL_UNIX;
-                  if (set_options) {
-                    set_fileformat(EOL_UNIX, OPT_LOCAL);
-                  }
-                  file_rewind = true;
-                  keep_fileformat = true;
-                  goto retry;
+        memchrsub(ptr, NUL, NL, (size_t)(nl - ptr));  // NULs are replaced by newlines!
+        ptr = nl;
+        if (ptr == end) {
+          break;
+        }
+        if (skip_count == 0) {
+          *ptr = NUL;                         // end of line
+          len = (colnr_T)(ptr - line_start + 1);
+          if (fileformat == EOL_DOS) {
+            if (ptr > line_start && ptr[-1] == CAR) {
+              // remove CR before NL
+              ptr[-1] = NUL;
+              len--;
+            } else if (ff_error != EOL_DOS) {
+              // Reading in Dos format, but no CR-LF found!
+              // When 'fileformats' includes "unix", delete all
+              // the lines read so far and start all over again.
+              // Otherwise give an error message later.
+              if (try_unix
+                  && !read_stdin
+                  && (read_buffer || vim_lseek(fd, 0, SEEK_SET) == 0)) {
+                fileformat = EOL_UNIX;
+                if (set_options) {
+                  set_fileformat(EOL_UNIX, OPT_LOCAL);
                 }
-                ff_error = EOL_DOS;
+                file_rewind = true;
+                keep_fileformat = true;
+                goto retry;
               }
+              ff_error = EOL_DOS;
             }
-            if (ml_append(lnum, line_start, len, newfile) == FAIL) {
-              error = true;
-              break;
-            }
-            if (read_undo_file) {
-              sha256_update(&sha_ctx, (uint8_t *)line_start, (size_t)len);
-            }
-            lnum++;
-            if (--read_count == 0) {
-              error = true;                         // break loop
-              line_start = ptr;                 // nothing left to write
-              break;
-            }
-          } else {
-            skip_count--;
           }
-          line_start = ptr + 1;
+          kv_push(new_lines, ((String){ .data = line_start, .size = (size_t)len - 1 }));
+          if (read_undo_file) {
+            sha256_update(&sha_ctx, (uint8_t *)line_start, (size_t)len);
+          }
+          if (--read_count == 0) {
+            error = true;                         // break loop
+            line_start = ptr;                 // nothing left to write
+            break;
+          }
+        } else {
+          skip_count--;
         }
+        line_start = ++ptr;
+      }
+    }
+
+    // Append the lines found in this block at once, before the next read()
+    // overwrites their text.
+    if (kv_size(new_lines) > 0) {
+      linenr_T old_line_count = curbuf->b_ml.ml_line_count;
+      if (ml_append_lines(curbuf, lnum, new_lines.items, kv_size(new_lines),
+                          newfile ? ML_APPEND_NEW : 0) == FAIL) {
+        error = true;
       }
+      lnum += curbuf->b_ml.ml_line_count - old_line_count;
+      kv_size(new_lines) = 0;
     }
     linerest = (ptr - line_start);
     os_breakcheck();
@@ -1633,6 +1690,7 @@ failed:
     os_set_cloexec(fd);
   }
   xfree(buffer);
+  kv_destroy(new_lines);
 
   if (read_stdin) {
     close(fd);
@@ -1659,7 +1717,7 @@ failed:
   // In recovery mode everything but autocommands is skipped.
   if (!recoverymode) {
     // need to delete the last line, which comes from the empty buffer
-    if (newfile && wasempty && !(curbuf->b_ml.ml_flags & ML_EMPTY)) {
+    if (newfile && wasempty && !mapped && !(curbuf->b_ml.ml_flags & ML_EMPTY)) {
       ml_delete(curbuf->b_ml.ml_line_count);
       linecnt--;
     }
@@ -1901,6 +1959,99 @@ bool is_dev_fd_file(char *fname)
 }
 #endif
 
+/// Try to back the empty buffer "buf" with a private mapping of the file
+/// "fd", see ml_map_attach().  Only done when the file is at least
+/// 'largefilesize' Mbyte, all of it is valid UTF-8 (unless 'binary' is set)
+/// and no line is too long.  Otherwise the file is read as usual.
+///
+/// @param[out] filesizep  set to the size of the file when it is mapped
+///
+/// @return  true when the buffer is backed by the mapping.
+static bool readfile_map(buf_T *buf, int fd, off_T *filesizep)
+{
+#ifdef HAVE_SYS_MMAN_H
+  FileInfo file_info;
+  if (!os_fileinfo_fd(fd, &file_info)) {
+    return false;
+  }
+  uint64_t fsize = os_fileinfo_size(&file_info);
+  if (fsize < (uint64_t)p_lfs * 1024 * 1024 || fsize > SIZE_MAX) {
+    return false;
+  }
+  char *base = os_mmap_private(fd, (size_t)fsize);
+  if (base == NULL) {
+    return false;
+  }
+
+  mlmap_T map = {
+    .mm_base = base,
+    .mm_size = (size_t)fsize,
+    .mm_file_info = file_info,
+    .mm_fd = -1,
+  };
+  kv_push(map.mm_index, 0);
+
+  // Count the lines and remember where every MLMAP_STRIDE'th line starts,
+  // checking for illegal bytes like the UTF-8 check in readfile() does.
+  linenr_T line_count = 0;
+  char *end = base + fsize;
+  for (char *p = base; p < end;) {
+    char *nl = memchr(p, NL, (size_t)(end - p));
+    char *eol = nl != NULL ? nl : end;
+    if (eol - p >= MAXCOL || line_count == MAXLNUM - 1) {
+      goto fail;
+    }
+    if (!buf->b_p_bin) {
+      for (const char *q = p; (q = utf_skip_ascii(q, (size_t)(eol - q))) < eol;) {
+        int l = utf_ptr2len_len(q, (int)(eol - q));
+        if (l == 1 || l > eol - q) {
+          goto fail;
+        }
+        q += l;
+      }
+    }
+    line_count++;
+    if (nl == NULL) {
+      break;
+    }
+    p = nl + 1;
+    if (line_count % MLMAP_STRIDE == 0 && p < end) {
+      kv_push(map.mm_index, (size_t)(p - base));
+    }
+    if ((line_count & 0xffff) == 0) {
+      os_breakcheck();
+      if (got_int) {
+        goto fail;
+      }
+    }
+  }
+
+  // Keep the file open, to notice when it is changed by another program.
+  map.mm_fd = os_dup(fd);
+  if (map.mm_fd < 0) {
+    goto fail;
+  }
+  os_set_cloexec(map.mm_fd);
+
+  ml_map_attach(buf, &map, line_count);
+  *filesizep = (off_T)fsize;
+  return true;
+
+fail:
+  kv_destroy(map.mm_index);
+  os_munmap(base, (size_t)fsize);
+  return false;
+#else
+  return false;
+#endif
+}
+
+/// @return  true when the file mapping of "buf" ends in a line break.
+static bool readfile_map_has_eol(buf_T *buf)
+{
+  return buf->b_ml.ml_map->mm_eol;
+}
+
 /// From the current line count and characters read after that, estimate the
 /// line number where we are now.
 /// Used for error messages that include a line number.
@@ -1911,10 +2062,8 @@ bool is_dev_fd_file(char *fname)
 static linenr_T readfile_linenr(linenr_T linecnt, char *p, const char *endp)
 {
   linenr_T lnum = curbuf->b_ml.ml_line_count - linecnt + 1;
-  for (char *s = p; s < endp; s++) {
-    if (*s == '\n') {
-      lnum++;
-    }
+  for (const char *s = p; (s = memchr(s, NL, (size_t)(endp - s))) != NULL; s++) {
+    lnum++;
   }
   return lnum;
 }
@@ -99,6 +99,10 @@
 # undef FUNC_ATTR_PRINTF
 #endif
 
+#ifdef FUNC_ATTR_TARGET_AVX2
+# undef FUNC_ATTR_TARGET_AVX2
+#endif
+
 #ifndef DID_REAL_ATTR
 # define DID_REAL_ATTR
 # ifdef __GNUC__
@@ -140,6 +144,12 @@
 #   define REAL_FATTR_NO_SANITIZE_ADDRESS \
   __attribute__((no_sanitize_address))
 #  endif
+
+// Compile the function with AVX2 instructions.  It may only be called after
+// checking that the CPU has them.
+#  ifdef HAVE_AVX2_INTRINSICS
+#   define REAL_FATTR_TARGET_AVX2 __attribute__((target("avx2")))
+#  endif
 # endif
 
 // Define attributes that are not defined for this compiler.
@@ -207,6 +217,10 @@
 # ifndef REAL_FATTR_PRINTF
 #  define REAL_FATTR_PRINTF(x, y)
 # endif
+
+# ifndef REAL_FATTR_TARGET_AVX2
+#  define REAL_FATTR_TARGET_AVX2
+# endif
 #endif
 
 #if defined(DEFINE_FUNC_ATTRIBUTES) || defined(DEFINE_EMPTY_ATTRIBUTES)
@@ -222,6 +236,8 @@
 # define FUNC_API_LUA_ONLY
 /// API function fails during textlock.
 # define FUNC_API_TEXTLOCK
+/// API function does not change any state, it only gets information.
+# define FUNC_API_READONLY
 /// API function fails during textlock, but allows cmdwin.
 # define FUNC_API_TEXTLOCK_ALLOW_CMDWIN
 /// API function introduced at the given API level.
@@ -247,6 +263,7 @@
 # define FUNC_ATTR_NO_SANITIZE_UNDEFINED REAL_FATTR_NO_SANITIZE_UNDEFINED
 # define FUNC_ATTR_NO_SANITIZE_ADDRESS REAL_FATTR_NO_SANITIZE_ADDRESS
 # define FUNC_ATTR_PRINTF(x, y) REAL_FATTR_PRINTF(x, y)
+# define FUNC_ATTR_TARGET_AVX2 REAL_FATTR_TARGET_AVX2
 #elif defined(DEFINE_EMPTY_ATTRIBUTES)
 # define FUNC_ATTR_MALLOC
 # define FUNC_ATTR_ALLOC_SIZE(x)
@@ -264,4 +281,5 @@
 # define FUNC_ATTR_NO_SANITIZE_UNDEFINED
 # define FUNC_ATTR_NO_SANITIZE_ADDRESS
 # define FUNC_ATTR_PRINTF(x, y)
+# define FUNC_ATTR_TARGET_AVX2
 #endif
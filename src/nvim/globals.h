@@ -85,7 +85,13 @@ EXTERN struct nvim_stats_s {
   int64_t fsync;
   int64_t redraw;
   int16_t log_skip;  // How many logs were tried and skipped before log_init.
-} g_stats INIT( = { 0, 0, 0 });
+  int64_t mf_compressed;        // Bytes used by compressed memfile blocks.
+  int64_t mf_compressed_raw;    // Size of these blocks when not compressed.
+  int64_t glyph_cache_hits;     // Glyphs found in the glyph cache.
+  int64_t glyph_cache_misses;   // Glyphs added to the glyph cache.
+  int64_t glyph_cache_evictions;  // Times the glyph cache was full.
+  int64_t glyph_cache_evicted;  // Glyphs removed from the glyph cache.
+} g_stats INIT( = { 0, 0, 0, 0, 0, 0, 0, 0, 0 });
 
 // Values for "starting".
 #define NO_SCREEN       2       // no screen updating yet
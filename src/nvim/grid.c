@@ -17,7 +17,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "auto/config.h"
 #include "nvim/api/private/defs.h"
+#include "nvim/api/ui.h"
 #include "nvim/arabic.h"
 #include "nvim/ascii_defs.h"
 #include "nvim/buffer_defs.h"
@@ -27,15 +29,28 @@
 #include "nvim/highlight.h"
 #include "nvim/log.h"
 #include "nvim/map_defs.h"
+#include "nvim/math.h"
 #include "nvim/mbyte.h"
 #include "nvim/memory.h"
 #include "nvim/message.h"
 #include "nvim/option_vars.h"
 #include "nvim/optionstr.h"
+#include "nvim/popupmenu.h"
+#include "nvim/sign.h"
+#include "nvim/terminal.h"
 #include "nvim/types_defs.h"
 #include "nvim/ui.h"
 #include "nvim/ui_defs.h"
 
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+# include <emmintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+# define HAVE_SSE2
+#endif
+
 #include "grid.c.generated.h"
 
 // temporary buffer for rendering a single screenline, so it can be
@@ -50,8 +65,26 @@ static size_t linebuf_size = 0;
 // back to a string buffer.
 //
 // The maximum byte size of a glyph is MAX_SCHAR_SIZE (including the final NUL).
+//
+// When the cache is full, the glyphs still referenced by the grids and other
+// holders of schar_T values are moved to a new generation of the cache, and
+// the other glyphs are evicted. See schar_cache_evict_if_full().
 static Set(glyph) glyph_cache = SET_INIT;
 
+// The previous generation of glyph_cache, while glyphs are moved out of it.
+static Set(glyph) glyph_cache_old = SET_INIT;
+static bool glyph_cache_evicting = false;
+
+// note: critical max is really (1<<24)-1. This gives us some marginal
+// until next time update_screen() is called
+#define GLYPH_CACHE_MAX (1<<21)
+
+#ifdef ORDER_BIG_ENDIAN
+# define schar_idx(sc) (sc & (0x00FFFFFF))
+#else
+# define schar_idx(sc) (sc >> 8)
+#endif
+
 /// Determine if dedicated window grid should be used or the default_grid
 ///
 /// If UI did not request multigrid support, draw all windows on the
@@ -88,39 +121,159 @@ schar_T schar_from_buf(const char *buf, size_t len)
     memcpy((char *)&sc, buf, len);
     return sc;
   } else {
-    String str = { .data = (char *)buf, .size = len };
-
     MHPutStatus status;
-    uint32_t idx = set_put_idx(glyph, &glyph_cache, str, &status);
-    assert(idx < 0xFFFFFF);
+    schar_T sc = schar_cache_put(buf, len, &status);
+    if (status == kMHExisting) {
+      g_stats.glyph_cache_hits++;
+    } else {
+      g_stats.glyph_cache_misses++;
+    }
+    return sc;
+  }
+}
+
+static schar_T schar_cache_put(const char *buf, size_t len, MHPutStatus *status)
+{
+  String str = { .data = (char *)buf, .size = len };
+  uint32_t idx = set_put_idx(glyph, &glyph_cache, str, status);
+  assert(idx < 0xFFFFFF);
 #ifdef ORDER_BIG_ENDIAN
-    return idx + ((uint32_t)0xFF << 24);
+  return idx + ((uint32_t)0xFF << 24);
 #else
-    return 0xFF + (idx << 8);
+  return 0xFF + (idx << 8);
 #endif
-  }
 }
 
-/// Check if cache is full, and if it is, clear it.
+/// Check if cache is full, and if it is, evict the glyphs which are not
+/// referenced anymore.
+///
+/// The glyphs referenced by the grids, decorations, signs, terminals and char
+/// options are kept, and these schar_T values are updated to refer to the new cache.
+/// Only if that doesn't free enough space, the cache is cleared.
 ///
 /// This should normally only be called in update_screen()
 ///
-/// @return true if cache was clered, and all your screen buffers now are hosed
+/// @return true if cache was cleared, and all your screen buffers now are hosed
 /// and you need to use UPD_CLEAR
-bool schar_cache_clear_if_full(void)
+bool schar_cache_evict_if_full(void)
+{
+  return schar_cache_full() && schar_cache_evict();
+}
+
+/// Evicts the glyphs not referenced anymore, see schar_cache_evict_if_full().
+bool schar_cache_evict(void)
 {
-  // note: critical max is really (1<<24)-1. This gives us some marginal
-  // until next time update_screen() is called
-  if (glyph_cache.h.n_keys > (1<<21)) {
-    schar_cache_clear();
+  schar_cache_evict_start();
+  schar_cache_keep_grid(&default_grid);
+  schar_cache_keep_grid(&msg_grid);
+  schar_cache_keep_grid(&pum_grid);
+  FOR_ALL_TAB_WINDOWS(tp, wp) {
+    schar_cache_keep_grid(&wp->w_grid_alloc);
+  }
+  decor_keep_glyphs();
+  sign_keep_glyphs();
+  terminal_keep_glyphs();
+  remote_ui_keep_glyphs();
+  schar_cache_evict_finish();
+
+  // Regenerate the parsed schar_T values of char options in the new cache.
+  // This must not return an error as cell widths have not changed.
+  if (check_chars_options()) {
+    abort();
+  }
+
+  if (glyph_cache.h.n_keys > GLYPH_CACHE_MAX / 2) {
+    // Already counted as an eviction.
+    g_stats.glyph_cache_evicted += glyph_cache.h.size;
+    schar_cache_reset();
     return true;
   }
   return false;
 }
 
+/// @return true if the glyph cache is full, and schar_cache_evict_start() should be
+/// called when it is safe to move the glyphs in use.
+bool schar_cache_full(void)
+{
+  return glyph_cache.h.n_keys > GLYPH_CACHE_MAX;
+}
+
+/// Start a new generation of the glyph cache.
+///
+/// Until schar_cache_evict_finish(), schar_cache_keep() must be called for every
+/// schar_T value still in use, and other values must not be looked up.
+void schar_cache_evict_start(void)
+{
+  assert(!glyph_cache_evicting);
+  glyph_cache_old = glyph_cache;
+  glyph_cache = (Set(glyph)) SET_INIT;
+  glyph_cache_evicting = true;
+}
+
+/// Moves the glyph of "sc" to the new generation of the glyph cache.
+///
+/// @return the value which refers to the glyph in the new generation.
+schar_T schar_cache_keep(schar_T sc)
+{
+  assert(glyph_cache_evicting);
+  if (!schar_high(sc)) {
+    return sc;
+  }
+  uint32_t idx = schar_idx(sc);
+  if (idx >= glyph_cache_old.h.n_keys) {
+    // Left from before schar_cache_clear() in a grid which is not shown and
+    // will be redrawn.
+    return schar_from_ascii(' ');
+  }
+  const char *str = &glyph_cache_old.keys[idx];
+  MHPutStatus status;
+  return schar_cache_put(str, strlen(str), &status);
+}
+
+void schar_cache_keep_buf(schar_T *buf, size_t len)
+{
+  for (size_t i = 0; i < len; i++) {
+    buf[i] = schar_cache_keep(buf[i]);
+  }
+}
+
+static void schar_cache_keep_grid(ScreenGrid *grid)
+{
+  if (grid->chars != NULL) {
+    schar_cache_keep_buf(grid->chars, (size_t)grid->rows * (size_t)grid->cols);
+  }
+}
+
+/// Frees the previous generation of the glyph cache, and the glyphs which
+/// were not kept.
+void schar_cache_evict_finish(void)
+{
+  assert(glyph_cache_evicting);
+  g_stats.glyph_cache_evictions++;
+  g_stats.glyph_cache_evicted += glyph_cache_old.h.size - glyph_cache.h.size;
+  set_destroy(glyph, &glyph_cache_old);
+  glyph_cache_evicting = false;
+}
+
+/// @return the number of glyphs in the cache.
+size_t schar_cache_size(void)
+{
+  return glyph_cache.h.size;
+}
+
 void schar_cache_clear(void)
+{
+  g_stats.glyph_cache_evictions++;
+  g_stats.glyph_cache_evicted += glyph_cache.h.size;
+  schar_cache_reset();
+}
+
+/// Clears the glyph cache, and forgets the glyphs held outside the grids.
+static void schar_cache_reset(void)
 {
   decor_check_invalid_glyphs();
+  terminal_forget_glyphs();
+  remote_ui_forget_glyphs();
   set_clear(glyph, &glyph_cache);
 
   // for char options we have stored the original strings. Regenerate
@@ -140,12 +293,6 @@ bool schar_high(schar_T sc)
 #endif
 }
 
-#ifdef ORDER_BIG_ENDIAN
-# define schar_idx(sc) (sc & (0x00FFFFFF))
-#else
-# define schar_idx(sc) (sc >> 8)
-#endif
-
 /// sets final NUL
 size_t schar_get(char *buf_out, schar_T sc)
 {
@@ -648,6 +795,175 @@ static int grid_char_needs_redraw(ScreenGrid *grid, int col, size_t off_to, int
               || rdb_flags & kOptRdbFlagNodelta));
 }
 
+static CellCmpImpl cell_cmp_impl = kCellCmpScalar;
+static bool cell_cmp_checked = false;
+
+/// @return  the fastest way to compare cells which this CPU supports.
+static CellCmpImpl cell_cmp_supported(void)
+{
+#ifdef HAVE_AVX2_INTRINSICS
+  if (__builtin_cpu_supports("avx2")) {
+    return kCellCmpAVX2;
+  }
+#endif
+#ifdef HAVE_SSE2
+  return kCellCmpSSE2;
+#else
+  return kCellCmpScalar;
+#endif
+}
+
+/// Selects how grid_put_linebuf() finds the changed cells, for testing.
+///
+/// @return  "impl", or the fastest supported one when the CPU lacks it.
+CellCmpImpl grid_set_cell_cmp(CellCmpImpl impl)
+{
+  cell_cmp_impl = MIN(impl, cell_cmp_supported());
+  cell_cmp_checked = true;
+  return cell_cmp_impl;
+}
+
+/// Finds the cells from "start" to "end" (exclusive) where "chars1" and
+/// "attrs1" differ from "chars2" and "attrs2".
+///
+/// @param[out] first  the first differing cell, "end" when there is none
+/// @param[out] last   one past the last differing cell, "start" when there is none
+void grid_cells_diff(const schar_T *chars1, const sattr_T *attrs1, const schar_T *chars2,
+                     const sattr_T *attrs2, int start, int end, int *first, int *last)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (!cell_cmp_checked) {
+    grid_set_cell_cmp(kCellCmpAVX2);
+  }
+  switch (cell_cmp_impl) {
+  case kCellCmpAVX2:
+    *first = cells_first_diff_avx2(chars1, attrs1, chars2, attrs2, start, end);
+    *last = cells_last_diff_avx2(chars1, attrs1, chars2, attrs2, *first, end);
+    break;
+  case kCellCmpSSE2:
+    *first = cells_first_diff_sse2(chars1, attrs1, chars2, attrs2, start, end);
+    *last = cells_last_diff_sse2(chars1, attrs1, chars2, attrs2, *first, end);
+    break;
+  default:
+    *first = cells_first_diff(chars1, attrs1, chars2, attrs2, start, end);
+    *last = cells_last_diff(chars1, attrs1, chars2, attrs2, *first, end);
+    break;
+  }
+  if (*first == end) {
+    *last = start;
+  }
+}
+
+static int cells_first_diff(const schar_T *chars1, const sattr_T *attrs1, const schar_T *chars2,
+                            const sattr_T *attrs2, int start, int end)
+{
+  int i = start;
+  while (i < end && chars1[i] == chars2[i] && attrs1[i] == attrs2[i]) {
+    i++;
+  }
+  return i;
+}
+
+static int cells_last_diff(const schar_T *chars1, const sattr_T *attrs1, const schar_T *chars2,
+                           const sattr_T *attrs2, int start, int end)
+{
+  int i = end;
+  while (i > start && chars1[i - 1] == chars2[i - 1] && attrs1[i - 1] == attrs2[i - 1]) {
+    i--;
+  }
+  return i;
+}
+
+/// @return  the index of the highest bit set in "mask", which must not be zero.
+static int mask_last_bit(unsigned mask)
+{
+  int bit = 0;
+  while (mask >>= 1) {
+    bit++;
+  }
+  return bit;
+}
+
+// The vectorized variants compare four (SSE2) or eight (AVX2) cells at a time.
+// In the mask a bit is set for each cell which differs.  They are only
+// selected by grid_set_cell_cmp() when the CPU supports them.
+
+#define CELLS_NE_SSE2(i) \
+  ((unsigned)_mm_movemask_ps(_mm_castsi128_ps(_mm_and_si128( \
+    _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(chars1 + (i))), \
+                    _mm_loadu_si128((const __m128i *)(chars2 + (i)))), \
+    _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(attrs1 + (i))), \
+                    _mm_loadu_si128((const __m128i *)(attrs2 + (i))))))) ^ 0xfU)
+
+static int cells_first_diff_sse2(const schar_T *chars1, const sattr_T *attrs1,
+                                 const schar_T *chars2, const sattr_T *attrs2, int start, int end)
+{
+  int i = start;
+#ifdef HAVE_SSE2
+  for (; i + 4 <= end; i += 4) {
+    unsigned ne = CELLS_NE_SSE2(i);
+    if (ne) {
+      return i + xctz(ne);
+    }
+  }
+#endif
+  return cells_first_diff(chars1, attrs1, chars2, attrs2, i, end);
+}
+
+static int cells_last_diff_sse2(const schar_T *chars1, const sattr_T *attrs1,
+                                const schar_T *chars2, const sattr_T *attrs2, int start, int end)
+{
+  int i = end;
+#ifdef HAVE_SSE2
+  for (; i - 4 >= start; i -= 4) {
+    unsigned ne = CELLS_NE_SSE2(i - 4);
+    if (ne) {
+      return i - 4 + mask_last_bit(ne) + 1;
+    }
+  }
+#endif
+  return cells_last_diff(chars1, attrs1, chars2, attrs2, start, i);
+}
+
+#define CELLS_NE_AVX2(i) \
+  ((unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256( \
+    _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(chars1 + (i))), \
+                       _mm256_loadu_si256((const __m256i *)(chars2 + (i)))), \
+    _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(attrs1 + (i))), \
+                       _mm256_loadu_si256((const __m256i *)(attrs2 + (i))))))) ^ 0xffU)
+
+static int cells_first_diff_avx2(const schar_T *chars1, const sattr_T *attrs1,
+                                 const schar_T *chars2, const sattr_T *attrs2, int start, int end)
+  FUNC_ATTR_TARGET_AVX2
+{
+  int i = start;
+#ifdef HAVE_AVX2_INTRINSICS
+  for (; i + 8 <= end; i += 8) {
+    unsigned ne = CELLS_NE_AVX2(i);
+    if (ne) {
+      return i + xctz(ne);
+    }
+  }
+#endif
+  return cells_first_diff(chars1, attrs1, chars2, attrs2, i, end);
+}
+
+static int cells_last_diff_avx2(const schar_T *chars1, const sattr_T *attrs1,
+                                const schar_T *chars2, const sattr_T *attrs2, int start, int end)
+  FUNC_ATTR_TARGET_AVX2
+{
+  int i = end;
+#ifdef HAVE_AVX2_INTRINSICS
+  for (; i - 8 >= start; i -= 8) {
+    unsigned ne = CELLS_NE_AVX2(i - 8);
+    if (ne) {
+      return i - 8 + mask_last_bit(ne) + 1;
+    }
+  }
+#endif
+  return cells_last_diff(chars1, attrs1, chars2, attrs2, start, i);
+}
+
 /// Move one buffered line to the window grid, but only the characters that
 /// have actually changed.  Handle insert/delete character.
 ///
@@ -712,12 +1028,34 @@ void grid_put_linebuf(ScreenGrid *grid, int row, int coloff, int col, int endcol
     }
   }
 
+  if (col < endcol) {
+    memcpy(grid->vcols + off_to + col, linebuf_vcol + col,
+           (size_t)(endcol - col) * sizeof(*grid->vcols));
+  }
+
+  // Only look at the characters from the first to the last changed cell.
+  int check_end = endcol;
+  if (col < endcol && !exmode_active && !(rdb_flags & kOptRdbFlagNodelta)) {
+    int first, last;
+    grid_cells_diff(linebuf_char, linebuf_attr, grid->chars + off_to, grid->attrs + off_to,
+                    col, endcol, &first, &last);
+    // Include the whole double-width chars at the edges.
+    if (first > col && first < endcol && linebuf_char[first] == 0) {
+      first--;
+    }
+    if (last < endcol && linebuf_char[last] == 0) {
+      last++;
+    }
+    col = first;
+    check_end = last;
+  }
+
   redraw_next = grid_char_needs_redraw(grid, col, off_to + (size_t)col, endcol - col);
 
   int start_dirty = -1;
   int end_dirty = 0;
 
-  while (col < endcol) {
+  while (col < check_end) {
     int char_cells = 1;  // 1: normal char
                          // 2: occupies two display cells
     if (col + 1 < endcol && linebuf_char[col + 1] == 0) {
@@ -757,11 +1095,6 @@ void grid_put_linebuf(ScreenGrid *grid, int row, int coloff, int col, int endcol
       }
     }
 
-    grid->vcols[off] = linebuf_vcol[col];
-    if (char_cells == 2) {
-      grid->vcols[off + 1] = linebuf_vcol[col + 1];
-    }
-
     col += char_cells;
   }
 
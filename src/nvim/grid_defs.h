@@ -119,3 +119,10 @@ typedef struct {
   int clear_width;
   bool wrap;
 } GridLineEvent;
+
+/// Ways to find the changed cells in grid_put_linebuf(), slowest first.
+typedef enum {
+  kCellCmpScalar,
+  kCellCmpSSE2,
+  kCellCmpAVX2,
+} CellCmpImpl;
@@ -0,0 +1,214 @@
+// Compression with the LZ4 block format.
+//
+// Only the block format is implemented, not the frame format: the caller
+// keeps track of the compressed and uncompressed sizes.  The compressor is
+// the simple greedy one with a single hash table, it favours speed over
+// compression ratio.
+//
+// A block is a sequence of sequences.  Each sequence is a token byte, whose
+// high four bits are the number of literals and low four bits the match
+// length minus LZ4_MINMATCH, followed by extra length bytes for the literals
+// when the count is 15, the literals, a two byte little endian offset of
+// the match and extra length bytes for the match when its length is 15.  The
+// last sequence only has literals.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "nvim/lz4.h"
+
+#include "lz4.c.generated.h"
+
+enum {
+  LZ4_MINMATCH = 4,        ///< minimal length of a match
+  LZ4_LASTLITERALS = 5,    ///< the last bytes are always literals
+  LZ4_MFLIMIT = 12,        ///< a match must start this far before the end
+  LZ4_MAX_OFFSET = 65535,  ///< maximal distance to a match
+  LZ4_HASH_LOG = 12,       ///< log2 of the number of hash table entries
+};
+
+static inline uint32_t lz4_read32(const uint8_t *p)
+{
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint32_t lz4_hash(uint32_t v)
+{
+  return (v * 2654435761U) >> (32 - LZ4_HASH_LOG);
+}
+
+/// Store the extra bytes for length "len", which is at least 15.
+static uint8_t *lz4_put_length(uint8_t *op, size_t len)
+{
+  len -= 15;
+  while (len >= 255) {
+    *op++ = 255;
+    len -= 255;
+  }
+  *op++ = (uint8_t)len;
+  return op;
+}
+
+/// Add the extra bytes of a length to "len".
+///
+/// @return  false when the input ends early.
+static bool lz4_get_length(const uint8_t **ipp, const uint8_t *iend, size_t *len)
+{
+  const uint8_t *ip = *ipp;
+  uint8_t b;
+  do {
+    if (ip >= iend) {
+      return false;
+    }
+    b = *ip++;
+    *len += b;
+  } while (b == 255);
+  *ipp = ip;
+  return true;
+}
+
+/// @return  worst case number of bytes for a sequence with "lit" literals
+///          and a match of length "mlen" (minus LZ4_MINMATCH).
+static size_t lz4_seq_size(size_t lit, size_t mlen)
+{
+  return 1 + lit + lit / 255 + 1 + 2 + mlen / 255 + 1;
+}
+
+/// Compress "len" bytes of "src" into "dst", which has room for "cap" bytes.
+///
+/// @return  the size of the compressed data, or zero when it does not fit in
+///          "cap" bytes (the data does not compress well).
+size_t lz4_compress(const char *src, size_t len, char *dst, size_t cap)
+  FUNC_ATTR_NONNULL_ALL
+{
+  const uint8_t *const base = (const uint8_t *)src;
+  const uint8_t *const iend = base + len;
+  const uint8_t *ip = base;
+  const uint8_t *anchor = base;
+  uint8_t *op = (uint8_t *)dst;
+  uint8_t *const oend = op + cap;
+
+  if (len > UINT32_MAX) {
+    return 0;
+  }
+
+  if (len >= LZ4_MFLIMIT + 1) {
+    const uint8_t *const mflimit = iend - LZ4_MFLIMIT;
+    const uint8_t *const matchlimit = iend - LZ4_LASTLITERALS;
+    uint32_t table[1 << LZ4_HASH_LOG] = { 0 };
+
+    while (ip < mflimit) {
+      uint32_t seq = lz4_read32(ip);
+      uint32_t h = lz4_hash(seq);
+      const uint8_t *ref = base + table[h];
+      table[h] = (uint32_t)(ip - base);
+      if (ref >= ip || ip - ref > LZ4_MAX_OFFSET || lz4_read32(ref) != seq) {
+        // Skip faster over data that does not compress.
+        ip += 1 + ((size_t)(ip - anchor) >> 6);
+        continue;
+      }
+
+      const uint8_t *mp = ip + LZ4_MINMATCH;
+      const uint8_t *rp = ref + LZ4_MINMATCH;
+      while (mp < matchlimit && *mp == *rp) {
+        mp++;
+        rp++;
+      }
+
+      size_t lit = (size_t)(ip - anchor);
+      size_t mlen = (size_t)(mp - ip) - LZ4_MINMATCH;
+      if (lz4_seq_size(lit, mlen) > (size_t)(oend - op)) {
+        return 0;
+      }
+      uint8_t *token = op++;
+      *token = (uint8_t)(((lit < 15 ? lit : 15) << 4) | (mlen < 15 ? mlen : 15));
+      if (lit >= 15) {
+        op = lz4_put_length(op, lit);
+      }
+      memcpy(op, anchor, lit);
+      op += lit;
+      size_t offset = (size_t)(ip - ref);
+      *op++ = (uint8_t)(offset & 0xff);
+      *op++ = (uint8_t)(offset >> 8);
+      if (mlen >= 15) {
+        op = lz4_put_length(op, mlen);
+      }
+      ip = anchor = mp;
+    }
+  }
+
+  // The last literals.
+  size_t lit = (size_t)(iend - anchor);
+  if (1 + lit + lit / 255 + 1 > (size_t)(oend - op)) {
+    return 0;
+  }
+  *op++ = (uint8_t)((lit < 15 ? lit : 15) << 4);
+  if (lit >= 15) {
+    op = lz4_put_length(op, lit);
+  }
+  memcpy(op, anchor, lit);
+  op += lit;
+
+  return (size_t)(op - (uint8_t *)dst);
+}
+
+/// Uncompress "srclen" bytes of "src" into "dst", which must become exactly
+/// "len" bytes.
+///
+/// @return  false when "src" is not valid compressed data for "len" bytes.
+bool lz4_decompress(const char *src, size_t srclen, char *dst, size_t len)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_WARN_UNUSED_RESULT
+{
+  const uint8_t *ip = (const uint8_t *)src;
+  const uint8_t *const iend = ip + srclen;
+  uint8_t *op = (uint8_t *)dst;
+  uint8_t *const oend = op + len;
+
+  while (ip < iend) {
+    unsigned token = *ip++;
+    size_t lit = token >> 4;
+    if (lit == 15 && !lz4_get_length(&ip, iend, &lit)) {
+      return false;
+    }
+    if (lit > (size_t)(iend - ip) || lit > (size_t)(oend - op)) {
+      return false;
+    }
+    memcpy(op, ip, lit);
+    op += lit;
+    ip += lit;
+    if (ip == iend) {
+      break;  // the last sequence has no match
+    }
+
+    if (iend - ip < 2) {
+      return false;
+    }
+    size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+    ip += 2;
+    size_t mlen = token & 15;
+    if (mlen == 15 && !lz4_get_length(&ip, iend, &mlen)) {
+      return false;
+    }
+    mlen += LZ4_MINMATCH;
+    if (offset == 0 || offset > (size_t)(op - (uint8_t *)dst)
+        || mlen > (size_t)(oend - op)) {
+      return false;
+    }
+    const uint8_t *match = op - offset;
+    if (offset >= mlen) {
+      memcpy(op, match, mlen);
+      op += mlen;
+    } else {
+      // Overlapping match: repeats the last "offset" bytes.
+      while (mlen-- > 0) {
+        *op++ = *match++;
+      }
+    }
+  }
+
+  return op == oend;
+}
@@ -123,6 +123,13 @@
 # define UNREACHABLE
 #endif
 
+// Storage class for a static variable of which each thread has its own copy.
+#if defined(_MSC_VER)
+# define THREAD_LOCAL __declspec(thread)
+#else
+# define THREAD_LOCAL __thread
+#endif
+
 // Type of uv_buf_t.len is platform-dependent.
 // Related: https://github.com/libuv/libuv/pull/1236
 #if defined(MSWIN)
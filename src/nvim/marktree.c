@@ -120,21 +120,24 @@ typedef kvec_withinit_t(Damage, 8) DamageList;
 
 #include "marktree.c.generated.h"
 
+// TODO(bfredl): MT_FLAG_REAL could go away if we fix marktree_getp_aux for real
+#define MT_CMP_MASK (MT_FLAG_RIGHT_GRAVITY | MT_FLAG_END | MT_FLAG_REAL | MT_FLAG_LAST)
+
+/// @return the position as a single integer which sorts like the position,
+/// so that row and col are compared at once.
+static inline int64_t pos_key(MTPos p)
+{
+  return (int64_t)p.row * ((int64_t)1 << 32) + p.col;
+}
+
 #define mt_generic_cmp(a, b) (((b) < (a)) - ((a) < (b)))
 static int key_cmp(MTKey a, MTKey b)
 {
-  int cmp = mt_generic_cmp(a.pos.row, b.pos.row);
+  int cmp = mt_generic_cmp(pos_key(a.pos), pos_key(b.pos));
   if (cmp != 0) {
     return cmp;
   }
-  cmp = mt_generic_cmp(a.pos.col, b.pos.col);
-  if (cmp != 0) {
-    return cmp;
-  }
-
-  // TODO(bfredl): MT_FLAG_REAL could go away if we fix marktree_getp_aux for real
-  const uint16_t cmp_mask = MT_FLAG_RIGHT_GRAVITY | MT_FLAG_END | MT_FLAG_REAL | MT_FLAG_LAST;
-  return mt_generic_cmp(a.flags & cmp_mask, b.flags & cmp_mask);
+  return mt_generic_cmp(a.flags & MT_CMP_MASK, b.flags & MT_CMP_MASK);
 }
 
 /// @return position of k if it exists in the node, otherwise the position
@@ -145,19 +148,19 @@ static inline int marktree_getp_aux(const MTNode *x, MTKey k, bool *match)
   bool dummy_match;
   bool *m = match ? match : &dummy_match;
 
-  int begin = 0;
-  int end = x->n;
   if (x->n == 0) {
     *m = false;
     return -1;
   }
-  while (begin < end) {
-    int mid = (begin + end) >> 1;
-    if (key_cmp(x->key[mid], k) < 0) {
-      begin = mid + 1;
-    } else {
-      end = mid;
-    }
+  // Count the keys before "k".  A node has few keys: looking at all of them
+  // without branching is faster than a binary search, whose branches cannot
+  // be predicted.
+  const int64_t k_pos = pos_key(k.pos);
+  const int k_flags = k.flags & MT_CMP_MASK;
+  int begin = 0;
+  for (int i = 0; i < x->n; i++) {
+    const int64_t pos = pos_key(x->key[i].pos);
+    begin += (pos < k_pos) | ((pos == k_pos) & ((x->key[i].flags & MT_CMP_MASK) < k_flags));
   }
   if (begin == x->n) {
     *m = false;
@@ -326,6 +329,173 @@ void marktree_put(MarkTree *b, MTKey key, int end_row, int end_col, bool end_rig
   }
 }
 
+static int key_cmp_many(const void *a, const void *b)
+{
+  const MTKey *ka = a;
+  const MTKey *kb = b;
+  int cmp = key_cmp(*ka, *kb);
+  if (cmp != 0) {
+    return cmp;
+  }
+  // same as repeated marktree_put(): a later mark goes after an earlier one
+  cmp = mt_generic_cmp(ka->ns, kb->ns);
+  return cmp != 0 ? cmp : mt_generic_cmp(ka->id, kb->id);
+}
+
+/// Put many marks at once, like calling marktree_put() for each of "pairs".
+///
+/// When "pairs" is large compared to the tree, all keys are collected in
+/// order and the tree is rebuilt bottom-up with full nodes, which is linear in
+/// the number of keys instead of a descent (and node splits) for every key.
+void marktree_put_many(MarkTree *b, MTPair *pairs, size_t n)
+{
+  if (n == 0) {
+    return;
+  } else if (n < b->n_keys / 4) {
+    for (size_t i = 0; i < n; i++) {
+      marktree_put(b, pairs[i].start, pairs[i].end_pos.row, pairs[i].end_pos.col,
+                   pairs[i].end_right_gravity);
+    }
+    return;
+  }
+
+  size_t n_old = b->n_keys;
+  MTKey *keys = xmalloc((n_old + 2 * n) * sizeof(*keys));
+  MTKey *new_keys = keys + n_old;
+
+  size_t n_new = 0;
+  bool sorted = true;
+  for (size_t i = 0; i < n; i++) {
+    MTKey key = pairs[i].start;
+    assert(!(key.flags & ~(MT_FLAG_EXTERNAL_MASK | MT_FLAG_RIGHT_GRAVITY)));
+    key.flags |= MT_FLAG_REAL;
+    if (pairs[i].end_pos.row >= 0) {
+      key.flags |= MT_FLAG_PAIRED;
+    }
+    new_keys[n_new++] = key;
+    if (pairs[i].end_pos.row >= 0) {
+      MTKey end_key = key;
+      end_key.flags = (uint16_t)((uint16_t)(key.flags & ~MT_FLAG_RIGHT_GRAVITY)
+                                 |(uint16_t)MT_FLAG_END
+                                 |(uint16_t)(pairs[i].end_right_gravity
+                                             ? MT_FLAG_RIGHT_GRAVITY : 0));
+      end_key.pos = pairs[i].end_pos;
+      new_keys[n_new++] = end_key;
+    }
+  }
+  for (size_t i = 1; i < n_new && sorted; i++) {
+    sorted = key_cmp_many(&new_keys[i - 1], &new_keys[i]) <= 0;
+  }
+  if (!sorted) {
+    qsort(new_keys, n_new, sizeof(*new_keys), key_cmp_many);
+  }
+
+  if (n_old > 0) {
+    // Merge with the existing keys. These go first, an existing key is never
+    // moved after a new key at the same position.
+    MTKey *old_keys = xmalloc(n_old * sizeof(*old_keys));
+    MarkTreeIter itr[1];
+    size_t n_it = 0;
+    marktree_itr_first(b, itr);
+    while (itr->x) {
+      old_keys[n_it++] = marktree_itr_current(itr);
+      marktree_itr_next(b, itr);
+    }
+    assert(n_it == n_old);
+
+    size_t i = 0, j = 0, k = 0;
+    while (i < n_old && j < n_new) {
+      keys[k++] = key_cmp(old_keys[i], new_keys[j]) <= 0 ? old_keys[i++] : new_keys[j++];
+    }
+    while (i < n_old) {
+      keys[k++] = old_keys[i++];
+    }
+    // any remaining new keys are already in place
+    xfree(old_keys);
+  }
+
+  marktree_clear(b);
+  size_t n_keys = n_old + n_new;
+  b->root = marktree_build(b, keys, n_keys);
+  xfree(keys);
+  b->n_keys = n_keys;
+  meta_describe_node(b->meta_root, b->root);
+  marktree_intersect_all(b);
+}
+
+/// Build a tree of all the "n" keys, which are sorted and have absolute
+/// positions. The keys are used as scratch space.
+///
+/// Each level is built from the keys left over by the level below it: the
+/// keys are divided evenly over as few nodes as possible, with one key in
+/// between every two nodes which goes up to the next level.
+///
+/// @return the root node
+static MTNode *marktree_build(MarkTree *b, MTKey *keys, size_t n)
+{
+  MTNode **children = NULL;
+  int level = 0;
+  size_t m = n;
+  while (true) {
+    size_t count = m <= 2 * T - 1 ? 1 : (m + 2 * T) / (2 * T);
+    size_t per_node = (m - (count - 1)) / count;
+    size_t extra = (m - (count - 1)) % count;
+    MTNode **nodes = xmalloc(count * sizeof(*nodes));
+    size_t src = 0, dst = 0;
+    for (size_t j = 0; j < count; j++) {
+      int nk = (int)per_node + (j < extra ? 1 : 0);
+      MTNode *x = marktree_alloc_node(b, level > 0 || count == 1);
+      x->level = (int16_t)level;
+      x->n = nk;
+      memcpy(x->key, &keys[src], (size_t)nk * sizeof(*keys));
+      for (int i = 0; i < nk; i++) {
+        refkey(b, x, i);
+      }
+      if (level > 0) {
+        // the first key of a node and its first child have the same index
+        for (int i = 0; i < nk + 1; i++) {
+          MTNode *child = children[src + (size_t)i];
+          x->ptr[i] = child;
+          child->parent = x;
+          child->p_idx = (int16_t)i;
+          meta_describe_node(x->meta[i], child);
+        }
+      }
+      nodes[j] = x;
+      src += (size_t)nk;
+      if (j + 1 < count) {
+        keys[dst++] = keys[src++];
+      }
+    }
+    xfree(children);
+    children = nodes;
+    if (count == 1) {
+      break;
+    }
+    m = dst;
+    level++;
+  }
+
+  MTNode *root = children[0];
+  xfree(children);
+  marktree_build_relative(root, MTPos(0, 0));
+  return root;
+}
+
+/// Make the absolute key positions of the subtree "x" relative, "base" being
+/// the position the keys of "x" are relative to.
+static void marktree_build_relative(MTNode *x, MTPos base)
+{
+  if (x->level) {
+    for (int i = 0; i < x->n + 1; i++) {
+      marktree_build_relative(x->ptr[i], i == 0 ? base : x->key[i - 1].pos);
+    }
+  }
+  for (int i = 0; i < x->n; i++) {
+    relative(base, &x->key[i].pos);
+  }
+}
+
 // this is currently not used very often, but if it was it should use binary search
 static bool intersection_has(Intersection *x, uint64_t id)
 {
@@ -439,6 +609,35 @@ void marktree_intersect_pair(MarkTree *b, uint64_t id, MarkTreeIter *itr, MarkTr
 #undef iat
 }
 
+/// Add the intersections of all pairs, for a tree without any.
+///
+/// Iterates over all marks. For each START mark of a pair, intersect the nodes
+/// between the pair.
+static void marktree_intersect_all(MarkTree *b)
+{
+  MarkTreeIter itr[1];
+  marktree_itr_first(b, itr);
+  while (true) {
+    MTKey mark = marktree_itr_current(itr);
+    if (mark.pos.row < 0) {
+      break;
+    }
+
+    if (mt_start(mark)) {
+      MarkTreeIter start_itr[1];
+      MarkTreeIter end_itr[1];
+      uint64_t end_id = mt_lookup_id(mark.ns, mark.id, true);
+      MTKey k = marktree_lookup(b, end_id, end_itr);
+      if (k.pos.row >= 0) {
+        *start_itr = *itr;
+        marktree_intersect_pair(b, mt_lookup_key(mark), start_itr, end_itr, false);
+      }
+    }
+
+    marktree_itr_next(b, itr);
+  }
+}
+
 static MTNode *marktree_alloc_node(MarkTree *b, bool internal)
 {
   MTNode *x = xcalloc(1, internal ? ILEN : sizeof(MTNode));
@@ -1860,7 +2059,9 @@ bool marktree_itr_step_overlap(MarkTree *b, MarkTreeIter *itr, MTPair *pair)
 
 static void swap_keys(MarkTree *b, MarkTreeIter *itr1, MarkTreeIter *itr2, DamageList *damage)
 {
-  if (itr1->x != itr2->x) {
+  // Also in the same inner node: the children between the two keys change
+  // which side of the moved pair ends they are on.
+  if (itr1->x != itr2->x || itr1->x->level) {
     if (mt_paired(rawkey(itr1))) {
       kvi_push(*damage, ((Damage){ mt_lookup_key(rawkey(itr1)), itr1->x, itr2->x,
                                    itr1->i, itr2->i }));
@@ -1908,14 +2109,6 @@ static void swap_keys(MarkTree *b, MarkTreeIter *itr1, MarkTreeIter *itr2, Damag
   refkey(b, itr2->x, itr2->i);
 }
 
-static int damage_cmp(const void *s1, const void *s2)
-{
-  Damage *d1 = (Damage *)s1;
-  Damage *d2 = (Damage *)s2;
-  assert(d1->id != d2->id);
-  return d1->id > d2->id ? 1 : -1;
-}
-
 bool marktree_splice(MarkTree *b, int32_t start_line, int start_col, int old_extent_line,
                      int old_extent_col, int new_extent_line, int new_extent_col)
 {
@@ -2072,18 +2265,20 @@ past_continue_same_node:
   }
 
   if (kv_size(damage)) {
-    // TODO(bfredl): a full sort is not really needed. we just need a "start" node to find
-    // its corresponding "end" node. Set up some dedicated hash for this later (c.f. the
-    // "grow only" variant of khash_t branch)
-    qsort((void *)&kv_A(damage, 0), kv_size(damage), sizeof(kv_A(damage, 0)),
-          damage_cmp);
+    // A full sort is not needed: a "start" item just needs to find its
+    // corresponding "end" item.
+    Map(uint64_t, ssize_t) damage_idx = MAP_INIT;
+    for (size_t i = 0; i < kv_size(damage); i++) {
+      map_put(uint64_t, ssize_t)(&damage_idx, kv_A(damage, i).id, (ssize_t)i);
+    }
+    assert(map_size(&damage_idx) == kv_size(damage));
 
     for (size_t i = 0; i < kv_size(damage); i++) {
       Damage d = kv_A(damage, i);
-      assert(i == 0 || d.id > kv_A(damage, i - 1).id);
       if (!(d.id & MARKTREE_END_FLAG)) {  // start
-        if (i + 1 < kv_size(damage) && kv_A(damage, i + 1).id == (d.id | MARKTREE_END_FLAG)) {
-          Damage d2 = kv_A(damage, i + 1);
+        ssize_t end_i = map_get(uint64_t, ssize_t)(&damage_idx, d.id | MARKTREE_END_FLAG);
+        if (end_i >= 0) {
+          Damage d2 = kv_A(damage, end_i);
 
           // pair
           marktree_itr_set_node(b, itr, d.old, d.old_i);
@@ -2092,8 +2287,6 @@ past_continue_same_node:
           marktree_itr_set_node(b, itr, d.new, d.new_i);
           marktree_itr_set_node(b, enditr, d2.new, d2.new_i);
           marktree_intersect_pair(b, d.id, itr, enditr, false);
-
-          i++;  // consume two items
           continue;
         }
 
@@ -2109,9 +2302,13 @@ past_continue_same_node:
           marktree_intersect_pair(b, d.id, itr, enditr, false);
         }
       } else {
+        uint64_t start_id = d.id & ~MARKTREE_END_FLAG;
+        if (map_has(uint64_t, &damage_idx, start_id)) {
+          continue;  // done together with the start
+        }
+
         // d is lone end, start didn't move
         MarkTreeIter startpos[1];
-        uint64_t start_id = d.id & ~MARKTREE_END_FLAG;
 
         marktree_lookup(b, start_id, startpos);
         if (startpos->x) {
@@ -2124,6 +2321,7 @@ past_continue_same_node:
         }
       }
     }
+    map_destroy(uint64_t, &damage_idx);
   }
   kvi_destroy(damage);
 
@@ -2402,29 +2600,8 @@ bool marktree_check_intersections(MarkTree *b)
   // 1. move x->intersect to checked[x] and reinit x->intersect
   mt_recurse_nodes(b->root, &checked);
 
-  // 2. iterate over all marks. for each START mark of a pair,
-  // intersect the nodes between the pair
-  MarkTreeIter itr[1];
-  marktree_itr_first(b, itr);
-  while (true) {
-    MTKey mark = marktree_itr_current(itr);
-    if (mark.pos.row < 0) {
-      break;
-    }
-
-    if (mt_start(mark)) {
-      MarkTreeIter start_itr[1];
-      MarkTreeIter end_itr[1];
-      uint64_t end_id = mt_lookup_id(mark.ns, mark.id, true);
-      MTKey k = marktree_lookup(b, end_id, end_itr);
-      if (k.pos.row >= 0) {
-        *start_itr = *itr;
-        marktree_intersect_pair(b, mt_lookup_key(mark), start_itr, end_itr, false);
-      }
-    }
-
-    marktree_itr_next(b, itr);
-  }
+  // 2. recreate the intersections
+  marktree_intersect_all(b);
 
   // 3. for each node check if the recreated intersection
   // matches the old checked[x] intersection.
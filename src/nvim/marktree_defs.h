@@ -9,11 +9,15 @@
 
 enum {
   MT_MAX_DEPTH     = 20,
+  // A node has between MT_BRANCH_FACTOR - 1 and 2*MT_BRANCH_FACTOR - 1 keys.
+  // Can be tuned: a larger value makes the tree shallower, at the cost of
+  // moving more keys around on insert and delete.
   MT_BRANCH_FACTOR = 10,
   // note max branch is actually 2*MT_BRANCH_FACTOR
   // and strictly this is ceil(log2(2*MT_BRANCH_FACTOR + 1))
   // as we need a pseudo-index for "right before this node"
-  MT_LOG2_BRANCH   = 5,
+  MT_LOG2_BRANCH   = (2 * MT_BRANCH_FACTOR + 1 <= 32 ? 5
+                      : 2 * MT_BRANCH_FACTOR + 1 <= 64 ? 6 : 7),
 };
 
 typedef struct {
@@ -30,6 +30,7 @@
 #include <locale.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -964,6 +965,31 @@ int utf_ptr2len_len(const char *p, int size)
   return len;
 }
 
+/// Skip over ASCII bytes, checking a word at a time.
+///
+/// @return  pointer to the first byte in "p[len]" that is 0x80 or above, or
+///          "p + len" when there is none.
+const char *utf_skip_ascii(const char *p, size_t len)
+  FUNC_ATTR_PURE FUNC_ATTR_WARN_UNUSED_RESULT FUNC_ATTR_NONNULL_RET
+{
+  const char *const end = p + len;
+
+  // Four words at a time, the OR of the high bits is enough to know the
+  // whole block is ASCII.  memcpy() is compiled into plain (unaligned) loads.
+  while (end - p >= (ptrdiff_t)(4 * sizeof(uint64_t))) {
+    uint64_t w[4];
+    memcpy(w, p, sizeof(w));
+    if (((w[0] | w[1] | w[2] | w[3]) & 0x8080808080808080ULL) != 0) {
+      break;
+    }
+    p += sizeof(w);
+  }
+  while (p < end && (uint8_t)(*p) < 0x80) {
+    p++;
+  }
+  return p;
+}
+
 /// Return the number of bytes occupied by a UTF-8 character in a string.
 /// This includes following composing characters.
 /// Returns zero for NUL.
@@ -16,6 +16,8 @@
 /// Each block can be in memory and/or in a file. The block stays in memory
 /// as long as it is locked. If it is no longer locked it can be swapped out to
 /// the file. It is only written to the file if it has been changed.
+/// Without a file, data blocks that were not used recently are compressed
+/// when 'memcompress' is set.
 ///
 /// Under normal operation the file is created when opening the memory file and
 /// deleted when closing the memory file. Only with recovery an existing memory
@@ -31,6 +33,7 @@
 /// mf_put()          unlock a block, may be marked for writing
 /// mf_free()         remove a block
 /// mf_sync()         sync changed parts of memfile to disk
+/// mf_sync_wait()    wait for the swap writer thread to finish
 /// mf_release_all()  release as much memory as possible
 /// mf_trans_del()    may translate negative to positive block number
 /// mf_fullname()     make file name full path (use before first :cd)
@@ -41,21 +44,26 @@
 #include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <uv.h>
 
+#include "klib/kvec.h"
 #include "nvim/assert_defs.h"
 #include "nvim/buffer_defs.h"
 #include "nvim/errors.h"
 #include "nvim/fileio.h"
 #include "nvim/gettext_defs.h"
 #include "nvim/globals.h"
+#include "nvim/lz4.h"
 #include "nvim/map_defs.h"
 #include "nvim/memfile.h"
 #include "nvim/memfile_defs.h"
 #include "nvim/memline.h"
 #include "nvim/memory.h"
 #include "nvim/message.h"
+#include "nvim/option_vars.h"
 #include "nvim/os/fs.h"
 #include "nvim/os/fs_defs.h"
 #include "nvim/os/input.h"
@@ -67,6 +75,39 @@
 
 #define MEMFILE_PAGE_SIZE 4096       /// default page size
 
+/// Pages at consecutive positions in the swap file, written with one call.
+typedef struct {
+  int64_t offset;                    ///< position of the first page
+  size_t size;                       ///< number of bytes
+  size_t iov_idx;                    ///< index of the first page in mfjob_T.iov
+  size_t iov_count;                  ///< number of items in mfjob_T.iov
+} mfrun_T;
+
+/// Write queued for the swap writer thread.  Contains a copy of the dirty
+/// blocks of a memfile, so that the main thread can go on changing them.
+typedef struct mfjob_S mfjob_T;
+struct mfjob_S {
+  memfile_T *mfp;
+  int fd;
+  bool fsync;                        ///< fsync() the file after writing
+  char *data;                        ///< copy of the blocks
+  kvec_t(uv_buf_t) iov;              ///< the blocks in "data"
+  kvec_t(mfrun_T) runs;
+  mfjob_T *next;
+};
+
+/// Thread that writes swap files for mf_sync() with MFS_ASYNC, so that a
+/// slow disk does not make typing stall.  The jobs are done in order.
+static struct {
+  bool started;                      ///< only used by the main thread
+  uv_thread_t thread;
+  uv_mutex_t mutex;
+  uv_cond_t work_cond;               ///< signaled when a job was queued
+  uv_cond_t done_cond;               ///< signaled when a job was done
+  mfjob_T *first;                    ///< job being done or next to do
+  mfjob_T *last;
+} mf_writer;
+
 #include "memfile.c.generated.h"
 
 static const char e_block_was_not_locked[] = N_("E293: Block was not locked");
@@ -101,6 +142,12 @@ memfile_T *mf_open(char *fname, int flags)
 
   mfp->mf_free_first = NULL;         // free list is empty
   mfp->mf_dirty = MF_DIRTY_NO;
+  mfp->mf_async_pending = 0;
+  mfp->mf_async_failed = false;
+  mfp->mf_async_infile_count = 0;
+  mfp->mf_lru_first = NULL;
+  mfp->mf_lru_last = NULL;
+  mfp->mf_lru_size = 0;
   mfp->mf_hash = (PMap(int64_t)) MAP_INIT;
   mfp->mf_trans = (Map(int64_t, int64_t)) MAP_INIT;
   mfp->mf_page_size = MEMFILE_PAGE_SIZE;
@@ -157,6 +204,7 @@ int mf_open_file(memfile_T *mfp, char *fname)
 {
   if (mf_do_open(mfp, fname, O_RDWR | O_CREAT | O_EXCL)) {
     mfp->mf_dirty = MF_DIRTY_YES;
+    mf_lru_clear(mfp);  // blocks are written to the file now
     return OK;
   }
 
@@ -171,6 +219,7 @@ void mf_close(memfile_T *mfp, bool del_file)
   if (mfp == NULL) {                    // safety check
     return;
   }
+  mf_sync_wait(mfp);
   if (mfp->mf_fd >= 0 && close(mfp->mf_fd) < 0) {
     emsg(_(e_swapclose));
   }
@@ -181,6 +230,9 @@ void mf_close(memfile_T *mfp, bool del_file)
   // free entries in used list
   bhdr_T *hp;
   map_foreach_value(&mfp->mf_hash, hp, {
+    if (hp->bh_flags & BH_COMPRESSED) {
+      mf_uncount(mfp, hp);
+    }
     mf_free_bhdr(hp);
   })
   while (mfp->mf_free_first != NULL) {  // free entries in free list
@@ -209,6 +261,7 @@ void mf_close_file(buf_T *buf, bool getlines)
     }
   }
 
+  mf_sync_wait(mfp);
   if (close(mfp->mf_fd) < 0) {           // close the file
     emsg(_(e_swapclose));
   }
@@ -266,6 +319,8 @@ bhdr_T *mf_new(memfile_T *mfp, bool negative, unsigned page_count)
     }
   }
   hp->bh_flags = BH_LOCKED | BH_DIRTY;    // new block is always dirty
+  hp->bh_pinned = 0;
+  hp->bh_lru_prev = hp->bh_lru_next = NULL;
   mfp->mf_dirty = MF_DIRTY_YES;
   hp->bh_page_count = page_count;
   pmap_put(int64_t)(&mfp->mf_hash, hp->bh_bnum, hp);
@@ -313,6 +368,13 @@ bhdr_T *mf_get(memfile_T *mfp, blocknr_T nr, unsigned page_count)
       return NULL;
     }
   } else {
+    if (hp->bh_flags & BH_COMPRESSED) {
+      if (!mf_uncompress(mfp, hp)) {
+        return NULL;
+      }
+    } else {
+      mf_lru_remove(mfp, hp);
+    }
     pmap_del(int64_t)(&mfp->mf_hash, hp->bh_bnum, NULL);
   }
 
@@ -344,11 +406,34 @@ void mf_put(memfile_T *mfp, bhdr_T *hp, bool dirty, bool infile)
   if (infile) {
     mf_trans_add(mfp, hp);      // may translate negative in positive nr
   }
+  if ((flags & BH_DATA) && hp->bh_pinned == 0) {
+    mf_lru_add(mfp, hp);
+  }
+}
+
+/// Keep the data of block "hp" where it is, also when it is not locked: it
+/// is not compressed or released until mf_unpin() was called as often as
+/// mf_pin().  The block must not be freed while it is pinned.
+void mf_pin(memfile_T *mfp, bhdr_T *hp)
+{
+  assert(!(hp->bh_flags & BH_COMPRESSED));
+  hp->bh_pinned++;
+  mf_lru_remove(mfp, hp);
+}
+
+/// Undo one mf_pin() of block "hp".
+void mf_unpin(memfile_T *mfp, bhdr_T *hp)
+{
+  assert(hp->bh_pinned > 0);
+  if (--hp->bh_pinned == 0 && (hp->bh_flags & (BH_LOCKED | BH_DATA)) == BH_DATA) {
+    mf_lru_add(mfp, hp);
+  }
 }
 
 /// Signal block as no longer used (may put it in the free list).
 void mf_free(memfile_T *mfp, bhdr_T *hp)
 {
+  mf_uncount(mfp, hp);
   xfree(hp->bh_data);           // free data
   pmap_del(int64_t)(&mfp->mf_hash, hp->bh_bnum, NULL);  // get *hp out of the hash table
   if (hp->bh_bnum < 0) {
@@ -368,6 +453,10 @@ void mf_free(memfile_T *mfp, bhdr_T *hp)
 ///               MFS_FLUSH  Make sure buffers are flushed to disk, so they will
 ///                          survive a system crash.
 ///               MFS_ZERO   Only write block 0.
+///               MFS_ASYNC  Copy the dirty blocks and let the swap writer
+///                          thread write them.  Does nothing when it is
+///                          still busy with the previous write.  Cannot be
+///                          used with MFS_ALL or MFS_ZERO.
 ///
 /// @return FAIL  If failure. Possible causes:
 ///               - No file (nothing to do).
@@ -383,6 +472,16 @@ int mf_sync(memfile_T *mfp, int flags)
     return FAIL;
   }
 
+  if (flags & MFS_ASYNC) {
+    assert(!(flags & (MFS_ALL | MFS_ZERO)));
+    if (mf_writer_start()) {
+      return mf_sync_async(mfp, flags);
+    }
+  }
+  // Blocks must be written in the order they were synced, e.g. block 0 must
+  // not get to the file before the data blocks it is about.
+  mf_sync_wait(mfp);
+
   // Only a CTRL-C while writing will break us here, not one typed previously.
   got_int = false;
 
@@ -437,6 +536,242 @@ int mf_sync(memfile_T *mfp, int flags)
   return status;
 }
 
+/// Start the swap writer thread, if not done already.
+///
+/// @return  false if the thread could not be started.
+static bool mf_writer_start(void)
+{
+  if (mf_writer.started) {
+    return true;
+  }
+  uv_mutex_init(&mf_writer.mutex);
+  uv_cond_init(&mf_writer.work_cond);
+  uv_cond_init(&mf_writer.done_cond);
+  if (uv_thread_create(&mf_writer.thread, mf_writer_main, NULL) != 0) {
+    uv_cond_destroy(&mf_writer.done_cond);
+    uv_cond_destroy(&mf_writer.work_cond);
+    uv_mutex_destroy(&mf_writer.mutex);
+    return false;
+  }
+  mf_writer.started = true;
+  return true;
+}
+
+/// Main function of the swap writer thread.  Runs until Nvim exits.
+static void mf_writer_main(void *arg)
+{
+  uv_mutex_lock(&mf_writer.mutex);
+  while (true) {
+    while (mf_writer.first == NULL) {
+      uv_cond_wait(&mf_writer.work_cond, &mf_writer.mutex);
+    }
+    mfjob_T *job = mf_writer.first;
+    uv_mutex_unlock(&mf_writer.mutex);
+
+    bool ok = true;
+    for (size_t i = 0; ok && i < kv_size(job->runs); i++) {
+      mfrun_T *run = &kv_A(job->runs, i);
+      ok = os_pwritev(job->fd, &kv_A(job->iov, run->iov_idx), run->iov_count, run->offset) >= 0;
+    }
+    if (ok && job->fsync) {
+      uv_fs_t req;
+      ok = uv_fs_fsync(NULL, &req, job->fd, NULL) >= 0;
+      uv_fs_req_cleanup(&req);
+    }
+
+    uv_mutex_lock(&mf_writer.mutex);
+    mf_writer.first = job->next;
+    if (mf_writer.first == NULL) {
+      mf_writer.last = NULL;
+    }
+    job->mfp->mf_async_pending--;
+    if (!ok) {
+      job->mfp->mf_async_failed = true;
+    }
+    uv_cond_broadcast(&mf_writer.done_cond);
+
+    xfree(job->data);
+    kv_destroy(job->iov);
+    kv_destroy(job->runs);
+    xfree(job);
+  }
+}
+
+/// Wait for the swap writer thread to finish the writes of "mfp".  When a
+/// write failed, give an error and mark the blocks dirty again, so that the
+/// next mf_sync() writes them.
+void mf_sync_wait(memfile_T *mfp)
+{
+  if (!mf_writer.started) {
+    return;
+  }
+  uv_mutex_lock(&mf_writer.mutex);
+  while (mfp->mf_async_pending > 0) {
+    uv_cond_wait(&mf_writer.done_cond, &mf_writer.mutex);
+  }
+  bool failed = mfp->mf_async_failed;
+  mfp->mf_async_failed = false;
+  uv_mutex_unlock(&mf_writer.mutex);
+
+  if (failed) {
+    bhdr_T *hp;
+    map_foreach_value(&mfp->mf_hash, hp, {
+      if (hp->bh_bnum >= 0) {
+        hp->bh_flags |= BH_DIRTY;
+      }
+    })
+    mfp->mf_dirty = MF_DIRTY_YES;
+    mfp->mf_infile_count = MIN(mfp->mf_infile_count, mfp->mf_async_infile_count);
+    if (!did_swapwrite_msg) {
+      emsg(_("E297: Write error in swap file"));
+    }
+    did_swapwrite_msg = true;
+  }
+}
+
+/// @return  whether the swap writer thread is still busy with a write of
+///          "mfp".
+static bool mf_sync_busy(memfile_T *mfp)
+{
+  uv_mutex_lock(&mf_writer.mutex);
+  bool busy = mfp->mf_async_pending > 0;
+  uv_mutex_unlock(&mf_writer.mutex);
+  if (!busy) {
+    mf_sync_wait(mfp);  // report a failed write
+  }
+  return busy;
+}
+
+static int mf_bnum_cmp(const void *a, const void *b)
+{
+  blocknr_T na = (*(bhdr_T **)a)->bh_bnum;
+  blocknr_T nb = (*(bhdr_T **)b)->bh_bnum;
+  return na < nb ? -1 : na > nb;
+}
+
+/// Add "page_count" pages of the data of block "hp" to "job", to be written
+/// at page "nr".  Extends the last run when it ends at that page.
+static void mf_job_add(memfile_T *mfp, mfjob_T *job, char **datap, blocknr_T nr,
+                       const bhdr_T *hp, unsigned page_count)
+{
+  size_t size = (size_t)mfp->mf_page_size * page_count;
+  int64_t offset = (int64_t)mfp->mf_page_size * nr;
+
+  memcpy(*datap, hp->bh_data, size);
+  kv_push(job->iov, uv_buf_init(*datap, (unsigned)size));
+  *datap += size;
+
+  if (kv_size(job->runs) > 0
+      && kv_last(job->runs).offset + (int64_t)kv_last(job->runs).size == offset) {
+    kv_last(job->runs).size += size;
+    kv_last(job->runs).iov_count++;
+  } else {
+    kv_push(job->runs, ((mfrun_T){ .offset = offset, .size = size,
+                                   .iov_idx = kv_size(job->iov) - 1, .iov_count = 1 }));
+  }
+}
+
+/// mf_sync() with MFS_ASYNC: copy the dirty blocks with a positive number
+/// and queue them for the swap writer thread.  Pages next to each other in
+/// the file are written with one vectored write.  Block 0 is written last,
+/// so that it never refers to data blocks that are not in the file yet.
+static int mf_sync_async(memfile_T *mfp, int flags)
+{
+  if (mf_sync_busy(mfp)) {
+    return OK;  // try again next time
+  }
+
+  kvec_t(bhdr_T *) blocks = KV_INITIAL_VALUE;
+  bhdr_T *hp;
+  map_foreach_value(&mfp->mf_hash, hp, {
+    if (hp->bh_bnum >= 0 && (hp->bh_flags & BH_DIRTY)) {
+      kv_push(blocks, hp);
+    }
+  })
+  mfp->mf_dirty = MF_DIRTY_NO;
+  if (kv_size(blocks) == 0 && !(flags & MFS_FLUSH)) {
+    kv_destroy(blocks);
+    return OK;
+  }
+  qsort(blocks.items, kv_size(blocks), sizeof(bhdr_T *), mf_bnum_cmp);
+
+  // Like mf_write(): there must be no gaps in the file, write the blocks in
+  // front of a block beyond the end too.  A freed block is filled with data
+  // from the current block.  First make a plan, then copy the data.
+  typedef struct {
+    blocknr_T nr;
+    bhdr_T *hp;                        // block to take the data from
+    unsigned page_count;
+  } mfpage_T;
+  kvec_t(mfpage_T) plan = KV_INITIAL_VALUE;
+  bhdr_T *block0 = NULL;
+  size_t pages = 0;
+  blocknr_T infile_count = mfp->mf_infile_count;
+  for (size_t i = 0; i < kv_size(blocks); i++) {
+    hp = kv_A(blocks, i);
+    if (!(hp->bh_flags & BH_DIRTY)) {
+      continue;  // already written to fill a gap
+    }
+    while (infile_count < hp->bh_bnum) {
+      bhdr_T *hp2 = pmap_get(int64_t)(&mfp->mf_hash, infile_count);
+      unsigned page_count = hp2 == NULL ? 1 : hp2->bh_page_count;
+      if (hp2 != NULL && hp2->bh_bnum == 0) {
+        block0 = hp2;
+      } else {
+        kv_push(plan, ((mfpage_T){ infile_count, hp2 == NULL ? hp : hp2, page_count }));
+        pages += page_count;
+      }
+      if (hp2 != NULL) {
+        hp2->bh_flags &= ~BH_DIRTY;
+      }
+      infile_count += page_count;
+    }
+    if (hp->bh_bnum == 0) {
+      block0 = hp;
+    } else {
+      kv_push(plan, ((mfpage_T){ hp->bh_bnum, hp, hp->bh_page_count }));
+      pages += hp->bh_page_count;
+    }
+    hp->bh_flags &= ~BH_DIRTY;
+    infile_count = MAX(infile_count, hp->bh_bnum + (blocknr_T)hp->bh_page_count);
+  }
+  if (block0 != NULL) {
+    kv_push(plan, ((mfpage_T){ 0, block0, block0->bh_page_count }));
+    pages += block0->bh_page_count;
+  }
+  kv_destroy(blocks);
+
+  mfjob_T *job = xcalloc(1, sizeof(mfjob_T));
+  job->mfp = mfp;
+  job->fd = mfp->mf_fd;
+  job->fsync = flags & MFS_FLUSH;
+  if (job->fsync) {
+    g_stats.fsync++;  // counted here, g_stats is not for other threads
+  }
+  job->data = xmalloc(MAX(pages, 1) * mfp->mf_page_size);
+  char *data = job->data;
+  for (size_t i = 0; i < kv_size(plan); i++) {
+    mfpage_T *page = &kv_A(plan, i);
+    mf_job_add(mfp, job, &data, page->nr, page->hp, page->page_count);
+  }
+  kv_destroy(plan);
+
+  mfp->mf_async_infile_count = mfp->mf_infile_count;
+  mfp->mf_infile_count = infile_count;
+
+  uv_mutex_lock(&mf_writer.mutex);
+  if (mf_writer.last != NULL) {
+    mf_writer.last->next = job;
+  } else {
+    mf_writer.first = job;
+  }
+  mf_writer.last = job;
+  mfp->mf_async_pending++;
+  uv_cond_signal(&mf_writer.work_cond);
+  uv_mutex_unlock(&mf_writer.mutex);
+  return OK;
+}
+
 /// Set dirty flag for all blocks in memory file with a positive block number.
 /// These are blocks that need to be written to a newly created swapfile.
 void mf_set_dirty(memfile_T *mfp)
@@ -470,7 +805,7 @@ bool mf_release_all(void)
       if (mfp->mf_fd >= 0) {
         for (int i = 0; i < (int)map_size(&mfp->mf_hash);) {
           bhdr_T *hp = mfp->mf_hash.values[i];
-          if (!(hp->bh_flags & BH_LOCKED)
+          if (!(hp->bh_flags & BH_LOCKED) && hp->bh_pinned == 0
               && (!(hp->bh_flags & BH_DIRTY)
                   || mf_write(mfp, hp) != FAIL)) {
             pmap_del(int64_t)(&mfp->mf_hash, hp->bh_bnum, NULL);
@@ -488,12 +823,127 @@ bool mf_release_all(void)
   return retval;
 }
 
+/// Add unlocked data block "hp" to the end of the mf_lru list, when there is
+/// no swap file.  Then compress the blocks at the start of the list while the
+/// list takes more than 'memcompress' Kbyte.  "hp" itself is not compressed,
+/// it is likely to be used again soon.
+static void mf_lru_add(memfile_T *mfp, bhdr_T *hp)
+{
+  if (mfp->mf_fd >= 0 || p_mcm <= 0) {
+    return;
+  }
+  mf_lru_remove(mfp, hp);
+  hp->bh_lru_prev = mfp->mf_lru_last;
+  hp->bh_lru_next = NULL;
+  if (mfp->mf_lru_last != NULL) {
+    mfp->mf_lru_last->bh_lru_next = hp;
+  } else {
+    mfp->mf_lru_first = hp;
+  }
+  mfp->mf_lru_last = hp;
+  mfp->mf_lru_size += (size_t)mfp->mf_page_size * hp->bh_page_count;
+
+  while (mfp->mf_lru_size > (size_t)p_mcm * 1024 && mfp->mf_lru_first != hp) {
+    bhdr_T *oldest = mfp->mf_lru_first;
+    mf_lru_remove(mfp, oldest);
+    mf_compress(mfp, oldest);
+  }
+}
+
+/// Remove block "hp" from the mf_lru list, if it is in it.
+static void mf_lru_remove(memfile_T *mfp, bhdr_T *hp)
+{
+  if (hp->bh_lru_prev == NULL && mfp->mf_lru_first != hp) {
+    return;  // not in the list
+  }
+  if (hp->bh_lru_prev != NULL) {
+    hp->bh_lru_prev->bh_lru_next = hp->bh_lru_next;
+  } else {
+    mfp->mf_lru_first = hp->bh_lru_next;
+  }
+  if (hp->bh_lru_next != NULL) {
+    hp->bh_lru_next->bh_lru_prev = hp->bh_lru_prev;
+  } else {
+    mfp->mf_lru_last = hp->bh_lru_prev;
+  }
+  hp->bh_lru_prev = hp->bh_lru_next = NULL;
+  mfp->mf_lru_size -= (size_t)mfp->mf_page_size * hp->bh_page_count;
+}
+
+/// Uncompress all blocks and empty the mf_lru list.  Used when a swap file
+/// is opened: blocks are not compressed when they can be written to it.
+static void mf_lru_clear(memfile_T *mfp)
+{
+  bhdr_T *hp;
+  map_foreach_value(&mfp->mf_hash, hp, {
+    if (hp->bh_flags & BH_COMPRESSED) {
+      mf_uncompress(mfp, hp);
+    }
+    hp->bh_lru_prev = hp->bh_lru_next = NULL;
+  })
+  mfp->mf_lru_first = NULL;
+  mfp->mf_lru_last = NULL;
+  mfp->mf_lru_size = 0;
+}
+
+/// Compress the data of unlocked block "hp".  Keeps it uncompressed when it
+/// would not become at least 1/8 smaller.
+static void mf_compress(memfile_T *mfp, bhdr_T *hp)
+{
+  size_t size = (size_t)mfp->mf_page_size * hp->bh_page_count;
+  char *data = xmalloc(size);
+  size_t compressed_size = lz4_compress(hp->bh_data, size, data, size - size / 8);
+  if (compressed_size == 0) {
+    xfree(data);
+    return;
+  }
+  xfree(hp->bh_data);
+  hp->bh_data = xrealloc(data, compressed_size);
+  hp->bh_compressed_size = (unsigned)compressed_size;
+  hp->bh_flags |= BH_COMPRESSED;
+  g_stats.mf_compressed += (int64_t)compressed_size;
+  g_stats.mf_compressed_raw += (int64_t)size;
+}
+
+/// Uncompress the data of block "hp".
+///
+/// @return  false if the compressed data is invalid.
+static bool mf_uncompress(memfile_T *mfp, bhdr_T *hp)
+{
+  size_t size = (size_t)mfp->mf_page_size * hp->bh_page_count;
+  char *data = xmalloc(size);
+  if (!lz4_decompress(hp->bh_data, hp->bh_compressed_size, data, size)) {
+    xfree(data);
+    internal_error("mf_uncompress()");
+    return false;
+  }
+  mf_uncount(mfp, hp);
+  xfree(hp->bh_data);
+  hp->bh_data = data;
+  hp->bh_flags &= ~BH_COMPRESSED;
+  return true;
+}
+
+/// Remove block "hp" from the mf_lru list or from the compression stats,
+/// before it is uncompressed or freed.
+static void mf_uncount(memfile_T *mfp, bhdr_T *hp)
+{
+  if (hp->bh_flags & BH_COMPRESSED) {
+    g_stats.mf_compressed -= hp->bh_compressed_size;
+    g_stats.mf_compressed_raw -= (int64_t)mfp->mf_page_size * hp->bh_page_count;
+  } else {
+    mf_lru_remove(mfp, hp);
+  }
+}
+
 /// Allocate a block header and a block of memory for it.
 static bhdr_T *mf_alloc_bhdr(memfile_T *mfp, unsigned page_count)
 {
   bhdr_T *hp = xmalloc(sizeof(bhdr_T));
   hp->bh_data = xmalloc((size_t)mfp->mf_page_size * page_count);
   hp->bh_page_count = page_count;
+  hp->bh_pinned = 0;
+  hp->bh_lru_prev = hp->bh_lru_next = NULL;
   return hp;
 }
 
@@ -529,6 +979,7 @@ static bhdr_T *mf_rem_free(memfile_T *mfp)
 ///                - Error reading file.
 static int mf_read(memfile_T *mfp, bhdr_T *hp)
 {
+  mf_sync_wait(mfp);
   if (mfp->mf_fd < 0) {     // there is no file, can't read
     return FAIL;
   }
@@ -564,6 +1015,7 @@ static int mf_write(memfile_T *mfp, bhdr_T *hp)
   bhdr_T *hp2;
   unsigned page_count;      // number of pages written
 
+  mf_sync_wait(mfp);
   if (mfp->mf_fd < 0 && !mfp->mf_reopen) {
     // there is no file and there was no file, can't write
     return FAIL;
@@ -9,6 +9,7 @@ enum {
   MFS_STOP  = 2,  ///< stop syncing when a character is available
   MFS_FLUSH = 4,  ///< flushed file to disk
   MFS_ZERO  = 8,  ///< only write block 0
+  MFS_ASYNC = 16, ///< let the swap writer thread write the blocks
 };
 
 enum {
@@ -20,4 +21,8 @@ enum {
   MAX_SWAP_PAGE_SIZE = 50000,
 };
 
+/// Smallest non-zero value of 'memcompress', in Kbyte: a few blocks of text
+/// are always kept uncompressed.
+enum { MEMCOMPRESS_MIN = 64, };
+
 #include "memfile.h.generated.h"
@@ -24,16 +24,24 @@ typedef int64_t blocknr_T;
 /// The free list is a single linked list, not sorted.
 /// The blocks in the free list have no block of memory allocated and
 /// the contents of the block in the file (if any) is irrelevant.
-typedef struct {
+typedef struct bhdr_S bhdr_T;
+struct bhdr_S {
   blocknr_T bh_bnum;                 ///< key used in hash table
 
   void *bh_data;                     ///< pointer to memory (for used block)
   unsigned bh_page_count;            ///< number of pages in this block
 
-#define BH_DIRTY    1U
-#define BH_LOCKED   2U
-  unsigned bh_flags;                 ///< BH_DIRTY or BH_LOCKED
-} bhdr_T;
+#define BH_DIRTY       1U
+#define BH_LOCKED      2U
+#define BH_DATA        4U            ///< data block, may be compressed
+#define BH_COMPRESSED  8U            ///< bh_data is compressed
+  unsigned bh_flags;                 ///< BH_DIRTY, BH_LOCKED, etc.
+
+  unsigned bh_compressed_size;       ///< size of bh_data when BH_COMPRESSED
+  int bh_pinned;                     ///< number of mf_pin() calls not undone
+  bhdr_T *bh_lru_prev;               ///< previous in mf_lru list
+  bhdr_T *bh_lru_next;               ///< next in mf_lru list
+};
 
 typedef enum {
   MF_DIRTY_NO = 0,      ///< no dirty blocks
@@ -65,4 +73,18 @@ typedef struct {
   blocknr_T mf_infile_count;         ///< number of pages in the file
   unsigned mf_page_size;             ///< number of bytes in a page
   mfdirty_T mf_dirty;
+
+  /// Unlocked uncompressed data blocks when there is no swap file, least
+  /// recently used first.  When they take more than 'memcompress' the first
+  /// ones are compressed.
+  bhdr_T *mf_lru_first;
+  bhdr_T *mf_lru_last;
+  size_t mf_lru_size;                ///< number of bytes of blocks in mf_lru
+
+  /// Writes queued for the swap writer thread, see mf_sync_async().
+  /// mf_async_pending and mf_async_failed are only accessed with the writer
+  /// mutex held.
+  int mf_async_pending;              ///< number of queued writes not done yet
+  bool mf_async_failed;              ///< a queued write failed
+  blocknr_T mf_async_infile_count;   ///< mf_infile_count before the queued write
 } memfile_T;
@@ -39,6 +39,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
@@ -88,6 +89,7 @@
 #include "nvim/os/time_defs.h"
 #include "nvim/path.h"
 #include "nvim/pos_defs.h"
+#include "nvim/regexp.h"
 #include "nvim/spell.h"
 #include "nvim/statusline.h"
 #include "nvim/strings.h"
@@ -255,6 +257,47 @@ typedef enum {
   SEA_CHOICE_ABORT = 6,
 } sea_choice_T;
 
+enum {
+  /// Number of lines ml_filter_lines() checks at a time.  The data blocks of
+  /// these lines are kept in memory at the same time.
+  MLFILTER_BATCH = 1 << 18,
+  /// Minimal number of lines for a thread of ml_filter_lines().
+  MLFILTER_THREAD_LINES = 1 << 15,
+  /// Maximum number of threads used by ml_filter_lines().
+  MLFILTER_MAX_THREADS = 8,
+};
+
+enum {
+  /// Maximum number of extents of a file mapping.  When more are needed all
+  /// lines are moved into data blocks.
+  MLMAP_MAX_EXTENTS = 1000,
+  /// Minimal time between two checks of a mapped file, in nanoseconds.
+  MLMAP_CHECK_NS = 10 * 1000 * 1000,
+};
+
+/// Lines checked by ml_filter_lines(): part of a data block or of
+/// MLMAP_STRIDE lines of a file mapping.
+typedef struct {
+  linenr_T lnum;           ///< first line
+  int count;               ///< number of lines
+  const DataBlock *dp;     ///< data block, NULL for a file mapping
+  int idx;                 ///< index of "lnum" in "dp"
+  const char *text;        ///< file mapping: text of "lnum"
+  const char *end;         ///< file mapping: end of the mapping
+  char sep;                ///< file mapping: character at the end of a line
+} mlrun_T;
+
+/// Work of one thread of ml_filter_lines().
+typedef struct {
+  const mlrun_T *runs;     ///< runs to check
+  size_t nruns;
+  mlcheck_T check;
+  void *arg;
+  int index;               ///< "thread" argument of "check"
+  uint8_t *result;         ///< result for the first line of the first run
+  uv_thread_t thread;
+} mlfilterjob_T;
+
 #include "memline.c.generated.h"
 
 static const char e_ml_get_invalid_lnum_nr[]
@@ -294,6 +337,10 @@ int ml_open(buf_T *buf)
   buf->b_ml.ml_line_offset = 0;
   buf->b_ml.ml_chunksize = NULL;
   buf->b_ml.ml_usedchunks = 0;
+  buf->b_ml.ml_chunktree = NULL;
+  buf->b_ml.ml_treechunks = 0;
+  buf->b_ml.ml_map = NULL;
+  buf->b_ml.ml_view = NULL;
 
   if (cmdmod.cmod_flags & CMOD_NOSWAPFILE) {
     buf->b_p_swf = false;
@@ -433,8 +480,10 @@ void ml_setname(buf_T *buf)
       success = true;
       break;
     }
-    // need to close the swapfile before renaming
+    // need to close the swapfile before renaming, the swap writer thread
+    // must be done with it
     if (mfp->mf_fd >= 0) {
+      mf_sync_wait(mfp);
       close(mfp->mf_fd);
       mfp->mf_fd = -1;
     }
@@ -569,6 +618,7 @@ void ml_close(buf_T *buf, int del_file)
   if (buf->b_ml.ml_mfp == NULL) {               // not open
     return;
   }
+  ml_view_free(buf);
   mf_close(buf->b_ml.ml_mfp, del_file);       // close the .swp file
   if (buf->b_ml.ml_line_lnum != 0
       && (buf->b_ml.ml_flags & (ML_LINE_DIRTY | ML_ALLOCATED))) {
@@ -576,6 +626,12 @@ void ml_close(buf_T *buf, int del_file)
   }
   xfree(buf->b_ml.ml_stack);
   XFREE_CLEAR(buf->b_ml.ml_chunksize);
+  XFREE_CLEAR(buf->b_ml.ml_chunktree);
+  buf->b_ml.ml_treechunks = 0;
+  if (buf->b_ml.ml_map != NULL) {
+    ml_map_free(buf->b_ml.ml_map);
+    buf->b_ml.ml_map = NULL;
+  }
   buf->b_ml.ml_mfp = NULL;
 
   // Reset the "recovered" flag, give the ATTENTION prompt the next time
@@ -830,6 +886,7 @@ void ml_recover(bool checkext)
   buf->b_ml.ml_line_offset = 0;
   buf->b_ml.ml_locked = NULL;           // no locked block
   buf->b_ml.ml_flags = 0;
+  buf->b_ml.ml_view = NULL;
 
   // open the memfile from the old swapfile
   char *p = xstrdup(fname_used);  // save "fname_used" for the message:
@@ -1688,13 +1745,18 @@ static int recov_file_names(char **names, char *path, bool prepend_dot)
 /// @param check_file  if true, check if original file exists and was not changed.
 /// @param check_char  if true, stop syncing when character becomes available, but
 ///
-/// always sync at least one block.
+/// always sync at least one block.  The blocks are then written by the swap
+/// writer thread, see mf_sync().
 void ml_sync_all(int check_file, int check_char, bool do_fsync)
 {
   FOR_ALL_BUFFERS(buf) {
     if (buf->b_ml.ml_mfp == NULL || buf->b_ml.ml_mfp->mf_fname == NULL) {
       continue;                             // no file
     }
+    // The swapfile must have all lines of a changed buffer.
+    if (buf->b_ml.ml_map != NULL && bufIsChanged(buf)) {
+      ml_map_materialize(buf);
+    }
     ml_flush_line(buf, false);              // flush buffered line
                                             // flush locked block
     ml_find_line(buf, 0, ML_FLUSH);
@@ -1713,7 +1775,7 @@ void ml_sync_all(int check_file, int check_char, bool do_fsync)
       }
     }
     if (buf->b_ml.ml_mfp->mf_dirty == MF_DIRTY_YES) {
-      mf_sync(buf->b_ml.ml_mfp, (check_char ? MFS_STOP : 0)
+      mf_sync(buf->b_ml.ml_mfp, (check_char ? MFS_STOP | MFS_ASYNC : 0)
               | (do_fsync && bufIsChanged(buf) ? MFS_FLUSH : 0));
       if (check_char && os_char_avail()) {      // character available now
         break;
@@ -1746,6 +1808,9 @@ void ml_preserve(buf_T *buf, bool message, bool do_fsync)
   // before.
   got_int = false;
 
+  if (buf->b_ml.ml_map != NULL) {
+    ml_map_materialize(buf);        // all lines go into the swapfile
+  }
   ml_flush_line(buf, false);        // flush buffered line
   ml_find_line(buf, 0, ML_FLUSH);   // flush locked block
   int status = mf_sync(mfp, MFS_ALL | (do_fsync ? MFS_FLUSH : 0));
@@ -1899,6 +1964,17 @@ errorret:
   }
   lnum = MAX(lnum, 1);  // pretend line 0 is line 1
 
+  if (buf->b_ml.ml_map != NULL) {
+    ml_map_check(buf);
+  }
+
+  if (will_change) {
+    ml_view_changed(buf);
+    if (buf->b_ml.ml_map != NULL) {
+      ml_map_promote(buf, lnum);
+    }
+  }
+
   // See if it is the same line as requested last time.
   // Otherwise may need to flush last used line.
   // Don't use the last used line when 'swapfile' is reset, need to load all
@@ -1906,11 +1982,31 @@ errorret:
   if (buf->b_ml.ml_line_lnum != lnum) {
     ml_flush_line(buf, false);
 
+    // A line in the file mapping is used where it is.  Otherwise the line is
+    // in the tree, under another number when some lines are mapped.
+    mlmap_T *map = buf->b_ml.ml_map;
+    linenr_T tree_lnum = lnum;
+    if (map != NULL) {
+      linenr_T map_lnum = ml_map_lookup(map, lnum, &tree_lnum);
+      if (map_lnum != 0) {
+        colnr_T len;
+        buf->b_ml.ml_line_ptr = ml_map_text(map, map_lnum, &len);
+        buf->b_ml.ml_line_len = len + 1;
+        buf->b_ml.ml_line_lnum = lnum;
+        buf->b_ml.ml_flags &= ~(ML_LINE_DIRTY | ML_ALLOCATED);
+        goto theend;
+      }
+      ml_map_tree_begin(buf);
+    }
+
     // Find the data block containing the line.
     // This also fills the stack with the blocks from the root to the data
     // block and releases any locked block.
-    bhdr_T *hp;
-    if ((hp = ml_find_line(buf, lnum, ML_FIND)) == NULL) {
+    bhdr_T *hp = ml_find_line(buf, tree_lnum, ML_FIND);
+    if (map != NULL) {
+      ml_map_tree_end(buf, map);
+    }
+    if (hp == NULL) {
       if (recursive == 0) {
         // Avoid giving this message for a recursive call, may happen
         // when the GUI redraws part of the text.
@@ -1926,7 +2022,7 @@ errorret:
 
     DataBlock *dp = hp->bh_data;
 
-    int idx = lnum - buf->b_ml.ml_locked_low;
+    int idx = tree_lnum - buf->b_ml.ml_locked_low;
     unsigned start = (dp->db_index[idx] & DB_INDEX_MASK);
     // The text ends where the previous line starts.  The first line ends
     // at the end of the block.
@@ -1937,6 +2033,7 @@ errorret:
     buf->b_ml.ml_line_lnum = lnum;
     buf->b_ml.ml_flags &= ~(ML_LINE_DIRTY | ML_ALLOCATED);
   }
+theend:
   if (will_change) {
     buf->b_ml.ml_flags |= (ML_LOCKED_DIRTY | ML_LOCKED_POS);
 #ifdef ML_GET_ALLOC_LINES
@@ -1963,6 +2060,345 @@ errorret:
   return buf->b_ml.ml_line_ptr;
 }
 
+/// Open a view on the lines of "buf", for a caller that goes back and forth
+/// between lines, like a search for a pattern that matches a line break.
+/// Until ml_view_close() the text returned by ml_view_get() stays valid while
+/// getting other lines less than MLVIEW_SIZE lines away, as long as the buffer
+/// is not changed.  The data blocks holding the text are pinned, a line in a
+/// file mapping is used where it is.
+/// Calls can be nested.
+void ml_view_open(buf_T *buf)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (buf->b_ml.ml_mfp == NULL) {
+    return;
+  }
+  if (buf->b_ml.ml_view == NULL) {
+    // Put a changed line in its data block now, the text in the data blocks
+    // must not move while the view is open.
+    ml_flush_line(buf, false);
+    buf->b_ml.ml_view = xcalloc(1, sizeof(mlview_T));
+  }
+  buf->b_ml.ml_view->mv_refcount++;
+}
+
+/// Close a view opened with ml_view_open().
+void ml_view_close(buf_T *buf)
+  FUNC_ATTR_NONNULL_ALL
+{
+  // The view is gone when the memline was closed meanwhile.
+  if (buf->b_ml.ml_view != NULL && --buf->b_ml.ml_view->mv_refcount == 0) {
+    ml_view_free(buf);
+  }
+}
+
+/// Get line "lnum" of "buf" from the view opened with ml_view_open().
+/// Without a view this is like ml_get_buf().
+///
+/// @param[out] lenp  length of the line, excluding the NUL
+///
+/// @return  pointer to the text of the line
+char *ml_view_get(buf_T *buf, linenr_T lnum, colnr_T *lenp)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_NONNULL_RET
+{
+  mlview_T *view = buf->b_ml.ml_view;
+
+  lnum = MAX(lnum, 1);  // pretend line 0 is line 1
+  if (view == NULL || lnum > buf->b_ml.ml_line_count) {
+    // ml_get_buf() also gives the error for an invalid line number.
+    char *line = ml_get_buf(buf, lnum);
+    *lenp = ml_get_buf_len(buf, lnum);
+    return line;
+  }
+
+  mlviewline_T *vl = &view->mv_lines[lnum & (MLVIEW_SIZE - 1)];
+  if (vl->mvl_lnum != lnum) {
+    ml_view_drop(buf, vl);
+
+    // ml_line_ptr may point into the block that ml_find_line() unlocks.
+    ml_flush_line(buf, false);
+
+    mlmap_T *map = buf->b_ml.ml_map;
+    linenr_T tree_lnum = lnum;
+    linenr_T map_lnum = map != NULL ? ml_map_lookup(map, lnum, &tree_lnum) : 0;
+    if (map_lnum != 0) {
+      // The text stays where it is in the mapping.
+      vl->mvl_ptr = ml_map_text(map, map_lnum, &vl->mvl_len);
+    } else {
+      if (map != NULL) {
+        ml_map_tree_begin(buf);
+      }
+      bhdr_T *hp = ml_find_line(buf, tree_lnum, ML_FIND);
+      if (map != NULL) {
+        ml_map_tree_end(buf, map);
+      }
+      if (hp == NULL) {
+        char *line = ml_get_buf(buf, lnum);  // gives the error message
+        *lenp = ml_get_buf_len(buf, lnum);
+        return line;
+      }
+      DataBlock *dp = hp->bh_data;
+      int idx = tree_lnum - buf->b_ml.ml_locked_low;
+      unsigned start = (dp->db_index[idx] & DB_INDEX_MASK);
+      unsigned end = idx == 0 ? dp->db_txt_end : (dp->db_index[idx - 1] & DB_INDEX_MASK);
+      char *text = (char *)dp + start;
+      colnr_T len = *text == NUL ? 0 : (colnr_T)(end - start - 1);
+#ifdef ML_GET_ALLOC_LINES
+      ml_view_copy(vl, text, len);
+#else
+      vl->mvl_ptr = text;
+      vl->mvl_len = len;
+      mf_pin(buf->b_ml.ml_mfp, hp);
+      vl->mvl_hp = hp;
+#endif
+    }
+    vl->mvl_lnum = lnum;
+  }
+  *lenp = vl->mvl_len;
+  return vl->mvl_ptr;
+}
+
+#ifdef ML_GET_ALLOC_LINES
+/// Put a copy of "len" bytes at "text" in line "vl" of a view.
+static void ml_view_copy(mlviewline_T *vl, const char *text, colnr_T len)
+{
+  // Use new memory every time, so that using the old text is noticed.
+  xfree(vl->mvl_copy);
+  vl->mvl_copy = xmemdupz(text, (size_t)len);
+  vl->mvl_ptr = vl->mvl_copy;
+  vl->mvl_len = len;
+}
+#endif
+
+/// Forget line "vl" of the view of "buf" and unpin its data block.
+static void ml_view_drop(buf_T *buf, mlviewline_T *vl)
+{
+  if (vl->mvl_hp != NULL) {
+    mf_unpin(buf->b_ml.ml_mfp, vl->mvl_hp);
+    vl->mvl_hp = NULL;
+  }
+  vl->mvl_lnum = 0;
+}
+
+/// Forget the lines in the view of "buf", if there is one, because the text
+/// in the data blocks is going to change.
+static void ml_view_changed(buf_T *buf)
+{
+  mlview_T *view = buf->b_ml.ml_view;
+  if (view == NULL) {
+    return;
+  }
+  for (int i = 0; i < MLVIEW_SIZE; i++) {
+    ml_view_drop(buf, &view->mv_lines[i]);
+  }
+}
+
+/// Free the view of "buf", also when it is still open.
+static void ml_view_free(buf_T *buf)
+{
+  mlview_T *view = buf->b_ml.ml_view;
+  if (view == NULL) {
+    return;
+  }
+  ml_view_changed(buf);
+  for (int i = 0; i < MLVIEW_SIZE; i++) {
+    xfree(view->mv_lines[i].mvl_copy);
+  }
+  XFREE_CLEAR(buf->b_ml.ml_view);
+}
+
+/// @return  the number of threads ml_filter_lines() may use, "thread" passed
+///          to the check is below this.
+int ml_filter_max_threads(void)
+{
+  int n;
+  // uv_available_parallelism() was added in libuv 1.44.0.
+#if UV_VERSION_MAJOR > 1 || UV_VERSION_MINOR >= 44
+  n = (int)uv_available_parallelism();
+#else
+  uv_cpu_info_t *cpus;
+  if (uv_cpu_info(&cpus, &n) == 0) {
+    uv_free_cpu_info(cpus, n);
+  } else {
+    n = 1;
+  }
+#endif
+  return MAX(1, MIN(n, MLFILTER_MAX_THREADS));
+}
+
+/// Call "check" for lines "lnum1" to "lnum2" of "buf" and store what it
+/// returned in "result", one byte per line.  For many lines the text is
+/// checked by worker threads, "check" gets the text where it is stored and
+/// must be thread-safe.  The "thread" argument of "check" is different for
+/// each thread, it can be used as an index for per-thread data.  The text is
+/// not NUL terminated.  A NUL character in the text may be a NL or a NUL byte.
+/// Lines that were not checked because of an interrupt are set to one.
+void ml_filter_lines(buf_T *buf, linenr_T lnum1, linenr_T lnum2, mlcheck_T check, void *arg,
+                     uint8_t *result)
+  FUNC_ATTR_NONNULL_ARG(1, 4, 6)
+{
+  if (lnum1 > lnum2) {
+    return;
+  }
+  if (buf->b_ml.ml_mfp == NULL) {
+    memset(result, true, (size_t)(lnum2 - lnum1 + 1));
+    return;
+  }
+
+  // The text of the data blocks is read while the blocks are not locked.
+  ml_flush_line(buf, false);
+  if (buf->b_ml.ml_map != NULL) {
+    ml_map_check(buf);
+  }
+
+  memfile_T *mfp = buf->b_ml.ml_mfp;
+  mlmap_T *map = buf->b_ml.ml_map;
+  kvec_t(mlrun_T) runs = KV_INITIAL_VALUE;
+  kvec_t(bhdr_T *) pinned = KV_INITIAL_VALUE;
+  const int max_threads = ml_filter_max_threads();
+  linenr_T lnum = lnum1;
+
+  while (lnum <= lnum2) {
+    // Collect the runs of a batch of lines, pin the data blocks.
+    const linenr_T batch_start = lnum;
+    kv_size(runs) = 0;
+    while (lnum <= lnum2 && lnum - batch_start < MLFILTER_BATCH) {
+      mlrun_T run = { .lnum = lnum };
+      // A run ends at the end of a stride of the mapping or of a data block,
+      // and where the mapped lines stop or start.
+      linenr_T tree_lnum = lnum;
+      linenr_T map_lnum = 0;
+      linenr_T next = MAXLNUM;
+      if (map != NULL) {
+        map_lnum = ml_map_lookup(map, lnum, &tree_lnum);
+        int i = ml_map_find_ext(map, lnum);
+        if (map_lnum != 0) {
+          const mlmapext_T *ext = &kv_A(map->mm_exts, i);
+          next = ext->me_lnum + ext->me_count;
+        } else if ((size_t)(i + 1) < kv_size(map->mm_exts)) {
+          next = kv_A(map->mm_exts, i + 1).me_lnum;
+        }
+      }
+      if (map_lnum != 0) {
+        colnr_T len;
+        run.text = ml_map_line(map, map_lnum, &len);
+        run.end = map->mm_base + map->mm_limit;
+        run.sep = map->mm_ready[(map_lnum - 1) / MLMAP_STRIDE] ? NUL : NL;
+        run.count = MLMAP_STRIDE - (map_lnum - 1) % MLMAP_STRIDE;
+      } else {
+        if (map != NULL) {
+          ml_map_tree_begin(buf);
+        }
+        bhdr_T *hp = ml_find_line(buf, tree_lnum, ML_FIND);
+        if (map != NULL) {
+          ml_map_tree_end(buf, map);
+        }
+        if (hp == NULL) {
+          break;
+        }
+        mf_pin(mfp, hp);
+        kv_push(pinned, hp);
+        run.dp = hp->bh_data;
+        run.idx = tree_lnum - buf->b_ml.ml_locked_low;
+        run.count = buf->b_ml.ml_locked_high - tree_lnum + 1;
+      }
+      run.count = MIN(run.count, next - lnum);
+      run.count = MIN(run.count, lnum2 - lnum + 1);
+      kv_push(runs, run);
+      lnum += run.count;
+    }
+    if (kv_size(runs) == 0) {
+      break;  // error finding a line
+    }
+
+    // Divide the runs over the threads, the current one takes the first part.
+    const linenr_T nlines = lnum - batch_start;
+    const int nthreads = MAX(1, MIN(max_threads, nlines / MLFILTER_THREAD_LINES));
+    mlfilterjob_T jobs[MLFILTER_MAX_THREADS];
+    size_t r = 0;
+    for (int i = 0; i < nthreads; i++) {
+      const linenr_T stop = batch_start + (linenr_T)((int64_t)nlines * (i + 1) / nthreads);
+      jobs[i] = (mlfilterjob_T){ .check = check, .arg = arg, .index = i };
+      if (r < kv_size(runs)) {
+        jobs[i].runs = &kv_A(runs, r);
+        jobs[i].result = result + (kv_A(runs, r).lnum - lnum1);
+      }
+      while (r < kv_size(runs) && (i == nthreads - 1 || kv_A(runs, r).lnum < stop)) {
+        jobs[i].nruns++;
+        r++;
+      }
+    }
+    bool started[MLFILTER_MAX_THREADS] = { false };
+    for (int i = 1; i < nthreads; i++) {
+      started[i] = jobs[i].nruns > 0
+                   && uv_thread_create(&jobs[i].thread, ml_filter_thread, &jobs[i]) == 0;
+    }
+    for (int i = 0; i < nthreads; i++) {
+      if (!started[i]) {
+        ml_filter_job(&jobs[i]);
+      }
+    }
+    for (int i = 1; i < nthreads; i++) {
+      if (started[i]) {
+        uv_thread_join(&jobs[i].thread);
+      }
+    }
+
+    for (size_t i = 0; i < kv_size(pinned); i++) {
+      mf_unpin(mfp, kv_A(pinned, i));
+    }
+    kv_size(pinned) = 0;
+
+    fast_breakcheck();
+    if (got_int) {
+      break;
+    }
+  }
+
+  if (lnum <= lnum2) {
+    memset(result + (lnum - lnum1), true, (size_t)(lnum2 - lnum + 1));
+  }
+  kv_destroy(runs);
+  kv_destroy(pinned);
+}
+
+/// Thread started by ml_filter_lines().
+static void ml_filter_thread(void *arg)
+{
+  ml_filter_job(arg);
+  // The check may have matched a regexp in this thread.
+  regexec_free_pool();
+}
+
+/// Check the lines of the runs of one thread of ml_filter_lines().
+static void ml_filter_job(void *arg)
+{
+  mlfilterjob_T *job = arg;
+  uint8_t *result = job->result;
+
+  for (size_t i = 0; i < job->nruns; i++) {
+    const mlrun_T *run = &job->runs[i];
+    if (run->dp != NULL) {
+      const DataBlock *dp = run->dp;
+      for (int idx = run->idx; idx < run->idx + run->count; idx++) {
+        unsigned start = (dp->db_index[idx] & DB_INDEX_MASK);
+        unsigned end = idx == 0 ? dp->db_txt_end : (dp->db_index[idx - 1] & DB_INDEX_MASK);
+        const char *text = (const char *)dp + start;
+        *result++ = job->check(text, *text == NUL ? 0 : end - start - 1, job->index, job->arg);
+      }
+    } else {
+      const char *text = run->text;
+      for (int n = 0; n < run->count; n++) {
+        text = MIN(text, run->end);  // lines past mm_limit are empty
+        const char *sep = memchr(text, run->sep, (size_t)(run->end - text));
+        const char *end = sep != NULL ? sep : run->end;
+        *result++ = job->check(text, (size_t)(end - text), job->index, job->arg);
+        text = end + 1;
+      }
+    }
+  }
+}
+
 /// Check if a line that was just obtained by a call to ml_get
 /// is in allocated memory.
 /// This ignores ML_ALLOCATED to get the same behavior as without ML_GET_ALLOC_LINES.
@@ -1986,6 +2422,11 @@ static int ml_append_int(buf_T *buf, linenr_T lnum, char *line_arg, colnr_T len_
   if (lnum > buf->b_ml.ml_line_count || buf->b_ml.ml_mfp == NULL) {
     return FAIL;  // lnum out of range
   }
+  if (buf->b_ml.ml_map != NULL) {
+    return ml_map_append(buf, lnum, line_arg, len_arg, flags);
+  }
+
+  ml_view_changed(buf);
 
   if (lowest_marked && lowest_marked > lnum) {
     lowest_marked = lnum + 1;
@@ -2388,6 +2829,81 @@ theend:
   return ret;
 }
 
+/// Copy lines into the locked data block, after line "lnum", as long as
+/// they fit in its free space.  The text of the lines that follow is moved
+/// only once, the pointer blocks are updated when the block is released.
+///
+/// @param lnum  append after this line, which must be in the locked block
+/// @param lines  text of the new lines, each NUL terminated
+/// @param count  number of items in "lines"
+/// @param flags  ML_APPEND_ flags
+///
+/// @return  number of lines that were appended, may be zero
+static size_t ml_append_fill(buf_T *buf, linenr_T lnum, const String *lines, size_t count,
+                             int flags)
+  FUNC_ATTR_NONNULL_ALL
+{
+  // The locked block has line numbers of the tree when lines are mapped.
+  bhdr_T *hp = buf->b_ml.ml_locked;
+  if (hp == NULL || buf->b_ml.ml_map != NULL
+      || lnum < buf->b_ml.ml_locked_low || lnum > buf->b_ml.ml_locked_high) {
+    return 0;
+  }
+  DataBlock *dp = hp->bh_data;
+  int db_idx = lnum - buf->b_ml.ml_locked_low;
+  int line_count = (int)dp->db_line_count;
+  assert(line_count == buf->b_ml.ml_locked_high - buf->b_ml.ml_locked_low + 1);
+
+  size_t n = 0;
+  unsigned text_len = 0;
+  unsigned space_needed = 0;
+  for (; n < count; n++) {
+    unsigned len = (unsigned)lines[n].size + 1;
+    if (space_needed + len + (unsigned)INDEX_SIZE > dp->db_free) {
+      break;
+    }
+    text_len += len;
+    space_needed += len + (unsigned)INDEX_SIZE;
+  }
+  if (n == 0) {
+    return 0;
+  }
+
+  // The text of the lines after "lnum" is just below the text of "lnum",
+  // move it down to make room for the new lines.
+  unsigned offset = dp->db_index[db_idx] & DB_INDEX_MASK;
+  if (line_count > db_idx + 1) {
+    memmove((char *)dp + dp->db_txt_start - text_len,
+            (char *)dp + dp->db_txt_start,
+            (size_t)(offset - dp->db_txt_start));
+    for (int i = line_count - 1; i > db_idx; i--) {
+      dp->db_index[i + (int)n] = dp->db_index[i] - text_len;
+    }
+  }
+  dp->db_txt_start -= text_len;
+  dp->db_free -= space_needed;
+  dp->db_line_count += (linenr_T)n;
+
+  for (size_t i = 0; i < n; i++) {
+    colnr_T len = (colnr_T)lines[i].size + 1;
+    offset -= (unsigned)len;
+    memmove((char *)dp + offset, lines[i].data, (size_t)len);
+    dp->db_index[db_idx + 1 + (int)i] = offset | ((flags & ML_APPEND_MARK) ? DB_MARKED : 0);
+    ml_updatechunk(buf, lnum + 1 + (linenr_T)i, len, ML_CHNK_ADDLINE);
+  }
+
+  // Mark the block dirty, the line counts in the pointer blocks are updated
+  // when it is released, like for ML_INSERT in ml_find_line().
+  buf->b_ml.ml_flags |= ML_LOCKED_DIRTY;
+  if (!(flags & ML_APPEND_NEW)) {
+    buf->b_ml.ml_flags |= ML_LOCKED_POS;
+  }
+  buf->b_ml.ml_locked_lineadd += (linenr_T)n;
+  buf->b_ml.ml_locked_high += (linenr_T)n;
+  buf->b_ml.ml_line_count += (linenr_T)n;
+  return n;
+}
+
 /// Flush any pending change and call ml_append_int()
 ///
 /// @param buf
@@ -2464,6 +2980,50 @@ int ml_append_buf(buf_T *buf, linenr_T lnum, char *line, colnr_T len, bool newfi
   return ml_append_flush(buf, lnum, line, len, newfile ? ML_APPEND_NEW : 0);
 }
 
+/// Append "count" lines after line "lnum" of "buf" (may be 0 to insert the
+/// lines in front of the first line).  Does the same as calling
+/// ml_append_buf() for every line, but fills each data block with as many
+/// lines as fit at once, instead of finding the block, moving the text after
+/// the insert position and updating the pointer blocks for every line.
+/// The buffer must already have a memline.
+///
+/// Check: The caller of this function should probably also call
+/// appended_lines().
+///
+/// @param lnum  append after this line (can be 0)
+/// @param lines  text of the new lines, each NUL terminated, NULs in the text
+///               replaced with NL.  Can't be text of a line in the buffer.
+/// @param count  number of items in "lines"
+/// @param flags  ML_APPEND_ flags
+///
+/// @return  FAIL for failure, OK otherwise
+int ml_append_lines(buf_T *buf, linenr_T lnum, const String *lines, size_t count, int flags)
+  FUNC_ATTR_NONNULL_ARG(1)
+{
+  if (buf->b_ml.ml_mfp == NULL || lnum > buf->b_ml.ml_line_count) {
+    return FAIL;
+  }
+  if (buf->b_ml.ml_line_lnum != 0) {
+    ml_flush_line(buf, false);
+  }
+
+  for (size_t i = 0; i < count;) {
+    // Append one line the normal way, this locks the data block it ends up
+    // in, splitting a full block when needed.
+    if (ml_append_int(buf, lnum, lines[i].data, (colnr_T)lines[i].size + 1, flags) == FAIL) {
+      return FAIL;
+    }
+    lnum++;
+    i++;
+
+    // Then copy as many of the following lines into that block as fit.
+    size_t n = ml_append_fill(buf, lnum, lines + i, count - i, flags);
+    lnum += (linenr_T)n;
+    i += n;
+  }
+  return OK;
+}
+
 void ml_add_deleted_len(char *ptr, ssize_t len)
 {
   ml_add_deleted_len_buf(curbuf, ptr, len);
@@ -2542,10 +3102,16 @@ int ml_replace_buf_len(buf_T *buf, linenr_T lnum, char *line_arg, size_t len_arg
     line = xmemdupz(line, len_arg);
   }
 
+  ml_view_changed(buf);
+
   if (buf->b_ml.ml_line_lnum != lnum) {
     // another line is buffered, flush it
     ml_flush_line(buf, false);
   }
+  if (buf->b_ml.ml_map != NULL) {
+    // The changed line is flushed into the tree.
+    ml_map_promote(buf, lnum);
+  }
 
   if (kv_size(buf->update_callbacks)) {
     ml_add_deleted_len_buf(buf, ml_get_buf(buf, lnum), -1);
@@ -2593,6 +3159,12 @@ int ml_delete_buf(buf_T *buf, linenr_T lnum, bool message)
 static int ml_delete_int(buf_T *buf, linenr_T lnum, int flags)
   FUNC_ATTR_NONNULL_ALL
 {
+  if (buf->b_ml.ml_map != NULL) {
+    return ml_map_delete(buf, lnum, flags);
+  }
+
+  ml_view_changed(buf);
+
   if (lowest_marked && lowest_marked > lnum) {
     lowest_marked--;
   }
@@ -2770,7 +3342,9 @@ void ml_setmarked(linenr_T lnum)
 /// find the first line with its DB_MARKED flag set
 linenr_T ml_firstmarked(void)
 {
-  if (curbuf->b_ml.ml_mfp == NULL) {
+  // ml_setmarked() moves the lines of a mapped buffer into data blocks,
+  // without that there are no marks.
+  if (curbuf->b_ml.ml_mfp == NULL || curbuf->b_ml.ml_map != NULL) {
     return 0;
   }
 
@@ -2803,7 +3377,7 @@ linenr_T ml_firstmarked(void)
 /// clear all DB_MARKED flags
 void ml_clearmarked(void)
 {
-  if (curbuf->b_ml.ml_mfp == NULL) {        // nothing to do
+  if (curbuf->b_ml.ml_mfp == NULL || curbuf->b_ml.ml_map != NULL) {  // nothing to do
     return;
   }
 
@@ -2849,6 +3423,18 @@ static void ml_flush_line(buf_T *buf, bool noalloc)
   if (buf->b_ml.ml_line_lnum == 0 || buf->b_ml.ml_mfp == NULL) {
     return;             // nothing to do
   }
+  if ((buf->b_ml.ml_flags & ML_LINE_DIRTY) && buf->b_ml.ml_map != NULL) {
+    // A changed line is in the tree, flush it under its line number there.
+    mlmap_T *map = buf->b_ml.ml_map;
+    linenr_T tree_lnum;
+    ml_map_lookup(map, buf->b_ml.ml_line_lnum, &tree_lnum);
+    buf->b_ml.ml_line_lnum = 0;
+    ml_map_tree_begin(buf);
+    buf->b_ml.ml_line_lnum = tree_lnum;
+    ml_flush_line(buf, noalloc);
+    ml_map_tree_end(buf, map);
+    return;
+  }
   if (buf->b_ml.ml_flags & ML_LINE_DIRTY) {
     // This code doesn't work recursively.
     if (entered) {
@@ -2857,6 +3443,7 @@ static void ml_flush_line(buf_T *buf, bool noalloc)
     entered = true;
 
     buf->flush_count++;
+    ml_view_changed(buf);
 
     linenr_T lnum = buf->b_ml.ml_line_lnum;
     char *new_line = buf->b_ml.ml_line_ptr;
@@ -2938,6 +3525,7 @@ static bhdr_T *ml_new_data(memfile_T *mfp, bool negative, int page_count)
 {
   assert(page_count >= 0);
   bhdr_T *hp = mf_new(mfp, negative, (unsigned)page_count);
+  hp->bh_flags |= BH_DATA;
   DataBlock *dp = hp->bh_data;
   dp->db_id = DATA_ID;
   dp->db_txt_start = dp->db_txt_end = (unsigned)page_count * mfp->mf_page_size;
@@ -2977,6 +3565,11 @@ static bhdr_T *ml_find_line(buf_T *buf, linenr_T lnum, int action)
   bhdr_T *hp;
   int top;
 
+  // The lines of a mapped buffer are not in the tree yet.
+  if (buf->b_ml.ml_map != NULL && action != ML_FLUSH) {
+    ml_map_materialize(buf);
+  }
+
   memfile_T *mfp = buf->b_ml.ml_mfp;
 
   // If there is a locked block check if the wanted line is in it.
@@ -3052,6 +3645,7 @@ static bhdr_T *ml_find_line(buf_T *buf, linenr_T lnum, int action)
 
     DataBlock *dp = hp->bh_data;
     if (dp->db_id == DATA_ID) {         // data block
+      hp->bh_flags |= BH_DATA;
       buf->b_ml.ml_locked = hp;
       buf->b_ml.ml_locked_low = low;
       buf->b_ml.ml_locked_high = high;
@@ -3827,6 +4421,7 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, int len, int updtype)
     buf->b_ml.ml_usedchunks = 1;
     buf->b_ml.ml_chunksize[0].mlcs_numlines = 1;
     buf->b_ml.ml_chunksize[0].mlcs_totalsize = 1;
+    buf->b_ml.ml_treechunks = 0;
   }
 
   if (updtype == ML_CHNK_UPDLINE && buf->b_ml.ml_line_count == 1) {
@@ -3834,6 +4429,7 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, int len, int updtype)
     buf->b_ml.ml_usedchunks = 1;
     buf->b_ml.ml_chunksize[0].mlcs_numlines = 1;
     buf->b_ml.ml_chunksize[0].mlcs_totalsize = buf->b_ml.ml_line_len;
+    buf->b_ml.ml_treechunks = 0;
     return;
   }
 
@@ -3841,13 +4437,8 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, int len, int updtype)
   // chunk.
   if (buf != ml_upd_lastbuf || line != ml_upd_lastline + 1
       || updtype != ML_CHNK_ADDLINE) {
-    for (curline = 1, curix = 0;
-         curix < buf->b_ml.ml_usedchunks - 1
-         && line >= curline +
-         buf->b_ml.ml_chunksize[curix].mlcs_numlines;
-         curix++) {
-      curline += buf->b_ml.ml_chunksize[curix].mlcs_numlines;
-    }
+    int size;
+    curix = ml_chunktree_find(buf, line, 0, false, &curline, &size);
   } else if (curix < buf->b_ml.ml_usedchunks - 1
              && line >= curline + buf->b_ml.ml_chunksize[curix].mlcs_numlines) {
     // Adjust cached curix & curline
@@ -3860,6 +4451,8 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, int len, int updtype)
     len = -len;
   }
   curchnk->mlcs_totalsize += len;
+  ml_chunktree_add(buf, curix, updtype == ML_CHNK_ADDLINE ? 1 : updtype == ML_CHNK_DELLINE ? -1 : 0,
+                   len);
   if (updtype == ML_CHNK_ADDLINE) {
     int rest;
     DataBlock *dp;
@@ -3914,6 +4507,7 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, int len, int updtype)
       buf->b_ml.ml_chunksize[curix].mlcs_totalsize = size;
       buf->b_ml.ml_chunksize[curix + 1].mlcs_totalsize -= size;
       buf->b_ml.ml_usedchunks++;
+      buf->b_ml.ml_treechunks = 0;
       ml_upd_lastbuf = NULL;         // Force recalc of curix & curline
       return;
     } else if (buf->b_ml.ml_chunksize[curix].mlcs_numlines >= MLCS_MINL
@@ -3923,6 +4517,7 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, int len, int updtype)
       // after this. Do it now to avoid the loop above later on
       curchnk = buf->b_ml.ml_chunksize + curix + 1;
       buf->b_ml.ml_usedchunks++;
+      buf->b_ml.ml_treechunks = 0;
       if (line == buf->b_ml.ml_line_count) {
         curchnk->mlcs_numlines = 0;
         curchnk->mlcs_totalsize = 0;
@@ -3957,6 +4552,7 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, int len, int updtype)
       curchnk = buf->b_ml.ml_chunksize + curix;
     } else if (curix == 0 && curchnk->mlcs_numlines <= 0) {
       buf->b_ml.ml_usedchunks--;
+      buf->b_ml.ml_treechunks = 0;
       memmove(buf->b_ml.ml_chunksize, buf->b_ml.ml_chunksize + 1,
               (size_t)buf->b_ml.ml_usedchunks * sizeof(chunksize_T));
       return;
@@ -3971,6 +4567,7 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, int len, int updtype)
     curchnk[-1].mlcs_numlines += curchnk->mlcs_numlines;
     curchnk[-1].mlcs_totalsize += curchnk->mlcs_totalsize;
     buf->b_ml.ml_usedchunks--;
+    buf->b_ml.ml_treechunks = 0;
     if (curix < buf->b_ml.ml_usedchunks) {
       memmove(buf->b_ml.ml_chunksize + curix,
               buf->b_ml.ml_chunksize + curix + 1,
@@ -3984,6 +4581,90 @@ static void ml_updatechunk(buf_T *buf, linenr_T line, int len, int updtype)
   ml_upd_lastcurix = curix;
 }
 
+/// Rebuild the Fenwick tree over the chunks of "buf" after chunks were
+/// split or merged.  Takes O(n) for n chunks, which is amortized over the
+/// hundreds of lines that need to be added or deleted to change the chunks.
+static void ml_chunktree_build(buf_T *buf)
+{
+  int n = buf->b_ml.ml_usedchunks;
+  chunksize_T *tree = xrealloc(buf->b_ml.ml_chunktree, sizeof(chunksize_T) * (size_t)(n + 1));
+  buf->b_ml.ml_chunktree = tree;
+
+  // Node "i" holds the sum of the chunks (i - lowbit(i), i], 1-based.
+  memcpy(tree + 1, buf->b_ml.ml_chunksize, sizeof(chunksize_T) * (size_t)n);
+  for (int i = 1; i <= n; i++) {
+    int parent = i + (i & -i);
+    if (parent <= n) {
+      tree[parent].mlcs_numlines += tree[i].mlcs_numlines;
+      tree[parent].mlcs_totalsize += tree[i].mlcs_totalsize;
+    }
+  }
+  buf->b_ml.ml_treechunks = n;
+}
+
+/// Add "lines" and "size" to chunk "ix" in the Fenwick tree.  Nothing to do
+/// when the tree is going to be rebuilt anyway.
+static void ml_chunktree_add(buf_T *buf, int ix, int lines, int size)
+{
+  int n = buf->b_ml.ml_treechunks;
+  if (n == 0) {
+    return;
+  }
+  assert(ix < n);
+  for (int i = ix + 1; i <= n; i += i & -i) {
+    buf->b_ml.ml_chunktree[i].mlcs_numlines += lines;
+    buf->b_ml.ml_chunktree[i].mlcs_totalsize += size;
+  }
+}
+
+/// Find the chunk that contains line "lnum" (when not zero) or byte
+/// "offset" (when not zero), using one extra byte per line for the line
+/// break when "ffdos" is set.  The last chunk is used when it is beyond the
+/// end.
+///
+/// @param[out] curlinep  first line of the chunk
+/// @param[out] sizep  byte offset of the chunk, including the CRs for
+///                    "ffdos" only when looking for an offset
+///
+/// @return  index of the chunk
+static int ml_chunktree_find(buf_T *buf, linenr_T lnum, int offset, bool ffdos,
+                             linenr_T *curlinep, int *sizep)
+{
+  if (buf->b_ml.ml_treechunks != buf->b_ml.ml_usedchunks) {
+    ml_chunktree_build(buf);
+  }
+  chunksize_T *tree = buf->b_ml.ml_chunktree;
+
+  // Descend the tree, skipping over all chunks that end before the line or
+  // offset.  The last chunk is never skipped.
+  int last = buf->b_ml.ml_usedchunks - 1;
+  int pos = 0;
+  int lines = 0;
+  int size = 0;
+  int step = 1;
+  while (step * 2 <= last) {
+    step *= 2;
+  }
+  for (; step > 0 && last > 0; step /= 2) {
+    int next = pos + step;
+    if (next > last) {
+      continue;
+    }
+    int next_lines = lines + tree[next].mlcs_numlines;
+    int next_size = size + tree[next].mlcs_totalsize;
+    if ((lnum != 0 && lnum >= 1 + next_lines)
+        || (offset != 0 && offset > next_size + ffdos * next_lines)) {
+      pos = next;
+      lines = next_lines;
+      size = next_size;
+    }
+  }
+
+  *curlinep = 1 + lines;
+  *sizep = size + (offset && ffdos ? lines : 0);
+  return pos;
+}
+
 /// Find offset for line or line with offset.
 ///
 /// @param buf buffer to use
@@ -4019,6 +4700,16 @@ int ml_find_line_or_offset(buf_T *buf, linenr_T lnum, int *offp, bool no_ff)
     return (int)buf->b_ml.ml_line_offset;
   }
 
+  if (buf->b_ml.ml_map != NULL && lnum >= 0) {
+    ml_map_check(buf);
+  }
+  if (buf->b_ml.ml_map != NULL && lnum >= 0) {
+    if (lnum > 0) {
+      return ml_map_line2byte(buf, lnum, ffdos);
+    }
+    ml_map_materialize(buf);
+  }
+
   if (buf->b_ml.ml_usedchunks == -1
       || buf->b_ml.ml_chunksize == NULL
       || lnum < 0) {
@@ -4038,25 +4729,10 @@ int ml_find_line_or_offset(buf_T *buf, linenr_T lnum, int *offp, bool no_ff)
   if (lnum == 0 && offset <= 0) {
     return 1;       // Not a "find offset" and offset 0 _must_ be in line 1
   }
-  // Find the last chunk before the one containing our line. Last chunk is
-  // special because it will never qualify.
-  linenr_T curline = 1;
-  int curix = 0;
-  int size = 0;
-  while (curix < buf->b_ml.ml_usedchunks - 1
-         && ((lnum != 0
-              && lnum >= curline + buf->b_ml.ml_chunksize[curix].mlcs_numlines)
-             || (offset != 0
-                 && offset > size +
-                 buf->b_ml.ml_chunksize[curix].mlcs_totalsize
-                 + ffdos * buf->b_ml.ml_chunksize[curix].mlcs_numlines))) {
-    curline += buf->b_ml.ml_chunksize[curix].mlcs_numlines;
-    size += buf->b_ml.ml_chunksize[curix].mlcs_totalsize;
-    if (offset && ffdos) {
-      size += buf->b_ml.ml_chunksize[curix].mlcs_numlines;
-    }
-    curix++;
-  }
+  // Find the chunk containing our line.
+  linenr_T curline;
+  int size;
+  ml_chunktree_find(buf, lnum, offset, ffdos, &curline, &size);
 
   while ((lnum != 0 && curline < lnum) || (offset != 0 && size < offset)) {
     if (curline > buf->b_ml.ml_line_count
@@ -4139,6 +4815,542 @@ int ml_find_line_or_offset(buf_T *buf, linenr_T lnum, int *offp, bool no_ff)
   return size;
 }
 
+/// Let the buffer "buf", which only contains the empty line of a new
+/// memline, be backed by the private file mapping "map" with "line_count"
+/// lines.  The buffer takes over the mapping, its index and its file
+/// descriptor.
+///
+/// ml_get_buf() returns lines where they are in the mapping.  A line that is
+/// changed is moved into the data blocks, with the lines that are added.
+/// The lines that are left in the mapping are kept as extents (mm_exts).  The
+/// tree holds the other lines, in order, followed by the empty line of the
+/// new memline.  A line in the tree is found by its buffer line number minus
+/// the number of mapped lines before it, see ml_map_tree_begin().
+/// All lines are moved into data blocks by ml_map_materialize() when
+/// something needs all the blocks of the memline.
+void ml_map_attach(buf_T *buf, const mlmap_T *map, linenr_T line_count)
+  FUNC_ATTR_NONNULL_ALL
+{
+  assert(buf->b_ml.ml_map == NULL && buf->b_ml.ml_line_count == 1 && line_count > 0);
+
+  ml_flush_line(buf, false);
+  mlmap_T *mp = xmemdup(map, sizeof(*map));
+  mp->mm_limit = mp->mm_size;
+  mp->mm_eol = mp->mm_base[mp->mm_size - 1] == NL;
+  mp->mm_line_count = line_count;
+  mp->mm_cur_lnum = 0;
+  mp->mm_ready = xcalloc(kv_size(mp->mm_index), sizeof(bool));
+  kv_init(mp->mm_exts);
+  kv_push(mp->mm_exts, ((mlmapext_T){
+    .me_lnum = 1,
+    .me_count = line_count,
+    .me_map_lnum = 1,
+    .me_bytes = ml_map_offset(mp, line_count + 1),
+  }));
+  mp->mm_mapped = line_count;
+  mp->mm_check_time = os_hrtime();
+
+  // The last line can't be NUL terminated in the mapping.
+  if (!mp->mm_eol) {
+    colnr_T len;
+    char *text = ml_map_line(mp, line_count, &len);
+    mp->mm_last = xmemdupz(text, (size_t)len);
+    memchrsub(mp->mm_last, NUL, NL, (size_t)len);  // NULs are stored as NLs
+  }
+
+  buf->b_ml.ml_map = mp;
+  buf->b_ml.ml_line_count = line_count;
+  buf->b_ml.ml_flags &= ~ML_EMPTY;
+}
+
+/// Unmap and free "map".
+static void ml_map_free(mlmap_T *map)
+{
+#ifdef HAVE_SYS_MMAN_H
+  os_munmap(map->mm_base, map->mm_size);
+#endif
+  if (map->mm_fd >= 0) {
+    os_close(map->mm_fd);
+  }
+  kv_destroy(map->mm_index);
+  xfree(map->mm_ready);
+  kv_destroy(map->mm_exts);
+  xfree(map->mm_last);
+  xfree(map);
+}
+
+/// Find line "lnum" in file mapping "map".
+///
+/// Starts at the closest line in mm_index, or at the line looked up last
+/// time when that is closer, so that going through lines in sequence is
+/// cheap.  Only the first mm_limit bytes are read, a line after that is
+/// empty.
+///
+/// @param[out] lenp  length of the line, excluding the line break
+///
+/// @return  pointer to the text of the line in the mapping
+static char *ml_map_line(mlmap_T *map, linenr_T lnum, colnr_T *lenp)
+  FUNC_ATTR_NONNULL_ALL
+{
+  size_t idx = (size_t)(lnum - 1) / MLMAP_STRIDE;
+  // The lines of a stride prepared by ml_map_text() end in a NUL.
+  const int sep = map->mm_ready[idx] ? NUL : NL;
+  const size_t limit = map->mm_limit;
+  linenr_T cur = (linenr_T)(idx * MLMAP_STRIDE) + 1;
+  size_t off = MIN(kv_A(map->mm_index, idx), limit);
+
+  if (map->mm_cur_lnum >= cur && map->mm_cur_lnum <= lnum) {
+    cur = map->mm_cur_lnum;
+    off = map->mm_cur_off;
+  }
+  for (; cur < lnum && off < limit; cur++) {
+    char *end = memchr(map->mm_base + off, sep, limit - off);
+    off = end != NULL ? (size_t)(end - map->mm_base) + 1 : limit;
+  }
+  map->mm_cur_lnum = lnum;
+  map->mm_cur_off = off;
+
+  char *text = map->mm_base + off;
+  char *end = memchr(text, sep, limit - off);
+  *lenp = (colnr_T)((end != NULL ? end : map->mm_base + limit) - text);
+  return text;
+}
+
+/// Get line "lnum" of file mapping "map" like it is stored in a data block:
+/// NUL terminated, with NULs in the text replaced with NL.  This is done in
+/// the mapping itself for the MLMAP_STRIDE lines around "lnum", only the
+/// pages holding them get a private copy.
+///
+/// @param[out] lenp  length of the line, excluding the NUL
+static char *ml_map_text(mlmap_T *map, linenr_T lnum, colnr_T *lenp)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_NONNULL_RET
+{
+  if (lnum == map->mm_line_count && map->mm_last != NULL) {
+    *lenp = (colnr_T)strlen(map->mm_last);
+    return map->mm_last;
+  }
+
+  size_t idx = (size_t)(lnum - 1) / MLMAP_STRIDE;
+  if (!map->mm_ready[idx]) {
+    char *p = map->mm_base + kv_A(map->mm_index, idx);
+    char *end = map->mm_base + map->mm_limit;
+    for (int n = 0; n < MLMAP_STRIDE && p < end; n++) {
+      char *nl = memchr(p, NL, (size_t)(end - p));
+      if (nl == NULL) {
+        break;  // the last line, see mm_last
+      }
+      memchrsub(p, NUL, NL, (size_t)(nl - p));
+      *nl = NUL;
+      p = nl + 1;
+    }
+    map->mm_ready[idx] = true;
+  }
+  return ml_map_line(map, lnum, lenp);
+}
+
+/// @return  byte offset of line "lnum" of file mapping "map", the size of the
+///          text when "lnum" is after the last line.  Counts one byte for
+///          each line break, also when the last line has none.
+static size_t ml_map_offset(mlmap_T *map, linenr_T lnum)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (lnum > map->mm_line_count) {
+    return map->mm_size + !map->mm_eol;
+  }
+  colnr_T len;
+  return (size_t)(ml_map_line(map, lnum, &len) - map->mm_base);
+}
+
+/// @return  index of the last extent of "map" that starts at or before line
+///          "lnum", -1 when there is none.
+static int ml_map_find_ext(const mlmap_T *map, linenr_T lnum)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_PURE
+{
+  int lo = 0;
+  int hi = (int)kv_size(map->mm_exts);
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (kv_A(map->mm_exts, mid).me_lnum <= lnum) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo - 1;
+}
+
+/// Find where line "lnum" of a mapped buffer is.
+///
+/// @param[out] tree_lnump  line number in the tree, zero when in the mapping
+///
+/// @return  line number in the mapping, zero when the line is in the tree.
+static linenr_T ml_map_lookup(const mlmap_T *map, linenr_T lnum, linenr_T *tree_lnump)
+  FUNC_ATTR_NONNULL_ALL
+{
+  int i = ml_map_find_ext(map, lnum);
+  if (i < 0) {
+    *tree_lnump = lnum;
+    return 0;
+  }
+  const mlmapext_T *ext = &kv_A(map->mm_exts, i);
+  if (lnum < ext->me_lnum + ext->me_count) {
+    *tree_lnump = 0;
+    return ext->me_map_lnum + (lnum - ext->me_lnum);
+  }
+  *tree_lnump = lnum - ext->me_before - ext->me_count;
+  return 0;
+}
+
+/// @return  number of mapped lines before line "lnum", "bytesp" is set to
+///          their size.
+static linenr_T ml_map_count_before(mlmap_T *map, linenr_T lnum, size_t *bytesp)
+  FUNC_ATTR_NONNULL_ARG(1)
+{
+  int i = ml_map_find_ext(map, lnum - 1);
+  if (i < 0) {
+    if (bytesp != NULL) {
+      *bytesp = 0;
+    }
+    return 0;
+  }
+  const mlmapext_T *ext = &kv_A(map->mm_exts, i);
+  linenr_T count = MIN(ext->me_count, lnum - ext->me_lnum);
+  if (bytesp != NULL) {
+    *bytesp = ext->me_bytes_before
+              + (count == ext->me_count
+                 ? ext->me_bytes
+                 : ml_map_offset(map, ext->me_map_lnum + count)
+                 - ml_map_offset(map, ext->me_map_lnum));
+  }
+  return ext->me_before + count;
+}
+
+/// Update the extents of "map" starting at index "idx" after "added" lines
+/// were inserted before them (deleted when negative), and the counts of the
+/// mapped lines before them.
+static void ml_map_fix_exts(mlmap_T *map, size_t idx, linenr_T added)
+  FUNC_ATTR_NONNULL_ALL
+{
+  linenr_T before = 0;
+  size_t bytes_before = 0;
+  if (idx > 0) {
+    const mlmapext_T *prev = &kv_A(map->mm_exts, idx - 1);
+    before = prev->me_before + prev->me_count;
+    bytes_before = prev->me_bytes_before + prev->me_bytes;
+  }
+  for (; idx < kv_size(map->mm_exts); idx++) {
+    mlmapext_T *ext = &kv_A(map->mm_exts, idx);
+    ext->me_lnum += added;
+    ext->me_before = before;
+    ext->me_bytes_before = bytes_before;
+    before += ext->me_count;
+    bytes_before += ext->me_bytes;
+  }
+  map->mm_mapped = before;
+}
+
+/// Split the extent of "map" holding line "lnum", when it also holds the
+/// line after it.  The caller checks for MLMAP_MAX_EXTENTS.
+static void ml_map_split(mlmap_T *map, linenr_T lnum)
+  FUNC_ATTR_NONNULL_ALL
+{
+  int i = ml_map_find_ext(map, lnum);
+  if (i < 0) {
+    return;
+  }
+  mlmapext_T *ext = &kv_A(map->mm_exts, i);
+  linenr_T count = lnum - ext->me_lnum + 1;
+  if (count >= ext->me_count) {
+    return;
+  }
+  size_t bytes = ml_map_offset(map, ext->me_map_lnum + count)
+                 - ml_map_offset(map, ext->me_map_lnum);
+  mlmapext_T tail = {
+    .me_lnum = lnum + 1,
+    .me_count = ext->me_count - count,
+    .me_map_lnum = ext->me_map_lnum + count,
+    .me_bytes = ext->me_bytes - bytes,
+    .me_before = ext->me_before + count,
+    .me_bytes_before = ext->me_bytes_before + bytes,
+  };
+  ext->me_count = count;
+  ext->me_bytes = bytes;
+
+  kv_pushp(map->mm_exts);
+  memmove(&kv_A(map->mm_exts, i + 2), &kv_A(map->mm_exts, i + 1),
+          (kv_size(map->mm_exts) - (size_t)i - 2) * sizeof(mlmapext_T));
+  kv_A(map->mm_exts, i + 1) = tail;
+}
+
+/// Remove mapped line "lnum" from its extent, the lines after it move up.
+static void ml_map_cut(buf_T *buf, linenr_T lnum)
+  FUNC_ATTR_NONNULL_ALL
+{
+  mlmap_T *map = buf->b_ml.ml_map;
+  ml_map_split(map, lnum);
+  size_t i = (size_t)ml_map_find_ext(map, lnum);
+  mlmapext_T *ext = &kv_A(map->mm_exts, i);
+  linenr_T map_lnum = ext->me_map_lnum + ext->me_count - 1;
+  ext->me_bytes -= ml_map_offset(map, map_lnum + 1) - ml_map_offset(map, map_lnum);
+  if (--ext->me_count == 0) {
+    kv_shift(map->mm_exts, i, 1);
+  } else {
+    i++;
+  }
+  ml_map_fix_exts(map, i, -1);
+  buf->b_ml.ml_line_count--;
+}
+
+/// Let the memline functions work on the data blocks of mapped buffer "buf"
+/// as if there is no mapping: the line count is that of the tree, line
+/// numbers are those in the tree.  No line may be cached.  Must be followed
+/// by ml_map_tree_end() before anything else uses the buffer.
+static void ml_map_tree_begin(buf_T *buf)
+  FUNC_ATTR_NONNULL_ALL
+{
+  mlmap_T *map = buf->b_ml.ml_map;
+  assert(buf->b_ml.ml_line_lnum == 0);
+  map->mm_buf_line_count = buf->b_ml.ml_line_count;
+  map->mm_prev_line_count = buf->b_prev_line_count;
+  buf->b_ml.ml_line_count -= map->mm_mapped - 1;
+  buf->b_ml.ml_map = NULL;
+}
+
+/// Go back to buffer line numbers after ml_map_tree_begin().  Lines inserted
+/// or deleted in the tree are added to the line count.
+static void ml_map_tree_end(buf_T *buf, mlmap_T *map)
+  FUNC_ATTR_NONNULL_ALL
+{
+  buf->b_ml.ml_map = map;
+  buf->b_ml.ml_line_count += map->mm_mapped - 1;
+  if (map->mm_prev_line_count == 0 && buf->b_prev_line_count != 0) {
+    buf->b_prev_line_count = map->mm_buf_line_count;
+  }
+}
+
+/// ml_append_int() for a mapped buffer: the line goes into the tree.
+static int ml_map_append(buf_T *buf, linenr_T lnum, char *line, colnr_T len, int flags)
+  FUNC_ATTR_NONNULL_ARG(1)
+{
+  mlmap_T *map = buf->b_ml.ml_map;
+  if (kv_size(map->mm_exts) >= MLMAP_MAX_EXTENTS) {
+    ml_map_materialize(buf);
+    return ml_append_int(buf, lnum, line, len, flags);
+  }
+
+  ml_map_split(map, lnum);
+  linenr_T tree_lnum = lnum - ml_map_count_before(map, lnum + 1, NULL);
+  ml_map_tree_begin(buf);
+  int ret = ml_append_int(buf, tree_lnum, line, len, flags);
+  ml_map_tree_end(buf, map);
+  if (ret == OK) {
+    ml_map_fix_exts(map, (size_t)(ml_map_find_ext(map, lnum) + 1), 1);
+  }
+  return ret;
+}
+
+/// ml_delete_int() for a mapped buffer.
+static int ml_map_delete(buf_T *buf, linenr_T lnum, int flags)
+  FUNC_ATTR_NONNULL_ALL
+{
+  mlmap_T *map = buf->b_ml.ml_map;
+  if (buf->b_ml.ml_line_count == 1 || kv_size(map->mm_exts) >= MLMAP_MAX_EXTENTS) {
+    ml_map_materialize(buf);
+    return ml_delete_int(buf, lnum, flags);
+  }
+
+  linenr_T tree_lnum;
+  linenr_T map_lnum = ml_map_lookup(map, lnum, &tree_lnum);
+  if (map_lnum == 0) {
+    ml_map_tree_begin(buf);
+    int ret = ml_delete_int(buf, tree_lnum, flags);
+    ml_map_tree_end(buf, map);
+    if (ret == OK) {
+      ml_map_fix_exts(map, (size_t)(ml_map_find_ext(map, lnum) + 1), -1);
+    }
+    return ret;
+  }
+
+  ml_view_changed(buf);
+  if (buf->b_prev_line_count == 0) {
+    buf->b_prev_line_count = buf->b_ml.ml_line_count;
+  }
+  colnr_T len;
+  ml_add_deleted_len_buf(buf, ml_map_text(map, map_lnum, &len), len);
+  ml_map_cut(buf, lnum);
+  if (map->mm_mapped == 0) {
+    ml_map_materialize(buf);  // only drops the mapping
+  }
+  return OK;
+}
+
+/// Move line "lnum" of mapped buffer "buf" into the tree, if it is still in
+/// the mapping, so that it can be changed.
+static void ml_map_promote(buf_T *buf, linenr_T lnum)
+  FUNC_ATTR_NONNULL_ALL
+{
+  mlmap_T *map = buf->b_ml.ml_map;
+  linenr_T tree_lnum;
+  linenr_T map_lnum = ml_map_lookup(map, lnum, &tree_lnum);
+  if (map_lnum == 0) {
+    return;
+  }
+  // Cutting the line may split an extent.  Appending it then must not move
+  // all lines into data blocks, its text is in the mapping.
+  if (kv_size(map->mm_exts) >= MLMAP_MAX_EXTENTS - 1) {
+    ml_map_materialize(buf);
+    return;
+  }
+
+  ml_flush_line(buf, false);
+  int prev_line_count = buf->b_prev_line_count;
+  colnr_T len;
+  char *text = ml_map_text(map, map_lnum, &len);
+  ml_map_cut(buf, lnum);
+  ml_map_append(buf, lnum - 1, text, len + 1, 0);
+  buf->b_prev_line_count = prev_line_count;
+  if (map->mm_mapped == 0) {
+    ml_map_materialize(buf);  // only drops the mapping
+  }
+}
+
+/// ml_find_line_or_offset() for a mapped buffer: byte offset of line "lnum",
+/// using one byte for a line break, two with "ffdos".
+static int ml_map_line2byte(buf_T *buf, linenr_T lnum, bool ffdos)
+  FUNC_ATTR_NONNULL_ALL
+{
+  mlmap_T *map = buf->b_ml.ml_map;
+
+  if (lnum > buf->b_ml.ml_line_count + 1) {
+    return -1;
+  }
+
+  // The size of the mapped lines before "lnum" plus the offset of the first
+  // line in the tree that is not before "lnum".
+  size_t size;
+  linenr_T tree_lnum = lnum - ml_map_count_before(map, lnum, &size);
+  if (tree_lnum > 1) {
+    // A changed line after "lnum" does not matter, keep it.
+    linenr_T line_lnum = buf->b_ml.ml_line_lnum;
+    if (line_lnum != 0 && line_lnum < lnum) {
+      ml_flush_line(buf, false);
+      line_lnum = 0;
+    }
+    buf->b_ml.ml_line_lnum = 0;
+    ml_map_tree_begin(buf);
+    int offset = ml_find_line_or_offset(buf, tree_lnum, NULL, true);
+    ml_map_tree_end(buf, map);
+    buf->b_ml.ml_line_lnum = line_lnum;
+    if (offset < 0) {
+      return -1;
+    }
+    size += (size_t)offset;
+  }
+
+  if (ffdos) {
+    size += (size_t)lnum - 1;
+  }
+  // Don't count the last line break if 'noeol' and ('bin' or 'nofixeol').
+  if ((!buf->b_p_fixeol || buf->b_p_bin) && !buf->b_p_eol
+      && lnum > buf->b_ml.ml_line_count) {
+    size -= (size_t)ffdos + 1;
+  }
+  // The offset does not fit in the result.
+  if (size > INT_MAX) {
+    return -1;
+  }
+  return (int)size;
+}
+
+/// Check if the file mapped for "buf" was changed by another program, at
+/// most once every MLMAP_CHECK_NS.  If it was, move the lines into data
+/// blocks before the changed file is read through the mapping, a page past
+/// the end of the file can't be read.  Lines that are no longer in the file
+/// become empty.  Not done while a view is open, its text must stay valid.
+static void ml_map_check(buf_T *buf)
+  FUNC_ATTR_NONNULL_ALL
+{
+  mlmap_T *map = buf->b_ml.ml_map;
+  uint64_t now = os_hrtime();
+  if (buf->b_ml.ml_view != NULL || now - map->mm_check_time < MLMAP_CHECK_NS) {
+    return;
+  }
+  map->mm_check_time = now;
+
+  FileInfo file_info;
+  if (!os_fileinfo_fd(map->mm_fd, &file_info)) {
+    map->mm_limit = 0;
+  } else if (os_fileinfo_size(&file_info) != os_fileinfo_size(&map->mm_file_info)
+             || file_info.stat.st_mtim.tv_sec != map->mm_file_info.stat.st_mtim.tv_sec
+             || file_info.stat.st_mtim.tv_nsec != map->mm_file_info.stat.st_mtim.tv_nsec) {
+    map->mm_limit = (size_t)MIN(os_fileinfo_size(&file_info), map->mm_size);
+  } else {
+    return;
+  }
+  ml_map_materialize(buf);
+}
+
+/// Move the lines of every buffer that is backed by a mapping of the file
+/// "fname" into data blocks.  Must be done before the file is truncated or
+/// written in place, the lines would be read from the changed file otherwise
+/// (or SIGBUS is raised when a mapped page is past the end of the file).
+void ml_map_release_file(const char *fname)
+  FUNC_ATTR_NONNULL_ALL
+{
+  FileID file_id;
+  if (!os_fileid(fname, &file_id)) {
+    return;
+  }
+  FOR_ALL_BUFFERS(buf) {
+    if (buf->b_ml.ml_map != NULL
+        && os_fileid_equal_fileinfo(&file_id, &buf->b_ml.ml_map->mm_file_info)) {
+      ml_map_materialize(buf);
+    }
+  }
+}
+
+/// Move the mapped lines of a buffer into data blocks and drop the mapping,
+/// so that the memline can be used like for any other buffer.
+static void ml_map_materialize(buf_T *buf)
+{
+  mlmap_T *map = buf->b_ml.ml_map;
+  int prev_line_count = buf->b_prev_line_count;
+
+  ml_flush_line(buf, false);
+  // Text in the view may be in the mapping.
+  ml_view_changed(buf);
+
+  // Insert the lines of the extents between the lines of the tree, like
+  // readfile() does.  Then delete the empty line at the end of the tree.
+  ml_map_tree_begin(buf);
+  char *line = NULL;
+  size_t line_size = 0;
+  bool ok = true;
+  for (size_t i = 0; ok && i < kv_size(map->mm_exts); i++) {
+    const mlmapext_T *ext = &kv_A(map->mm_exts, i);
+    for (linenr_T n = 0; ok && n < ext->me_count; n++) {
+      colnr_T len;
+      char *text = ml_map_line(map, ext->me_map_lnum + n, &len);
+      if ((size_t)len + 1 > line_size) {
+        line_size = MAX((size_t)len + 1, line_size * 2);
+        line = xrealloc(line, line_size);
+      }
+      memcpy(line, text, (size_t)len);
+      line[len] = NUL;
+      memchrsub(line, NUL, NL, (size_t)len);
+      ok = ml_append_int(buf, ext->me_lnum + n - 1, line, len + 1, ML_APPEND_NEW) == OK;
+    }
+  }
+  xfree(line);
+
+  inhibit_delete_count++;
+  ml_delete_int(buf, buf->b_ml.ml_line_count, 0);
+  inhibit_delete_count--;
+
+  buf->b_prev_line_count = prev_line_count;
+  ml_map_free(map);
+}
+
 /// Goto byte in buffer with offset 'cnt'.
 void goto_byte(int cnt)
 {
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "nvim/api/private/defs.h"  // IWYU pragma: keep
 #include "nvim/ascii_defs.h"
 #include "nvim/eval/typval_defs.h"  // IWYU pragma: keep
 #include "nvim/memline_defs.h"  // IWYU pragma: keep
@@ -1,6 +1,12 @@
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "klib/kvec.h"
 #include "nvim/memfile_defs.h"
+#include "nvim/os/fs_defs.h"
 #include "nvim/pos_defs.h"
 
 ///
@@ -20,6 +26,69 @@ typedef struct {
   int mlcs_totalsize;
 } chunksize_T;
 
+/// Number of lines between two entries in mm_index.
+enum { MLMAP_STRIDE = 256, };
+
+/// Lines of a buffer that are still in the file mapping: buffer lines
+/// me_lnum to me_lnum + me_count - 1 are lines me_map_lnum and following of
+/// the mapping.
+typedef struct {
+  linenr_T me_lnum;             ///< first line in the buffer
+  linenr_T me_count;            ///< number of lines
+  linenr_T me_map_lnum;         ///< first line in the mapping
+  size_t me_bytes;              ///< size of the lines, with one byte for each line break
+  linenr_T me_before;           ///< number of lines in the extents before this one
+  size_t me_bytes_before;       ///< size of the lines in the extents before this one
+} mlmapext_T;
+
+/// A private mapping of the file that backs the unchanged lines of a buffer,
+/// see ml_map_attach().  The lines are separated by NL, there are no NUL
+/// bytes at the end of a line.  The lines of a stride are NUL terminated
+/// when they are first used, see ml_map_text().
+typedef struct {
+  char *mm_base;                ///< start of the mapping
+  size_t mm_size;               ///< number of bytes in the mapping
+  size_t mm_limit;              ///< number of bytes that can be read, less than
+                                ///< mm_size when the file was truncated
+  bool mm_eol;                  ///< the last line ends in a NL
+  linenr_T mm_line_count;       ///< number of lines in the mapping
+  kvec_t(size_t) mm_index;      ///< byte offset of line 1, MLMAP_STRIDE + 1, etc.
+  bool *mm_ready;                ///< per stride: its lines are NUL terminated
+  char *mm_last;                ///< NUL terminated copy of the last line when it
+                                ///< does not end in a NL
+  linenr_T mm_cur_lnum;         ///< line last looked up, 0 if none
+  size_t mm_cur_off;            ///< byte offset of mm_cur_lnum
+  kvec_t(mlmapext_T) mm_exts;   ///< lines of the buffer in the mapping, in order
+  linenr_T mm_mapped;           ///< number of lines in mm_exts
+  linenr_T mm_buf_line_count;   ///< line count saved by ml_map_tree_begin()
+  int mm_prev_line_count;       ///< b_prev_line_count saved by ml_map_tree_begin()
+  int mm_fd;                    ///< the mapped file, to notice it was changed
+  FileInfo mm_file_info;        ///< size and time of the file when it was mapped
+  uint64_t mm_check_time;       ///< os_hrtime() of the last check of the file
+} mlmap_T;
+
+/// Number of lines in an mlview_T, must be a power of two.
+enum { MLVIEW_SIZE = 32, };
+
+/// A line kept by an mlview_T.
+typedef struct {
+  linenr_T mvl_lnum;            ///< line number, 0 when not used
+  colnr_T mvl_len;              ///< length of the text, excluding the NUL
+  char *mvl_ptr;                ///< text of the line
+  bhdr_T *mvl_hp;               ///< pinned data block holding the text, or NULL
+  char *mvl_copy;               ///< copy of the text, with ML_GET_ALLOC_LINES
+} mlviewline_T;
+
+/// Lines of a buffer whose text stays where it is, see ml_view_open().
+typedef struct {
+  int mv_refcount;                     ///< ml_view_open() calls not closed yet
+  mlviewline_T mv_lines[MLVIEW_SIZE];  ///< line "lnum" is at lnum % MLVIEW_SIZE
+} mlview_T;
+
+/// Check done by ml_filter_lines() on the "len" bytes of text of a line, in
+/// the thread with index "thread".
+typedef uint8_t (*mlcheck_T)(const char *text, size_t len, int thread, void *arg);
+
 // Flags when calling ml_updatechunk()
 #define ML_CHNK_ADDLINE 1
 #define ML_CHNK_DELLINE 2
@@ -33,7 +102,13 @@ typedef struct {
 ///   data_block: leaf nodes
 ///
 /// Memline also has "chunks" of 800 lines that are separate from the 128-tree
-/// structure, primarily used to speed up line2byte() and byte2line().
+/// structure, primarily used to speed up line2byte() and byte2line().  A
+/// Fenwick tree over the chunks finds the chunk of a line or byte offset in
+/// O(log n) steps.
+///
+/// A large file can be backed by a mapping of the file (ml_map) instead.  The
+/// tree then only holds the lines that were changed or added, followed by an
+/// empty line, the other lines are read from the mapping.
 ///
 /// Motivation: If you have a file that is 10000 lines long, and you insert
 ///             a line at linenr 1000, you don't want to move 9000 lines in
@@ -69,4 +144,9 @@ typedef struct {
   chunksize_T *ml_chunksize;
   int ml_numchunks;
   int ml_usedchunks;
+  chunksize_T *ml_chunktree;    // Fenwick tree with the sums of ml_chunksize
+  int ml_treechunks;            // nr of chunks in ml_chunktree, 0 when invalid
+
+  mlmap_T *ml_map;              // file mapping backing unchanged lines
+  mlview_T *ml_view;            // lines kept by ml_view_open() or NULL
 } memline_T;
@@ -35,6 +35,9 @@
 
 #include "msgpack_rpc/channel.c.generated.h"
 
+/// Maximal number of read-only requests handled together.
+#define RPC_BATCH_MAX 256
+
 #ifdef NVIM_LOG_DEBUG
 # define REQ "[request]  "
 # define RES "[response] "
@@ -79,6 +82,8 @@ void rpc_start(Channel *channel)
   channel->is_rpc = true;
   RpcState *rpc = &channel->rpc;
   rpc->closed = false;
+  rpc->pipeline = false;
+  rpc->batch = NULL;
   rpc->unpacker = xcalloc(1, sizeof *rpc->unpacker);
   unpacker_init(rpc->unpacker);
   rpc->next_request_id = 1;
@@ -212,11 +217,17 @@ static size_t receive_msgpack(RStream *stream, const char *rbuf, size_t c, void
     Unpacker *p = channel->rpc.unpacker;
     p->read_ptr = rbuf;
     p->read_size = c;
+    p->borrow_start = rbuf;
+    p->borrow_end = rstream_buffer_end(stream);
     parse_msgpack(channel);
 
     if (!unpacker_closed(p)) {
-      consumed = c - p->read_size;
+      // A message continues in the next read.
+      pin_read_buffer(channel, stream);
+      // Relative to the new buffer, if it was taken.
+      consumed = rstream_available(stream) - p->read_size;
     }
+    p->borrow_start = p->borrow_end = NULL;
   }
 
   if (eof) {
@@ -292,6 +303,9 @@ static void parse_msgpack(Channel *channel)
         return;
       }
       Array arg = res.data.array;
+      if (p->borrow_end) {
+        pin_read_buffer(channel, channel_outstream(channel));
+      }
       handle_request(channel, p, arg);
     }
   }
@@ -302,6 +316,29 @@ static void parse_msgpack(Channel *channel)
   }
 }
 
+/// Keeps the strings of the message being parsed which point into the read
+/// buffer of "stream" valid after the stream reuses the buffer.  Usually the
+/// buffer is given to the message and the stream reads into a new one.  When
+/// more of it is still to be parsed than was borrowed, the strings are copied
+/// instead.
+static void pin_read_buffer(Channel *channel, RStream *stream)
+{
+  Unpacker *p = channel->rpc.unpacker;
+  if (kv_size(p->borrowed) == 0) {
+    return;
+  }
+  if (p->read_size > p->borrowed_size) {
+    unpacker_copy_borrowed(p);
+    return;
+  }
+
+  size_t consumed = (size_t)(p->read_ptr - stream->read_pos);
+  unpacker_pin(p, rstream_take_buffer(stream, consumed));
+  p->read_ptr = stream->read_pos;
+  p->borrow_start = stream->read_pos;
+  p->borrow_end = rstream_buffer_end(stream);
+}
+
 /// Handles requests and notifications received on the channel.
 static void handle_request(Channel *channel, Unpacker *p, Array args)
   FUNC_ATTR_NONNULL_ALL
@@ -312,6 +349,7 @@ static void handle_request(Channel *channel, Unpacker *p, Array args)
     send_error(channel, p->handler, p->type, p->request_id, p->unpack_error.msg);
     api_clear_error(&p->unpack_error);
     arena_mem_free(arena_finish(&p->arena));
+    unpacker_free_pinned(&p->pinned);
     return;
   }
 
@@ -322,6 +360,8 @@ static void handle_request(Channel *channel, Unpacker *p, Array args)
   evdata->args = args;
   evdata->used_mem = p->arena;
   p->arena = (Arena)ARENA_EMPTY;
+  evdata->pinned = p->pinned;
+  p->pinned = (PinnedBuffers)KV_INITIAL_VALUE;
   evdata->request_id = p->request_id;
   channel_incref(channel);
   if (p->handler.fast) {
@@ -340,13 +380,44 @@ static void handle_request(Channel *channel, Unpacker *p, Array args)
       Event ev = event_create_oneshot(event_create(request_event, evdata), 2);
       multiqueue_put_event(channel->events, ev);
       multiqueue_put_event(resize_events, ev);
+    } else if (p->handler.readonly && channel->rpc.pipeline) {
+      if (channel->rpc.batch == NULL) {
+        channel->rpc.batch = xcalloc(1, sizeof(RequestBatch));
+        multiqueue_put(channel->events, request_batch_event, channel, channel->rpc.batch);
+      }
+      kv_push(*channel->rpc.batch, evdata);
+      DLOG("RPC: batched %.*s", (int)p->method_name_len, p->handler.name);
+      if (kv_size(*channel->rpc.batch) == RPC_BATCH_MAX) {
+        // Still check for input now and then.
+        channel->rpc.batch = NULL;
+      }
+      return;
     } else {
       multiqueue_put(channel->events, request_event, evdata);
       DLOG("RPC: scheduled %.*s", (int)p->method_name_len, p->handler.name);
     }
+    // Later read-only requests must be handled after this one.
+    channel->rpc.batch = NULL;
   }
 }
 
+/// Handles consecutive read-only requests, without processing other events or
+/// checking for input in between.
+static void request_batch_event(void **argv)
+{
+  Channel *channel = argv[0];
+  RequestBatch *batch = argv[1];
+  // The channel is alive, each request holds a reference.
+  if (channel->rpc.batch == batch) {
+    channel->rpc.batch = NULL;
+  }
+  for (size_t i = 0; i < kv_size(*batch); i++) {
+    request_event((void **)&kv_A(*batch, i));
+  }
+  kv_destroy(*batch);
+  xfree(batch);
+}
+
 /// Handles a message, depending on the type:
 ///   - Request: invokes method and writes the response (or error).
 ///   - Notification: invokes method (emits `nvim_error_event` on error).
@@ -373,6 +444,7 @@ static void request_event(void **argv)
 free_ret:
   // e->args (and possibly result) are allocated in an arena
   arena_mem_free(arena_finish(&e->used_mem));
+  unpacker_free_pinned(&e->pinned);
   channel_decref(channel);
   xfree(e);
   api_clear_error(&error);
@@ -668,6 +740,27 @@ void rpc_set_client_info(uint64_t id, Dict info)
     chan->rpc.client_type = kClientTypeUnknown;
   }
 
+  // "pipeline" in "attributes" enables pipelining of read-only requests
+  const char *pipeline = NULL;
+  for (size_t i = 0; i < info.size; i++) {
+    Object attrs = info.items[i].value;
+    if (strequal(info.items[i].key.data, "attributes") && attrs.type == kObjectTypeDict) {
+      for (size_t j = 0; j < attrs.data.dict.size; j++) {
+        KeyValuePair *kv = &attrs.data.dict.items[j];
+        if (strequal(kv->key.data, "pipeline") && kv->value.type == kObjectTypeString) {
+          pipeline = kv->value.data.string.data;
+        }
+      }
+    }
+  }
+  chan->rpc.pipeline = pipeline != NULL && strequal(pipeline, "readonly");
+  if (chan->streamtype != kChannelStreamInternal) {
+    channel_instream(chan)->coalesce = chan->rpc.pipeline;
+  }
+  if (!chan->rpc.pipeline) {
+    chan->rpc.batch = NULL;
+  }
+
   channel_info_changed(chan, false);
 }
 
@@ -27,6 +27,9 @@ typedef struct {
   ArenaMem result_mem;
 } ChannelCallFrame;
 
+/// Read buffers given to a request, as its strings point into them.
+typedef kvec_t(char *) PinnedBuffers;
+
 typedef struct {
   MessageType type;
   Channel *channel;
@@ -34,10 +37,16 @@ typedef struct {
   Array args;
   uint32_t request_id;
   Arena used_mem;
+  PinnedBuffers pinned;
 } RequestEvent;
 
+/// Consecutive read-only requests of a channel, handled by one event.
+typedef kvec_t(RequestEvent *) RequestBatch;
+
 typedef struct {
   bool closed;
+  bool pipeline;  ///< handle consecutive read-only requests together
+  RequestBatch *batch;  ///< queued batch which read-only requests can join
   Unpacker *unpacker;
   RemoteUI *ui;
   uint32_t next_request_id;
@@ -23,6 +23,7 @@ Object unpack(const char *data, size_t size, Arena *arena, Error *err)
   mpack_parser_init(&unpacker.parser, 0);
   unpacker.parser.data.p = &unpacker;
   unpacker.arena = *arena;
+  unpacker.borrow_end = NULL;
 
   int result = mpack_parse(&unpacker.parser, &data, &size,
                            api_parse_enter, api_parse_exit);
@@ -101,15 +102,21 @@ static void api_parse_enter(mpack_parser_t *parser, mpack_node_t *node)
 
   case MPACK_TOKEN_BIN:
   case MPACK_TOKEN_STR: {
-    char *mem = arena_alloc(&p->arena, node->tok.length + 1, false);
-    mem[node->tok.length] = NUL;
-    String str = { .data = mem, .size = node->tok.length };
+    String str = { .data = NULL, .size = node->tok.length };
+    // A string which may be borrowed from the read buffer is only allocated
+    // when its first chunk shows that it is not all there.
+    if (!may_borrow(p, str.size)) {
+      str.data = arena_alloc(&p->arena, str.size + 1, false);
+      str.data[str.size] = NUL;
+    }
     if (key_location) {
       *key_location = str;
     } else {
       *result = STRING_OBJ(str);
+      key_location = &result->data.string;
     }
     node->data[0].p = str.data;
+    node->data[1].p = key_location;
     break;
   }
   case MPACK_TOKEN_EXT:
@@ -120,6 +127,21 @@ static void api_parse_enter(mpack_parser_t *parser, mpack_node_t *node)
     assert(parent);
     if (parent->tok.type == MPACK_TOKEN_STR || parent->tok.type == MPACK_TOKEN_BIN) {
       char *data = parent->data[0].p;
+      if (data == NULL) {
+        String *str = parent->data[1].p;
+        const char *chunk = node->tok.data.chunk_ptr;
+        // The byte after the string must be in the buffer for its NUL.
+        if (node->tok.length == str->size
+            && chunk >= p->borrow_start && chunk + str->size < p->borrow_end) {
+          str->data = (char *)chunk;
+          kv_push(p->borrowed, str);
+          p->borrowed_size += str->size;
+          break;
+        }
+        data = str->data = arena_alloc(&p->arena, str->size + 1, false);
+        data[str->size] = NUL;
+        parent->data[0].p = data;
+      }
       memcpy(data + parent->pos,
              node->tok.data.chunk_ptr, node->tok.length);
     } else {
@@ -179,6 +201,51 @@ static void api_parse_exit(mpack_parser_t *parser, mpack_node_t *node)
 {
 }
 
+/// Strings shorter than this are always copied, tracking them costs more.
+#define BORROW_MIN_SIZE 16
+
+/// @return  whether a string of "size" bytes may point into the read buffer.
+static bool may_borrow(Unpacker *p, size_t size)
+{
+  // Only the arguments of requests, not the "redraw" events of state 13.
+  return p->borrow_end != NULL && size >= BORROW_MIN_SIZE
+         && p->state == 2 && p->type != kMessageTypeResponse;
+}
+
+/// Copies the strings which point into the read buffer to the arena.
+void unpacker_copy_borrowed(Unpacker *p)
+{
+  for (size_t i = 0; i < kv_size(p->borrowed); i++) {
+    String *str = kv_A(p->borrowed, i);
+    str->data = arena_memdupz(&p->arena, str->data, str->size);
+  }
+  kv_size(p->borrowed) = 0;
+  p->borrowed_size = 0;
+}
+
+/// Gives the read buffer "buf" to the message being parsed, which keeps it
+/// until the message is freed.  The stream must have stopped reading into it,
+/// then the strings which point into it can be NUL terminated.
+void unpacker_pin(Unpacker *p, char *buf)
+{
+  for (size_t i = 0; i < kv_size(p->borrowed); i++) {
+    String *str = kv_A(p->borrowed, i);
+    str->data[str->size] = NUL;
+  }
+  kv_size(p->borrowed) = 0;
+  p->borrowed_size = 0;
+  kv_push(p->pinned, buf);
+}
+
+void unpacker_free_pinned(PinnedBuffers *pinned)
+{
+  for (size_t i = 0; i < kv_size(*pinned); i++) {
+    free_block(kv_A(*pinned, i));
+  }
+  kv_destroy(*pinned);
+  *pinned = (PinnedBuffers)KV_INITIAL_VALUE;
+}
+
 void unpacker_init(Unpacker *p)
 {
   mpack_parser_init(&p->parser, 0);
@@ -187,6 +254,10 @@ void unpacker_init(Unpacker *p)
   p->unpack_error = ERROR_INIT;
 
   p->arena = (Arena)ARENA_EMPTY;
+  p->borrow_start = p->borrow_end = NULL;
+  kv_init(p->borrowed);
+  p->borrowed_size = 0;
+  kv_init(p->pinned);
 
   p->has_grid_line_event = false;
 }
@@ -194,6 +265,8 @@ void unpacker_init(Unpacker *p)
 void unpacker_teardown(Unpacker *p)
 {
   arena_mem_free(arena_finish(&p->arena));
+  kv_destroy(p->borrowed);
+  unpacker_free_pinned(&p->pinned);
 }
 
 bool unpacker_parse_header(Unpacker *p)
@@ -36,6 +36,14 @@ struct Unpacker {
 
   Arena arena;
 
+  // Strings of requests in [borrow_start, borrow_end) point into the read
+  // buffer instead of being copied to the arena, until the buffer is pinned.
+  const char *borrow_start;
+  const char *borrow_end;
+  kvec_t(String *) borrowed;
+  size_t borrowed_size;
+  PinnedBuffers pinned;  // read buffers given to the current message
+
   int nevents;
   int ncalls;
   UIClientHandler ui_handler;
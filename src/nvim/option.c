@@ -2828,6 +2828,7 @@ static const char *validate_num_option(OptIndex opt_idx, OptInt *newval, char *e
 
   switch (opt_idx) {
   case kOptHelpheight:
+  case kOptLargefilesize:
   case kOptTitlelen:
   case kOptUpdatecount:
   case kOptReport:
@@ -2958,6 +2959,13 @@ static const char *validate_num_option(OptIndex opt_idx, OptInt *newval, char *e
       return e_cannot_have_more_than_hundred_quickfix;
     }
     break;
+  case kOptMemcompress:
+    if (value < 0) {
+      return e_positive;
+    } else if (value > 0 && value < MEMCOMPRESS_MIN) {
+      return e_invarg;
+    }
+    break;
   case kOptMaxsearchcount:
     if (value <= 0) {
       return e_positive;
@@ -395,6 +395,7 @@ EXTERN char *p_km;              ///< 'keymodel'
 EXTERN char *p_langmap;         ///< 'langmap'
 EXTERN int p_lnr;               ///< 'langnoremap'
 EXTERN int p_lrm;               ///< 'langremap'
+EXTERN OptInt p_lfs;            ///< 'largefilesize'
 EXTERN char *p_lm;              ///< 'langmenu'
 EXTERN OptInt p_lines;          ///< 'lines'
 EXTERN OptInt p_linespace;      ///< 'linespace'
@@ -416,6 +417,7 @@ EXTERN OptInt p_mco;            ///< 'maxcombine'
 EXTERN OptInt p_mfd;            ///< 'maxfuncdepth'
 EXTERN OptInt p_mmd;            ///< 'maxmapdepth'
 EXTERN OptInt p_mmp;            ///< 'maxmempattern'
+EXTERN OptInt p_mcm;            ///< 'memcompress'
 EXTERN OptInt p_mis;            ///< 'menuitems'
 EXTERN char *p_mopt;            ///< 'messagesopt'
 EXTERN OptInt p_msc;            ///< 'maxsearchcount'
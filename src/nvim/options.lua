@@ -5253,6 +5253,33 @@ local options = {
       type = 'boolean',
       varname = 'p_lrm',
     },
+    {
+      abbreviation = 'lfs',
+      defaults = 0,
+      desc = [=[
+        When editing a file of at least this many Mbyte, the buffer is
+        backed by a private memory mapping of the file instead of reading all
+        lines into memory.  Lines are used where they are in the mapping, so
+        opening and browsing a huge log file does not take time or memory
+        proportional to its size.  Only lines that are changed or added are
+        moved into memory, the other lines stay in the mapping.  All lines are
+        moved into memory when a swap file is written for the changed buffer,
+        set 'noswapfile' to avoid that.
+        Only used for a file that is valid UTF-8 (unless 'binary' is set) and
+        has "unix" 'fileformat', when 'undofile' is off.  Otherwise, or when
+        zero (the default), the file is read as usual.
+        Note: Changes made to the file by another program may show up in the
+        lines that are still mapped.  When the size or modification time of
+        the file changes, all lines are moved into memory the next time the
+        buffer is used, lines beyond the new end of the file are empty.
+        Only available on systems that support mmap().
+      ]=],
+      full_name = 'largefilesize',
+      scope = { 'global' },
+      short_desc = N_('minimal size (in Mbyte) of a file to map into memory'),
+      type = 'number',
+      varname = 'p_lfs',
+    },
     {
       abbreviation = 'ls',
       cb = 'did_set_laststatus',
@@ -5807,6 +5834,24 @@ local options = {
       type = 'number',
       varname = 'p_msc',
     },
+    {
+      abbreviation = 'mcm',
+      defaults = 0,
+      desc = [=[
+        When 'swapfile' is off, the text of a buffer is only kept in memory.
+        When the text of such a buffer takes more than this many Kbyte, the
+        blocks of text that were not used recently are compressed.  They are
+        uncompressed again when they are used.  This reduces the memory used
+        for many large buffers, at the cost of some CPU time.
+        Zero (the default) disables compressing.  Otherwise the value must be
+        at least 64.  How much memory is saved is reported by nvim__stats().
+      ]=],
+      full_name = 'memcompress',
+      scope = { 'global' },
+      short_desc = N_('memory (in Kbyte) of text kept uncompressed without swap file'),
+      type = 'number',
+      varname = 'p_mcm',
+    },
     {
       abbreviation = 'mis',
       defaults = 25,
@@ -53,6 +53,10 @@
 # include <sys/uio.h>
 #endif
 
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
+
 #ifdef MSWIN
 # include "nvim/mbyte.h"
 # include "nvim/option.h"
@@ -669,6 +673,34 @@ ptrdiff_t os_readv(const int fd, bool *const ret_eof, struct iovec *iov, size_t
 }
 #endif  // HAVE_READV
 
+#ifdef HAVE_SYS_MMAN_H
+/// Map a file into memory, privately.
+///
+/// The mapping stays valid after `fd` is closed.  Pages that are written to
+/// get a private copy, the file itself is never changed.  Pages that are not
+/// written to are shared with the page cache, thus changes to the file made
+/// by other processes may become visible.
+///
+/// @param[in]  fd  File descriptor to map, must be opened for reading.
+/// @param[in]  size  Number of bytes to map, must not be zero.
+///
+/// @return Start of the mapping or NULL on failure.
+void *os_mmap_private(const int fd, const size_t size)
+  FUNC_ATTR_WARN_UNUSED_RESULT
+{
+  assert(size > 0);
+  void *const p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  return p == MAP_FAILED ? NULL : p;
+}
+
+/// Unmap memory mapped with os_mmap_private().
+void os_munmap(void *const addr, const size_t size)
+  FUNC_ATTR_NONNULL_ALL
+{
+  munmap(addr, size);
+}
+#endif  // HAVE_SYS_MMAN_H
+
 /// Write to a file
 ///
 /// @param[in]  fd  File descriptor to write to.
@@ -710,6 +742,49 @@ ptrdiff_t os_write(const int fd, const char *const buf, const size_t size, const
   return (ptrdiff_t)written_bytes;
 }
 
+/// Write several buffers at a position in a file, like pwritev().
+///
+/// Does not use or change the file position, thus can be used from another
+/// thread while the main thread uses `fd`.  Does not update `g_stats`.
+///
+/// @param[in]  fd  File descriptor to write to.
+/// @param[in,out]  bufs  Buffers to write, modified when a write is partial.
+/// @param[in]  nbufs  Number of buffers.
+/// @param[in]  offset  Position in the file to write the first buffer.
+///
+/// @return Number of bytes written or libuv error code (< 0).
+ptrdiff_t os_pwritev(const int fd, uv_buf_t *bufs, size_t nbufs, int64_t offset)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_WARN_UNUSED_RESULT
+{
+  size_t written_bytes = 0;
+  while (nbufs > 0) {
+    uv_fs_t req;
+    const int r = uv_fs_write(NULL, &req, fd, bufs, (unsigned)nbufs, offset, NULL);
+    uv_fs_req_cleanup(&req);
+    if (r == UV_EINTR || r == UV_EAGAIN) {
+      continue;
+    } else if (r < 0) {
+      return r;
+    } else if (r == 0) {
+      return UV_UNKNOWN;
+    }
+    written_bytes += (size_t)r;
+    offset += r;
+    // Skip over what was written.
+    size_t done = (size_t)r;
+    while (nbufs > 0 && done >= bufs->len) {
+      done -= bufs->len;
+      bufs++;
+      nbufs--;
+    }
+    if (nbufs > 0) {
+      bufs->base += done;
+      bufs->len -= done;
+    }
+  }
+  return (ptrdiff_t)written_bytes;
+}
+
 /// Copies a file from `path` to `new_path`.
 ///
 /// @see http://docs.libuv.org/en/v1.x/fs.html#c.uv_fs_copyfile
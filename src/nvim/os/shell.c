@@ -7,6 +7,8 @@
 
 #include "auto/config.h"
 #include "klib/kvec.h"
+#include "nvim/api/private/defs.h"
+#include "nvim/api/private/helpers.h"
 #include "nvim/ascii_defs.h"
 #include "nvim/buffer.h"
 #include "nvim/charset.h"
@@ -1218,11 +1220,12 @@ static size_t write_output(char *output, size_t remaining, bool eof)
 
   char *start = output;
   size_t off = 0;
+  kvec_t(String) lines = KV_INITIAL_VALUE;
   while (off < remaining) {
     // CRLF
     if (output[off] == CAR && output[off + 1] == NL) {
       output[off] = NUL;
-      ml_append(curwin->w_cursor.lnum++, output, (int)off + 1, false);
+      kv_push(lines, cbuf_as_string(output, off));
       size_t skip = off + 2;
       output += skip;
       remaining -= skip;
@@ -1231,7 +1234,7 @@ static size_t write_output(char *output, size_t remaining, bool eof)
     } else if (output[off] == CAR || output[off] == NL) {
       // Insert the line
       output[off] = NUL;
-      ml_append(curwin->w_cursor.lnum++, output, (int)off + 1, false);
+      kv_push(lines, cbuf_as_string(output, off));
       size_t skip = off + 1;
       output += skip;
       remaining -= skip;
@@ -1246,6 +1249,13 @@ static size_t write_output(char *output, size_t remaining, bool eof)
     off++;
   }
 
+  // Insert the complete lines at once.
+  if (kv_size(lines) > 0) {
+    ml_append_lines(curbuf, curwin->w_cursor.lnum, lines.items, kv_size(lines), 0);
+    curwin->w_cursor.lnum += (linenr_T)kv_size(lines);
+  }
+  kv_destroy(lines);
+
   if (eof) {
     if (remaining) {
       // append unfinished line
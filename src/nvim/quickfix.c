@@ -5488,12 +5488,17 @@ static bool vgr_match_buflines(qf_list_T *qfl, char *fname, buf_T *buf, char *sp
   bool found_match = false;
   size_t pat_len = strlen(spat);
   pat_len = MIN(pat_len, FUZZY_MATCH_MAX_LEN);
+  uint8_t *may_match = NULL;
+  if (!(flags & VGR_FUZZY)) {
+    may_match = search_lines_may_match(buf, 1, buf->b_ml.ml_line_count, regmatch);
+  }
 
   for (linenr_T lnum = 1; lnum <= buf->b_ml.ml_line_count && *tomatch > 0; lnum++) {
     colnr_T col = 0;
     if (!(flags & VGR_FUZZY)) {
       // Regular expression match
-      while (vim_regexec_multi(regmatch, curwin, buf, lnum, col, NULL, NULL) > 0) {
+      while ((may_match == NULL || may_match[lnum - 1] != kLineNoMatch)
+             && vim_regexec_multi(regmatch, curwin, buf, lnum, col, NULL, NULL) > 0) {
         // Pass the buffer number so that it gets used even for a
         // dummy buffer, unless duplicate_name is set, then the
         // buffer will be wiped out below.
@@ -5581,6 +5586,7 @@ static bool vgr_match_buflines(qf_list_T *qfl, char *fname, buf_T *buf, char *sp
     }
   }
 
+  xfree(may_match);
   return found_match;
 }
 
@@ -29,8 +29,10 @@
 #include "nvim/globals.h"
 #include "nvim/keycodes.h"
 #include "nvim/macros_defs.h"
+#include "nvim/map_defs.h"
 #include "nvim/mark.h"
 #include "nvim/mark_defs.h"
+#include "nvim/math.h"
 #include "nvim/mbyte.h"
 #include "nvim/mbyte_defs.h"
 #include "nvim/memline.h"
@@ -47,6 +49,11 @@
 #include "nvim/types_defs.h"
 #include "nvim/vim_defs.h"
 
+#if defined(__SSE2__) || defined(_M_X64)
+# include <emmintrin.h>
+# define HAVE_SSE2
+#endif
+
 typedef enum {
   RGLF_LINE = 0x01,
   RGLF_LENGTH = 0x02,
@@ -65,6 +72,24 @@ enum {
   NFA_TOO_EXPENSIVE = -1,
 };
 
+enum {
+  /// Maximum length of a literal string found by nfa_get_regmust().
+  NFA_REGMUST_LEN = 32,
+  /// Maximum number of alternative strings found by nfa_get_regmust().
+  NFA_REGMUST_ALT = REGMUST_MAX,
+};
+
+enum {
+  /// Size of the states in the cache of the lazy DFA before it is flushed.
+  /// Every regprog has its own cache, this allows for some tens of states.
+  DFA_MAX_BYTES = 32 * 1024,
+  /// Bytes to scan per state before the cache is full, the DFA is not used
+  /// for the pattern anymore when fewer were scanned.
+  DFA_MIN_SCAN = 10,
+  DFA_UNKNOWN = -1,  ///< transition not computed yet
+  DFA_FAILED = -2,   ///< gave up, use the NFA
+};
+
 /// Which regexp engine to use? Needed for vim_regcomp().
 /// Must match with 'regexpengine'.
 enum {
@@ -81,7 +106,7 @@ struct regprog {
   unsigned regflags;
   unsigned re_engine;  ///< Automatic, backtracking or NFA engine.
   unsigned re_flags;   ///< Second argument for vim_regcomp().
-  bool re_in_use;      ///< prog is being executed
+  int re_in_use;       ///< number of matches executing the prog
 };
 
 /// Structure used by the back track matcher.
@@ -93,7 +118,7 @@ typedef struct {
   unsigned regflags;
   unsigned re_engine;
   unsigned re_flags;
-  bool re_in_use;
+  int re_in_use;
 
   int regstart;
   uint8_t reganch;
@@ -105,13 +130,13 @@ typedef struct {
 
 /// Structure representing a NFA state.
 /// An NFA state may have no outgoing edge, when it is a NFA_MATCH state.
+typedef struct dfa dfa_T;
 typedef struct nfa_state nfa_state_T;
 struct nfa_state {
   int c;
   nfa_state_T *out;
   nfa_state_T *out1;
   int id;
-  int lastlist[2];  ///< 0: normal, 1: recursive
   int val;
 };
 
@@ -122,13 +147,17 @@ typedef struct {
   unsigned regflags;
   unsigned re_engine;
   unsigned re_flags;
-  bool re_in_use;
+  int re_in_use;
 
   nfa_state_T *start;   ///< points into state[]
 
   int reganch;          ///< pattern starts with ^
   int regstart;         ///< char at start of pattern
   uint8_t *match_text;  ///< plain text to match with
+  int nregmust;         ///< number of strings in regmust[]
+  uint8_t *regmust[NFA_REGMUST_ALT];  ///< a match contains one of these
+  bool dfa_usable;      ///< the lazy DFA can run this pattern
+  dfa_T *dfa;           ///< lazy DFA, allocated when first used
 
   int has_zend;         ///< pattern contains \ze
   int has_backref;      ///< pattern contains \1 .. \9
@@ -139,6 +168,56 @@ typedef struct {
   nfa_state_T state[];
 } nfa_regprog_T;
 
+/// Literal text which the matches of a part of a pattern have in common.
+/// Used by nfa_get_regmust() while walking the postfix form.
+typedef struct {
+  bool exact;  ///< every match is "prefix", which is complete
+  char prefix[NFA_REGMUST_LEN + 1];  ///< every match starts with this
+  char suffix[NFA_REGMUST_LEN + 1];  ///< every match ends with this
+  int nmust;   ///< number of strings in "must", zero if nothing is known
+  char must[NFA_REGMUST_ALT][NFA_REGMUST_LEN + 1];  ///< every match contains one of these
+} nfa_lit_T;
+
+/// A state of the lazy DFA: the NFA states which consume a character after
+/// the same text.
+typedef struct {
+  int nids;           ///< number of NFA states in "ids"
+  int *ids;           ///< indexes in nfa_regprog_T "state", sorted
+  bool match;         ///< a match ends here
+  bool match_eol;     ///< a match ends here at the end of the line
+  int16_t next[256];  ///< next state for a character or DFA_UNKNOWN
+} dfa_state_T;
+
+/// Lazy DFA for a nfa_regprog_T, see dfa_may_match().
+struct dfa {
+  bool failed;             ///< the cache was flushed too often, only use the NFA
+  bool ic;                 ///< "rex->reg_ic" for the cached states
+  garray_T states;         ///< dfa_state_T pointers
+  Map(String, int) index;  ///< "ids" of a state to its index + 1
+  int start[2];            ///< start state, index 1 at column zero
+  int flushes;             ///< number of times the cache was flushed
+  size_t scanned;          ///< bytes scanned since the last flush
+  size_t bytes;            ///< memory used by the cached states
+  int *mark;               ///< per NFA state: "gen" when it was reached
+  int gen;                 ///< incremented for every dfa_walk()
+  int *stack;              ///< states still to be followed by dfa_walk()
+  int sp;                  ///< number of items in "stack"
+  int *ids;                ///< NFA states found by dfa_walk()
+  int nids;                ///< number of items in "ids"
+  nfa_state_T **seeds;     ///< states to start dfa_walk() with
+};
+
+/// Matches a regexp against lines in a thread other than the main thread,
+/// see vim_regworker_new().
+struct regworker {
+  regprog_T *prog;
+  bool ic;
+  buf_T *buf;       ///< for 'iskeyword' and the like, instead of curbuf
+  dfa_T *dfa;       ///< lazy DFA of this worker, the one of "prog" is not used
+  char *line;       ///< NUL terminated copy of the line
+  size_t linesize;  ///< allocated size of "line"
+};
+
 struct regengine {
   /// bt_regcomp or nfa_regcomp
   regprog_T *(*regcomp)(uint8_t *, int);
@@ -158,8 +237,8 @@ struct regengine {
 // Also stores the length of "backpos".
 typedef struct {
   union {
-    uint8_t *ptr;       // rex.input pointer, for single-line regexp
-    lpos_T pos;        // rex.input pos, for multi-line regexp
+    uint8_t *ptr;       // rex->input pointer, for single-line regexp
+    lpos_T pos;        // rex->input pos, for multi-line regexp
   } rs_u;
   int rs_len;
 } regsave_T;
@@ -201,7 +280,7 @@ typedef struct regitem_S {
   union {
     save_se_T sesave;
     regsave_T regsave;
-  } rs_un;                      // room for saving rex.input
+  } rs_un;                      // room for saving rex->input
 } regitem_T;
 
 // used for BEHIND and NOBEHIND matching
@@ -282,6 +361,9 @@ typedef struct {
   int has_pim;                  ///< true when any state has a PIM
 } nfa_list_T;
 
+/// Execution state of a match, see regexec_S below.
+typedef struct regexec_S regexec_T;
+
 #ifdef REGEXP_DEBUG
 // show/save debugging data when BT engine is used
 # define BT_REGEXP_DUMP
@@ -359,7 +441,6 @@ static const char e_z_not_allowed[] = N_("E66: \\z( not allowed here");
 static const char e_z1_not_allowed[] = N_("E67: \\z1 - \\z9 not allowed here");
 static const char e_missing_sb[] = N_("E69: Missing ] after %s%%[");
 static const char e_empty_sb[] = N_("E70: Empty %s%%[]");
-static const char e_recursive[] = N_("E956: Cannot use pattern recursively");
 static const char e_regexp_number_after_dot_pos_search_chr[]
   = N_("E1204: No Number allowed after .: '\\%%%c'");
 static const char e_nfa_regexp_missing_value_in_chr[]
@@ -575,6 +656,7 @@ static void init_class_tab(void)
 #define RF_HASNL    4   // can match a NL
 #define RF_ICOMBINE 8   // ignore combining characters
 #define RF_LOOKBH   16  // uses "\@<=" or "\@<!"
+#define RF_HASPOS   32  // uses a position item like "\%23l", "\%#" or "\%^"
 
 // Global work variables for vim_regcomp().
 
@@ -1206,15 +1288,9 @@ static int read_limits(int *minval, int *maxval)
 
 // vim_regexec and friends
 
-// Global work variables for vim_regexec().
-
-// Sometimes need to save a copy of a line.  Since alloc()/free() is very
-// slow, we keep one allocated piece of memory and only re-allocate it when
-// it's too small.  It's freed in bt_regexec_both() when finished.
-static uint8_t *reg_tofree = NULL;
-static unsigned reg_tofreelen;
-
-// Structure used to store the execution state of the regex engine.
+// Structure used to store the execution state of the regex engine.  Every
+// vim_regexec_*() and vim_regsub*() call gets its own one from a pool, thus a
+// match can be done while another one is in progress, also in another thread.
 // Which ones are set depends on whether a single-line or multi-line match is
 // done:
 //                      single-line             multi-line
@@ -1229,7 +1305,7 @@ static unsigned reg_tofreelen;
 // reg_firstlnum        <invalid>               first line in which to search
 // reg_maxline          0                       last line nr
 // reg_line_lbr         false or true           false
-typedef struct {
+struct regexec_S {
   regmatch_T *reg_match;
   regmmatch_T *reg_mmatch;
 
@@ -1264,40 +1340,180 @@ typedef struct {
 
   bool reg_nobreak;
 
+  // Set by vim_regworker_match(): matching in a thread other than the main
+  // thread.  There is no breakcheck and no error message, "reg_failed" is set
+  // instead of giving one.
+  regworker_T *reg_worker;
+  bool reg_failed;
+
   // Copy of "rmm_maxcol": maximum column to search for a match.  Zero when
   // there is no maximum.
   colnr_T reg_maxcol;
 
+  uint8_t *reg_startzp[NSUBEXP];  ///< Workspace to mark beginning
+  uint8_t *reg_endzp[NSUBEXP];    ///<   and end of \z(...\) matches
+  lpos_T reg_startzpos[NSUBEXP];  ///< idem, beginning pos
+  lpos_T reg_endzpos[NSUBEXP];    ///< idem, end pos
+
+  // State for the backtracking engine regexec.
+
+  // Sometimes need to save a copy of a line.  Since alloc()/free() is very
+  // slow, we keep one allocated piece of memory and only re-allocate it when
+  // it's too small.  It's freed in bt_regexec_both() when finished.
+  uint8_t *reg_tofree;
+  unsigned reg_tofreelen;
+
+  // "regstack" and "backpos" are used by regmatch().  They are kept over calls
+  // to avoid invoking malloc() and free() often.
+  // "regstack" is a stack with regitem_T items, sometimes preceded by regstar_T
+  // or regbehind_T.
+  // "backpos" is a table with backpos_T for BACK
+  garray_T regstack;
+  garray_T backpos;
+
+  regsave_T behind_pos;  ///< where a look-behind match must end
+
+  // The arguments from BRACE_LIMITS are stored here.  They are actually local
+  // to regmatch(), but they are here to reduce the amount of stack space used
+  // (it can be called recursively many times).
+  int64_t bl_minval;
+  int64_t bl_maxval;
+
+  int64_t brace_min[10];  ///< Minimums for complex brace repeats
+  int64_t brace_max[10];  ///< Maximums for complex brace repeats
+  int brace_count[10];    ///< Current counts for complex brace repeats
+
   // State for the NFA engine regexec.
   int nfa_has_zend;     ///< NFA regexp \ze operator encountered.
   int nfa_has_backref;  ///< NFA regexp \1 .. \9 encountered.
   int nfa_nsubexpr;     ///< Number of sub expressions actually being used
                         ///< during execution. 1 if only the whole match
                         ///< (subexpr 0) is used.
-  // listid is global, so that it increases on recursive calls to
-  // nfa_regmatch(), which means we don't have to clear the lastlist field of
+  // listid is kept here, so that it increases on recursive calls to
+  // nfa_regmatch(), which means we don't have to clear "nfa_lastlist" for
   // all the states.
   int nfa_listid;
   int nfa_alt_listid;
 
   int nfa_has_zsubexpr;  ///< NFA regexp has \z( ), set zsubexpr.
-} regexec_T;
 
-static regexec_T rex;
-static bool rex_in_use = false;
+  int nfa_match;                ///< whether a match has been found
+  proftime_T *nfa_time_limit;
+  int *nfa_timed_out;
+  int nfa_time_count;
+  save_se_T *nfa_endp;          ///< If not NULL match must end at this position
+  int nfa_ll_index;             ///< 0 for first call to nfa_regmatch(), 1 for
+                                ///< recursive call.
+
+  // Per NFA state, indexed by its "id": ID of the list it was last added to.
+  // [0] for the first call to nfa_regmatch(), [1] for recursive calls.
+  int *nfa_lastlist[2];
+  int nfa_lastlist_len;  ///< number of items in "nfa_lastlist[0]" and [1]
+
+  regsubs_T nfa_temp_subs;    ///< copy of "subs" made by addstate()
+  int nfa_addstate_depth;     ///< recursion depth of addstate()
+
+  garray_T nfa_lists;  ///< nfa_list_T pairs used by nfa_regmatch(), one for
+                       ///< each recursion level
+  int nfa_depth;       ///< number of "nfa_lists" in use
+
+  regexec_T *pool_next;  ///< next unused context in the pool
+};
+
+/// Context of the innermost match in progress in the current thread.
+static THREAD_LOCAL regexec_T *rex = NULL;
+/// Contexts of the current thread that are not in use.
+static THREAD_LOCAL regexec_T *rex_pool = NULL;
+
+// The thread lists of nfa_regmatch() and "nfa_lastlist" are kept in the pool
+// while they have room for up to this number of NFA states.
+#define NFA_LISTS_KEEP 500
+
+/// Make an execution context from the pool the current one.
+///
+/// @return  the context that was current before, to be passed to regexec_put().
+static regexec_T *regexec_get(void)
+{
+  regexec_T *prev = rex;
+  if (rex_pool != NULL) {
+    rex = rex_pool;
+    rex_pool = rex->pool_next;
+  } else {
+    rex = xcalloc(1, sizeof(*rex));
+    ga_init(&rex->nfa_lists, sizeof(nfa_list_T *), 4);
+  }
+  return prev;
+}
+
+/// Put the current execution context back in the pool and make "prev" the
+/// current one again.
+static void regexec_put(regexec_T *prev)
+{
+  assert(rex->nfa_depth == 0);
+  for (int i = 0; i < rex->nfa_lists.ga_len; i++) {
+    nfa_list_T *list = ((nfa_list_T **)rex->nfa_lists.ga_data)[i];
+    for (int j = 0; j < 2; j++) {
+      if (list[j].len > NFA_LISTS_KEEP + 1) {
+        XFREE_CLEAR(list[j].t);
+        list[j].len = 0;
+      }
+    }
+  }
+  if (rex->nfa_lastlist_len > NFA_LISTS_KEEP) {
+    XFREE_CLEAR(rex->nfa_lastlist[0]);
+    XFREE_CLEAR(rex->nfa_lastlist[1]);
+    rex->nfa_lastlist_len = 0;
+  }
+  rex->pool_next = rex_pool;
+  rex_pool = rex;
+  rex = prev;
+}
+
+/// Free the unused execution contexts of the current thread.  A thread other
+/// than the main thread that matched regexps must call this before it exits.
+void regexec_free_pool(void)
+{
+  while (rex_pool != NULL) {
+    regexec_T *rp = rex_pool;
+    rex_pool = rp->pool_next;
+    xfree(rp->reg_tofree);
+    ga_clear(&rp->regstack);
+    ga_clear(&rp->backpos);
+    xfree(rp->nfa_lastlist[0]);
+    xfree(rp->nfa_lastlist[1]);
+    for (int i = 0; i < rp->nfa_lists.ga_len; i++) {
+      nfa_list_T *list = ((nfa_list_T **)rp->nfa_lists.ga_data)[i];
+      xfree(list[0].t);
+      xfree(list[1].t);
+      xfree(list);
+    }
+    ga_clear(&rp->nfa_lists);
+    xfree(rp);
+  }
+}
 
 static void reg_breakcheck(void)
 {
-  if (!rex.reg_nobreak) {
+  if (!rex->reg_nobreak && rex->reg_worker == NULL) {
     fast_breakcheck();
   }
 }
 
+/// Give the error for a match that needs too much memory.
+static void reg_toobig(void)
+{
+  if (rex->reg_worker != NULL) {
+    rex->reg_failed = true;
+  } else {
+    emsg(_(e_pattern_uses_more_memory_than_maxmempattern));
+  }
+}
+
 // Return true if character 'c' is included in 'iskeyword' option for
 // "reg_buf" buffer.
 static bool reg_iswordc(int c)
 {
-  return vim_iswordc_buf(c, rex.reg_buf);
+  return vim_iswordc_buf(c, rex->reg_buf);
 }
 
 static bool can_f_submatch = false;  ///< true when submatch() can be used
@@ -1332,8 +1548,8 @@ static void reg_getline_common(linenr_T lnum, reg_getline_flags_T flags, char **
     firstlnum = rsm.sm_firstlnum + lnum;
     maxline = rsm.sm_maxline;
   } else {
-    firstlnum = rex.reg_firstlnum + lnum;
-    maxline = rex.reg_maxline;
+    firstlnum = rex->reg_firstlnum + lnum;
+    maxline = rex->reg_maxline;
   }
 
   // when looking behind for a match/no-match lnum is negative. but we
@@ -1361,11 +1577,15 @@ static void reg_getline_common(linenr_T lnum, reg_getline_flags_T flags, char **
     return;
   }
 
+  // When searchit() opened a view on the buffer the lines stay valid while
+  // going back and forth between them.
+  colnr_T len;
+  char *p = ml_view_get(rex->reg_buf, firstlnum, &len);
   if (get_line) {
-    *line = ml_get_buf(rex.reg_buf, firstlnum);
+    *line = p;
   }
   if (get_length) {
-    *length = ml_get_buf_len(rex.reg_buf, firstlnum);
+    *length = len;
   }
 }
 
@@ -1385,13 +1605,8 @@ static colnr_T reg_getline_len(linenr_T lnum)
   return length;
 }
 
-static uint8_t *reg_startzp[NSUBEXP];  // Workspace to mark beginning
-static uint8_t *reg_endzp[NSUBEXP];    //   and end of \z(...\) matches
-static lpos_T reg_startzpos[NSUBEXP];   // idem, beginning pos
-static lpos_T reg_endzpos[NSUBEXP];     // idem, end pos
-
 // true if using multi-line regexp.
-#define REG_MULTI       (rex.reg_match == NULL)
+#define REG_MULTI       (rex->reg_match == NULL)
 
 // Create a new extmatch and mark it as referenced once.
 static reg_extmatch_T *make_extmatch(void)
@@ -1428,28 +1643,28 @@ void unref_extmatch(reg_extmatch_T *em)
 // Get class of previous character.
 static int reg_prev_class(void)
 {
-  if (rex.input > rex.line) {
-    return mb_get_class_tab((char *)rex.input - 1 -
-                            utf_head_off((char *)rex.line, (char *)rex.input - 1),
-                            rex.reg_buf->b_chartab);
+  if (rex->input > rex->line) {
+    return mb_get_class_tab((char *)rex->input - 1 -
+                            utf_head_off((char *)rex->line, (char *)rex->input - 1),
+                            rex->reg_buf->b_chartab);
   }
   return -1;
 }
 
-// Return true if the current rex.input position matches the Visual area.
+// Return true if the current rex->input position matches the Visual area.
 static bool reg_match_visual(void)
 {
   pos_T top, bot;
   linenr_T lnum;
   colnr_T col;
-  win_T *wp = rex.reg_win == NULL ? curwin : rex.reg_win;
+  win_T *wp = rex->reg_win == NULL ? curwin : rex->reg_win;
   int mode;
   colnr_T start, end;
   colnr_T start2, end2;
   colnr_T curswant;
 
   // Check if the buffer is the current buffer and not using a string.
-  if (rex.reg_buf != curbuf || VIsual.lnum == 0 || !REG_MULTI) {
+  if (rex->reg_buf != curbuf || VIsual.lnum == 0 || !REG_MULTI) {
     return false;
   }
 
@@ -1478,12 +1693,12 @@ static bool reg_match_visual(void)
     mode = curbuf->b_visual.vi_mode;
     curswant = curbuf->b_visual.vi_curswant;
   }
-  lnum = rex.lnum + rex.reg_firstlnum;
+  lnum = rex->lnum + rex->reg_firstlnum;
   if (lnum < top.lnum || lnum > bot.lnum) {
     return false;
   }
 
-  col = (colnr_T)(rex.input - rex.line);
+  col = (colnr_T)(rex->input - rex->line);
   if (mode == 'v') {
     if ((lnum == top.lnum && col < top.col)
         || (lnum == bot.lnum && col >= bot.col + (*p_sel != 'e'))) {
@@ -1502,11 +1717,11 @@ static bool reg_match_visual(void)
       end = MAXCOL;
     }
 
-    // getvvcol() flushes rex.line, need to get it again
-    rex.line = (uint8_t *)reg_getline(rex.lnum);
-    rex.input = rex.line + col;
+    // getvvcol() flushes rex->line, need to get it again
+    rex->line = (uint8_t *)reg_getline(rex->lnum);
+    rex->input = rex->line + col;
 
-    colnr_T cols = win_linetabsize(wp, rex.reg_firstlnum + rex.lnum, (char *)rex.line, col);
+    colnr_T cols = win_linetabsize(wp, rex->reg_firstlnum + rex->lnum, (char *)rex->line, col);
     if (cols < start || cols > end - (*p_sel == 'e')) {
       return false;
     }
@@ -1520,7 +1735,7 @@ static int prog_magic_wrong(void)
 {
   regprog_T *prog;
 
-  prog = REG_MULTI ? rex.reg_mmatch->regprog : rex.reg_match->regprog;
+  prog = REG_MULTI ? rex->reg_mmatch->regprog : rex->reg_match->regprog;
   if (prog->engine == &nfa_regengine) {
     // For NFA matcher we don't check the magic
     return false;
@@ -1538,43 +1753,43 @@ static int prog_magic_wrong(void)
 // used (to increase speed).
 static void cleanup_subexpr(void)
 {
-  if (!rex.need_clear_subexpr) {
+  if (!rex->need_clear_subexpr) {
     return;
   }
 
   if (REG_MULTI) {
     // Use 0xff to set lnum to -1
-    memset(rex.reg_startpos, 0xff, sizeof(lpos_T) * NSUBEXP);
-    memset(rex.reg_endpos, 0xff, sizeof(lpos_T) * NSUBEXP);
+    memset(rex->reg_startpos, 0xff, sizeof(lpos_T) * NSUBEXP);
+    memset(rex->reg_endpos, 0xff, sizeof(lpos_T) * NSUBEXP);
   } else {
-    memset(rex.reg_startp, 0, sizeof(char *) * NSUBEXP);
-    memset(rex.reg_endp, 0, sizeof(char *) * NSUBEXP);
+    memset(rex->reg_startp, 0, sizeof(char *) * NSUBEXP);
+    memset(rex->reg_endp, 0, sizeof(char *) * NSUBEXP);
   }
-  rex.need_clear_subexpr = false;
+  rex->need_clear_subexpr = false;
 }
 
 static void cleanup_zsubexpr(void)
 {
-  if (!rex.need_clear_zsubexpr) {
+  if (!rex->need_clear_zsubexpr) {
     return;
   }
 
   if (REG_MULTI) {
     // Use 0xff to set lnum to -1
-    memset(reg_startzpos, 0xff, sizeof(lpos_T) * NSUBEXP);
-    memset(reg_endzpos, 0xff, sizeof(lpos_T) * NSUBEXP);
+    memset(rex->reg_startzpos, 0xff, sizeof(lpos_T) * NSUBEXP);
+    memset(rex->reg_endzpos, 0xff, sizeof(lpos_T) * NSUBEXP);
   } else {
-    memset(reg_startzp, 0, sizeof(char *) * NSUBEXP);
-    memset(reg_endzp, 0, sizeof(char *) * NSUBEXP);
+    memset(rex->reg_startzp, 0, sizeof(char *) * NSUBEXP);
+    memset(rex->reg_endzp, 0, sizeof(char *) * NSUBEXP);
   }
-  rex.need_clear_zsubexpr = false;
+  rex->need_clear_zsubexpr = false;
 }
 
-// Advance rex.lnum, rex.line and rex.input to the next line.
+// Advance rex->lnum, rex->line and rex->input to the next line.
 static void reg_nextline(void)
 {
-  rex.line = (uint8_t *)reg_getline(++rex.lnum);
-  rex.input = rex.line;
+  rex->line = (uint8_t *)reg_getline(++rex->lnum);
+  rex->input = rex->line;
   reg_breakcheck();
 }
 
@@ -1582,7 +1797,7 @@ static void reg_nextline(void)
 // Returns RA_FAIL, RA_NOMATCH or RA_MATCH.
 // If "bytelen" is not NULL, it is set to the byte length of the match in the
 // last line.
-// Optional: ignore case if rex.reg_ic is set.
+// Optional: ignore case if rex->reg_ic is set.
 static int match_with_backref(linenr_T start_lnum, colnr_T start_col, linenr_T end_lnum,
                               colnr_T end_col, int *bytelen)
 {
@@ -1597,17 +1812,17 @@ static int match_with_backref(linenr_T start_lnum, colnr_T start_col, linenr_T e
   while (true) {
     // Since getting one line may invalidate the other, need to make copy.
     // Slow!
-    if (rex.line != reg_tofree) {
-      len = (int)strlen((char *)rex.line);
-      if (reg_tofree == NULL || len >= (int)reg_tofreelen) {
+    if (rex->line != rex->reg_tofree) {
+      len = (int)strlen((char *)rex->line);
+      if (rex->reg_tofree == NULL || len >= (int)rex->reg_tofreelen) {
         len += 50;              // get some extra
-        xfree(reg_tofree);
-        reg_tofree = xmalloc((size_t)len);
-        reg_tofreelen = (unsigned)len;
+        xfree(rex->reg_tofree);
+        rex->reg_tofree = xmalloc((size_t)len);
+        rex->reg_tofreelen = (unsigned)len;
       }
-      STRCPY(reg_tofree, rex.line);
-      rex.input = reg_tofree + (rex.input - rex.line);
-      rex.line = reg_tofree;
+      STRCPY(rex->reg_tofree, rex->line);
+      rex->input = rex->reg_tofree + (rex->input - rex->line);
+      rex->line = rex->reg_tofree;
     }
 
     // Get the line to compare with.
@@ -1620,8 +1835,8 @@ static int match_with_backref(linenr_T start_lnum, colnr_T start_col, linenr_T e
       len = reg_getline_len(clnum) - ccol;
     }
 
-    if ((!rex.reg_ic && cstrncmp(p + ccol, (char *)rex.input, &len) != 0)
-        || (rex.reg_ic && mb_strnicmp(p + ccol, (char *)rex.input, (size_t)len) != 0)) {
+    if ((!rex->reg_ic && cstrncmp(p + ccol, (char *)rex->input, &len) != 0)
+        || (rex->reg_ic && mb_strnicmp(p + ccol, (char *)rex->input, (size_t)len) != 0)) {
       return RA_NOMATCH;  // doesn't match
     }
     if (bytelen != NULL) {
@@ -1630,7 +1845,7 @@ static int match_with_backref(linenr_T start_lnum, colnr_T start_col, linenr_T e
     if (clnum == end_lnum) {
       break;  // match and at end!
     }
-    if (rex.lnum >= rex.reg_maxline) {
+    if (rex->lnum >= rex->reg_maxline) {
       return RA_NOMATCH;  // text too short
     }
 
@@ -1646,7 +1861,7 @@ static int match_with_backref(linenr_T start_lnum, colnr_T start_col, linenr_T e
     }
   }
 
-  // found a match!  Note that rex.line may now point to a copy of the line,
+  // found a match!  Note that rex->line may now point to a copy of the line,
   // that should not matter.
   return RA_MATCH;
 }
@@ -1734,7 +1949,7 @@ static void mb_decompose(int c, int *c1, int *c2, int *c3)
   }
 }
 
-/// Compare two strings, ignore case if rex.reg_ic set.
+/// Compare two strings, ignore case if rex->reg_ic set.
 /// Return 0 if strings match, non-zero otherwise.
 /// Correct the length "*n" when composing characters are ignored
 /// or when both utf codepoints are considered equal because of
@@ -1743,7 +1958,7 @@ static int cstrncmp(char *s1, char *s2, int *n)
 {
   int result;
 
-  if (!rex.reg_ic) {
+  if (!rex->reg_ic) {
     result = strncmp(s1, s2, (size_t)(*n));
   } else {
     char *p = s1;
@@ -1770,7 +1985,7 @@ static int cstrncmp(char *s1, char *s2, int *n)
   }
 
   // if it failed and it's utf8 and we want to combineignore:
-  if (result != 0 && rex.reg_icombine) {
+  if (result != 0 && rex->reg_icombine) {
     const char *str1, *str2;
     int c1, c2, c11, c12;
     int junk;
@@ -1787,13 +2002,13 @@ static int cstrncmp(char *s1, char *s2, int *n)
       // decompose the character if necessary, into 'base' characters
       // because I don't care about Arabic, I will hard-code the Hebrew
       // which I *do* care about!  So sue me...
-      if (c1 != c2 && (!rex.reg_ic || utf_fold(c1) != utf_fold(c2))) {
+      if (c1 != c2 && (!rex->reg_ic || utf_fold(c1) != utf_fold(c2))) {
         // decomposition necessary?
         mb_decompose(c1, &c11, &junk, &junk);
         mb_decompose(c2, &c12, &junk, &junk);
         c1 = c11;
         c2 = c12;
-        if (c11 != c12 && (!rex.reg_ic || utf_fold(c11) != utf_fold(c12))) {
+        if (c11 != c12 && (!rex->reg_ic || utf_fold(c11) != utf_fold(c12))) {
           break;
         }
       }
@@ -1807,6 +2022,42 @@ static int cstrncmp(char *s1, char *s2, int *n)
   return result;
 }
 
+/// Find the first byte in "p" which is "c1", "c2", NUL or not ASCII.
+///
+/// The SSE2 variant reads whole aligned blocks, which may extend past the NUL
+/// but never into another page.
+static const char *cstrchr_scan(const char *p, uint8_t c1, uint8_t c2)
+  FUNC_ATTR_PURE FUNC_ATTR_WARN_UNUSED_RESULT FUNC_ATTR_NONNULL_ALL
+  FUNC_ATTR_NO_SANITIZE_ADDRESS
+{
+#ifdef HAVE_SSE2
+  const __m128i v1 = _mm_set1_epi8((char)c1);
+  const __m128i v2 = _mm_set1_epi8((char)c2);
+  const __m128i zero = _mm_setzero_si128();
+  const uintptr_t off = (uintptr_t)p & 15;
+  const __m128i *block = (const __m128i *)(p - off);
+  unsigned valid = 0xffffU << off;
+  while (true) {
+    const __m128i v = _mm_load_si128(block);
+    const __m128i eq = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, v1), _mm_cmpeq_epi8(v, v2)),
+                                    _mm_cmpeq_epi8(v, zero));
+    // The sign bit of "v" is set for the bytes which are not ASCII.
+    const unsigned found = ((unsigned)_mm_movemask_epi8(eq) | (unsigned)_mm_movemask_epi8(v))
+                           & valid;
+    if (found != 0) {
+      return (const char *)block + xctz(found);
+    }
+    block++;
+    valid = 0xffffU;
+  }
+#else
+  while (*p != NUL && (uint8_t)(*p) < 0x80 && (uint8_t)(*p) != c1 && (uint8_t)(*p) != c2) {
+    p++;
+  }
+  return p;
+#endif
+}
+
 /// Wrapper around strchr which accounts for case-insensitive searches and
 /// non-ASCII characters.
 ///
@@ -1820,7 +2071,7 @@ static inline char *cstrchr(const char *const s, const int c)
   FUNC_ATTR_PURE FUNC_ATTR_WARN_UNUSED_RESULT FUNC_ATTR_NONNULL_ALL
   FUNC_ATTR_ALWAYS_INLINE
 {
-  if (!rex.reg_ic) {
+  if (!rex->reg_ic) {
     return vim_strchr(s, c);
   }
 
@@ -1838,6 +2089,23 @@ static inline char *cstrchr(const char *const s, const int c)
     return vim_strchr(s, c);
   }
 
+  if (c < 0x80) {
+    // Skip over the ASCII text which can't match, only a non-ASCII character
+    // may need to be folded.
+    for (const char *p = cstrchr_scan(s, (uint8_t)c, (uint8_t)cc); *p != NUL;) {
+      if ((uint8_t)(*p) < 0x80) {
+        return (char *)p;
+      }
+      // Do not match an illegal byte, compare with lower case of the character.
+      const int uc = utf_ptr2char(p);
+      if (uc != (uint8_t)(*p) && utf_fold(uc) == lc) {
+        return (char *)p;
+      }
+      p = cstrchr_scan(p + utfc_ptr2len(p), (uint8_t)c, (uint8_t)cc);
+    }
+    return NULL;
+  }
+
   for (const char *p = s; *p != NUL; p += utfc_ptr2len(p)) {
     const int uc = utf_ptr2char(p);
     if (c > 0x80 || uc > 0x80) {
@@ -1854,6 +2122,158 @@ static inline char *cstrchr(const char *const s, const int c)
   return NULL;
 }
 
+/// Check whether "s" contains "must", a string that every match contains.
+/// Ignores case if rex->reg_ic is set.
+///
+/// @return  false if there can't be a match in "s".
+static bool regmust_found(const char *s, const char *must)
+  FUNC_ATTR_PURE FUNC_ATTR_WARN_UNUSED_RESULT FUNC_ATTR_NONNULL_ALL
+{
+  if (rex->reg_icombine) {
+    // Composing characters in the text may be skipped.
+    return true;
+  }
+  if (!rex->reg_ic) {
+    return strstr(s, must) != NULL;
+  }
+
+  const int c = utf_ptr2char(must);
+  for (const char *p = cstrchr(s, c); p != NULL; p = cstrchr(p + utf_ptr2len(p), c)) {
+    const char *t = p;
+    const char *m = must;
+    // Compare like the engines do, one character at a time.
+    while (*m != NUL && *t != NUL) {
+      const int tc = utf_ptr2char(t);
+      const int mc = utf_ptr2char(m);
+      if (tc != mc && utf_fold(tc) != utf_fold(mc)) {
+        break;
+      }
+      t += utf_ptr2len(t);
+      m += utf_ptr2len(m);
+    }
+    if (*m == NUL) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// Get the literal text that every match of "prog" contains, for checking
+/// lines with vim_regmust_found() without running the regexp engine.
+///
+/// @param ic  ignore case, like rmm_ic of regmmatch_T
+/// @param buf  buffer of the lines, for 'iskeyword' and the like
+///
+/// @return  false when nothing useful is known about the matches, e.g. when
+///          the pattern can match a line break.
+bool vim_regmust_get(regprog_T *prog, bool ic, regmust_T *rm)
+  FUNC_ATTR_NONNULL_ALL
+{
+  rm->nmust = 0;
+  rm->ic = (prog->regflags & RF_ICASE) || (ic && !(prog->regflags & RF_NOICASE));
+  if (prog->regflags & (RF_HASNL | RF_ICOMBINE)) {
+    return false;
+  }
+
+  if (prog->engine == &nfa_regengine) {
+    nfa_regprog_T *nprog = (nfa_regprog_T *)prog;
+    if (nprog->match_text != NULL) {
+      // The text after "regstart".
+      rm->must[rm->nmust++] = (char *)nprog->match_text;
+    } else {
+      for (int i = 0; i < nprog->nregmust; i++) {
+        rm->must[rm->nmust++] = (char *)nprog->regmust[i];
+      }
+    }
+  } else if (((bt_regprog_T *)prog)->regmust != NULL) {
+    rm->must[rm->nmust++] = (char *)((bt_regprog_T *)prog)->regmust;
+  }
+
+  // Only use ASCII text, a NL stands for a NUL in the text.
+  for (int i = 0; i < rm->nmust; i++) {
+    const char *p = rm->must[i];
+    if (*p == NUL) {
+      rm->nmust = 0;
+    }
+    for (; *p != NUL; p++) {
+      if ((uint8_t)(*p) >= 0x80 || *p == NL) {
+        rm->nmust = 0;
+      }
+    }
+  }
+  return rm->nmust > 0;
+}
+
+/// Check whether the "len" bytes at "s" contain one of the strings in "rm",
+/// like regmust_found() does.  "s" does not need to be NUL terminated.
+/// Does not use any global state, can be called from any thread.
+///
+/// @return  false if there can't be a match in "s".
+bool vim_regmust_found(const regmust_T *rm, const char *s, size_t len)
+  FUNC_ATTR_PURE FUNC_ATTR_WARN_UNUSED_RESULT FUNC_ATTR_NONNULL_ALL
+{
+  const char *const end = s + len;
+
+  for (int i = 0; i < rm->nmust; i++) {
+    const char *must = rm->must[i];
+    const size_t mlen = strlen(must);
+    if (!rm->ic) {
+      for (const char *p = s; (p = memchr(p, must[0], (size_t)(end - p))) != NULL; p++) {
+        if ((size_t)(end - p) < mlen) {
+          break;
+        }
+        if (memcmp(p, must, mlen) == 0) {
+          return true;
+        }
+      }
+      continue;
+    }
+
+    const int lc = TOLOWER_ASC((uint8_t)must[0]);
+    for (const char *p = s; p < end;) {
+      // A non-ASCII character may fold to an ASCII one, such as the Kelvin
+      // sign.  An illegal or incomplete byte sequence is a single byte.
+      int l = 1;
+      int c = (uint8_t)(*p);
+      if (c >= 0x80) {
+        l = utf_ptr2len_len(p, (int)(end - p));
+        if (l > end - p) {
+          l = 1;
+        } else if (l > 1) {
+          c = utf_fold(utf_ptr2char(p));
+        }
+      }
+      if (TOLOWER_ASC(c) == lc) {
+        // Compare like the engines do, one character at a time.
+        const char *t = p + l;
+        const char *m = must + 1;
+        while (*m != NUL && t < end) {
+          int tl = 1;
+          int tc = (uint8_t)(*t);
+          if (tc >= 0x80) {
+            tl = utf_ptr2len_len(t, (int)(end - t));
+            if (tl > end - t) {
+              tl = 1;
+            } else if (tl > 1) {
+              tc = utf_fold(utf_ptr2char(t));
+            }
+          }
+          if (TOLOWER_ASC(tc) != TOLOWER_ASC((uint8_t)(*m))) {
+            break;
+          }
+          t += tl;
+          m++;
+        }
+        if (*m == NUL) {
+          return true;
+        }
+      }
+      p += l;
+    }
+  }
+  return false;
+}
+
 ////////////////////////////////////////////////////////////////
 //                    regsub stuff                            //
 ////////////////////////////////////////////////////////////////
@@ -2025,26 +2445,16 @@ static void clear_submatch_list(staticList10_T *sl)
 /// Returns the size of the replacement, including terminating NUL.
 int vim_regsub(regmatch_T *rmp, char *source, typval_T *expr, char *dest, int destlen, int flags)
 {
-  regexec_T rex_save;
-  bool rex_in_use_save = rex_in_use;
-
-  if (rex_in_use) {
-    // Being called recursively, save the state.
-    rex_save = rex;
-  }
-  rex_in_use = true;
+  regexec_T *const rex_prev = regexec_get();
 
-  rex.reg_match = rmp;
-  rex.reg_mmatch = NULL;
-  rex.reg_maxline = 0;
-  rex.reg_buf = curbuf;
-  rex.reg_line_lbr = true;
+  rex->reg_match = rmp;
+  rex->reg_mmatch = NULL;
+  rex->reg_maxline = 0;
+  rex->reg_buf = curbuf;
+  rex->reg_line_lbr = true;
   int result = vim_regsub_both(source, expr, dest, destlen, flags);
 
-  rex_in_use = rex_in_use_save;
-  if (rex_in_use) {
-    rex = rex_save;
-  }
+  regexec_put(rex_prev);
 
   return result;
 }
@@ -2052,27 +2462,17 @@ int vim_regsub(regmatch_T *rmp, char *source, typval_T *expr, char *dest, int de
 int vim_regsub_multi(regmmatch_T *rmp, linenr_T lnum, char *source, char *dest, int destlen,
                      int flags)
 {
-  regexec_T rex_save;
-  bool rex_in_use_save = rex_in_use;
-
-  if (rex_in_use) {
-    // Being called recursively, save the state.
-    rex_save = rex;
-  }
-  rex_in_use = true;
-
-  rex.reg_match = NULL;
-  rex.reg_mmatch = rmp;
-  rex.reg_buf = curbuf;  // always works on the current buffer!
-  rex.reg_firstlnum = lnum;
-  rex.reg_maxline = curbuf->b_ml.ml_line_count - lnum;
-  rex.reg_line_lbr = false;
+  regexec_T *const rex_prev = regexec_get();
+
+  rex->reg_match = NULL;
+  rex->reg_mmatch = rmp;
+  rex->reg_buf = curbuf;  // always works on the current buffer!
+  rex->reg_firstlnum = lnum;
+  rex->reg_maxline = curbuf->b_ml.ml_line_count - lnum;
+  rex->reg_line_lbr = false;
   int result = vim_regsub_both(source, NULL, dest, destlen, flags);
 
-  rex_in_use = rex_in_use_save;
-  if (rex_in_use) {
-    rex = rex_save;
-  }
+  regexec_put(rex_prev);
 
   return result;
 }
@@ -2150,11 +2550,11 @@ static int vim_regsub_both(char *source, typval_T *expr, char *dest, int destlen
         rsm_save = rsm;
       }
       can_f_submatch = true;
-      rsm.sm_match = rex.reg_match;
-      rsm.sm_mmatch = rex.reg_mmatch;
-      rsm.sm_firstlnum = rex.reg_firstlnum;
-      rsm.sm_maxline = rex.reg_maxline;
-      rsm.sm_line_lbr = rex.reg_line_lbr;
+      rsm.sm_match = rex->reg_match;
+      rsm.sm_mmatch = rex->reg_mmatch;
+      rsm.sm_firstlnum = rex->reg_firstlnum;
+      rsm.sm_maxline = rex->reg_maxline;
+      rsm.sm_line_lbr = rex->reg_line_lbr;
 
       // Although unlikely, it is possible that the expression invokes a
       // substitute command (it might fail, but still).  Therefore keep
@@ -2361,31 +2761,31 @@ static int vim_regsub_both(char *source, typval_T *expr, char *dest, int destlen
         dst++;
       } else {
         if (REG_MULTI) {
-          clnum = rex.reg_mmatch->startpos[no].lnum;
-          if (clnum < 0 || rex.reg_mmatch->endpos[no].lnum < 0) {
+          clnum = rex->reg_mmatch->startpos[no].lnum;
+          if (clnum < 0 || rex->reg_mmatch->endpos[no].lnum < 0) {
             s = NULL;
           } else {
-            s = reg_getline(clnum) + rex.reg_mmatch->startpos[no].col;
-            if (rex.reg_mmatch->endpos[no].lnum == clnum) {
-              len = rex.reg_mmatch->endpos[no].col
-                    - rex.reg_mmatch->startpos[no].col;
+            s = reg_getline(clnum) + rex->reg_mmatch->startpos[no].col;
+            if (rex->reg_mmatch->endpos[no].lnum == clnum) {
+              len = rex->reg_mmatch->endpos[no].col
+                    - rex->reg_mmatch->startpos[no].col;
             } else {
-              len = reg_getline_len(clnum) - rex.reg_mmatch->startpos[no].col;
+              len = reg_getline_len(clnum) - rex->reg_mmatch->startpos[no].col;
             }
           }
         } else {
-          s = rex.reg_match->startp[no];
-          if (rex.reg_match->endp[no] == NULL) {
+          s = rex->reg_match->startp[no];
+          if (rex->reg_match->endp[no] == NULL) {
             s = NULL;
           } else {
-            len = (int)(rex.reg_match->endp[no] - s);
+            len = (int)(rex->reg_match->endp[no] - s);
           }
         }
         if (s != NULL) {
           while (true) {
             if (len == 0) {
               if (REG_MULTI) {
-                if (rex.reg_mmatch->endpos[no].lnum == clnum) {
+                if (rex->reg_mmatch->endpos[no].lnum == clnum) {
                   break;
                 }
                 if (copy) {
@@ -2397,8 +2797,8 @@ static int vim_regsub_both(char *source, typval_T *expr, char *dest, int destlen
                 }
                 dst++;
                 s = reg_getline(++clnum);
-                if (rex.reg_mmatch->endpos[no].lnum == clnum) {
-                  len = rex.reg_mmatch->endpos[no].col;
+                if (rex->reg_mmatch->endpos[no].lnum == clnum) {
+                  len = rex->reg_mmatch->endpos[no].col;
                 } else {
                   len = reg_getline_len(clnum);
                 }
@@ -2640,17 +3040,17 @@ list_T *reg_submatch_list(int no)
 /// @param lnum  nr of line to start looking for match
 static void init_regexec_multi(regmmatch_T *rmp, win_T *win, buf_T *buf, linenr_T lnum)
 {
-  rex.reg_match = NULL;
-  rex.reg_mmatch = rmp;
-  rex.reg_buf = buf;
-  rex.reg_win = win;
-  rex.reg_firstlnum = lnum;
-  rex.reg_maxline = rex.reg_buf->b_ml.ml_line_count - lnum;
-  rex.reg_line_lbr = false;
-  rex.reg_ic = rmp->rmm_ic;
-  rex.reg_icombine = false;
-  rex.reg_nobreak = rmp->regprog->re_flags & RE_NOBREAK;
-  rex.reg_maxcol = rmp->rmm_maxcol;
+  rex->reg_match = NULL;
+  rex->reg_mmatch = rmp;
+  rex->reg_buf = buf;
+  rex->reg_win = win;
+  rex->reg_firstlnum = lnum;
+  rex->reg_maxline = rex->reg_buf->b_ml.ml_line_count - lnum;
+  rex->reg_line_lbr = false;
+  rex->reg_ic = rmp->rmm_ic;
+  rex->reg_icombine = false;
+  rex->reg_nobreak = rmp->regprog->re_flags & RE_NOBREAK;
+  rex->reg_maxcol = rmp->rmm_maxcol;
 }
 
 // regexp_bt.c {{{1
@@ -2888,9 +3288,6 @@ static uint8_t *regcode;         ///< Code-emit pointer, or JUST_CALC_SIZE
 static int64_t regsize;            ///< Code size.
 static int reg_toolong;         ///< true when offset out of range
 static uint8_t had_endbrace[NSUBEXP];  ///< flags, true if end of () found
-static int64_t brace_min[10];        ///< Minimums for complex brace repeats
-static int64_t brace_max[10];        ///< Maximums for complex brace repeats
-static int brace_count[10];       ///< Current counts for complex brace repeats
 static int one_exactly = false;   ///< only do one char for EXACTLY
 
 // When making changes to classchars also change nfa_classcodes.
@@ -2925,16 +3322,6 @@ typedef struct backpos_S {
   regsave_T bp_pos;           // last input position
 } backpos_T;
 
-// "regstack" and "backpos" are used by regmatch().  They are kept over calls
-// to avoid invoking malloc() and free() often.
-// "regstack" is a stack with regitem_T items, sometimes preceded by regstar_T
-// or regbehind_T.
-// "backpos_T" is a table with backpos_T for BACK
-static garray_T regstack = GA_EMPTY_INIT_VALUE;
-static garray_T backpos = GA_EMPTY_INIT_VALUE;
-
-static regsave_T behind_pos;
-
 // Both for regstack and backpos tables we use the following strategy of
 // allocation (to reduce malloc/free calls):
 // - Initial size is fairly small.
@@ -4497,10 +4884,12 @@ static uint8_t *regatom(int *flagp)
     // pattern -- regardless of whether or not it makes sense.
     case '^':
       ret = regnode(RE_BOF);
+      regflags |= RF_HASPOS;
       break;
 
     case '$':
       ret = regnode(RE_EOF);
+      regflags |= RF_HASPOS;
       break;
 
     case '#':
@@ -4510,10 +4899,12 @@ static uint8_t *regatom(int *flagp)
         return FAIL;
       }
       ret = regnode(CURSOR);
+      regflags |= RF_HASPOS;
       break;
 
     case 'V':
       ret = regnode(RE_VISUAL);
+      regflags |= RF_HASPOS;
       break;
 
     case 'C':
@@ -4648,6 +5039,7 @@ static uint8_t *regatom(int *flagp)
           // "\%'m", "\%<'m" and "\%>'m": Mark
           c = getchr();
           ret = regnode(RE_MARK);
+          regflags |= RF_HASPOS;
           if (ret == JUST_CALC_SIZE) {
             regsize += 2;
           } else {
@@ -4661,6 +5053,7 @@ static uint8_t *regatom(int *flagp)
             rc_did_emsg = true;
             return NULL;
           }
+          regflags |= RF_HASPOS;
           if (c == 'l') {
             if (cur) {
               n = (uint32_t)curwin->w_cursor.lnum;
@@ -4937,7 +5330,7 @@ collection:
               break;
             case CLASS_KEYWORD:
               for (cu = 1; cu <= 255; cu++) {
-                if (reg_iswordc(cu)) {
+                if (vim_iswordc(cu)) {
                   regmbc(cu);
                 }
               }
@@ -5448,7 +5841,7 @@ static regprog_T *bt_regcomp(uint8_t *expr, int re_flags)
 
   // Allocate space.
   bt_regprog_T *r = xmalloc(offsetof(bt_regprog_T, program) + (size_t)regsize);
-  r->re_in_use = false;
+  r->re_in_use = 0;
 
   // Second pass: emit code.
   regcomp_start(expr, re_flags);
@@ -5508,8 +5901,10 @@ static regprog_T *bt_regcomp(uint8_t *expr, int re_flags)
 
     // When the r.e. starts with BOW, it is faster to look for a regmust
     // first. Used a lot for "#" and "*" commands. (Added by mool).
-    if ((flags & SPSTART || OP(scan) == BOW || OP(scan) == EOW)
-        && !(flags & HASNL)) {
+    // Otherwise a literal string of two or more bytes is still cheap to look
+    // for, it avoids trying the match at each start character.
+    if (!(flags & HASNL)) {
+      const bool expensive = flags & SPSTART || OP(scan) == BOW || OP(scan) == EOW;
       longest = NULL;
       len = 0;
       for (; scan != NULL; scan = regnext(scan)) {
@@ -5521,8 +5916,10 @@ static regprog_T *bt_regcomp(uint8_t *expr, int re_flags)
           }
         }
       }
-      r->regmust = longest;
-      r->regmlen = len;
+      if (expensive || len >= 2) {
+        r->regmust = longest;
+        r->regmlen = len;
+      }
     }
   }
 #ifdef BT_REGEXP_DUMP
@@ -5575,23 +5972,17 @@ static void bt_regfree(regprog_T *prog)
   xfree(prog);
 }
 
-#define ADVANCE_REGINPUT() MB_PTR_ADV(rex.input)
-
-// The arguments from BRACE_LIMITS are stored here.  They are actually local
-// to regmatch(), but they are here to reduce the amount of stack space used
-// (it can be called recursively many times).
-static int64_t bl_minval;
-static int64_t bl_maxval;
+#define ADVANCE_REGINPUT() MB_PTR_ADV(rex->input)
 
 // Save the input line and position in a regsave_T.
 static void reg_save(regsave_T *save, garray_T *gap)
   FUNC_ATTR_NONNULL_ALL
 {
   if (REG_MULTI) {
-    save->rs_u.pos.col = (colnr_T)(rex.input - rex.line);
-    save->rs_u.pos.lnum = rex.lnum;
+    save->rs_u.pos.col = (colnr_T)(rex->input - rex->line);
+    save->rs_u.pos.lnum = rex->lnum;
   } else {
-    save->rs_u.ptr = rex.input;
+    save->rs_u.ptr = rex->input;
   }
   save->rs_len = gap->ga_len;
 }
@@ -5601,15 +5992,15 @@ static void reg_restore(regsave_T *save, garray_T *gap)
   FUNC_ATTR_NONNULL_ALL
 {
   if (REG_MULTI) {
-    if (rex.lnum != save->rs_u.pos.lnum) {
+    if (rex->lnum != save->rs_u.pos.lnum) {
       // only call reg_getline() when the line number changed to save
       // a bit of time
-      rex.lnum = save->rs_u.pos.lnum;
-      rex.line = (uint8_t *)reg_getline(rex.lnum);
+      rex->lnum = save->rs_u.pos.lnum;
+      rex->line = (uint8_t *)reg_getline(rex->lnum);
     }
-    rex.input = rex.line + save->rs_u.pos.col;
+    rex->input = rex->line + save->rs_u.pos.col;
   } else {
-    rex.input = save->rs_u.ptr;
+    rex->input = save->rs_u.ptr;
   }
   gap->ga_len = save->rs_len;
 }
@@ -5619,10 +6010,10 @@ static bool reg_save_equal(const regsave_T *save)
   FUNC_ATTR_NONNULL_ALL
 {
   if (REG_MULTI) {
-    return rex.lnum == save->rs_u.pos.lnum
-           && rex.input == rex.line + save->rs_u.pos.col;
+    return rex->lnum == save->rs_u.pos.lnum
+           && rex->input == rex->line + save->rs_u.pos.col;
   }
-  return rex.input == save->rs_u.ptr;
+  return rex->input == save->rs_u.ptr;
 }
 
 // Save the sub-expressions before attempting a match.
@@ -5644,18 +6035,18 @@ static bool reg_save_equal(const regsave_T *save)
 static void save_se_multi(save_se_T *savep, lpos_T *posp)
 {
   savep->se_u.pos = *posp;
-  posp->lnum = rex.lnum;
-  posp->col = (colnr_T)(rex.input - rex.line);
+  posp->lnum = rex->lnum;
+  posp->col = (colnr_T)(rex->input - rex->line);
 }
 
 static void save_se_one(save_se_T *savep, uint8_t **pp)
 {
   savep->se_u.ptr = *pp;
-  *pp = rex.input;
+  *pp = rex->input;
 }
 
 /// regrepeat - repeatedly match something simple, return how many.
-/// Advances rex.input (and rex.lnum) to just after the matched chars.
+/// Advances rex->input (and rex->lnum) to just after the matched chars.
 ///
 /// @param maxcount  maximum number of matches allowed
 static int regrepeat(uint8_t *p, int64_t maxcount)
@@ -5665,7 +6056,7 @@ static int regrepeat(uint8_t *p, int64_t maxcount)
   int mask;
   int testval = 0;
 
-  uint8_t *scan = rex.input;  // Make local copy of rex.input for speed.
+  uint8_t *scan = rex->input;  // Make local copy of rex->input for speed.
   opnd = OPERAND(p);
   switch (OP(p)) {
   case ANY:
@@ -5677,13 +6068,13 @@ static int regrepeat(uint8_t *p, int64_t maxcount)
         count++;
         MB_PTR_ADV(scan);
       }
-      if (!REG_MULTI || !WITH_NL(OP(p)) || rex.lnum > rex.reg_maxline
-          || rex.reg_line_lbr || count == maxcount) {
+      if (!REG_MULTI || !WITH_NL(OP(p)) || rex->lnum > rex->reg_maxline
+          || rex->reg_line_lbr || count == maxcount) {
         break;
       }
       count++;  // count the line-break
       reg_nextline();
-      scan = rex.input;
+      scan = rex->input;
       if (got_int) {
         break;
       }
@@ -5700,16 +6091,16 @@ static int regrepeat(uint8_t *p, int64_t maxcount)
       if (vim_isIDc(utf_ptr2char((char *)scan)) && (testval || !ascii_isdigit(*scan))) {
         MB_PTR_ADV(scan);
       } else if (*scan == NUL) {
-        if (!REG_MULTI || !WITH_NL(OP(p)) || rex.lnum > rex.reg_maxline
-            || rex.reg_line_lbr) {
+        if (!REG_MULTI || !WITH_NL(OP(p)) || rex->lnum > rex->reg_maxline
+            || rex->reg_line_lbr) {
           break;
         }
         reg_nextline();
-        scan = rex.input;
+        scan = rex->input;
         if (got_int) {
           break;
         }
-      } else if (rex.reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
+      } else if (rex->reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
         scan++;
       } else {
         break;
@@ -5725,20 +6116,20 @@ static int regrepeat(uint8_t *p, int64_t maxcount)
   case SKWORD:
   case SKWORD + ADD_NL:
     while (count < maxcount) {
-      if (vim_iswordp_buf((char *)scan, rex.reg_buf)
+      if (vim_iswordp_buf((char *)scan, rex->reg_buf)
           && (testval || !ascii_isdigit(*scan))) {
         MB_PTR_ADV(scan);
       } else if (*scan == NUL) {
-        if (!REG_MULTI || !WITH_NL(OP(p)) || rex.lnum > rex.reg_maxline
-            || rex.reg_line_lbr) {
+        if (!REG_MULTI || !WITH_NL(OP(p)) || rex->lnum > rex->reg_maxline
+            || rex->reg_line_lbr) {
           break;
         }
         reg_nextline();
-        scan = rex.input;
+        scan = rex->input;
         if (got_int) {
           break;
         }
-      } else if (rex.reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
+      } else if (rex->reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
         scan++;
       } else {
         break;
@@ -5757,16 +6148,16 @@ static int regrepeat(uint8_t *p, int64_t maxcount)
       if (vim_isfilec(utf_ptr2char((char *)scan)) && (testval || !ascii_isdigit(*scan))) {
         MB_PTR_ADV(scan);
       } else if (*scan == NUL) {
-        if (!REG_MULTI || !WITH_NL(OP(p)) || rex.lnum > rex.reg_maxline
-            || rex.reg_line_lbr) {
+        if (!REG_MULTI || !WITH_NL(OP(p)) || rex->lnum > rex->reg_maxline
+            || rex->reg_line_lbr) {
           break;
         }
         reg_nextline();
-        scan = rex.input;
+        scan = rex->input;
         if (got_int) {
           break;
         }
-      } else if (rex.reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
+      } else if (rex->reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
         scan++;
       } else {
         break;
@@ -5783,19 +6174,19 @@ static int regrepeat(uint8_t *p, int64_t maxcount)
   case SPRINT + ADD_NL:
     while (count < maxcount) {
       if (*scan == NUL) {
-        if (!REG_MULTI || !WITH_NL(OP(p)) || rex.lnum > rex.reg_maxline
-            || rex.reg_line_lbr) {
+        if (!REG_MULTI || !WITH_NL(OP(p)) || rex->lnum > rex->reg_maxline
+            || rex->reg_line_lbr) {
           break;
         }
         reg_nextline();
-        scan = rex.input;
+        scan = rex->input;
         if (got_int) {
           break;
         }
       } else if (vim_isprintc(utf_ptr2char((char *)scan)) == 1
                  && (testval || !ascii_isdigit(*scan))) {
         MB_PTR_ADV(scan);
-      } else if (rex.reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
+      } else if (rex->reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
         scan++;
       } else {
         break;
@@ -5811,12 +6202,12 @@ do_class:
     while (count < maxcount) {
       int l;
       if (*scan == NUL) {
-        if (!REG_MULTI || !WITH_NL(OP(p)) || rex.lnum > rex.reg_maxline
-            || rex.reg_line_lbr) {
+        if (!REG_MULTI || !WITH_NL(OP(p)) || rex->lnum > rex->reg_maxline
+            || rex->reg_line_lbr) {
           break;
         }
         reg_nextline();
-        scan = rex.input;
+        scan = rex->input;
         if (got_int) {
           break;
         }
@@ -5827,7 +6218,7 @@ do_class:
         scan += l;
       } else if ((class_tab[*scan] & mask) == testval) {
         scan++;
-      } else if (rex.reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
+      } else if (rex->reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
         scan++;
       } else {
         break;
@@ -5911,7 +6302,7 @@ do_class:
     // This doesn't do a multi-byte character, because a MULTIBYTECODE
     // would have been used for it.  It does handle single-byte
     // characters, such as latin1.
-    if (rex.reg_ic) {
+    if (rex->reg_ic) {
       cu = mb_toupper(*opnd);
       cl = mb_tolower(*opnd);
       while (count < maxcount && (*scan == cu || *scan == cl)) {
@@ -5934,7 +6325,7 @@ do_class:
     // Safety check (just in case 'encoding' was changed since
     // compiling the program).
     if ((len = utfc_ptr2len((char *)opnd)) > 1) {
-      if (rex.reg_ic) {
+      if (rex->reg_ic) {
         cf = utf_fold(utf_ptr2char((char *)opnd));
       }
       while (count < maxcount && utfc_ptr2len((char *)scan) >= len) {
@@ -5943,7 +6334,7 @@ do_class:
             break;
           }
         }
-        if (i < len && (!rex.reg_ic
+        if (i < len && (!rex->reg_ic
                         || utf_fold(utf_ptr2char((char *)scan)) != cf)) {
           break;
         }
@@ -5964,16 +6355,16 @@ do_class:
     while (count < maxcount) {
       int len;
       if (*scan == NUL) {
-        if (!REG_MULTI || !WITH_NL(OP(p)) || rex.lnum > rex.reg_maxline
-            || rex.reg_line_lbr) {
+        if (!REG_MULTI || !WITH_NL(OP(p)) || rex->lnum > rex->reg_maxline
+            || rex->reg_line_lbr) {
           break;
         }
         reg_nextline();
-        scan = rex.input;
+        scan = rex->input;
         if (got_int) {
           break;
         }
-      } else if (rex.reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
+      } else if (rex->reg_line_lbr && *scan == '\n' && WITH_NL(OP(p))) {
         scan++;
       } else if ((len = utfc_ptr2len((char *)scan)) > 1) {
         if ((cstrchr((char *)opnd, utf_ptr2char((char *)scan)) == NULL) == testval) {
@@ -5992,15 +6383,15 @@ do_class:
 
   case NEWL:
     while (count < maxcount
-           && ((*scan == NUL && rex.lnum <= rex.reg_maxline && !rex.reg_line_lbr
-                && REG_MULTI) || (*scan == '\n' && rex.reg_line_lbr))) {
+           && ((*scan == NUL && rex->lnum <= rex->reg_maxline && !rex->reg_line_lbr
+                && REG_MULTI) || (*scan == '\n' && rex->reg_line_lbr))) {
       count++;
-      if (rex.reg_line_lbr) {
+      if (rex->reg_line_lbr) {
         ADVANCE_REGINPUT();
       } else {
         reg_nextline();
       }
-      scan = rex.input;
+      scan = rex->input;
       if (got_int) {
         break;
       }
@@ -6015,7 +6406,7 @@ do_class:
     break;
   }
 
-  rex.input = scan;
+  rex->input = scan;
 
   return (int)count;
 }
@@ -6026,17 +6417,17 @@ static regitem_T *regstack_push(regstate_T state, uint8_t *scan)
 {
   regitem_T *rp;
 
-  if ((int64_t)((unsigned)regstack.ga_len >> 10) >= p_mmp) {
-    emsg(_(e_pattern_uses_more_memory_than_maxmempattern));
+  if ((int64_t)((unsigned)rex->regstack.ga_len >> 10) >= p_mmp) {
+    reg_toobig();
     return NULL;
   }
-  ga_grow(&regstack, sizeof(regitem_T));
+  ga_grow(&rex->regstack, sizeof(regitem_T));
 
-  rp = (regitem_T *)((char *)regstack.ga_data + regstack.ga_len);
+  rp = (regitem_T *)((char *)rex->regstack.ga_data + rex->regstack.ga_len);
   rp->rs_state = state;
   rp->rs_scan = scan;
 
-  regstack.ga_len += (int)sizeof(regitem_T);
+  rex->regstack.ga_len += (int)sizeof(regitem_T);
   return rp;
 }
 
@@ -6045,10 +6436,10 @@ static void regstack_pop(uint8_t **scan)
 {
   regitem_T *rp;
 
-  rp = (regitem_T *)((char *)regstack.ga_data + regstack.ga_len) - 1;
+  rp = (regitem_T *)((char *)rex->regstack.ga_data + rex->regstack.ga_len) - 1;
   *scan = rp->rs_scan;
 
-  regstack.ga_len -= (int)sizeof(regitem_T);
+  rex->regstack.ga_len -= (int)sizeof(regitem_T);
 }
 
 // Save the current subexpr to "bp", so that they can be restored
@@ -6056,20 +6447,20 @@ static void regstack_pop(uint8_t **scan)
 static void save_subexpr(regbehind_T *bp)
   FUNC_ATTR_NONNULL_ALL
 {
-  // When "rex.need_clear_subexpr" is set we don't need to save the values, only
+  // When "rex->need_clear_subexpr" is set we don't need to save the values, only
   // remember that this flag needs to be set again when restoring.
-  bp->save_need_clear_subexpr = rex.need_clear_subexpr;
-  if (rex.need_clear_subexpr) {
+  bp->save_need_clear_subexpr = rex->need_clear_subexpr;
+  if (rex->need_clear_subexpr) {
     return;
   }
 
   for (int i = 0; i < NSUBEXP; i++) {
     if (REG_MULTI) {
-      bp->save_start[i].se_u.pos = rex.reg_startpos[i];
-      bp->save_end[i].se_u.pos = rex.reg_endpos[i];
+      bp->save_start[i].se_u.pos = rex->reg_startpos[i];
+      bp->save_end[i].se_u.pos = rex->reg_endpos[i];
     } else {
-      bp->save_start[i].se_u.ptr = rex.reg_startp[i];
-      bp->save_end[i].se_u.ptr = rex.reg_endp[i];
+      bp->save_start[i].se_u.ptr = rex->reg_startp[i];
+      bp->save_end[i].se_u.ptr = rex->reg_endp[i];
     }
   }
 }
@@ -6079,18 +6470,18 @@ static void restore_subexpr(regbehind_T *bp)
   FUNC_ATTR_NONNULL_ALL
 {
   // Only need to restore saved values when they are not to be cleared.
-  rex.need_clear_subexpr = bp->save_need_clear_subexpr;
-  if (rex.need_clear_subexpr) {
+  rex->need_clear_subexpr = bp->save_need_clear_subexpr;
+  if (rex->need_clear_subexpr) {
     return;
   }
 
   for (int i = 0; i < NSUBEXP; i++) {
     if (REG_MULTI) {
-      rex.reg_startpos[i] = bp->save_start[i].se_u.pos;
-      rex.reg_endpos[i] = bp->save_end[i].se_u.pos;
+      rex->reg_startpos[i] = bp->save_start[i].se_u.pos;
+      rex->reg_endpos[i] = bp->save_end[i].se_u.pos;
     } else {
-      rex.reg_startp[i] = bp->save_start[i].se_u.ptr;
-      rex.reg_endp[i] = bp->save_end[i].se_u.ptr;
+      rex->reg_startp[i] = bp->save_start[i].se_u.ptr;
+      rex->reg_endp[i] = bp->save_end[i].se_u.ptr;
     }
   }
 }
@@ -6107,9 +6498,9 @@ static void restore_subexpr(regbehind_T *bp)
 /// @param tm         timeout limit or NULL
 /// @param timed_out  flag set on timeout or NULL
 ///
-/// @return - true when there is a match.  Leaves rex.input and rex.lnum
+/// @return - true when there is a match.  Leaves rex->input and rex->lnum
 ///         just after the last matched character.
-///         - false when there is no match.  Leaves rex.input and rex.lnum in an
+///         - false when there is no match.  Leaves rex->input and rex->lnum in an
 ///         undefined state!
 static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
 {
@@ -6123,8 +6514,8 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
 
   // Make "regstack" and "backpos" empty.  They are allocated and freed in
   // bt_regexec_both() to reduce malloc()/free() calls.
-  regstack.ga_len = 0;
-  backpos.ga_len = 0;
+  rex->regstack.ga_len = 0;
+  rex->backpos.ga_len = 0;
 
   // Repeat until "regstack" is empty.
   while (true) {
@@ -6181,19 +6572,19 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
 
       op = OP(scan);
       // Check for character class with NL added.
-      if (!rex.reg_line_lbr && WITH_NL(op) && REG_MULTI
-          && *rex.input == NUL && rex.lnum <= rex.reg_maxline) {
+      if (!rex->reg_line_lbr && WITH_NL(op) && REG_MULTI
+          && *rex->input == NUL && rex->lnum <= rex->reg_maxline) {
         reg_nextline();
-      } else if (rex.reg_line_lbr && WITH_NL(op) && *rex.input == '\n') {
+      } else if (rex->reg_line_lbr && WITH_NL(op) && *rex->input == '\n') {
         ADVANCE_REGINPUT();
       } else {
         if (WITH_NL(op)) {
           op -= ADD_NL;
         }
-        c = utf_ptr2char((char *)rex.input);
+        c = utf_ptr2char((char *)rex->input);
         switch (op) {
         case BOL:
-          if (rex.input != rex.line) {
+          if (rex->input != rex->line) {
             status = RA_NOMATCH;
           }
           break;
@@ -6208,25 +6599,25 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
           // We're not at the beginning of the file when below the first
           // line where we started, not at the start of the line or we
           // didn't start at the first line of the buffer.
-          if (rex.lnum != 0 || rex.input != rex.line
-              || (REG_MULTI && rex.reg_firstlnum > 1)) {
+          if (rex->lnum != 0 || rex->input != rex->line
+              || (REG_MULTI && rex->reg_firstlnum > 1)) {
             status = RA_NOMATCH;
           }
           break;
 
         case RE_EOF:
-          if (rex.lnum != rex.reg_maxline || c != NUL) {
+          if (rex->lnum != rex->reg_maxline || c != NUL) {
             status = RA_NOMATCH;
           }
           break;
 
         case CURSOR:
           // Check if the buffer is in a window and compare the
-          // rex.reg_win->w_cursor position to the match position.
-          if (rex.reg_win == NULL
-              || (rex.lnum + rex.reg_firstlnum != rex.reg_win->w_cursor.lnum)
-              || ((colnr_T)(rex.input - rex.line) !=
-                  rex.reg_win->w_cursor.col)) {
+          // rex->reg_win->w_cursor position to the match position.
+          if (rex->reg_win == NULL
+              || (rex->lnum + rex->reg_firstlnum != rex->reg_win->w_cursor.lnum)
+              || ((colnr_T)(rex->input - rex->line) !=
+                  rex->reg_win->w_cursor.col)) {
             status = RA_NOMATCH;
           }
           break;
@@ -6237,13 +6628,13 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
           int mark = OPERAND(scan)[0];
           int cmp = OPERAND(scan)[1];
           pos_T *pos;
-          size_t col = REG_MULTI ? (size_t)(rex.input - rex.line) : 0;
-          fmark_T *fm = mark_get(rex.reg_buf, curwin, NULL, kMarkBufLocal, mark);
+          size_t col = REG_MULTI ? (size_t)(rex->input - rex->line) : 0;
+          fmark_T *fm = mark_get(rex->reg_buf, curwin, NULL, kMarkBufLocal, mark);
 
           // Line may have been freed, get it again.
           if (REG_MULTI) {
-            rex.line = (uint8_t *)reg_getline(rex.lnum);
-            rex.input = rex.line + col;
+            rex->line = (uint8_t *)reg_getline(rex->lnum);
+            rex->input = rex->line + col;
           }
 
           if (fm == NULL                    // mark doesn't exist
@@ -6251,18 +6642,18 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
             status = RA_NOMATCH;
           } else {
             pos = &fm->mark;
-            const colnr_T pos_col = pos->lnum == rex.lnum + rex.reg_firstlnum
+            const colnr_T pos_col = pos->lnum == rex->lnum + rex->reg_firstlnum
                                     && pos->col == MAXCOL
-                                    ? reg_getline_len(pos->lnum - rex.reg_firstlnum)
+                                    ? reg_getline_len(pos->lnum - rex->reg_firstlnum)
                                     : pos->col;
 
-            if (pos->lnum == rex.lnum + rex.reg_firstlnum
-                ? (pos_col == (colnr_T)(rex.input - rex.line)
+            if (pos->lnum == rex->lnum + rex->reg_firstlnum
+                ? (pos_col == (colnr_T)(rex->input - rex->line)
                    ? (cmp == '<' || cmp == '>')
-                   : (pos_col < (colnr_T)(rex.input - rex.line)
+                   : (pos_col < (colnr_T)(rex->input - rex->line)
                       ? cmp != '>'
                       : cmp != '<'))
-                : (pos->lnum < rex.lnum + rex.reg_firstlnum
+                : (pos->lnum < rex->lnum + rex->reg_firstlnum
                    ? cmp != '>'
                    : cmp != '<')) {
               status = RA_NOMATCH;
@@ -6278,30 +6669,30 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
           break;
 
         case RE_LNUM:
-          assert(rex.lnum + rex.reg_firstlnum >= 0
-                 && (uintmax_t)(rex.lnum + rex.reg_firstlnum) <= UINT32_MAX);
+          assert(rex->lnum + rex->reg_firstlnum >= 0
+                 && (uintmax_t)(rex->lnum + rex->reg_firstlnum) <= UINT32_MAX);
           if (!REG_MULTI
-              || !re_num_cmp((uint32_t)(rex.lnum + rex.reg_firstlnum), scan)) {
+              || !re_num_cmp((uint32_t)(rex->lnum + rex->reg_firstlnum), scan)) {
             status = RA_NOMATCH;
           }
           break;
 
         case RE_COL:
-          assert(rex.input - rex.line + 1 >= 0
-                 && (uintmax_t)(rex.input - rex.line + 1) <= UINT32_MAX);
-          if (!re_num_cmp((uint32_t)(rex.input - rex.line + 1), scan)) {
+          assert(rex->input - rex->line + 1 >= 0
+                 && (uintmax_t)(rex->input - rex->line + 1) <= UINT32_MAX);
+          if (!re_num_cmp((uint32_t)(rex->input - rex->line + 1), scan)) {
             status = RA_NOMATCH;
           }
           break;
 
         case RE_VCOL: {
-          win_T *wp = rex.reg_win == NULL ? curwin : rex.reg_win;
-          linenr_T lnum = REG_MULTI ? rex.reg_firstlnum + rex.lnum : 1;
+          win_T *wp = rex->reg_win == NULL ? curwin : rex->reg_win;
+          linenr_T lnum = REG_MULTI ? rex->reg_firstlnum + rex->lnum : 1;
           if (REG_MULTI && (lnum <= 0 || lnum > wp->w_buffer->b_ml.ml_line_count)) {
             lnum = 1;
           }
-          int vcol = win_linetabsize(wp, lnum, (char *)rex.line,
-                                     (colnr_T)(rex.input - rex.line));
+          int vcol = win_linetabsize(wp, lnum, (char *)rex->line,
+                                     (colnr_T)(rex->input - rex->line));
           if (!re_num_cmp((uint32_t)vcol + 1, scan)) {
             status = RA_NOMATCH;
           }
@@ -6309,13 +6700,13 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
         }
         break;
 
-        case BOW:  // \<word; rex.input points to w
+        case BOW:  // \<word; rex->input points to w
           if (c == NUL) {  // Can't match at end of line
             status = RA_NOMATCH;
           } else {
             // Get class of current and previous char (if it exists).
             const int this_class =
-              mb_get_class_tab((char *)rex.input, rex.reg_buf->b_chartab);
+              mb_get_class_tab((char *)rex->input, rex->reg_buf->b_chartab);
             if (this_class <= 1) {
               status = RA_NOMATCH;  // Not on a word at all.
             } else if (reg_prev_class() == this_class) {
@@ -6324,14 +6715,14 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
           }
           break;
 
-        case EOW:  // word\>; rex.input points after d
-          if (rex.input == rex.line) {  // Can't match at start of line
+        case EOW:  // word\>; rex->input points after d
+          if (rex->input == rex->line) {  // Can't match at start of line
             status = RA_NOMATCH;
           } else {
             int this_class, prev_class;
 
             // Get class of current and previous char (if it exists).
-            this_class = mb_get_class_tab((char *)rex.input, rex.reg_buf->b_chartab);
+            this_class = mb_get_class_tab((char *)rex->input, rex->reg_buf->b_chartab);
             prev_class = reg_prev_class();
             if (this_class == prev_class
                 || prev_class == 0 || prev_class == 1) {
@@ -6358,7 +6749,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
           break;
 
         case SIDENT:
-          if (ascii_isdigit(*rex.input) || !vim_isIDc(c)) {
+          if (ascii_isdigit(*rex->input) || !vim_isIDc(c)) {
             status = RA_NOMATCH;
           } else {
             ADVANCE_REGINPUT();
@@ -6366,7 +6757,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
           break;
 
         case KWORD:
-          if (!vim_iswordp_buf((char *)rex.input, rex.reg_buf)) {
+          if (!vim_iswordp_buf((char *)rex->input, rex->reg_buf)) {
             status = RA_NOMATCH;
           } else {
             ADVANCE_REGINPUT();
@@ -6374,8 +6765,8 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
           break;
 
         case SKWORD:
-          if (ascii_isdigit(*rex.input)
-              || !vim_iswordp_buf((char *)rex.input, rex.reg_buf)) {
+          if (ascii_isdigit(*rex->input)
+              || !vim_iswordp_buf((char *)rex->input, rex->reg_buf)) {
             status = RA_NOMATCH;
           } else {
             ADVANCE_REGINPUT();
@@ -6391,7 +6782,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
           break;
 
         case SFNAME:
-          if (ascii_isdigit(*rex.input) || !vim_isfilec(c)) {
+          if (ascii_isdigit(*rex->input) || !vim_isfilec(c)) {
             status = RA_NOMATCH;
           } else {
             ADVANCE_REGINPUT();
@@ -6399,7 +6790,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
           break;
 
         case PRINT:
-          if (!vim_isprintc(utf_ptr2char((char *)rex.input))) {
+          if (!vim_isprintc(utf_ptr2char((char *)rex->input))) {
             status = RA_NOMATCH;
           } else {
             ADVANCE_REGINPUT();
@@ -6407,7 +6798,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
           break;
 
         case SPRINT:
-          if (ascii_isdigit(*rex.input) || !vim_isprintc(utf_ptr2char((char *)rex.input))) {
+          if (ascii_isdigit(*rex->input) || !vim_isprintc(utf_ptr2char((char *)rex->input))) {
             status = RA_NOMATCH;
           } else {
             ADVANCE_REGINPUT();
@@ -6564,27 +6955,27 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
 
           opnd = OPERAND(scan);
           // Inline the first byte, for speed.
-          if (*opnd != *rex.input
-              && (!rex.reg_ic)) {
+          if (*opnd != *rex->input
+              && (!rex->reg_ic)) {
             status = RA_NOMATCH;
           } else if (*opnd == NUL) {
             // match empty string always works; happens when "~" is
             // empty.
           } else {
-            if (opnd[1] == NUL && !rex.reg_ic) {
+            if (opnd[1] == NUL && !rex->reg_ic) {
               len = 1;  // matched a single byte above
             } else {
               // Need to match first byte again for multi-byte.
               len = (int)strlen((char *)opnd);
-              if (cstrncmp((char *)opnd, (char *)rex.input, &len) != 0) {
+              if (cstrncmp((char *)opnd, (char *)rex->input, &len) != 0) {
                 status = RA_NOMATCH;
               }
             }
             // Check for following composing character, unless %C
             // follows (skips over all composing chars).
             if (status != RA_NOMATCH
-                && utf_composinglike((char *)rex.input, (char *)rex.input + len, NULL)
-                && !rex.reg_icombine
+                && utf_composinglike((char *)rex->input, (char *)rex->input + len, NULL)
+                && !rex->reg_icombine
                 && OP(next) != RE_COMPOSING) {
               // raaron: This code makes a composing character get
               // ignored, which is the correct behavior (sometimes)
@@ -6592,7 +6983,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
               status = RA_NOMATCH;
             }
             if (status != RA_NOMATCH) {
-              rex.input += len;
+              rex->input += len;
             }
           }
         }
@@ -6609,7 +7000,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
           } else {  // Check following combining characters
             int len = utfc_ptr2len((char *)q) - utf_ptr2len((char *)q);
 
-            rex.input += utf_ptr2len((char *)rex.input);
+            rex->input += utf_ptr2len((char *)rex->input);
             q += utf_ptr2len((char *)q);
 
             if (len == 0) {
@@ -6617,12 +7008,12 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
             }
 
             for (int i = 0; i < len; i++) {
-              if (q[i] != rex.input[i]) {
+              if (q[i] != rex->input[i]) {
                 status = RA_NOMATCH;
                 break;
               }
             }
-            rex.input += len;
+            rex->input += len;
           }
           break;
         }
@@ -6642,34 +7033,34 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
             // When only a composing char is given match at any
             // position where that composing char appears.
             status = RA_NOMATCH;
-            for (i = 0; rex.input[i] != NUL;
-                 i += utf_ptr2len((char *)rex.input + i)) {
-              const int inpc = utf_ptr2char((char *)rex.input + i);
+            for (i = 0; rex->input[i] != NUL;
+                 i += utf_ptr2len((char *)rex->input + i)) {
+              const int inpc = utf_ptr2char((char *)rex->input + i);
               if (!utf_iscomposing_legacy(inpc)) {
                 if (i > 0) {
                   break;
                 }
               } else if (opndc == inpc) {
                 // Include all following composing chars.
-                len = i + utfc_ptr2len((char *)rex.input + i);
+                len = i + utfc_ptr2len((char *)rex->input + i);
                 status = RA_MATCH;
                 break;
               }
             }
           } else {
-            if (cstrncmp((char *)opnd, (char *)rex.input, &len) != 0) {
+            if (cstrncmp((char *)opnd, (char *)rex->input, &len) != 0) {
               status = RA_NOMATCH;
               break;
             }
           }
-          rex.input += len;
+          rex->input += len;
         }
         break;
 
         case RE_COMPOSING:
           // Skip composing characters.
-          while (utf_iscomposing_legacy(utf_ptr2char((char *)rex.input))) {
-            rex.input += utf_ptr2len((char *)rex.input);
+          while (utf_iscomposing_legacy(utf_ptr2char((char *)rex->input))) {
+            rex->input += utf_ptr2len((char *)rex->input);
           }
           break;
 
@@ -6685,14 +7076,14 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
           // at the same position as the previous time.
           // The positions are stored in "backpos" and found by the
           // current value of "scan", the position in the RE program.
-          backpos_T *bp = (backpos_T *)backpos.ga_data;
-          for (i = 0; i < backpos.ga_len; i++) {
+          backpos_T *bp = (backpos_T *)rex->backpos.ga_data;
+          for (i = 0; i < rex->backpos.ga_len; i++) {
             if (bp[i].bp_scan == scan) {
               break;
             }
           }
-          if (i == backpos.ga_len) {
-            backpos_T *p = GA_APPEND_VIA_PTR(backpos_T, &backpos);
+          if (i == rex->backpos.ga_len) {
+            backpos_T *p = GA_APPEND_VIA_PTR(backpos_T, &rex->backpos);
             p->bp_scan = scan;
           } else if (reg_save_equal(&bp[i].bp_pos)) {
             // Still at same position as last time, fail.
@@ -6701,7 +7092,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
 
           assert(status != RA_FAIL);
           if (status != RA_NOMATCH) {
-            reg_save(&bp[i].bp_pos, &backpos);
+            reg_save(&bp[i].bp_pos, &rex->backpos);
           }
         }
         break;
@@ -6723,8 +7114,8 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
             status = RA_FAIL;
           } else {
             rp->rs_no = (int16_t)no;
-            save_se(&rp->rs_un.sesave, &rex.reg_startpos[no],
-                    &rex.reg_startp[no]);
+            save_se(&rp->rs_un.sesave, &rex->reg_startpos[no],
+                    &rex->reg_startp[no]);
             // We simply continue and handle the result when done.
           }
           break;
@@ -6753,8 +7144,8 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
             status = RA_FAIL;
           } else {
             rp->rs_no = (int16_t)no;
-            save_se(&rp->rs_un.sesave, &reg_startzpos[no],
-                    &reg_startzp[no]);
+            save_se(&rp->rs_un.sesave, &rex->reg_startzpos[no],
+                    &rex->reg_startzp[no]);
             // We simply continue and handle the result when done.
           }
           break;
@@ -6776,7 +7167,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
             status = RA_FAIL;
           } else {
             rp->rs_no = (int16_t)no;
-            save_se(&rp->rs_un.sesave, &rex.reg_endpos[no], &rex.reg_endp[no]);
+            save_se(&rp->rs_un.sesave, &rex->reg_endpos[no], &rex->reg_endp[no]);
             // We simply continue and handle the result when done.
           }
           break;
@@ -6797,8 +7188,8 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
             status = RA_FAIL;
           } else {
             rp->rs_no = (int16_t)no;
-            save_se(&rp->rs_un.sesave, &reg_endzpos[no],
-                    &reg_endzp[no]);
+            save_se(&rp->rs_un.sesave, &rex->reg_endzpos[no],
+                    &rex->reg_endzp[no]);
             // We simply continue and handle the result when done.
           }
           break;
@@ -6817,35 +7208,35 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
           no = op - BACKREF;
           cleanup_subexpr();
           if (!REG_MULTI) {  // Single-line regexp
-            if (rex.reg_startp[no] == NULL || rex.reg_endp[no] == NULL) {
+            if (rex->reg_startp[no] == NULL || rex->reg_endp[no] == NULL) {
               // Backref was not set: Match an empty string.
               len = 0;
             } else {
               // Compare current input with back-ref in the same line.
-              len = (int)(rex.reg_endp[no] - rex.reg_startp[no]);
-              if (cstrncmp((char *)rex.reg_startp[no], (char *)rex.input, &len) != 0) {
+              len = (int)(rex->reg_endp[no] - rex->reg_startp[no]);
+              if (cstrncmp((char *)rex->reg_startp[no], (char *)rex->input, &len) != 0) {
                 status = RA_NOMATCH;
               }
             }
           } else {  // Multi-line regexp
-            if (rex.reg_startpos[no].lnum < 0 || rex.reg_endpos[no].lnum < 0) {
+            if (rex->reg_startpos[no].lnum < 0 || rex->reg_endpos[no].lnum < 0) {
               // Backref was not set: Match an empty string.
               len = 0;
             } else {
-              if (rex.reg_startpos[no].lnum == rex.lnum
-                  && rex.reg_endpos[no].lnum == rex.lnum) {
+              if (rex->reg_startpos[no].lnum == rex->lnum
+                  && rex->reg_endpos[no].lnum == rex->lnum) {
                 // Compare back-ref within the current line.
-                len = rex.reg_endpos[no].col - rex.reg_startpos[no].col;
-                if (cstrncmp((char *)rex.line + rex.reg_startpos[no].col,
-                             (char *)rex.input, &len) != 0) {
+                len = rex->reg_endpos[no].col - rex->reg_startpos[no].col;
+                if (cstrncmp((char *)rex->line + rex->reg_startpos[no].col,
+                             (char *)rex->input, &len) != 0) {
                   status = RA_NOMATCH;
                 }
               } else {
                 // Messy situation: Need to compare between two lines.
-                int r = match_with_backref(rex.reg_startpos[no].lnum,
-                                           rex.reg_startpos[no].col,
-                                           rex.reg_endpos[no].lnum,
-                                           rex.reg_endpos[no].col,
+                int r = match_with_backref(rex->reg_startpos[no].lnum,
+                                           rex->reg_startpos[no].col,
+                                           rex->reg_endpos[no].lnum,
+                                           rex->reg_endpos[no].col,
                                            &len);
                 if (r != RA_MATCH) {
                   status = r;
@@ -6855,7 +7246,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
           }
 
           // Matched the backref, skip over it.
-          rex.input += len;
+          rex->input += len;
         }
         break;
 
@@ -6873,10 +7264,10 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
           if (re_extmatch_in != NULL
               && re_extmatch_in->matches[no] != NULL) {
             int len = (int)strlen((char *)re_extmatch_in->matches[no]);
-            if (cstrncmp((char *)re_extmatch_in->matches[no], (char *)rex.input, &len) != 0) {
+            if (cstrncmp((char *)re_extmatch_in->matches[no], (char *)rex->input, &len) != 0) {
               status = RA_NOMATCH;
             } else {
-              rex.input += len;
+              rex->input += len;
             }
           } else {
             // Backref was not set: Match an empty string.
@@ -6898,14 +7289,14 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
 
         case BRACE_LIMITS:
           if (OP(next) == BRACE_SIMPLE) {
-            bl_minval = OPERAND_MIN(scan);
-            bl_maxval = OPERAND_MAX(scan);
+            rex->bl_minval = OPERAND_MIN(scan);
+            rex->bl_maxval = OPERAND_MAX(scan);
           } else if (OP(next) >= BRACE_COMPLEX
                      && OP(next) < BRACE_COMPLEX + 10) {
             no = OP(next) - BRACE_COMPLEX;
-            brace_min[no] = OPERAND_MIN(scan);
-            brace_max[no] = OPERAND_MAX(scan);
-            brace_count[no] = 0;
+            rex->brace_min[no] = OPERAND_MIN(scan);
+            rex->brace_max[no] = OPERAND_MAX(scan);
+            rex->brace_count[no] = 0;
           } else {
             internal_error("BRACE_LIMITS");
             status = RA_FAIL;
@@ -6923,17 +7314,17 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
         case BRACE_COMPLEX + 8:
         case BRACE_COMPLEX + 9:
           no = op - BRACE_COMPLEX;
-          brace_count[no]++;
+          rex->brace_count[no]++;
 
           // If not matched enough times yet, try one more
-          if (brace_count[no] <= (brace_min[no] <= brace_max[no]
-                                  ? brace_min[no] : brace_max[no])) {
+          if (rex->brace_count[no] <= (rex->brace_min[no] <= rex->brace_max[no]
+                                  ? rex->brace_min[no] : rex->brace_max[no])) {
             rp = regstack_push(RS_BRCPLX_MORE, scan);
             if (rp == NULL) {
               status = RA_FAIL;
             } else {
               rp->rs_no = (int16_t)no;
-              reg_save(&rp->rs_un.regsave, &backpos);
+              reg_save(&rp->rs_un.regsave, &rex->backpos);
               next = OPERAND(scan);
               // We continue and handle the result when done.
             }
@@ -6941,27 +7332,27 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
           }
 
           // If matched enough times, may try matching some more
-          if (brace_min[no] <= brace_max[no]) {
+          if (rex->brace_min[no] <= rex->brace_max[no]) {
             // Range is the normal way around, use longest match
-            if (brace_count[no] <= brace_max[no]) {
+            if (rex->brace_count[no] <= rex->brace_max[no]) {
               rp = regstack_push(RS_BRCPLX_LONG, scan);
               if (rp == NULL) {
                 status = RA_FAIL;
               } else {
                 rp->rs_no = (int16_t)no;
-                reg_save(&rp->rs_un.regsave, &backpos);
+                reg_save(&rp->rs_un.regsave, &rex->backpos);
                 next = OPERAND(scan);
                 // We continue and handle the result when done.
               }
             }
           } else {
             // Range is backwards, use shortest match first
-            if (brace_count[no] <= brace_min[no]) {
+            if (rex->brace_count[no] <= rex->brace_min[no]) {
               rp = regstack_push(RS_BRCPLX_SHORT, scan);
               if (rp == NULL) {
                 status = RA_FAIL;
               } else {
-                reg_save(&rp->rs_un.regsave, &backpos);
+                reg_save(&rp->rs_un.regsave, &rex->backpos);
                 // We continue and handle the result when done.
               }
             }
@@ -6977,7 +7368,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
           // what character comes next.
           if (OP(next) == EXACTLY) {
             rst.nextb = *OPERAND(next);
-            if (rex.reg_ic) {
+            if (rex->reg_ic) {
               if (mb_isupper(rst.nextb)) {
                 rst.nextb_ic = mb_tolower(rst.nextb);
               } else {
@@ -6994,8 +7385,8 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
             rst.minval = (op == STAR) ? 0 : 1;
             rst.maxval = MAX_LIMIT;
           } else {
-            rst.minval = bl_minval;
-            rst.maxval = bl_maxval;
+            rst.minval = rex->bl_minval;
+            rst.maxval = rex->bl_maxval;
           }
 
           // When maxval > minval, try matching as much as possible, up
@@ -7012,12 +7403,12 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
             // It could match.  Prepare for trying to match what
             // follows.  The code is below.  Parameters are stored in
             // a regstar_T on the regstack.
-            if ((int64_t)((unsigned)regstack.ga_len >> 10) >= p_mmp) {
-              emsg(_(e_pattern_uses_more_memory_than_maxmempattern));
+            if ((int64_t)((unsigned)rex->regstack.ga_len >> 10) >= p_mmp) {
+              reg_toobig();
               status = RA_FAIL;
             } else {
-              ga_grow(&regstack, sizeof(regstar_T));
-              regstack.ga_len += (int)sizeof(regstar_T);
+              ga_grow(&rex->regstack, sizeof(regstar_T));
+              rex->regstack.ga_len += (int)sizeof(regstar_T);
               rp = regstack_push(rst.minval <= rst.maxval ? RS_STAR_LONG : RS_STAR_SHORT, scan);
               if (rp == NULL) {
                 status = RA_FAIL;
@@ -7040,7 +7431,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
             status = RA_FAIL;
           } else {
             rp->rs_no = (int16_t)op;
-            reg_save(&rp->rs_un.regsave, &backpos);
+            reg_save(&rp->rs_un.regsave, &rex->backpos);
             next = OPERAND(scan);
             // We continue and handle the result when done.
           }
@@ -7049,12 +7440,12 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
         case BEHIND:
         case NOBEHIND:
           // Need a bit of room to store extra positions.
-          if ((int64_t)((unsigned)regstack.ga_len >> 10) >= p_mmp) {
-            emsg(_(e_pattern_uses_more_memory_than_maxmempattern));
+          if ((int64_t)((unsigned)rex->regstack.ga_len >> 10) >= p_mmp) {
+            reg_toobig();
             status = RA_FAIL;
           } else {
-            ga_grow(&regstack, sizeof(regbehind_T));
-            regstack.ga_len += (int)sizeof(regbehind_T);
+            ga_grow(&rex->regstack, sizeof(regbehind_T));
+            rex->regstack.ga_len += (int)sizeof(regbehind_T);
             rp = regstack_push(RS_BEHIND1, scan);
             if (rp == NULL) {
               status = RA_FAIL;
@@ -7064,7 +7455,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
               save_subexpr(((regbehind_T *)rp) - 1);
 
               rp->rs_no = (int16_t)op;
-              reg_save(&rp->rs_un.regsave, &backpos);
+              reg_save(&rp->rs_un.regsave, &rex->backpos);
               // First try if what follows matches.  If it does then we
               // check the behind match by looping.
             }
@@ -7073,20 +7464,20 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
 
         case BHPOS:
           if (REG_MULTI) {
-            if (behind_pos.rs_u.pos.col != (colnr_T)(rex.input - rex.line)
-                || behind_pos.rs_u.pos.lnum != rex.lnum) {
+            if (rex->behind_pos.rs_u.pos.col != (colnr_T)(rex->input - rex->line)
+                || rex->behind_pos.rs_u.pos.lnum != rex->lnum) {
               status = RA_NOMATCH;
             }
-          } else if (behind_pos.rs_u.ptr != rex.input) {
+          } else if (rex->behind_pos.rs_u.ptr != rex->input) {
             status = RA_NOMATCH;
           }
           break;
 
         case NEWL:
-          if ((c != NUL || !REG_MULTI || rex.lnum > rex.reg_maxline
-               || rex.reg_line_lbr) && (c != '\n' || !rex.reg_line_lbr)) {
+          if ((c != NUL || !REG_MULTI || rex->lnum > rex->reg_maxline
+               || rex->reg_line_lbr) && (c != '\n' || !rex->reg_line_lbr)) {
             status = RA_NOMATCH;
-          } else if (rex.reg_line_lbr) {
+          } else if (rex->reg_line_lbr) {
             ADVANCE_REGINPUT();
           } else {
             reg_nextline();
@@ -7118,8 +7509,8 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
 
     // If there is something on the regstack execute the code for the state.
     // If the state is popped then loop and use the older state.
-    while (!GA_EMPTY(&regstack) && status != RA_FAIL) {
-      rp = (regitem_T *)((char *)regstack.ga_data + regstack.ga_len) - 1;
+    while (!GA_EMPTY(&rex->regstack) && status != RA_FAIL) {
+      rp = (regitem_T *)((char *)rex->regstack.ga_data + rex->regstack.ga_len) - 1;
       switch (rp->rs_state) {
       case RS_NOPEN:
         // Result is passed on as-is, simply pop the state.
@@ -7129,8 +7520,8 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
       case RS_MOPEN:
         // Pop the state.  Restore pointers when there is no match.
         if (status == RA_NOMATCH) {
-          restore_se(&rp->rs_un.sesave, &rex.reg_startpos[rp->rs_no],
-                     &rex.reg_startp[rp->rs_no]);
+          restore_se(&rp->rs_un.sesave, &rex->reg_startpos[rp->rs_no],
+                     &rex->reg_startp[rp->rs_no]);
         }
         regstack_pop(&scan);
         break;
@@ -7138,8 +7529,8 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
       case RS_ZOPEN:
         // Pop the state.  Restore pointers when there is no match.
         if (status == RA_NOMATCH) {
-          restore_se(&rp->rs_un.sesave, &reg_startzpos[rp->rs_no],
-                     &reg_startzp[rp->rs_no]);
+          restore_se(&rp->rs_un.sesave, &rex->reg_startzpos[rp->rs_no],
+                     &rex->reg_startzp[rp->rs_no]);
         }
         regstack_pop(&scan);
         break;
@@ -7147,8 +7538,8 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
       case RS_MCLOSE:
         // Pop the state.  Restore pointers when there is no match.
         if (status == RA_NOMATCH) {
-          restore_se(&rp->rs_un.sesave, &rex.reg_endpos[rp->rs_no],
-                     &rex.reg_endp[rp->rs_no]);
+          restore_se(&rp->rs_un.sesave, &rex->reg_endpos[rp->rs_no],
+                     &rex->reg_endp[rp->rs_no]);
         }
         regstack_pop(&scan);
         break;
@@ -7156,8 +7547,8 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
       case RS_ZCLOSE:
         // Pop the state.  Restore pointers when there is no match.
         if (status == RA_NOMATCH) {
-          restore_se(&rp->rs_un.sesave, &reg_endzpos[rp->rs_no],
-                     &reg_endzp[rp->rs_no]);
+          restore_se(&rp->rs_un.sesave, &rex->reg_endzpos[rp->rs_no],
+                     &rex->reg_endzp[rp->rs_no]);
         }
         regstack_pop(&scan);
         break;
@@ -7169,7 +7560,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
         } else {
           if (status != RA_BREAK) {
             // After a non-matching branch: try next one.
-            reg_restore(&rp->rs_un.regsave, &backpos);
+            reg_restore(&rp->rs_un.regsave, &rex->backpos);
             scan = rp->rs_scan;
           }
           if (scan == NULL || OP(scan) != BRANCH) {
@@ -7179,7 +7570,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
           } else {
             // Prepare to try a branch.
             rp->rs_scan = regnext(scan);
-            reg_save(&rp->rs_un.regsave, &backpos);
+            reg_save(&rp->rs_un.regsave, &rex->backpos);
             scan = OPERAND(scan);
           }
         }
@@ -7188,8 +7579,8 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
       case RS_BRCPLX_MORE:
         // Pop the state.  Restore pointers when there is no match.
         if (status == RA_NOMATCH) {
-          reg_restore(&rp->rs_un.regsave, &backpos);
-          brace_count[rp->rs_no]--;             // decrement match count
+          reg_restore(&rp->rs_un.regsave, &rex->backpos);
+          rex->brace_count[rp->rs_no]--;             // decrement match count
         }
         regstack_pop(&scan);
         break;
@@ -7198,8 +7589,8 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
         // Pop the state.  Restore pointers when there is no match.
         if (status == RA_NOMATCH) {
           // There was no match, but we did find enough matches.
-          reg_restore(&rp->rs_un.regsave, &backpos);
-          brace_count[rp->rs_no]--;
+          reg_restore(&rp->rs_un.regsave, &rex->backpos);
+          rex->brace_count[rp->rs_no]--;
           // continue with the items after "\{}"
           status = RA_CONT;
         }
@@ -7213,7 +7604,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
         // Pop the state.  Restore pointers when there is no match.
         if (status == RA_NOMATCH) {
           // There was no match, try to match one more item.
-          reg_restore(&rp->rs_un.regsave, &backpos);
+          reg_restore(&rp->rs_un.regsave, &rex->backpos);
         }
         regstack_pop(&scan);
         if (status == RA_NOMATCH) {
@@ -7231,7 +7622,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
         } else {
           status = RA_CONT;
           if (rp->rs_no != SUBPAT) {            // zero-width
-            reg_restore(&rp->rs_un.regsave, &backpos);
+            reg_restore(&rp->rs_un.regsave, &rex->backpos);
           }
         }
         regstack_pop(&scan);
@@ -7243,7 +7634,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
       case RS_BEHIND1:
         if (status == RA_NOMATCH) {
           regstack_pop(&scan);
-          regstack.ga_len -= (int)sizeof(regbehind_T);
+          rex->regstack.ga_len -= (int)sizeof(regbehind_T);
         } else {
           // The stuff after BEHIND/NOBEHIND matches.  Now try if
           // the behind part does (not) match before the current
@@ -7252,7 +7643,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
           // the current position.
 
           // save the position after the found match for next
-          reg_save(&(((regbehind_T *)rp) - 1)->save_after, &backpos);
+          reg_save(&(((regbehind_T *)rp) - 1)->save_after, &rex->backpos);
 
           // Start looking for a match with operand at the current
           // position.  Go back one character until we find the
@@ -7260,24 +7651,24 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
           // line (for multi-line matching).
           // Set behind_pos to where the match should end, BHPOS
           // will match it.  Save the current value.
-          (((regbehind_T *)rp) - 1)->save_behind = behind_pos;
-          behind_pos = rp->rs_un.regsave;
+          (((regbehind_T *)rp) - 1)->save_behind = rex->behind_pos;
+          rex->behind_pos = rp->rs_un.regsave;
 
           rp->rs_state = RS_BEHIND2;
 
-          reg_restore(&rp->rs_un.regsave, &backpos);
+          reg_restore(&rp->rs_un.regsave, &rex->backpos);
           scan = OPERAND(rp->rs_scan) + 4;
         }
         break;
 
       case RS_BEHIND2:
         // Looping for BEHIND / NOBEHIND match.
-        if (status == RA_MATCH && reg_save_equal(&behind_pos)) {
+        if (status == RA_MATCH && reg_save_equal(&rex->behind_pos)) {
           // found a match that ends where "next" started
-          behind_pos = (((regbehind_T *)rp) - 1)->save_behind;
+          rex->behind_pos = (((regbehind_T *)rp) - 1)->save_behind;
           if (rp->rs_no == BEHIND) {
             reg_restore(&(((regbehind_T *)rp) - 1)->save_after,
-                        &backpos);
+                        &rex->backpos);
           } else {
             // But we didn't want a match.  Need to restore the
             // subexpr, because what follows matched, so they have
@@ -7286,7 +7677,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
             restore_subexpr(((regbehind_T *)rp) - 1);
           }
           regstack_pop(&scan);
-          regstack.ga_len -= (int)sizeof(regbehind_T);
+          rex->regstack.ga_len -= (int)sizeof(regbehind_T);
         } else {
           int64_t limit;
 
@@ -7297,21 +7688,21 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
           if (REG_MULTI) {
             if (limit > 0
                 && ((rp->rs_un.regsave.rs_u.pos.lnum
-                     < behind_pos.rs_u.pos.lnum
-                     ? (colnr_T)strlen((char *)rex.line)
-                     : behind_pos.rs_u.pos.col)
+                     < rex->behind_pos.rs_u.pos.lnum
+                     ? (colnr_T)strlen((char *)rex->line)
+                     : rex->behind_pos.rs_u.pos.col)
                     - rp->rs_un.regsave.rs_u.pos.col >= limit)) {
               no = FAIL;
             } else if (rp->rs_un.regsave.rs_u.pos.col == 0) {
               if (rp->rs_un.regsave.rs_u.pos.lnum
-                  < behind_pos.rs_u.pos.lnum
+                  < rex->behind_pos.rs_u.pos.lnum
                   || reg_getline(--rp->rs_un.regsave.rs_u.pos.lnum)
                   == NULL) {
                 no = FAIL;
               } else {
-                reg_restore(&rp->rs_un.regsave, &backpos);
+                reg_restore(&rp->rs_un.regsave, &rex->backpos);
                 rp->rs_un.regsave.rs_u.pos.col =
-                  (colnr_T)strlen((char *)rex.line);
+                  (colnr_T)strlen((char *)rex->line);
               }
             } else {
               const uint8_t *const line =
@@ -7323,19 +7714,19 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
                 + 1;
             }
           } else {
-            if (rp->rs_un.regsave.rs_u.ptr == rex.line) {
+            if (rp->rs_un.regsave.rs_u.ptr == rex->line) {
               no = FAIL;
             } else {
-              MB_PTR_BACK(rex.line, rp->rs_un.regsave.rs_u.ptr);
+              MB_PTR_BACK(rex->line, rp->rs_un.regsave.rs_u.ptr);
               if (limit > 0
-                  && (behind_pos.rs_u.ptr - rp->rs_un.regsave.rs_u.ptr) > (ptrdiff_t)limit) {
+                  && (rex->behind_pos.rs_u.ptr - rp->rs_un.regsave.rs_u.ptr) > (ptrdiff_t)limit) {
                 no = FAIL;
               }
             }
           }
           if (no == OK) {
             // Advanced, prepare for finding match again.
-            reg_restore(&rp->rs_un.regsave, &backpos);
+            reg_restore(&rp->rs_un.regsave, &rex->backpos);
             scan = OPERAND(rp->rs_scan) + 4;
             if (status == RA_MATCH) {
               // We did match, so subexpr may have been changed,
@@ -7345,10 +7736,10 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
             }
           } else {
             // Can't advance.  For NOBEHIND that's a match.
-            behind_pos = (((regbehind_T *)rp) - 1)->save_behind;
+            rex->behind_pos = (((regbehind_T *)rp) - 1)->save_behind;
             if (rp->rs_no == NOBEHIND) {
               reg_restore(&(((regbehind_T *)rp) - 1)->save_after,
-                          &backpos);
+                          &rex->backpos);
               status = RA_MATCH;
             } else {
               // We do want a proper match.  Need to restore the
@@ -7360,7 +7751,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
               }
             }
             regstack_pop(&scan);
-            regstack.ga_len -= (int)sizeof(regbehind_T);
+            rex->regstack.ga_len -= (int)sizeof(regbehind_T);
           }
         }
         break;
@@ -7371,13 +7762,13 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
 
         if (status == RA_MATCH) {
           regstack_pop(&scan);
-          regstack.ga_len -= (int)sizeof(regstar_T);
+          rex->regstack.ga_len -= (int)sizeof(regstar_T);
           break;
         }
 
         // Tried once already, restore input pointers.
         if (status != RA_BREAK) {
-          reg_restore(&rp->rs_un.regsave, &backpos);
+          reg_restore(&rp->rs_un.regsave, &rex->backpos);
         }
 
         // Repeat until we found a position where it could match.
@@ -7390,22 +7781,22 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
               if (--rst->count < rst->minval) {
                 break;
               }
-              if (rex.input == rex.line) {
+              if (rex->input == rex->line) {
                 // backup to last char of previous line
-                if (rex.lnum == 0) {
+                if (rex->lnum == 0) {
                   status = RA_NOMATCH;
                   break;
                 }
-                rex.lnum--;
-                rex.line = (uint8_t *)reg_getline(rex.lnum);
+                rex->lnum--;
+                rex->line = (uint8_t *)reg_getline(rex->lnum);
                 // Just in case regrepeat() didn't count right.
-                if (rex.line == NULL) {
+                if (rex->line == NULL) {
                   break;
                 }
-                rex.input = rex.line + reg_getline_len(rex.lnum);
+                rex->input = rex->line + reg_getline_len(rex->lnum);
                 reg_breakcheck();
               } else {
-                MB_PTR_BACK(rex.line, rex.input);
+                MB_PTR_BACK(rex->line, rex->input);
               }
             } else {
               // Range is backwards, use shortest match first.
@@ -7426,9 +7817,9 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
           }
 
           // If it could match, try it.
-          if (rst->nextb == NUL || *rex.input == rst->nextb
-              || *rex.input == rst->nextb_ic) {
-            reg_save(&rp->rs_un.regsave, &backpos);
+          if (rst->nextb == NUL || *rex->input == rst->nextb
+              || *rex->input == rst->nextb_ic) {
+            reg_save(&rp->rs_un.regsave, &rex->backpos);
             scan = regnext(rp->rs_scan);
             status = RA_CONT;
             break;
@@ -7437,7 +7828,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
         if (status != RA_CONT) {
           // Failed.
           regstack_pop(&scan);
-          regstack.ga_len -= (int)sizeof(regstar_T);
+          rex->regstack.ga_len -= (int)sizeof(regstar_T);
           status = RA_NOMATCH;
         }
       }
@@ -7447,7 +7838,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
       // If we want to continue the inner loop or didn't pop a state
       // continue matching loop
       if (status == RA_CONT || rp == (regitem_T *)
-          ((char *)regstack.ga_data + regstack.ga_len) - 1) {
+          ((char *)rex->regstack.ga_data + rex->regstack.ga_len) - 1) {
         break;
       }
     }
@@ -7458,7 +7849,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
     }
 
     // If the regstack is empty or something failed we are done.
-    if (GA_EMPTY(&regstack) || status == RA_FAIL) {
+    if (GA_EMPTY(&rex->regstack) || status == RA_FAIL) {
       if (scan == NULL) {
         // We get here only if there's trouble -- normally "case END" is
         // the terminating point.
@@ -7474,7 +7865,7 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
   // NOTREACHED
 }
 
-/// Try match of "prog" with at rex.line["col"].
+/// Try match of "prog" with at rex->line["col"].
 ///
 /// @param tm         timeout limit or NULL
 /// @param timed_out  flag set on timeout or NULL
@@ -7482,10 +7873,10 @@ static bool regmatch(uint8_t *scan, const proftime_T *tm, int *timed_out)
 /// @return  0 for failure, or number of lines contained in the match.
 static int regtry(bt_regprog_T *prog, colnr_T col, proftime_T *tm, int *timed_out)
 {
-  rex.input = rex.line + col;
-  rex.need_clear_subexpr = true;
+  rex->input = rex->line + col;
+  rex->need_clear_subexpr = true;
   // Clear the external match subpointers if necessaey.
-  rex.need_clear_zsubexpr = (prog->reghasz == REX_SET);
+  rex->need_clear_zsubexpr = (prog->reghasz == REX_SET);
 
   if (regmatch(&prog->program[1], tm, timed_out) == 0) {
     return 0;
@@ -7493,28 +7884,31 @@ static int regtry(bt_regprog_T *prog, colnr_T col, proftime_T *tm, int *timed_ou
 
   cleanup_subexpr();
   if (REG_MULTI) {
-    if (rex.reg_startpos[0].lnum < 0) {
-      rex.reg_startpos[0].lnum = 0;
-      rex.reg_startpos[0].col = col;
+    if (rex->reg_startpos[0].lnum < 0) {
+      rex->reg_startpos[0].lnum = 0;
+      rex->reg_startpos[0].col = col;
     }
-    if (rex.reg_endpos[0].lnum < 0) {
-      rex.reg_endpos[0].lnum = rex.lnum;
-      rex.reg_endpos[0].col = (int)(rex.input - rex.line);
+    if (rex->reg_endpos[0].lnum < 0) {
+      rex->reg_endpos[0].lnum = rex->lnum;
+      rex->reg_endpos[0].col = (int)(rex->input - rex->line);
     } else {
       // Use line number of "\ze".
-      rex.lnum = rex.reg_endpos[0].lnum;
+      rex->lnum = rex->reg_endpos[0].lnum;
     }
   } else {
-    if (rex.reg_startp[0] == NULL) {
-      rex.reg_startp[0] = rex.line + col;
+    if (rex->reg_startp[0] == NULL) {
+      rex->reg_startp[0] = rex->line + col;
     }
-    if (rex.reg_endp[0] == NULL) {
-      rex.reg_endp[0] = rex.input;
+    if (rex->reg_endp[0] == NULL) {
+      rex->reg_endp[0] = rex->input;
     }
   }
   // Package any found \z(...\) matches for export. Default is none.
-  unref_extmatch(re_extmatch_out);
-  re_extmatch_out = NULL;
+  // Only the main thread sets "re_extmatch_out", leave it alone when unset.
+  if (re_extmatch_out != NULL) {
+    unref_extmatch(re_extmatch_out);
+    re_extmatch_out = NULL;
+  }
 
   if (prog->reghasz == REX_SET) {
     int i;
@@ -7524,22 +7918,24 @@ static int regtry(bt_regprog_T *prog, colnr_T col, proftime_T *tm, int *timed_ou
     for (i = 0; i < NSUBEXP; i++) {
       if (REG_MULTI) {
         // Only accept single line matches.
-        if (reg_startzpos[i].lnum >= 0
-            && reg_endzpos[i].lnum == reg_startzpos[i].lnum
-            && reg_endzpos[i].col >= reg_startzpos[i].col) {
+        if (rex->reg_startzpos[i].lnum >= 0
+            && rex->reg_endzpos[i].lnum == rex->reg_startzpos[i].lnum
+            && rex->reg_endzpos[i].col >= rex->reg_startzpos[i].col) {
           re_extmatch_out->matches[i] =
-            (uint8_t *)xstrnsave(reg_getline(reg_startzpos[i].lnum) + reg_startzpos[i].col,
-                                 (size_t)(reg_endzpos[i].col - reg_startzpos[i].col));
+            (uint8_t *)xstrnsave(reg_getline(rex->reg_startzpos[i].lnum)
+                                 + rex->reg_startzpos[i].col,
+                                 (size_t)(rex->reg_endzpos[i].col - rex->reg_startzpos[i].col));
         }
       } else {
-        if (reg_startzp[i] != NULL && reg_endzp[i] != NULL) {
+        if (rex->reg_startzp[i] != NULL && rex->reg_endzp[i] != NULL) {
           re_extmatch_out->matches[i] =
-            (uint8_t *)xstrnsave((char *)reg_startzp[i], (size_t)(reg_endzp[i] - reg_startzp[i]));
+            (uint8_t *)xstrnsave((char *)rex->reg_startzp[i],
+                                 (size_t)(rex->reg_endzp[i] - rex->reg_startzp[i]));
         }
       }
     }
   }
-  return 1 + rex.lnum;
+  return 1 + rex->lnum;
 }
 
 /// Match a regexp against a string ("line" points to the string) or multiple
@@ -7561,29 +7957,29 @@ static int bt_regexec_both(uint8_t *line, colnr_T startcol, proftime_T *tm, int
   // We allocate *_INITIAL amount of bytes first and then set the grow size
   // to much bigger value to avoid many malloc calls in case of deep regular
   // expressions.
-  if (regstack.ga_data == NULL) {
+  if (rex->regstack.ga_data == NULL) {
     // Use an item size of 1 byte, since we push different things
     // onto the regstack.
-    ga_init(&regstack, 1, REGSTACK_INITIAL);
-    ga_grow(&regstack, REGSTACK_INITIAL);
-    ga_set_growsize(&regstack, REGSTACK_INITIAL * 8);
+    ga_init(&rex->regstack, 1, REGSTACK_INITIAL);
+    ga_grow(&rex->regstack, REGSTACK_INITIAL);
+    ga_set_growsize(&rex->regstack, REGSTACK_INITIAL * 8);
   }
 
-  if (backpos.ga_data == NULL) {
-    ga_init(&backpos, sizeof(backpos_T), BACKPOS_INITIAL);
-    ga_grow(&backpos, BACKPOS_INITIAL);
-    ga_set_growsize(&backpos, BACKPOS_INITIAL * 8);
+  if (rex->backpos.ga_data == NULL) {
+    ga_init(&rex->backpos, sizeof(backpos_T), BACKPOS_INITIAL);
+    ga_grow(&rex->backpos, BACKPOS_INITIAL);
+    ga_set_growsize(&rex->backpos, BACKPOS_INITIAL * 8);
   }
 
   if (REG_MULTI) {
-    prog = (bt_regprog_T *)rex.reg_mmatch->regprog;
+    prog = (bt_regprog_T *)rex->reg_mmatch->regprog;
     line = (uint8_t *)reg_getline(0);
-    rex.reg_startpos = rex.reg_mmatch->startpos;
-    rex.reg_endpos = rex.reg_mmatch->endpos;
+    rex->reg_startpos = rex->reg_mmatch->startpos;
+    rex->reg_endpos = rex->reg_mmatch->endpos;
   } else {
-    prog = (bt_regprog_T *)rex.reg_match->regprog;
-    rex.reg_startp = (uint8_t **)rex.reg_match->startp;
-    rex.reg_endp = (uint8_t **)rex.reg_match->endp;
+    prog = (bt_regprog_T *)rex->reg_match->regprog;
+    rex->reg_startp = (uint8_t **)rex->reg_match->startp;
+    rex->reg_endp = (uint8_t **)rex->reg_match->endp;
   }
 
   // Be paranoid...
@@ -7598,59 +7994,37 @@ static int bt_regexec_both(uint8_t *line, colnr_T startcol, proftime_T *tm, int
   }
 
   // If the start column is past the maximum column: no need to try.
-  if (rex.reg_maxcol > 0 && col >= rex.reg_maxcol) {
+  if (rex->reg_maxcol > 0 && col >= rex->reg_maxcol) {
     goto theend;
   }
 
-  // If pattern contains "\c" or "\C": overrule value of rex.reg_ic
+  // If pattern contains "\c" or "\C": overrule value of rex->reg_ic
   if (prog->regflags & RF_ICASE) {
-    rex.reg_ic = true;
+    rex->reg_ic = true;
   } else if (prog->regflags & RF_NOICASE) {
-    rex.reg_ic = false;
+    rex->reg_ic = false;
   }
 
-  // If pattern contains "\Z" overrule value of rex.reg_icombine
+  // If pattern contains "\Z" overrule value of rex->reg_icombine
   if (prog->regflags & RF_ICOMBINE) {
-    rex.reg_icombine = true;
+    rex->reg_icombine = true;
   }
 
   // If there is a "must appear" string, look for it.
-  if (prog->regmust != NULL) {
-    int c = utf_ptr2char((char *)prog->regmust);
-    s = line + col;
-
-    // This is used very often, esp. for ":global".  Use two versions of
-    // the loop to avoid overhead of conditions.
-    if (!rex.reg_ic) {
-      while ((s = (uint8_t *)vim_strchr((char *)s, c)) != NULL) {
-        if (cstrncmp((char *)s, (char *)prog->regmust, &prog->regmlen) == 0) {
-          break;  // Found it.
-        }
-        MB_PTR_ADV(s);
-      }
-    } else {
-      while ((s = (uint8_t *)cstrchr((char *)s, c)) != NULL) {
-        if (cstrncmp((char *)s, (char *)prog->regmust, &prog->regmlen) == 0) {
-          break;  // Found it.
-        }
-        MB_PTR_ADV(s);
-      }
-    }
-    if (s == NULL) {  // Not present.
-      goto theend;
-    }
+  // This is used very often, esp. for ":global".
+  if (prog->regmust != NULL && !regmust_found((char *)line + col, (char *)prog->regmust)) {
+    goto theend;
   }
 
-  rex.line = line;
-  rex.lnum = 0;
-  reg_toolong = false;
+  rex->line = line;
+  rex->lnum = 0;
 
   // Simplest case: Anchored match need be tried only once.
   if (prog->reganch) {
-    int c = utf_ptr2char((char *)rex.line + col);
+    int c = utf_ptr2char((char *)rex->line + col);
     if (prog->regstart == NUL
         || prog->regstart == c
-        || (rex.reg_ic
+        || (rex->reg_ic
             && (utf_fold(prog->regstart) == utf_fold(c)
                 || (c < 255 && prog->regstart < 255
                     && mb_tolower(prog->regstart) == mb_tolower(c))))) {
@@ -7664,16 +8038,16 @@ static int bt_regexec_both(uint8_t *line, colnr_T startcol, proftime_T *tm, int
     while (!got_int) {
       if (prog->regstart != NUL) {
         // Skip until the char we know it must start with.
-        s = (uint8_t *)cstrchr((char *)rex.line + col, prog->regstart);
+        s = (uint8_t *)cstrchr((char *)rex->line + col, prog->regstart);
         if (s == NULL) {
           retval = 0;
           break;
         }
-        col = (int)(s - rex.line);
+        col = (int)(s - rex->line);
       }
 
       // Check for maximum column to try.
-      if (rex.reg_maxcol > 0 && col >= rex.reg_maxcol) {
+      if (rex->reg_maxcol > 0 && col >= rex->reg_maxcol) {
         retval = 0;
         break;
       }
@@ -7684,14 +8058,14 @@ static int bt_regexec_both(uint8_t *line, colnr_T startcol, proftime_T *tm, int
       }
 
       // if not currently on the first line, get it again
-      if (rex.lnum != 0) {
-        rex.lnum = 0;
-        rex.line = (uint8_t *)reg_getline(0);
+      if (rex->lnum != 0) {
+        rex->lnum = 0;
+        rex->line = (uint8_t *)reg_getline(0);
       }
-      if (rex.line[col] == NUL) {
+      if (rex->line[col] == NUL) {
         break;
       }
-      col += utfc_ptr2len((char *)rex.line + col);
+      col += utfc_ptr2len((char *)rex->line + col);
       // Check for timeout once in a twenty times to avoid overhead.
       if (tm != NULL && ++tm_count == 20) {
         tm_count = 0;
@@ -7708,39 +8082,39 @@ static int bt_regexec_both(uint8_t *line, colnr_T startcol, proftime_T *tm, int
 theend:
   // Free "reg_tofree" when it's a bit big.
   // Free regstack and backpos if they are bigger than their initial size.
-  if (reg_tofreelen > 400) {
-    XFREE_CLEAR(reg_tofree);
+  if (rex->reg_tofreelen > 400) {
+    XFREE_CLEAR(rex->reg_tofree);
   }
-  if (regstack.ga_maxlen > REGSTACK_INITIAL) {
-    ga_clear(&regstack);
+  if (rex->regstack.ga_maxlen > REGSTACK_INITIAL) {
+    ga_clear(&rex->regstack);
   }
-  if (backpos.ga_maxlen > BACKPOS_INITIAL) {
-    ga_clear(&backpos);
+  if (rex->backpos.ga_maxlen > BACKPOS_INITIAL) {
+    ga_clear(&rex->backpos);
   }
 
   if (retval > 0) {
     // Make sure the end is never before the start.  Can happen when \zs
     // and \ze are used.
     if (REG_MULTI) {
-      const lpos_T *const start = &rex.reg_mmatch->startpos[0];
-      const lpos_T *const end = &rex.reg_mmatch->endpos[0];
+      const lpos_T *const start = &rex->reg_mmatch->startpos[0];
+      const lpos_T *const end = &rex->reg_mmatch->endpos[0];
 
       if (end->lnum < start->lnum
           || (end->lnum == start->lnum && end->col < start->col)) {
-        rex.reg_mmatch->endpos[0] = rex.reg_mmatch->startpos[0];
+        rex->reg_mmatch->endpos[0] = rex->reg_mmatch->startpos[0];
       }
 
       // startpos[0] may be set by "\zs", also return the column where
       // the whole pattern matched.
-      rex.reg_mmatch->rmm_matchcol = col;
+      rex->reg_mmatch->rmm_matchcol = col;
     } else {
-      if (rex.reg_match->endp[0] < rex.reg_match->startp[0]) {
-        rex.reg_match->endp[0] = rex.reg_match->startp[0];
+      if (rex->reg_match->endp[0] < rex->reg_match->startp[0]) {
+        rex->reg_match->endp[0] = rex->reg_match->startp[0];
       }
 
       // startpos[0] may be set by "\zs", also return the column where
       // the whole pattern matched.
-      rex.reg_match->rm_matchcol = col;
+      rex->reg_match->rm_matchcol = col;
     }
   }
 
@@ -7758,16 +8132,16 @@ theend:
 /// @return  0 for failure, number of lines contained in the match otherwise.
 static int bt_regexec_nl(regmatch_T *rmp, uint8_t *line, colnr_T col, bool line_lbr)
 {
-  rex.reg_match = rmp;
-  rex.reg_mmatch = NULL;
-  rex.reg_maxline = 0;
-  rex.reg_line_lbr = line_lbr;
-  rex.reg_buf = curbuf;
-  rex.reg_win = NULL;
-  rex.reg_ic = rmp->rm_ic;
-  rex.reg_icombine = false;
-  rex.reg_nobreak = rmp->regprog->re_flags & RE_NOBREAK;
-  rex.reg_maxcol = 0;
+  rex->reg_match = rmp;
+  rex->reg_mmatch = NULL;
+  rex->reg_maxline = 0;
+  rex->reg_line_lbr = line_lbr;
+  rex->reg_buf = rex->reg_worker != NULL ? rex->reg_worker->buf : curbuf;
+  rex->reg_win = NULL;
+  rex->reg_ic = rmp->rm_ic;
+  rex->reg_icombine = false;
+  rex->reg_nobreak = rmp->regprog->re_flags & RE_NOBREAK;
+  rex->reg_maxcol = 0;
 
   int64_t r = bt_regexec_both(line, col, NULL, NULL);
   assert(r <= INT_MAX);
@@ -8532,14 +8906,11 @@ static int *post_ptr;
 // while NFA engine handles multibyte characters correctly.
 static bool wants_nfa;
 
-static int nstate;  ///< Number of states in the NFA. Also used when executing.
+static int nstate;  ///< Number of states in the NFA.
 static int istate;  ///< Index in the state vector, used in alloc_state()
 
-// If not NULL match must end at this position
-static save_se_T *nfa_endp = NULL;
-
-// 0 for first call to nfa_regmatch(), 1 for recursive call.
-static int nfa_ll_index = 0;
+static bool nfa_has_zend;     ///< NFA regexp \ze operator encountered.
+static bool nfa_has_backref;  ///< NFA regexp \1 .. \9 encountered.
 
 // Helper functions used when doing re2post() ... regatom() parsing
 #define EMIT(c) \
@@ -8574,8 +8945,8 @@ static void nfa_regcomp_start(uint8_t *expr, int re_flags)
   post_ptr = post_start;
   post_end = post_start + nstate_max;
   wants_nfa = false;
-  rex.nfa_has_zend = false;
-  rex.nfa_has_backref = false;
+  nfa_has_zend = false;
+  nfa_has_backref = false;
 
   // shared with BT engine
   regcomp_start(expr, re_flags);
@@ -8749,84 +9120,368 @@ static uint8_t *nfa_get_match_text(nfa_state_T *start)
   return ret;
 }
 
-// Allocate more space for post_start.  Called when
-// running above the estimated number of states.
-static void realloc_post_list(void)
+/// Set "lit" to say that nothing is known about the matched text.
+static void nfa_lit_unknown(nfa_lit_T *lit)
 {
-  // For weird patterns the number of states can be very high. Increasing by
-  // 50% seems a reasonable compromise between memory use and speed.
-  const size_t new_max = (size_t)(post_end - post_start) * 3 / 2;
-  int *new_start = xrealloc(post_start, new_max * sizeof(int));
-  post_ptr = new_start + (post_ptr - post_start);
-  post_end = new_start + new_max;
-  post_start = new_start;
+  CLEAR_POINTER(lit);
 }
 
-// Search between "start" and "end" and try to recognize a
-// character class in expanded form. For example [0-9].
-// On success, return the id the character class to be emitted.
-// On failure, return 0 (=FAIL)
-// Start points to the first char of the range, while end should point
-// to the closing brace.
-// Keep in mind that 'ignorecase' applies at execution time, thus [a-z] may
-// need to be interpreted as [a-zA-Z].
-static int nfa_recognize_char_class(uint8_t *start, const uint8_t *end, int extra_newl)
+/// Set "lit" to say that the matched text is always "str", which must not be
+/// longer than NFA_REGMUST_LEN bytes.
+static void nfa_lit_exact(nfa_lit_T *lit, const char *str)
 {
-#define CLASS_not            0x80
-#define CLASS_af             0x40
-#define CLASS_AF             0x20
-#define CLASS_az             0x10
-#define CLASS_AZ             0x08
-#define CLASS_o7             0x04
-#define CLASS_o9             0x02
-#define CLASS_underscore     0x01
+  CLEAR_POINTER(lit);
+  lit->exact = true;
+  xstrlcpy(lit->prefix, str, sizeof(lit->prefix));
+  xstrlcpy(lit->suffix, str, sizeof(lit->suffix));
+  if (*str != NUL) {
+    xstrlcpy(lit->must[0], str, sizeof(lit->must[0]));
+    lit->nmust = 1;
+  }
+}
 
-  uint8_t *p;
-  int config = 0;
+/// @return  length of the shortest of the "n" strings in "must".
+static size_t nfa_lit_shortest(char (*must)[NFA_REGMUST_LEN + 1], int n)
+{
+  size_t len = NFA_REGMUST_LEN;
+  for (int i = 0; i < n; i++) {
+    len = MIN(len, strlen(must[i]));
+  }
+  return len;
+}
 
-  bool newl = extra_newl == true;
+/// Use the "n" strings in "must" for "lit" when they are more selective than
+/// what it has: when the shortest one is longer, or when there are fewer.
+static void nfa_lit_better_must(nfa_lit_T *lit, char (*must)[NFA_REGMUST_LEN + 1], int n)
+{
+  size_t len = nfa_lit_shortest(must, n);
+  if (n == 0 || len == 0) {
+    return;
+  }
+  size_t oldlen = nfa_lit_shortest(lit->must, lit->nmust);
+  if (lit->nmust == 0 || len > oldlen || (len == oldlen && n < lit->nmust)) {
+    memmove(lit->must, must, (size_t)n * sizeof(*must));
+    lit->nmust = n;
+  }
+}
 
-  if (*end != ']') {
-    return FAIL;
+/// Use the single string "str" for "lit" when it is more selective.
+static void nfa_lit_better_str(nfa_lit_T *lit, const char *str)
+{
+  char must[1][NFA_REGMUST_LEN + 1];
+  xstrlcpy(must[0], str, sizeof(must[0]));
+  nfa_lit_better_must(lit, must, 1);
+}
+
+/// Combine "a" with "b" for NFA_CONCAT, the result is stored in "a".
+static void nfa_lit_concat(nfa_lit_T *a, nfa_lit_T *b)
+{
+  // The end of "a" and the start of "b" are next to each other.
+  char joined[2 * NFA_REGMUST_LEN + 1];
+  size_t len = xstrlcpy(joined, a->suffix, sizeof(joined));
+  len += xstrlcpy(joined + len, b->prefix, sizeof(joined) - len);
+
+  if (a->exact && b->exact && len <= NFA_REGMUST_LEN) {
+    nfa_lit_exact(a, joined);
+    return;
   }
-  p = start;
-  if (*p == '^') {
-    config |= CLASS_not;
-    p++;
+
+  nfa_lit_T r;
+  nfa_lit_unknown(&r);
+  // All strings are ASCII, they can be cut anywhere.
+  xstrlcpy(r.prefix, a->exact ? joined : a->prefix, sizeof(r.prefix));
+  xstrlcpy(r.suffix, b->exact ? joined + len - MIN(len, NFA_REGMUST_LEN) : b->suffix,
+           sizeof(r.suffix));
+  memcpy(r.must, a->must, sizeof(r.must));
+  r.nmust = a->nmust;
+  nfa_lit_better_must(&r, b->must, b->nmust);
+  nfa_lit_better_str(&r, joined);
+  nfa_lit_better_str(&r, r.prefix);
+  nfa_lit_better_str(&r, r.suffix);
+  *a = r;
+}
+
+/// Combine "a" with "b" for NFA_OR, the result is stored in "a".
+static void nfa_lit_or(nfa_lit_T *a, const nfa_lit_T *b)
+{
+  if (a->exact && b->exact && strcmp(a->prefix, b->prefix) == 0) {
+    return;
   }
 
-  while (p < end) {
-    if (p + 2 < end && *(p + 1) == '-') {
-      switch (*p) {
-      case '0':
-        if (*(p + 2) == '9') {
-          config |= CLASS_o9;
-          break;
-        } else if (*(p + 2) == '7') {
-          config |= CLASS_o7;
-          break;
-        }
-        return FAIL;
-      case 'a':
-        if (*(p + 2) == 'z') {
-          config |= CLASS_az;
-          break;
-        } else if (*(p + 2) == 'f') {
-          config |= CLASS_af;
-          break;
-        }
-        return FAIL;
-      case 'A':
-        if (*(p + 2) == 'Z') {
-          config |= CLASS_AZ;
-          break;
-        } else if (*(p + 2) == 'F') {
-          config |= CLASS_AF;
-          break;
-        }
-        return FAIL;
-      default:
-        return FAIL;
+  nfa_lit_T r;
+  nfa_lit_unknown(&r);
+  size_t len = 0;
+  while (a->prefix[len] != NUL && a->prefix[len] == b->prefix[len]) {
+    len++;
+  }
+  xmemcpyz(r.prefix, a->prefix, len);
+  size_t alen = strlen(a->suffix);
+  size_t blen = strlen(b->suffix);
+  for (len = 0; len < alen && len < blen; len++) {
+    if (a->suffix[alen - len - 1] != b->suffix[blen - len - 1]) {
+      break;
+    }
+  }
+  xstrlcpy(r.suffix, a->suffix + alen - len, sizeof(r.suffix));
+
+  // A match of either side contains one of the strings of that side.
+  if (a->nmust > 0 && b->nmust > 0 && a->nmust + b->nmust <= NFA_REGMUST_ALT) {
+    memcpy(r.must, a->must, (size_t)a->nmust * sizeof(r.must[0]));
+    r.nmust = a->nmust;
+    for (int i = 0; i < b->nmust; i++) {
+      int j = 0;
+      while (j < r.nmust && strcmp(r.must[j], b->must[i]) != 0) {
+        j++;
+      }
+      if (j == r.nmust) {
+        xstrlcpy(r.must[r.nmust++], b->must[i], sizeof(r.must[0]));
+      }
+    }
+  }
+  nfa_lit_better_str(&r, r.prefix);
+  nfa_lit_better_str(&r, r.suffix);
+  *a = r;
+}
+
+/// Find literal text which every match of the postfix form "postfix" .. "end"
+/// contains, one of up to NFA_REGMUST_ALT strings, and store it in
+/// "prog->regmust".  Lets nfa_regexec_both() reject a line without running the
+/// NFA.  Only ASCII characters are used, for these comparing bytes is the same
+/// as comparing characters, also with illegal bytes and when ignoring case.
+static void nfa_get_regmust(nfa_regprog_T *prog, const int *postfix, const int *end)
+{
+  prog->nregmust = 0;
+
+  nfa_lit_T *stack = xmalloc((size_t)(end - postfix + 1) * sizeof(*stack));
+  int sp = 0;
+
+#define NEED(n) \
+  if (sp < (n)) { \
+    goto theend; \
+  }
+
+  for (const int *p = postfix; p < end; p++) {
+    switch (*p) {
+    case NFA_NEWL:
+      // A match may continue in the next line, which is not checked.
+      goto theend;
+
+    case NFA_CONCAT:
+      NEED(2);
+      sp--;
+      nfa_lit_concat(&stack[sp - 1], &stack[sp]);
+      break;
+
+    case NFA_OR:
+      NEED(2);
+      sp--;
+      nfa_lit_or(&stack[sp - 1], &stack[sp]);
+      break;
+
+    case NFA_OPT_CHARS: {
+      int n = *++p;
+      NEED(n);
+      sp -= n;
+      nfa_lit_unknown(&stack[sp++]);
+      break;
+    }
+
+    case NFA_RANGE:
+      NEED(2);
+      sp--;
+      nfa_lit_unknown(&stack[sp - 1]);
+      break;
+
+    case NFA_STAR:
+    case NFA_STAR_NONGREEDY:
+    case NFA_QUEST:
+    case NFA_QUEST_NONGREEDY:
+    case NFA_END_COLL:
+    case NFA_END_NEG_COLL:
+      NEED(1);
+      nfa_lit_unknown(&stack[sp - 1]);
+      break;
+
+    case NFA_PREV_ATOM_JUST_BEFORE:
+    case NFA_PREV_ATOM_JUST_BEFORE_NEG:
+      p++;  // skip the count
+      FALLTHROUGH;
+    case NFA_PREV_ATOM_NO_WIDTH:
+    case NFA_PREV_ATOM_NO_WIDTH_NEG:
+      // Zero-width, the text it looks at may be outside of the match.
+      NEED(1);
+      nfa_lit_exact(&stack[sp - 1], "");
+      break;
+
+    case NFA_PREV_ATOM_LIKE_PATTERN:
+      // Matches the same text as the atom.
+      NEED(1);
+      break;
+
+    case NFA_COMPOSING:
+      if (sp == 0) {
+        sp++;
+      }
+      nfa_lit_unknown(&stack[sp - 1]);
+      break;
+
+    case NFA_MOPEN:
+    case NFA_MOPEN1:
+    case NFA_MOPEN2:
+    case NFA_MOPEN3:
+    case NFA_MOPEN4:
+    case NFA_MOPEN5:
+    case NFA_MOPEN6:
+    case NFA_MOPEN7:
+    case NFA_MOPEN8:
+    case NFA_MOPEN9:
+    case NFA_ZOPEN:
+    case NFA_ZOPEN1:
+    case NFA_ZOPEN2:
+    case NFA_ZOPEN3:
+    case NFA_ZOPEN4:
+    case NFA_ZOPEN5:
+    case NFA_ZOPEN6:
+    case NFA_ZOPEN7:
+    case NFA_ZOPEN8:
+    case NFA_ZOPEN9:
+    case NFA_NOPEN:
+      // Like post2nfa(): with an empty stack this is an empty group.
+      if (sp == 0) {
+        nfa_lit_exact(&stack[sp++], "");
+      }
+      break;
+
+    case NFA_LNUM:
+    case NFA_LNUM_GT:
+    case NFA_LNUM_LT:
+    case NFA_VCOL:
+    case NFA_VCOL_GT:
+    case NFA_VCOL_LT:
+    case NFA_COL:
+    case NFA_COL_GT:
+    case NFA_COL_LT:
+    case NFA_MARK:
+    case NFA_MARK_GT:
+    case NFA_MARK_LT:
+      p++;  // skip the lnum, col or mark name
+      FALLTHROUGH;
+    case NFA_EMPTY:
+    case NFA_BOL:
+    case NFA_EOL:
+    case NFA_BOW:
+    case NFA_EOW:
+    case NFA_BOF:
+    case NFA_EOF:
+    case NFA_ZSTART:
+    case NFA_ZEND:
+    case NFA_CURSOR:
+    case NFA_VISUAL:
+      nfa_lit_exact(&stack[sp++], "");
+      break;
+
+    default:
+      if (*p > 0 && *p < 0x80) {
+        char str[2] = { (char)(*p), NUL };
+        nfa_lit_exact(&stack[sp++], str);
+      } else {
+        nfa_lit_unknown(&stack[sp++]);
+      }
+      break;
+    }
+  }
+#undef NEED
+
+  // A single character is already handled by "regstart".
+  if (sp == 1 && stack[0].nmust > 0 && nfa_lit_shortest(stack[0].must, stack[0].nmust) >= 2) {
+    prog->nregmust = stack[0].nmust;
+    for (int i = 0; i < prog->nregmust; i++) {
+      prog->regmust[i] = (uint8_t *)xstrdup(stack[0].must[i]);
+    }
+  }
+
+theend:
+  xfree(stack);
+}
+
+// Allocate more space for post_start.  Called when
+// running above the estimated number of states.
+static void realloc_post_list(void)
+{
+  // For weird patterns the number of states can be very high. Increasing by
+  // 50% seems a reasonable compromise between memory use and speed.
+  const size_t new_max = (size_t)(post_end - post_start) * 3 / 2;
+  int *new_start = xrealloc(post_start, new_max * sizeof(int));
+  post_ptr = new_start + (post_ptr - post_start);
+  post_end = new_start + new_max;
+  post_start = new_start;
+}
+
+// Search between "start" and "end" and try to recognize a
+// character class in expanded form. For example [0-9].
+// On success, return the id the character class to be emitted.
+// On failure, return 0 (=FAIL)
+// Start points to the first char of the range, while end should point
+// to the closing brace.
+// Keep in mind that 'ignorecase' applies at execution time, thus [a-z] may
+// need to be interpreted as [a-zA-Z].
+static int nfa_recognize_char_class(uint8_t *start, const uint8_t *end, int extra_newl)
+{
+#define CLASS_not            0x80
+#define CLASS_af             0x40
+#define CLASS_AF             0x20
+#define CLASS_az             0x10
+#define CLASS_AZ             0x08
+#define CLASS_o7             0x04
+#define CLASS_o9             0x02
+#define CLASS_underscore     0x01
+
+  uint8_t *p;
+  int config = 0;
+
+  bool newl = extra_newl == true;
+
+  if (*end != ']') {
+    return FAIL;
+  }
+  p = start;
+  if (*p == '^') {
+    config |= CLASS_not;
+    p++;
+  }
+
+  while (p < end) {
+    if (p + 2 < end && *(p + 1) == '-') {
+      switch (*p) {
+      case '0':
+        if (*(p + 2) == '9') {
+          config |= CLASS_o9;
+          break;
+        } else if (*(p + 2) == '7') {
+          config |= CLASS_o7;
+          break;
+        }
+        return FAIL;
+      case 'a':
+        if (*(p + 2) == 'z') {
+          config |= CLASS_az;
+          break;
+        } else if (*(p + 2) == 'f') {
+          config |= CLASS_af;
+          break;
+        }
+        return FAIL;
+      case 'A':
+        if (*(p + 2) == 'Z') {
+          config |= CLASS_AZ;
+          break;
+        } else if (*(p + 2) == 'F') {
+          config |= CLASS_AF;
+          break;
+        }
+        return FAIL;
+      default:
+        return FAIL;
       }
       p += 3;
     } else if (p + 1 < end && *p == '\\' && *(p + 1) == 'n') {
@@ -10164,7 +10819,7 @@ static int nfa_regatom(void)
       return FAIL;
     }
     EMIT(NFA_BACKREF1 + refnum);
-    rex.nfa_has_backref = true;
+    nfa_has_backref = true;
   }
   break;
 
@@ -10179,7 +10834,7 @@ static int nfa_regatom(void)
       break;
     case 'e':
       EMIT(NFA_ZEND);
-      rex.nfa_has_zend = true;
+      nfa_has_zend = true;
       if (!re_mult_next("\\ze")) {
         return false;
       }
@@ -10198,7 +10853,7 @@ static int nfa_regatom(void)
         EMSG_RET_FAIL(_(e_z1_not_allowed));
       }
       EMIT(NFA_ZREF1 + (no_Magic(c) - '1'));
-      // No need to set rex.nfa_has_backref, the sub-matches don't
+      // No need to set nfa_has_backref, the sub-matches don't
       // change when \z1 .. \z9 matches or not.
       re_has_z = REX_USE;
       break;
@@ -10267,10 +10922,12 @@ static int nfa_regatom(void)
     // pattern -- regardless of whether or not it makes sense.
     case '^':
       EMIT(NFA_BOF);
+      regflags |= RF_HASPOS;
       break;
 
     case '$':
       EMIT(NFA_EOF);
+      regflags |= RF_HASPOS;
       break;
 
     case '#':
@@ -10281,10 +10938,12 @@ static int nfa_regatom(void)
         return FAIL;
       }
       EMIT(NFA_CURSOR);
+      regflags |= RF_HASPOS;
       break;
 
     case 'V':
       EMIT(NFA_VISUAL);
+      regflags |= RF_HASPOS;
       break;
 
     case 'C':
@@ -10357,6 +11016,7 @@ static int nfa_regatom(void)
           semsg(_(e_nfa_regexp_missing_value_in_chr), no_Magic(c));
           return FAIL;
         }
+        regflags |= RF_HASPOS;
         if (c == 'l') {
           if (cur) {
             n = curwin->w_cursor.lnum;
@@ -10396,6 +11056,7 @@ static int nfa_regatom(void)
         // \%'m  \%<'m  \%>'m
         EMIT(cmp == '<' ? NFA_MARK_LT
                         : cmp == '>' ? NFA_MARK_GT : NFA_MARK);
+        regflags |= RF_HASPOS;
         EMIT(getchr());
         break;
       }
@@ -10858,6 +11519,7 @@ static int nfa_regpiece(void)
     if (i == NFA_PREV_ATOM_JUST_BEFORE
         || i == NFA_PREV_ATOM_JUST_BEFORE_NEG) {
       EMIT((int)c2);
+      regflags |= RF_LOOKBH;
     }
     break;
 
@@ -11628,6 +12290,9 @@ static void nfa_dump(nfa_regprog_T *prog)
   if (prog->match_text != NULL) {
     fprintf(debugf, "match_text: \"%s\"\n", prog->match_text);
   }
+  for (int i = 0; i < prog->nregmust; i++) {
+    fprintf(debugf, "regmust: \"%s\"\n", prog->regmust[i]);
+  }
 
   fclose(debugf);
 }
@@ -11670,8 +12335,6 @@ static nfa_state_T *alloc_state(int c, nfa_state_T *out, nfa_state_T *out1)
   s->val = 0;
 
   s->id = istate;
-  s->lastlist[0] = 0;
-  s->lastlist[1] = 0;
 
   return s;
 }
@@ -12581,7 +13244,7 @@ static void nfa_postprocess(nfa_regprog_T *prog)
 static void log_subsexpr(regsubs_T *subs)
 {
   log_subexpr(&subs->norm);
-  if (rex.nfa_has_zsubexpr) {
+  if (rex->nfa_has_zsubexpr) {
     log_subexpr(&subs->synt);
   }
 }
@@ -12620,26 +13283,20 @@ static char *pim_info(const nfa_pim_T *pim)
     snprintf(buf, sizeof(buf), " PIM col %d",
              REG_MULTI
              ? (int)pim->end.pos.col
-             : (int)(pim->end.ptr - rex.input));
+             : (int)(pim->end.ptr - rex->input));
   }
   return buf;
 }
 
 #endif
 
-// Used during execution: whether a match has been found.
-static int nfa_match;
-static proftime_T *nfa_time_limit;
-static int *nfa_timed_out;
-static int nfa_time_count;
-
 // Copy postponed invisible match info from "from" to "to".
 static void copy_pim(nfa_pim_T *to, nfa_pim_T *from)
 {
   to->result = from->result;
   to->state = from->state;
   copy_sub(&to->subs.norm, &from->subs.norm);
-  if (rex.nfa_has_zsubexpr) {
+  if (rex->nfa_has_zsubexpr) {
     copy_sub(&to->subs.synt, &from->subs.synt);
   }
   to->end = from->end;
@@ -12649,9 +13306,9 @@ static void clear_sub(regsub_T *sub)
 {
   if (REG_MULTI) {
     // Use 0xff to set lnum to -1
-    memset(sub->list.multi, 0xff, sizeof(struct multipos) * (size_t)rex.nfa_nsubexpr);
+    memset(sub->list.multi, 0xff, sizeof(struct multipos) * (size_t)rex->nfa_nsubexpr);
   } else {
-    memset(sub->list.line, 0, sizeof(struct linepos) * (size_t)rex.nfa_nsubexpr);
+    memset(sub->list.line, 0, sizeof(struct linepos) * (size_t)rex->nfa_nsubexpr);
   }
   sub->in_use = 0;
 }
@@ -12698,7 +13355,7 @@ static void copy_sub_off(regsub_T *to, regsub_T *from)
 // Like copy_sub() but only do the end of the main match if \ze is present.
 static void copy_ze_off(regsub_T *to, regsub_T *from)
 {
-  if (!rex.nfa_has_zend) {
+  if (!rex->nfa_has_zend) {
     return;
   }
 
@@ -12745,7 +13402,7 @@ static bool sub_equal(regsub_T *sub1, regsub_T *sub2)
           != sub2->list.multi[i].start_col) {
         return false;
       }
-      if (rex.nfa_has_backref) {
+      if (rex->nfa_has_backref) {
         if (i < sub1->in_use) {
           s1 = sub1->list.multi[i].end_lnum;
         } else {
@@ -12780,7 +13437,7 @@ static bool sub_equal(regsub_T *sub1, regsub_T *sub2)
       if (sp1 != sp2) {
         return false;
       }
-      if (rex.nfa_has_backref) {
+      if (rex->nfa_has_backref) {
         if (i < sub1->in_use) {
           sp1 = sub1->list.line[i].end;
         } else {
@@ -12825,7 +13482,7 @@ static void report_state(char *action, regsub_T *sub, nfa_state_T *state, int li
   } else if (REG_MULTI) {
     col = sub->list.multi[0].start_col;
   } else {
-    col = (int)(sub->list.line[0].start - rex.line);
+    col = (int)(sub->list.line[0].start - rex->line);
   }
   nfa_set_code(state->c);
   if (log_fd == NULL) {
@@ -12852,7 +13509,7 @@ static bool has_state_with_pos(nfa_list_T *l, nfa_state_T *state, regsubs_T *sub
     nfa_thread_T *thread = &l->t[i];
     if (thread->state->id == state->id
         && sub_equal(&thread->subs.norm, &subs->norm)
-        && (!rex.nfa_has_zsubexpr
+        && (!rex->nfa_has_zsubexpr
             || sub_equal(&thread->subs.synt, &subs->synt))
         && pim_equal(&thread->pim, pim)) {
       return true;
@@ -12984,8 +13641,8 @@ static bool match_follows(const nfa_state_T *startstate, int depth)
 static bool state_in_list(nfa_list_T *l, nfa_state_T *state, regsubs_T *subs)
   FUNC_ATTR_NONNULL_ALL
 {
-  if (state->lastlist[nfa_ll_index] == l->id) {
-    if (!rex.nfa_has_backref || has_state_with_pos(l, state, subs, NULL)) {
+  if (rex->nfa_lastlist[rex->nfa_ll_index][state->id] == l->id) {
+    if (!rex->nfa_has_backref || has_state_with_pos(l, state, subs, NULL)) {
       return true;
     }
   }
@@ -13022,16 +13679,15 @@ static regsubs_T *addstate(nfa_list_T *l, nfa_state_T *state, regsubs_T *subs_ar
   int i;
   regsub_T *sub;
   regsubs_T *subs = subs_arg;
-  static regsubs_T temp_subs;
+  regsubs_T *const temp_subs = &rex->nfa_temp_subs;
 #ifdef REGEXP_DEBUG
   int did_print = false;
 #endif
-  static int depth = 0;
 
   // This function is called recursively.  When the depth is too much we run
   // out of stack and crash, limit recursiveness here.
-  if (++depth >= 5000 || subs == NULL) {
-    depth--;
+  if (++rex->nfa_addstate_depth >= 5000 || subs == NULL) {
+    rex->nfa_addstate_depth--;
     return NULL;
   }
 
@@ -13076,11 +13732,11 @@ static regsubs_T *addstate(nfa_list_T *l, nfa_state_T *state, regsubs_T *subs_ar
     // "^" won't match past end-of-line, don't bother trying.
     // Except when at the end of the line, or when we are going to the
     // next line for a look-behind match.
-    if (rex.input > rex.line
-        && *rex.input != NUL
-        && (nfa_endp == NULL
+    if (rex->input > rex->line
+        && *rex->input != NUL
+        && (rex->nfa_endp == NULL
             || !REG_MULTI
-            || rex.lnum == nfa_endp->se_u.pos.lnum)) {
+            || rex->lnum == rex->nfa_endp->se_u.pos.lnum)) {
       goto skip_add;
     }
     FALLTHROUGH;
@@ -13111,12 +13767,12 @@ static regsubs_T *addstate(nfa_list_T *l, nfa_state_T *state, regsubs_T *subs_ar
   // endless loop for "\(\)*"
 
   default:
-    if (state->lastlist[nfa_ll_index] == l->id && state->c != NFA_SKIP) {
+    if (rex->nfa_lastlist[rex->nfa_ll_index][state->id] == l->id && state->c != NFA_SKIP) {
       // This state is already in the list, don't add it again,
       // unless it is an MOPEN that is used for a backreference or
       // when there is a PIM. For NFA_MATCH check the position,
       // lower position is preferred.
-      if (!rex.nfa_has_backref && pim == NULL && !l->has_pim
+      if (!rex->nfa_has_backref && pim == NULL && !l->has_pim
           && state->c != NFA_MATCH) {
         // When called from addstate_here() do insert before
         // existing states.
@@ -13138,7 +13794,7 @@ skip_add:
                   abs(state->id), l->id, state->c, code,
                   pim == NULL ? "NULL" : "yes", l->has_pim, found);
 #endif
-          depth--;
+          rex->nfa_addstate_depth--;
           return subs;
         }
       }
@@ -13157,18 +13813,18 @@ skip_add:
       const size_t newsize = (size_t)newlen * sizeof(nfa_thread_T);
 
       if ((int64_t)(newsize >> 10) >= p_mmp) {
-        emsg(_(e_pattern_uses_more_memory_than_maxmempattern));
-        depth--;
+        reg_toobig();
+        rex->nfa_addstate_depth--;
         return NULL;
       }
-      if (subs != &temp_subs) {
+      if (subs != temp_subs) {
         // "subs" may point into the current array, need to make a
         // copy before it becomes invalid.
-        copy_sub(&temp_subs.norm, &subs->norm);
-        if (rex.nfa_has_zsubexpr) {
-          copy_sub(&temp_subs.synt, &subs->synt);
+        copy_sub(&temp_subs->norm, &subs->norm);
+        if (rex->nfa_has_zsubexpr) {
+          copy_sub(&temp_subs->synt, &subs->synt);
         }
-        subs = &temp_subs;
+        subs = temp_subs;
       }
 
       nfa_thread_T *const newt = xrealloc(l->t, newsize);
@@ -13177,7 +13833,7 @@ skip_add:
     }
 
     // add the state to the list
-    state->lastlist[nfa_ll_index] = l->id;
+    rex->nfa_lastlist[rex->nfa_ll_index][state->id] = l->id;
     thread = &l->t[l->n++];
     thread->state = state;
     if (pim == NULL) {
@@ -13187,7 +13843,7 @@ skip_add:
       l->has_pim = true;
     }
     copy_sub(&thread->subs.norm, &subs->norm);
-    if (rex.nfa_has_zsubexpr) {
+    if (rex->nfa_has_zsubexpr) {
       copy_sub(&thread->subs.synt, &subs->synt);
     }
 #ifdef REGEXP_DEBUG
@@ -13268,12 +13924,12 @@ skip_add:
         sub->in_use = subidx + 1;
       }
       if (off == -1) {
-        sub->list.multi[subidx].start_lnum = rex.lnum + 1;
+        sub->list.multi[subidx].start_lnum = rex->lnum + 1;
         sub->list.multi[subidx].start_col = 0;
       } else {
-        sub->list.multi[subidx].start_lnum = rex.lnum;
+        sub->list.multi[subidx].start_lnum = rex->lnum;
         sub->list.multi[subidx].start_col =
-          (colnr_T)(rex.input - rex.line + off);
+          (colnr_T)(rex->input - rex->line + off);
       }
       sub->list.multi[subidx].end_lnum = -1;
     } else {
@@ -13288,7 +13944,7 @@ skip_add:
         }
         sub->in_use = subidx + 1;
       }
-      sub->list.line[subidx].start = rex.input + off;
+      sub->list.line[subidx].start = rex->input + off;
     }
 
     subs = addstate(l, state->out, subs, pim, off_arg);
@@ -13314,7 +13970,7 @@ skip_add:
     break;
 
   case NFA_MCLOSE:
-    if (rex.nfa_has_zend
+    if (rex->nfa_has_zend
         && (REG_MULTI
             ? subs->norm.list.multi[0].end_lnum >= 0
             : subs->norm.list.line[0].end != NULL)) {
@@ -13363,18 +14019,18 @@ skip_add:
     if (REG_MULTI) {
       save_multipos = sub->list.multi[subidx];
       if (off == -1) {
-        sub->list.multi[subidx].end_lnum = rex.lnum + 1;
+        sub->list.multi[subidx].end_lnum = rex->lnum + 1;
         sub->list.multi[subidx].end_col = 0;
       } else {
-        sub->list.multi[subidx].end_lnum = rex.lnum;
+        sub->list.multi[subidx].end_lnum = rex->lnum;
         sub->list.multi[subidx].end_col =
-          (colnr_T)(rex.input - rex.line + off);
+          (colnr_T)(rex->input - rex->line + off);
       }
       // avoid compiler warnings
       save_ptr = NULL;
     } else {
       save_ptr = sub->list.line[subidx].end;
-      sub->list.line[subidx].end = rex.input + off;
+      sub->list.line[subidx].end = rex->input + off;
       // avoid compiler warnings
       CLEAR_FIELD(save_multipos);
     }
@@ -13398,7 +14054,7 @@ skip_add:
     sub->in_use = save_in_use;
     break;
   }
-  depth--;
+  rex->nfa_addstate_depth--;
   return subs;
 }
 
@@ -13448,7 +14104,7 @@ static regsubs_T *addstate_here(nfa_list_T *l, nfa_state_T *state, regsubs_T *su
       const size_t newsize = (size_t)newlen * sizeof(nfa_thread_T);
 
       if ((int64_t)(newsize >> 10) >= p_mmp) {
-        emsg(_(e_pattern_uses_more_memory_than_maxmempattern));
+        reg_toobig();
         return NULL;
       }
       nfa_thread_T *const newl = xmalloc(newsize);
@@ -13611,12 +14267,12 @@ retempty:
         || sub->list.multi[subidx].end_lnum < 0) {
       goto retempty;
     }
-    if (sub->list.multi[subidx].start_lnum == rex.lnum
-        && sub->list.multi[subidx].end_lnum == rex.lnum) {
+    if (sub->list.multi[subidx].start_lnum == rex->lnum
+        && sub->list.multi[subidx].end_lnum == rex->lnum) {
       len = sub->list.multi[subidx].end_col
             - sub->list.multi[subidx].start_col;
-      if (cstrncmp((char *)rex.line + sub->list.multi[subidx].start_col,
-                   (char *)rex.input, &len) == 0) {
+      if (cstrncmp((char *)rex->line + sub->list.multi[subidx].start_col,
+                   (char *)rex->input, &len) == 0) {
         *bytelen = len;
         return true;
       }
@@ -13635,7 +14291,7 @@ retempty:
       goto retempty;
     }
     len = (int)(sub->list.line[subidx].end - sub->list.line[subidx].start);
-    if (cstrncmp((char *)sub->list.line[subidx].start, (char *)rex.input, &len) == 0) {
+    if (cstrncmp((char *)sub->list.line[subidx].start, (char *)rex->input, &len) == 0) {
       *bytelen = len;
       return true;
     }
@@ -13660,7 +14316,7 @@ static int match_zref(int subidx, int *bytelen)
   }
 
   len = (int)strlen((char *)re_extmatch_in->matches[subidx]);
-  if (cstrncmp((char *)re_extmatch_in->matches[subidx], (char *)rex.input, &len) == 0) {
+  if (cstrncmp((char *)re_extmatch_in->matches[subidx], (char *)rex->input, &len) == 0) {
     *bytelen = len;
     return true;
   }
@@ -13669,32 +14325,17 @@ static int match_zref(int subidx, int *bytelen)
 
 // Save list IDs for all NFA states of "prog" into "list".
 // Also reset the IDs to zero.
-// Only used for the recursive value lastlist[1].
+// Only used for the recursive value nfa_lastlist[1].
 static void nfa_save_listids(nfa_regprog_T *prog, int *list)
 {
-  int i;
-  nfa_state_T *p;
-
-  // Order in the list is reverse, it's a bit faster that way.
-  p = &prog->state[0];
-  for (i = prog->nstate; --i >= 0;) {
-    list[i] = p->lastlist[1];
-    p->lastlist[1] = 0;
-    p++;
-  }
+  memcpy(list, rex->nfa_lastlist[1], (size_t)prog->nstate * sizeof(*list));
+  memset(rex->nfa_lastlist[1], 0, (size_t)prog->nstate * sizeof(*list));
 }
 
 // Restore list IDs from "list" to all NFA states.
 static void nfa_restore_listids(nfa_regprog_T *prog, const int *list)
 {
-  int i;
-  nfa_state_T *p;
-
-  p = &prog->state[0];
-  for (i = prog->nstate; --i >= 0;) {
-    p->lastlist[1] = list[i];
-    p++;
-  }
+  memcpy(rex->nfa_lastlist[1], list, (size_t)prog->nstate * sizeof(*list));
 }
 
 static bool nfa_re_num_cmp(uintmax_t val, int op, uintmax_t pos)
@@ -13715,11 +14356,11 @@ static int recursive_regmatch(nfa_state_T *state, nfa_pim_T *pim, nfa_regprog_T
                               regsubs_T *submatch, regsubs_T *m, int **listids, int *listids_len)
   FUNC_ATTR_NONNULL_ARG(1, 3, 5, 6, 7)
 {
-  const int save_reginput_col = (int)(rex.input - rex.line);
-  const int save_reglnum = rex.lnum;
-  const int save_nfa_match = nfa_match;
-  const int save_nfa_listid = rex.nfa_listid;
-  save_se_T *const save_nfa_endp = nfa_endp;
+  const int save_reginput_col = (int)(rex->input - rex->line);
+  const int save_reglnum = rex->lnum;
+  const int save_nfa_match = rex->nfa_match;
+  const int save_nfa_listid = rex->nfa_listid;
+  save_se_T *const save_nfa_endp = rex->nfa_endp;
   save_se_T endpos;
   save_se_T *endposp = NULL;
   int need_restore = false;
@@ -13727,9 +14368,9 @@ static int recursive_regmatch(nfa_state_T *state, nfa_pim_T *pim, nfa_regprog_T
   if (pim != NULL) {
     // start at the position where the postponed match was
     if (REG_MULTI) {
-      rex.input = rex.line + pim->end.pos.col;
+      rex->input = rex->line + pim->end.pos.col;
     } else {
-      rex.input = pim->end.ptr;
+      rex->input = pim->end.ptr;
     }
   }
 
@@ -13742,14 +14383,14 @@ static int recursive_regmatch(nfa_state_T *state, nfa_pim_T *pim, nfa_regprog_T
     endposp = &endpos;
     if (REG_MULTI) {
       if (pim == NULL) {
-        endpos.se_u.pos.col = (int)(rex.input - rex.line);
-        endpos.se_u.pos.lnum = rex.lnum;
+        endpos.se_u.pos.col = (int)(rex->input - rex->line);
+        endpos.se_u.pos.lnum = rex->lnum;
       } else {
         endpos.se_u.pos = pim->end.pos;
       }
     } else {
       if (pim == NULL) {
-        endpos.se_u.ptr = rex.input;
+        endpos.se_u.ptr = rex->input;
       } else {
         endpos.se_u.ptr = pim->end.ptr;
       }
@@ -13761,31 +14402,31 @@ static int recursive_regmatch(nfa_state_T *state, nfa_pim_T *pim, nfa_regprog_T
     // bytes if possible.
     if (state->val <= 0) {
       if (REG_MULTI) {
-        rex.line = (uint8_t *)reg_getline(--rex.lnum);
-        if (rex.line == NULL) {
+        rex->line = (uint8_t *)reg_getline(--rex->lnum);
+        if (rex->line == NULL) {
           // can't go before the first line
-          rex.line = (uint8_t *)reg_getline(++rex.lnum);
+          rex->line = (uint8_t *)reg_getline(++rex->lnum);
         }
       }
-      rex.input = rex.line;
+      rex->input = rex->line;
     } else {
-      if (REG_MULTI && (int)(rex.input - rex.line) < state->val) {
+      if (REG_MULTI && (int)(rex->input - rex->line) < state->val) {
         // Not enough bytes in this line, go to end of
         // previous line.
-        rex.line = (uint8_t *)reg_getline(--rex.lnum);
-        if (rex.line == NULL) {
+        rex->line = (uint8_t *)reg_getline(--rex->lnum);
+        if (rex->line == NULL) {
           // can't go before the first line
-          rex.line = (uint8_t *)reg_getline(++rex.lnum);
-          rex.input = rex.line;
+          rex->line = (uint8_t *)reg_getline(++rex->lnum);
+          rex->input = rex->line;
         } else {
-          rex.input = rex.line + reg_getline_len(rex.lnum);
+          rex->input = rex->line + reg_getline_len(rex->lnum);
         }
       }
-      if ((int)(rex.input - rex.line) >= state->val) {
-        rex.input -= state->val;
-        rex.input -= utf_head_off((char *)rex.line, (char *)rex.input);
+      if ((int)(rex->input - rex->line) >= state->val) {
+        rex->input -= state->val;
+        rex->input -= utf_head_off((char *)rex->line, (char *)rex->input);
       } else {
-        rex.input = rex.line;
+        rex->input = rex->line;
       }
     }
   }
@@ -13796,11 +14437,11 @@ static int recursive_regmatch(nfa_state_T *state, nfa_pim_T *pim, nfa_regprog_T
   }
   log_fd = NULL;
 #endif
-  // Have to clear the lastlist field of the NFA nodes, so that
+  // Have to clear "nfa_lastlist" for the NFA nodes, so that
   // nfa_regmatch() and addstate() can run properly after recursion.
-  if (nfa_ll_index == 1) {
-    // Already calling nfa_regmatch() recursively.  Save the lastlist[1]
-    // values and clear them.
+  if (rex->nfa_ll_index == 1) {
+    // Already calling nfa_regmatch() recursively.  Save the
+    // nfa_lastlist[1] values and clear them.
     if (*listids == NULL || *listids_len < prog->nstate) {
       xfree(*listids);
       *listids = xmalloc(sizeof(**listids) * (size_t)prog->nstate);
@@ -13808,40 +14449,40 @@ static int recursive_regmatch(nfa_state_T *state, nfa_pim_T *pim, nfa_regprog_T
     }
     nfa_save_listids(prog, *listids);
     need_restore = true;
-    // any value of rex.nfa_listid will do
+    // any value of rex->nfa_listid will do
   } else {
-    // First recursive nfa_regmatch() call, switch to the second lastlist
-    // entry.  Make sure rex.nfa_listid is different from a previous
-    // recursive call, because some states may still have this ID.
-    nfa_ll_index++;
-    if (rex.nfa_listid <= rex.nfa_alt_listid) {
-      rex.nfa_listid = rex.nfa_alt_listid;
+    // First recursive nfa_regmatch() call, switch to nfa_lastlist[1].
+    // Make sure rex->nfa_listid is different from a previous recursive
+    // call, because some states may still have this ID.
+    rex->nfa_ll_index++;
+    if (rex->nfa_listid <= rex->nfa_alt_listid) {
+      rex->nfa_listid = rex->nfa_alt_listid;
     }
   }
 
   // Call nfa_regmatch() to check if the current concat matches at this
   // position. The concat ends with the node NFA_END_INVISIBLE
-  nfa_endp = endposp;
+  rex->nfa_endp = endposp;
   const int result = nfa_regmatch(prog, state->out, submatch, m);
 
   if (need_restore) {
     nfa_restore_listids(prog, *listids);
   } else {
-    nfa_ll_index--;
-    rex.nfa_alt_listid = rex.nfa_listid;
+    rex->nfa_ll_index--;
+    rex->nfa_alt_listid = rex->nfa_listid;
   }
 
   // restore position in input text
-  rex.lnum = save_reglnum;
+  rex->lnum = save_reglnum;
   if (REG_MULTI) {
-    rex.line = (uint8_t *)reg_getline(rex.lnum);
+    rex->line = (uint8_t *)reg_getline(rex->lnum);
   }
-  rex.input = rex.line + save_reginput_col;
+  rex->input = rex->line + save_reginput_col;
   if (result != NFA_TOO_EXPENSIVE) {
-    nfa_match = save_nfa_match;
-    rex.nfa_listid = save_nfa_listid;
+    rex->nfa_match = save_nfa_match;
+    rex->nfa_listid = save_nfa_listid;
   }
-  nfa_endp = save_nfa_endp;
+  rex->nfa_endp = save_nfa_endp;
 
 #ifdef REGEXP_DEBUG
   open_debug_log(result);
@@ -14011,11 +14652,11 @@ static int failure_chance(nfa_state_T *state, int depth)
 // Skip until the char "c" we know a match must start with.
 static int skip_to_start(int c, colnr_T *colp)
 {
-  const uint8_t *const s = (uint8_t *)cstrchr((char *)rex.line + *colp, c);
+  const uint8_t *const s = (uint8_t *)cstrchr((char *)rex->line + *colp, c);
   if (s == NULL) {
     return FAIL;
   }
-  *colp = (int)(s - rex.line);
+  *colp = (int)(s - rex->line);
   return OK;
 }
 
@@ -14032,18 +14673,18 @@ static int find_match_text(colnr_T *startcol, int regstart, uint8_t *match_text)
     uint8_t *s1 = match_text;
     // skip regstart
     int regstart_len2 = regstart_len;
-    if (regstart_len2 > 1 && utf_ptr2len((char *)rex.line + col) != regstart_len2) {
+    if (regstart_len2 > 1 && utf_ptr2len((char *)rex->line + col) != regstart_len2) {
       // because of case-folding of the previously matched text, we may need
       // to skip fewer bytes than utf_char2len(regstart)
       regstart_len2 = utf_char2len(utf_fold(regstart));
     }
-    uint8_t *s2 = rex.line + col + regstart_len2;
+    uint8_t *s2 = rex->line + col + regstart_len2;
     while (*s1) {
       int c1_len = utf_ptr2len((char *)s1);
       int c1 = utf_ptr2char((char *)s1);
       int c2_len = utf_ptr2len((char *)s2);
       int c2 = utf_ptr2char((char *)s2);
-      if (c1 != c2 && (!rex.reg_ic || utf_fold(c1) != utf_fold(c2))) {
+      if (c1 != c2 && (!rex->reg_ic || utf_fold(c1) != utf_fold(c2))) {
         match = false;
         break;
       }
@@ -14055,13 +14696,13 @@ static int find_match_text(colnr_T *startcol, int regstart, uint8_t *match_text)
         && !utf_iscomposing_legacy(utf_ptr2char((char *)s2))) {
       cleanup_subexpr();
       if (REG_MULTI) {
-        rex.reg_startpos[0].lnum = rex.lnum;
-        rex.reg_startpos[0].col = col;
-        rex.reg_endpos[0].lnum = rex.lnum;
-        rex.reg_endpos[0].col = (colnr_T)(s2 - rex.line);
+        rex->reg_startpos[0].lnum = rex->lnum;
+        rex->reg_startpos[0].col = col;
+        rex->reg_endpos[0].lnum = rex->lnum;
+        rex->reg_endpos[0].col = (colnr_T)(s2 - rex->line);
       } else {
-        rex.reg_startp[0] = rex.line + col;
-        rex.reg_endp[0] = s2;
+        rex->reg_startp[0] = rex->line + col;
+        rex->reg_endp[0] = s2;
       }
       *startcol = col;
       return 1L;
@@ -14080,9 +14721,9 @@ static int find_match_text(colnr_T *startcol, int regstart, uint8_t *match_text)
 
 static int nfa_did_time_out(void)
 {
-  if (nfa_time_limit != NULL && profile_passed_limit(*nfa_time_limit)) {
-    if (nfa_timed_out != NULL) {
-      *nfa_timed_out = true;
+  if (rex->nfa_time_limit != NULL && profile_passed_limit(*rex->nfa_time_limit)) {
+    if (rex->nfa_timed_out != NULL) {
+      *rex->nfa_timed_out = true;
     }
     return true;
   }
@@ -14091,7 +14732,26 @@ static int nfa_did_time_out(void)
 
 /// Main matching routine.
 ///
-/// Run NFA to determine whether it matches rex.input.
+/// Get the two thread lists for a call to nfa_regmatch(), each with room for
+/// at least "len" threads.  They are used until "rex->nfa_depth" is
+/// decremented.
+static nfa_list_T *nfa_lists_get(int len)
+{
+  if (rex->nfa_depth == rex->nfa_lists.ga_len) {
+    GA_APPEND(nfa_list_T *, &rex->nfa_lists, xcalloc(2, sizeof(nfa_list_T)));
+  }
+  nfa_list_T *list = ((nfa_list_T **)rex->nfa_lists.ga_data)[rex->nfa_depth++];
+  for (int i = 0; i < 2; i++) {
+    if (list[i].len < len) {
+      xfree(list[i].t);
+      list[i].t = xmalloc((size_t)len * sizeof(nfa_thread_T));
+      list[i].len = len;
+    }
+  }
+  return list;
+}
+
+/// Run NFA to determine whether it matches rex->input.
 ///
 /// When "nfa_endp" is not NULL it is a required end-of-match position.
 ///
@@ -14107,7 +14767,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
   int flag = 0;
   bool go_to_nextline = false;
   nfa_thread_T *t;
-  nfa_list_T list[2];
+  nfa_list_T *list;
   int listidx;
   nfa_list_T *thislist;
   nfa_list_T *nextlist;
@@ -14137,14 +14797,9 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
     return false;
   }
 #endif
-  nfa_match = false;
+  rex->nfa_match = false;
 
-  // Allocate memory for the lists of nodes.
-  size_t size = (size_t)(prog->nstate + 1) * sizeof(nfa_thread_T);
-  list[0].t = xmalloc(size);
-  list[0].len = prog->nstate + 1;
-  list[1].t = xmalloc(size);
-  list[1].len = prog->nstate + 1;
+  list = nfa_lists_get(prog->nstate + 1);
 
 #ifdef REGEXP_DEBUG
   log_fd = fopen(NFA_REGEXP_RUN_LOG, "a");
@@ -14168,17 +14823,17 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
 #ifdef REGEXP_DEBUG
   fprintf(log_fd, "(---) STARTSTATE first\n");
 #endif
-  thislist->id = rex.nfa_listid + 1;
+  thislist->id = rex->nfa_listid + 1;
 
   // Inline optimized code for addstate(thislist, start, m, 0) if we know
   // it's the first MOPEN.
   if (toplevel) {
     if (REG_MULTI) {
-      m->norm.list.multi[0].start_lnum = rex.lnum;
-      m->norm.list.multi[0].start_col = (colnr_T)(rex.input - rex.line);
+      m->norm.list.multi[0].start_lnum = rex->lnum;
+      m->norm.list.multi[0].start_col = (colnr_T)(rex->input - rex->line);
       m->norm.orig_start_col = m->norm.list.multi[0].start_col;
     } else {
-      m->norm.list.line[0].start = rex.input;
+      m->norm.list.line[0].start = rex->input;
     }
     m->norm.in_use = 1;
     r = addstate(thislist, start->out, m, NULL, 0);
@@ -14186,7 +14841,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
     r = addstate(thislist, start, m, NULL, 0);
   }
   if (r == NULL) {
-    nfa_match = NFA_TOO_EXPENSIVE;
+    rex->nfa_match = NFA_TOO_EXPENSIVE;
     goto theend;
   }
 
@@ -14198,8 +14853,8 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
 
   // Run for each character.
   while (true) {
-    int curc = utf_ptr2char((char *)rex.input);
-    int clen = utfc_ptr2len((char *)rex.input);
+    int curc = utf_ptr2char((char *)rex->input);
+    int clen = utfc_ptr2len((char *)rex->input);
     if (curc == NUL) {
       clen = 0;
       go_to_nextline = false;
@@ -14210,20 +14865,20 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
     nextlist = &list[flag ^= 1];
     nextlist->n = 0;                // clear nextlist
     nextlist->has_pim = false;
-    rex.nfa_listid++;
+    rex->nfa_listid++;
     if (prog->re_engine == AUTOMATIC_ENGINE
-        && (rex.nfa_listid >= NFA_MAX_STATES)) {
+        && (rex->nfa_listid >= NFA_MAX_STATES)) {
       // Too many states, retry with old engine.
-      nfa_match = NFA_TOO_EXPENSIVE;
+      rex->nfa_match = NFA_TOO_EXPENSIVE;
       goto theend;
     }
 
-    thislist->id = rex.nfa_listid;
-    nextlist->id = rex.nfa_listid + 1;
+    thislist->id = rex->nfa_listid;
+    nextlist->id = rex->nfa_listid + 1;
 
 #ifdef REGEXP_DEBUG
     fprintf(log_fd, "------------------------------------------\n");
-    fprintf(log_fd, ">>> Reginput is \"%s\"\n", rex.input);
+    fprintf(log_fd, ">>> Reginput is \"%s\"\n", rex->input);
     fprintf(log_fd,
             ">>> Advanced one character... Current char is %c (code %d) \n",
             curc,
@@ -14255,8 +14910,8 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
       if (got_int) {
         break;
       }
-      if (nfa_time_limit != NULL && ++nfa_time_count == 20) {
-        nfa_time_count = 0;
+      if (rex->nfa_time_limit != NULL && ++rex->nfa_time_count == 20) {
+        rex->nfa_time_count = 0;
         if (nfa_did_time_out()) {
           break;
         }
@@ -14276,7 +14931,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
         } else if (REG_MULTI) {
           col = t->subs.norm.list.multi[0].start_col;
         } else {
-          col = (int)(t->subs.norm.list.line[0].start - rex.line);
+          col = (int)(t->subs.norm.list.line[0].start - rex->line);
         }
         nfa_set_code(t->state->c);
         fprintf(log_fd, "(%d) char %d %s (start col %d)%s... \n",
@@ -14293,16 +14948,16 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
       switch (t->state->c) {
       case NFA_MATCH:
         // If the match is not at the start of the line, ends before a
-        // composing characters and rex.reg_icombine is not set, that
+        // composing characters and rex->reg_icombine is not set, that
         // is not really a match.
-        if (!rex.reg_icombine
-            && rex.input != rex.line
+        if (!rex->reg_icombine
+            && rex->input != rex->line
             && utf_iscomposing_legacy(curc)) {
           break;
         }
-        nfa_match = true;
+        rex->nfa_match = true;
         copy_sub(&submatch->norm, &t->subs.norm);
-        if (rex.nfa_has_zsubexpr) {
+        if (rex->nfa_has_zsubexpr) {
           copy_sub(&submatch->synt, &t->subs.synt);
         }
 #ifdef REGEXP_DEBUG
@@ -14310,7 +14965,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
 #endif
         // Found the left-most longest match, do not look at any other
         // states at this position.  When the list of states is going
-        // to be empty quit without advancing, so that "rex.input" is
+        // to be empty quit without advancing, so that "rex->input" is
         // correct.
         if (nextlist->n == 0) {
           clen = 0;
@@ -14330,35 +14985,35 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
         // in the position in "nfa_endp".
         // Submatches are stored in *m, and used in the parent call.
 #ifdef REGEXP_DEBUG
-        if (nfa_endp != NULL) {
+        if (rex->nfa_endp != NULL) {
           if (REG_MULTI) {
             fprintf(log_fd,
                     "Current lnum: %d, endp lnum: %d;"
                     " current col: %d, endp col: %d\n",
-                    (int)rex.lnum,
-                    (int)nfa_endp->se_u.pos.lnum,
-                    (int)(rex.input - rex.line),
-                    nfa_endp->se_u.pos.col);
+                    (int)rex->lnum,
+                    (int)rex->nfa_endp->se_u.pos.lnum,
+                    (int)(rex->input - rex->line),
+                    rex->nfa_endp->se_u.pos.col);
           } else {
             fprintf(log_fd, "Current col: %d, endp col: %d\n",
-                    (int)(rex.input - rex.line),
-                    (int)(nfa_endp->se_u.ptr - rex.input));
+                    (int)(rex->input - rex->line),
+                    (int)(rex->nfa_endp->se_u.ptr - rex->input));
           }
         }
 #endif
         // If "nfa_endp" is set it's only a match if it ends at
         // "nfa_endp"
-        if (nfa_endp != NULL
+        if (rex->nfa_endp != NULL
             && (REG_MULTI
-                ? (rex.lnum != nfa_endp->se_u.pos.lnum
-                   || (int)(rex.input - rex.line) != nfa_endp->se_u.pos.col)
-                : rex.input != nfa_endp->se_u.ptr)) {
+                ? (rex->lnum != rex->nfa_endp->se_u.pos.lnum
+                   || (int)(rex->input - rex->line) != rex->nfa_endp->se_u.pos.col)
+                : rex->input != rex->nfa_endp->se_u.ptr)) {
           break;
         }
         // do not set submatches for \@!
         if (t->state->c != NFA_END_INVISIBLE_NEG) {
           copy_sub(&m->norm, &t->subs.norm);
-          if (rex.nfa_has_zsubexpr) {
+          if (rex->nfa_has_zsubexpr) {
             copy_sub(&m->synt, &t->subs.synt);
           }
         }
@@ -14366,7 +15021,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
         fprintf(log_fd, "Match found:\n");
         log_subsexpr(m);
 #endif
-        nfa_match = true;
+        rex->nfa_match = true;
         // See comment above at "goto nextchar".
         if (nextlist->n == 0) {
           clen = 0;
@@ -14398,7 +15053,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
           // Copy submatch info for the recursive call, opposite
           // of what happens on success below.
           copy_sub_off(&m->norm, &t->subs.norm);
-          if (rex.nfa_has_zsubexpr) {
+          if (rex->nfa_has_zsubexpr) {
             copy_sub_off(&m->synt, &t->subs.synt);
           }
           // First try matching the invisible match, then what
@@ -14406,7 +15061,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
           result = recursive_regmatch(t->state, NULL, prog, submatch, m,
                                       &listids, &listids_len);
           if (result == NFA_TOO_EXPENSIVE) {
-            nfa_match = result;
+            rex->nfa_match = result;
             goto theend;
           }
 
@@ -14420,7 +15075,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
                          == NFA_START_INVISIBLE_BEFORE_NEG_FIRST)) {
             // Copy submatch info from the recursive call
             copy_sub_off(&t->subs.norm, &m->norm);
-            if (rex.nfa_has_zsubexpr) {
+            if (rex->nfa_has_zsubexpr) {
               copy_sub_off(&t->subs.synt, &m->synt);
             }
             // If the pattern has \ze and it matched in the
@@ -14446,17 +15101,17 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
           pim.subs.norm.in_use = 0;
           pim.subs.synt.in_use = 0;
           if (REG_MULTI) {
-            pim.end.pos.col = (int)(rex.input - rex.line);
-            pim.end.pos.lnum = rex.lnum;
+            pim.end.pos.col = (int)(rex->input - rex->line);
+            pim.end.pos.lnum = rex->lnum;
           } else {
-            pim.end.ptr = rex.input;
+            pim.end.ptr = rex->input;
           }
           // t->state->out1 is the corresponding END_INVISIBLE
           // node; Add its out to the current list (zero-width
           // match).
           if (addstate_here(thislist, t->state->out1->out, &t->subs,
                             &pim, &listidx) == NULL) {
-            nfa_match = NFA_TOO_EXPENSIVE;
+            rex->nfa_match = NFA_TOO_EXPENSIVE;
             goto theend;
           }
         }
@@ -14500,7 +15155,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
         // Copy submatch info to the recursive call, opposite of what
         // happens afterwards.
         copy_sub_off(&m->norm, &t->subs.norm);
-        if (rex.nfa_has_zsubexpr) {
+        if (rex->nfa_has_zsubexpr) {
           copy_sub_off(&m->synt, &t->subs.synt);
         }
 
@@ -14508,7 +15163,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
         result = recursive_regmatch(t->state, NULL, prog, submatch, m,
                                     &listids, &listids_len);
         if (result == NFA_TOO_EXPENSIVE) {
-          nfa_match = result;
+          rex->nfa_match = result;
           goto theend;
         }
         if (result) {
@@ -14520,7 +15175,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
 #endif
           // Copy submatch info from the recursive call
           copy_sub_off(&t->subs.norm, &m->norm);
-          if (rex.nfa_has_zsubexpr) {
+          if (rex->nfa_has_zsubexpr) {
             copy_sub_off(&t->subs.synt, &m->synt);
           }
           // Now we need to skip over the matched text and then
@@ -14528,9 +15183,9 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
           if (REG_MULTI) {
             // TODO(RE): multi-line match
             bytelen = m->norm.list.multi[0].end_col
-                      - (int)(rex.input - rex.line);
+                      - (int)(rex->input - rex->line);
           } else {
-            bytelen = (int)(m->norm.list.line[0].end - rex.input);
+            bytelen = (int)(m->norm.list.line[0].end - rex->input);
           }
 
 #ifdef REGEXP_DEBUG
@@ -14559,7 +15214,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
       }
 
       case NFA_BOL:
-        if (rex.input == rex.line) {
+        if (rex->input == rex->line) {
           add_here = true;
           add_state = t->state->out;
         }
@@ -14581,7 +15236,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
           int this_class;
 
           // Get class of current and previous char (if it exists).
-          this_class = mb_get_class_tab((char *)rex.input, rex.reg_buf->b_chartab);
+          this_class = mb_get_class_tab((char *)rex->input, rex->reg_buf->b_chartab);
           if (this_class <= 1) {
             result = false;
           } else if (reg_prev_class() == this_class) {
@@ -14596,13 +15251,13 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
 
       case NFA_EOW:
         result = true;
-        if (rex.input == rex.line) {
+        if (rex->input == rex->line) {
           result = false;
         } else {
           int this_class, prev_class;
 
           // Get class of current and previous char (if it exists).
-          this_class = mb_get_class_tab((char *)rex.input, rex.reg_buf->b_chartab);
+          this_class = mb_get_class_tab((char *)rex->input, rex->reg_buf->b_chartab);
           prev_class = reg_prev_class();
           if (this_class == prev_class
               || prev_class == 0 || prev_class == 1) {
@@ -14616,15 +15271,15 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
         break;
 
       case NFA_BOF:
-        if (rex.lnum == 0 && rex.input == rex.line
-            && (!REG_MULTI || rex.reg_firstlnum == 1)) {
+        if (rex->lnum == 0 && rex->input == rex->line
+            && (!REG_MULTI || rex->reg_firstlnum == 1)) {
           add_here = true;
           add_state = t->state->out;
         }
         break;
 
       case NFA_EOF:
-        if (rex.lnum == rex.reg_maxline && curc == NUL) {
+        if (rex->lnum == rex->reg_maxline && curc == NUL) {
           add_here = true;
           add_state = t->state->out;
         }
@@ -14647,7 +15302,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
           // (no preceding character).
           len += utf_char2len(mc);
         }
-        if (rex.reg_icombine && len == 0) {
+        if (rex->reg_icombine && len == 0) {
           // If \Z was present, then ignore composing characters.
           // When ignoring the base character this always matches.
           if (sta->c != curc) {
@@ -14668,7 +15323,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
           // We don't care about the order of composing characters.
           // Get them into cchars[] first.
           while (len < clen) {
-            mc = utf_ptr2char((char *)rex.input + len);
+            mc = utf_ptr2char((char *)rex->input + len);
             cchars[ccount++] = mc;
             len += utf_char2len(mc);
             if (ccount == MAX_MCO) {
@@ -14702,14 +15357,14 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
       }
 
       case NFA_NEWL:
-        if (curc == NUL && !rex.reg_line_lbr && REG_MULTI
-            && rex.lnum <= rex.reg_maxline) {
+        if (curc == NUL && !rex->reg_line_lbr && REG_MULTI
+            && rex->lnum <= rex->reg_maxline) {
           go_to_nextline = true;
           // Pass -1 for the offset, which means taking the position
           // at the start of the next line.
           add_state = t->state->out;
           add_off = -1;
-        } else if (curc == '\n' && rex.reg_line_lbr) {
+        } else if (curc == '\n' && rex->reg_line_lbr) {
           // match \n as if it is an ordinary character
           add_state = t->state->out;
           add_off = 1;
@@ -14749,7 +15404,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
               // (no preceding character).
               len += utf_char2len(mc);
             }
-            if (rex.reg_icombine && len == 0) {
+            if (rex->reg_icombine && len == 0) {
               // If \Z was present, then ignore composing characters.
               // When ignoring the base character this always matches.
               if (sta->c != curc) {
@@ -14771,7 +15426,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
               // We don't care about the order of composing characters.
               // Get them into cchars[] first.
               while (len < clen) {
-                mc = utf_ptr2char((char *)rex.input + len);
+                mc = utf_ptr2char((char *)rex->input + len);
                 cchars[ccount++] = mc;
                 len += utf_char2len(mc);
                 if (ccount == MAX_MCO) {
@@ -14821,7 +15476,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
               result = result_if_matched;
               break;
             }
-            if (rex.reg_ic) {
+            if (rex->reg_ic) {
               int curc_low = utf_fold(curc);
               int done = false;
 
@@ -14838,7 +15493,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
             }
           } else if (state->c < 0 ? check_char_class(state->c, curc)
                                   : (curc == state->c
-                                     || (rex.reg_ic
+                                     || (rex->reg_ic
                                          && utf_fold(curc) == utf_fold(state->c)))) {
             result = result_if_matched;
             break;
@@ -14886,13 +15541,13 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
         break;
 
       case NFA_KWORD:           //  \k
-        result = vim_iswordp_buf((char *)rex.input, rex.reg_buf);
+        result = vim_iswordp_buf((char *)rex->input, rex->reg_buf);
         ADD_STATE_IF_MATCH(t->state);
         break;
 
       case NFA_SKWORD:          //  \K
         result = !ascii_isdigit(curc)
-                 && vim_iswordp_buf((char *)rex.input, rex.reg_buf);
+                 && vim_iswordp_buf((char *)rex->input, rex->reg_buf);
         ADD_STATE_IF_MATCH(t->state);
         break;
 
@@ -14907,12 +15562,12 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
         break;
 
       case NFA_PRINT:           //  \p
-        result = vim_isprintc(utf_ptr2char((char *)rex.input));
+        result = vim_isprintc(utf_ptr2char((char *)rex->input));
         ADD_STATE_IF_MATCH(t->state);
         break;
 
       case NFA_SPRINT:          //  \P
-        result = !ascii_isdigit(curc) && vim_isprintc(utf_ptr2char((char *)rex.input));
+        result = !ascii_isdigit(curc) && vim_isprintc(utf_ptr2char((char *)rex->input));
         ADD_STATE_IF_MATCH(t->state);
         break;
 
@@ -15007,24 +15662,24 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
         break;
 
       case NFA_LOWER_IC:        // [a-z]
-        result = ri_lower(curc) || (rex.reg_ic && ri_upper(curc));
+        result = ri_lower(curc) || (rex->reg_ic && ri_upper(curc));
         ADD_STATE_IF_MATCH(t->state);
         break;
 
       case NFA_NLOWER_IC:       // [^a-z]
         result = curc != NUL
-                 && !(ri_lower(curc) || (rex.reg_ic && ri_upper(curc)));
+                 && !(ri_lower(curc) || (rex->reg_ic && ri_upper(curc)));
         ADD_STATE_IF_MATCH(t->state);
         break;
 
       case NFA_UPPER_IC:        // [A-Z]
-        result = ri_upper(curc) || (rex.reg_ic && ri_lower(curc));
+        result = ri_upper(curc) || (rex->reg_ic && ri_lower(curc));
         ADD_STATE_IF_MATCH(t->state);
         break;
 
       case NFA_NUPPER_IC:       // [^A-Z]
         result = curc != NUL
-                 && !(ri_upper(curc) || (rex.reg_ic && ri_lower(curc)));
+                 && !(ri_upper(curc) || (rex->reg_ic && ri_lower(curc)));
         ADD_STATE_IF_MATCH(t->state);
         break;
 
@@ -15098,15 +15753,15 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
       case NFA_LNUM_GT:
       case NFA_LNUM_LT:
         assert(t->state->val >= 0
-               && !((rex.reg_firstlnum > 0
-                     && rex.lnum > LONG_MAX - rex.reg_firstlnum)
-                    || (rex.reg_firstlnum < 0
-                        && rex.lnum < LONG_MIN + rex.reg_firstlnum))
-               && rex.lnum + rex.reg_firstlnum >= 0);
+               && !((rex->reg_firstlnum > 0
+                     && rex->lnum > LONG_MAX - rex->reg_firstlnum)
+                    || (rex->reg_firstlnum < 0
+                        && rex->lnum < LONG_MIN + rex->reg_firstlnum))
+               && rex->lnum + rex->reg_firstlnum >= 0);
         result = (REG_MULTI
                   && nfa_re_num_cmp((uintmax_t)t->state->val,
                                     t->state->c - NFA_LNUM,
-                                    (uintmax_t)rex.lnum + (uintmax_t)rex.reg_firstlnum));
+                                    (uintmax_t)rex->lnum + (uintmax_t)rex->reg_firstlnum));
         if (result) {
           add_here = true;
           add_state = t->state->out;
@@ -15117,11 +15772,11 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
       case NFA_COL_GT:
       case NFA_COL_LT:
         assert(t->state->val >= 0
-               && rex.input >= rex.line
-               && (uintmax_t)(rex.input - rex.line) <= UINTMAX_MAX - 1);
+               && rex->input >= rex->line
+               && (uintmax_t)(rex->input - rex->line) <= UINTMAX_MAX - 1);
         result = nfa_re_num_cmp((uintmax_t)t->state->val,
                                 t->state->c - NFA_COL,
-                                (uintmax_t)(rex.input - rex.line + 1));
+                                (uintmax_t)(rex->input - rex->line + 1));
         if (result) {
           add_here = true;
           add_state = t->state->out;
@@ -15132,7 +15787,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
       case NFA_VCOL_GT:
       case NFA_VCOL_LT: {
         int op = t->state->c - NFA_VCOL;
-        colnr_T col = (colnr_T)(rex.input - rex.line);
+        colnr_T col = (colnr_T)(rex->input - rex->line);
 
         // Bail out quickly when there can't be a match, avoid the overhead of
         // win_linetabsize() on long lines.
@@ -15141,7 +15796,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
         }
 
         result = false;
-        win_T *wp = rex.reg_win == NULL ? curwin : rex.reg_win;
+        win_T *wp = rex->reg_win == NULL ? curwin : rex->reg_win;
         if (op == 1 && col - 1 > t->state->val && col > 100) {
           int64_t ts = (int64_t)wp->w_buffer->b_p_ts;
 
@@ -15153,11 +15808,11 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
           result = col > t->state->val * ts;
         }
         if (!result) {
-          linenr_T lnum = REG_MULTI ? rex.reg_firstlnum + rex.lnum : 1;
+          linenr_T lnum = REG_MULTI ? rex->reg_firstlnum + rex->lnum : 1;
           if (REG_MULTI && (lnum <= 0 || lnum > wp->w_buffer->b_ml.ml_line_count)) {
             lnum = 1;
           }
-          int vcol = win_linetabsize(wp, lnum, (char *)rex.line, col);
+          int vcol = win_linetabsize(wp, lnum, (char *)rex->line, col);
           assert(t->state->val >= 0);
           result = nfa_re_num_cmp((uintmax_t)t->state->val, op, (uintmax_t)vcol + 1);
         }
@@ -15171,31 +15826,31 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
       case NFA_MARK:
       case NFA_MARK_GT:
       case NFA_MARK_LT: {
-        size_t col = REG_MULTI ? (size_t)(rex.input - rex.line) : 0;
-        fmark_T *fm = mark_get(rex.reg_buf, curwin, NULL, kMarkBufLocal, t->state->val);
+        size_t col = REG_MULTI ? (size_t)(rex->input - rex->line) : 0;
+        fmark_T *fm = mark_get(rex->reg_buf, curwin, NULL, kMarkBufLocal, t->state->val);
 
         // Line may have been freed, get it again.
         if (REG_MULTI) {
-          rex.line = (uint8_t *)reg_getline(rex.lnum);
-          rex.input = rex.line + col;
+          rex->line = (uint8_t *)reg_getline(rex->lnum);
+          rex->input = rex->line + col;
         }
 
         // Compare the mark position to the match position, if the mark
         // exists and mark is set in reg_buf.
         if (fm != NULL && fm->mark.lnum > 0) {
           pos_T *pos = &fm->mark;
-          const colnr_T pos_col = pos->lnum == rex.lnum + rex.reg_firstlnum
+          const colnr_T pos_col = pos->lnum == rex->lnum + rex->reg_firstlnum
                                   && pos->col == MAXCOL
-                                  ? reg_getline_len(pos->lnum - rex.reg_firstlnum)
+                                  ? reg_getline_len(pos->lnum - rex->reg_firstlnum)
                                   : pos->col;
 
-          result = pos->lnum == rex.lnum + rex.reg_firstlnum
-                   ? (pos_col == (colnr_T)(rex.input - rex.line)
+          result = pos->lnum == rex->lnum + rex->reg_firstlnum
+                   ? (pos_col == (colnr_T)(rex->input - rex->line)
                       ? t->state->c == NFA_MARK
-                      : (pos_col < (colnr_T)(rex.input - rex.line)
+                      : (pos_col < (colnr_T)(rex->input - rex->line)
                          ? t->state->c == NFA_MARK_GT
                          : t->state->c == NFA_MARK_LT))
-                   : (pos->lnum < rex.lnum + rex.reg_firstlnum
+                   : (pos->lnum < rex->lnum + rex->reg_firstlnum
                       ? t->state->c == NFA_MARK_GT
                       : t->state->c == NFA_MARK_LT);
           if (result) {
@@ -15207,9 +15862,9 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
       }
 
       case NFA_CURSOR:
-        result = rex.reg_win != NULL
-                 && (rex.lnum + rex.reg_firstlnum == rex.reg_win->w_cursor.lnum)
-                 && ((colnr_T)(rex.input - rex.line) == rex.reg_win->w_cursor.col);
+        result = rex->reg_win != NULL
+                 && (rex->lnum + rex->reg_firstlnum == rex->reg_win->w_cursor.lnum)
+                 && ((colnr_T)(rex->input - rex->line) == rex->reg_win->w_cursor.col);
         if (result) {
           add_here = true;
           add_state = t->state->out;
@@ -15260,14 +15915,14 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
 #endif
         result = (c == curc);
 
-        if (!result && rex.reg_ic) {
+        if (!result && rex->reg_ic) {
           result = utf_fold(c) == utf_fold(curc);
         }
 
-        // If rex.reg_icombine is not set only skip over the character
+        // If rex->reg_icombine is not set only skip over the character
         // itself.  When it is set skip over composing characters.
-        if (result && !rex.reg_icombine) {
-          clen = utf_ptr2len((char *)rex.input);
+        if (result && !rex->reg_icombine) {
+          clen = utf_ptr2len((char *)rex->input);
         }
 
         ADD_STATE_IF_MATCH(t->state);
@@ -15308,7 +15963,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
                            == NFA_START_INVISIBLE_BEFORE_NEG_FIRST)) {
               // Copy submatch info from the recursive call
               copy_sub_off(&pim->subs.norm, &m->norm);
-              if (rex.nfa_has_zsubexpr) {
+              if (rex->nfa_has_zsubexpr) {
                 copy_sub_off(&pim->subs.synt, &m->synt);
               }
             }
@@ -15333,7 +15988,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
                          == NFA_START_INVISIBLE_BEFORE_NEG_FIRST)) {
             // Copy submatch info from the recursive call
             copy_sub_off(&t->subs.norm, &pim->subs.norm);
-            if (rex.nfa_has_zsubexpr) {
+            if (rex->nfa_has_zsubexpr) {
               copy_sub_off(&t->subs.synt, &pim->subs.synt);
             }
           } else {
@@ -15363,7 +16018,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
           }
         }
         if (r == NULL) {
-          nfa_match = NFA_TOO_EXPENSIVE;
+          rex->nfa_match = NFA_TOO_EXPENSIVE;
           goto theend;
         }
       }
@@ -15377,19 +16032,19 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
     // because recursive calls should only start in the first position.
     // Unless "nfa_endp" is not NULL, then we match the end position.
     // Also don't start a match past the first line.
-    if (!nfa_match
+    if (!rex->nfa_match
         && ((toplevel
-             && rex.lnum == 0
+             && rex->lnum == 0
              && clen != 0
-             && (rex.reg_maxcol == 0
-                 || (colnr_T)(rex.input - rex.line) < rex.reg_maxcol))
-            || (nfa_endp != NULL
+             && (rex->reg_maxcol == 0
+                 || (colnr_T)(rex->input - rex->line) < rex->reg_maxcol))
+            || (rex->nfa_endp != NULL
                 && (REG_MULTI
-                    ? (rex.lnum < nfa_endp->se_u.pos.lnum
-                       || (rex.lnum == nfa_endp->se_u.pos.lnum
-                           && (int)(rex.input - rex.line)
-                           < nfa_endp->se_u.pos.col))
-                    : rex.input < nfa_endp->se_u.ptr)))) {
+                    ? (rex->lnum < rex->nfa_endp->se_u.pos.lnum
+                       || (rex->lnum == rex->nfa_endp->se_u.pos.lnum
+                           && (int)(rex->input - rex->line)
+                           < rex->nfa_endp->se_u.pos.col))
+                    : rex->input < rex->nfa_endp->se_u.ptr)))) {
 #ifdef REGEXP_DEBUG
       fprintf(log_fd, "(---) STARTSTATE\n");
 #endif
@@ -15400,7 +16055,7 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
 
         if (prog->regstart != NUL && clen != 0) {
           if (nextlist->n == 0) {
-            colnr_T col = (colnr_T)(rex.input - rex.line) + clen;
+            colnr_T col = (colnr_T)(rex->input - rex->line) + clen;
 
             // Nextlist is empty, we can skip ahead to the
             // character that must appear at the start.
@@ -15409,15 +16064,15 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
             }
 #ifdef REGEXP_DEBUG
             fprintf(log_fd, "  Skipping ahead %d bytes to regstart\n",
-                    col - ((colnr_T)(rex.input - rex.line) + clen));
+                    col - ((colnr_T)(rex->input - rex->line) + clen));
 #endif
-            rex.input = rex.line + col - clen;
+            rex->input = rex->line + col - clen;
           } else {
             // Checking if the required start character matches is
             // cheaper than adding a state that won't match.
-            const int c = utf_ptr2char((char *)rex.input + clen);
+            const int c = utf_ptr2char((char *)rex->input + clen);
             if (c != prog->regstart
-                && (!rex.reg_ic
+                && (!rex->reg_ic
                     || utf_fold(c) != utf_fold(prog->regstart))) {
 #ifdef REGEXP_DEBUG
               fprintf(log_fd,
@@ -15431,20 +16086,20 @@ static int nfa_regmatch(nfa_regprog_T *prog, nfa_state_T *start, regsubs_T *subm
         if (add) {
           if (REG_MULTI) {
             m->norm.list.multi[0].start_col =
-              (colnr_T)(rex.input - rex.line) + clen;
+              (colnr_T)(rex->input - rex->line) + clen;
             m->norm.orig_start_col =
               m->norm.list.multi[0].start_col;
           } else {
-            m->norm.list.line[0].start = rex.input + clen;
+            m->norm.list.line[0].start = rex->input + clen;
           }
           if (addstate(nextlist, start->out, m, NULL, clen) == NULL) {
-            nfa_match = NFA_TOO_EXPENSIVE;
+            rex->nfa_match = NFA_TOO_EXPENSIVE;
             goto theend;
           }
         }
       } else {
         if (addstate(nextlist, start, m, NULL, clen) == NULL) {
-          nfa_match = NFA_TOO_EXPENSIVE;
+          rex->nfa_match = NFA_TOO_EXPENSIVE;
           goto theend;
         }
       }
@@ -15466,9 +16121,9 @@ nextchar:
     // Advance to the next character, or advance to the next line, or
     // finish.
     if (clen != 0) {
-      rex.input += clen;
-    } else if (go_to_nextline || (nfa_endp != NULL && REG_MULTI
-                                  && rex.lnum < nfa_endp->se_u.pos.lnum)) {
+      rex->input += clen;
+    } else if (go_to_nextline || (rex->nfa_endp != NULL && REG_MULTI
+                                  && rex->lnum < rex->nfa_endp->se_u.pos.lnum)) {
       reg_nextline();
     } else {
       break;
@@ -15480,8 +16135,8 @@ nextchar:
       break;
     }
     // Check for timeout once every twenty times to avoid overhead.
-    if (nfa_time_limit != NULL && ++nfa_time_count == 20) {
-      nfa_time_count = 0;
+    if (rex->nfa_time_limit != NULL && ++rex->nfa_time_count == 20) {
+      rex->nfa_time_count = 0;
       if (nfa_did_time_out()) {
         break;
       }
@@ -15497,18 +16152,17 @@ nextchar:
 
 theend:
   // Free memory
-  xfree(list[0].t);
-  xfree(list[1].t);
+  rex->nfa_depth--;
   xfree(listids);
 #undef ADD_STATE_IF_MATCH
 #ifdef NFA_REGEXP_DEBUG_LOG
   fclose(debug);
 #endif
 
-  return nfa_match;
+  return rex->nfa_match;
 }
 
-/// Try match of "prog" with at rex.line["col"].
+/// Try match of "prog" with at rex->line["col"].
 ///
 /// @param tm         timeout limit or NULL
 /// @param timed_out  flag set on timeout or NULL
@@ -15523,10 +16177,10 @@ static int nfa_regtry(nfa_regprog_T *prog, colnr_T col, proftime_T *tm, int *tim
   FILE *f;
 #endif
 
-  rex.input = rex.line + col;
-  nfa_time_limit = tm;
-  nfa_timed_out = timed_out;
-  nfa_time_count = 0;
+  rex->input = rex->line + col;
+  rex->nfa_time_limit = tm;
+  rex->nfa_timed_out = timed_out;
+  rex->nfa_time_count = 0;
 
 #ifdef REGEXP_DEBUG
   f = fopen(NFA_REGEXP_RUN_LOG, "a");
@@ -15536,7 +16190,7 @@ static int nfa_regtry(nfa_regprog_T *prog, colnr_T col, proftime_T *tm, int *tim
 # ifdef REGEXP_DEBUG
     fprintf(f, "\tRegexp is \"%s\"\n", nfa_regengine.expr);
 # endif
-    fprintf(f, "\tInput text is \"%s\" \n", rex.input);
+    fprintf(f, "\tInput text is \"%s\" \n", rex->input);
     fprintf(f, "\t=======================================================\n\n");
     nfa_print_state(f, start);
     fprintf(f, "\n\n");
@@ -15561,45 +16215,48 @@ static int nfa_regtry(nfa_regprog_T *prog, colnr_T col, proftime_T *tm, int *tim
   cleanup_subexpr();
   if (REG_MULTI) {
     for (i = 0; i < subs.norm.in_use; i++) {
-      rex.reg_startpos[i].lnum = subs.norm.list.multi[i].start_lnum;
-      rex.reg_startpos[i].col = subs.norm.list.multi[i].start_col;
+      rex->reg_startpos[i].lnum = subs.norm.list.multi[i].start_lnum;
+      rex->reg_startpos[i].col = subs.norm.list.multi[i].start_col;
 
-      rex.reg_endpos[i].lnum = subs.norm.list.multi[i].end_lnum;
-      rex.reg_endpos[i].col = subs.norm.list.multi[i].end_col;
+      rex->reg_endpos[i].lnum = subs.norm.list.multi[i].end_lnum;
+      rex->reg_endpos[i].col = subs.norm.list.multi[i].end_col;
     }
-    if (rex.reg_mmatch != NULL) {
-      rex.reg_mmatch->rmm_matchcol = subs.norm.orig_start_col;
+    if (rex->reg_mmatch != NULL) {
+      rex->reg_mmatch->rmm_matchcol = subs.norm.orig_start_col;
     }
 
-    if (rex.reg_startpos[0].lnum < 0) {
-      rex.reg_startpos[0].lnum = 0;
-      rex.reg_startpos[0].col = col;
+    if (rex->reg_startpos[0].lnum < 0) {
+      rex->reg_startpos[0].lnum = 0;
+      rex->reg_startpos[0].col = col;
     }
-    if (rex.reg_endpos[0].lnum < 0) {
+    if (rex->reg_endpos[0].lnum < 0) {
       // pattern has a \ze but it didn't match, use current end
-      rex.reg_endpos[0].lnum = rex.lnum;
-      rex.reg_endpos[0].col = (int)(rex.input - rex.line);
+      rex->reg_endpos[0].lnum = rex->lnum;
+      rex->reg_endpos[0].col = (int)(rex->input - rex->line);
     } else {
       // Use line number of "\ze".
-      rex.lnum = rex.reg_endpos[0].lnum;
+      rex->lnum = rex->reg_endpos[0].lnum;
     }
   } else {
     for (i = 0; i < subs.norm.in_use; i++) {
-      rex.reg_startp[i] = subs.norm.list.line[i].start;
-      rex.reg_endp[i] = subs.norm.list.line[i].end;
+      rex->reg_startp[i] = subs.norm.list.line[i].start;
+      rex->reg_endp[i] = subs.norm.list.line[i].end;
     }
 
-    if (rex.reg_startp[0] == NULL) {
-      rex.reg_startp[0] = rex.line + col;
+    if (rex->reg_startp[0] == NULL) {
+      rex->reg_startp[0] = rex->line + col;
     }
-    if (rex.reg_endp[0] == NULL) {
-      rex.reg_endp[0] = rex.input;
+    if (rex->reg_endp[0] == NULL) {
+      rex->reg_endp[0] = rex->input;
     }
   }
 
   // Package any found \z(...\) matches for export. Default is none.
-  unref_extmatch(re_extmatch_out);
-  re_extmatch_out = NULL;
+  // Only the main thread sets "re_extmatch_out", leave it alone when unset.
+  if (re_extmatch_out != NULL) {
+    unref_extmatch(re_extmatch_out);
+    re_extmatch_out = NULL;
+  }
 
   if (prog->reghasz == REX_SET) {
     cleanup_zsubexpr();
@@ -15628,7 +16285,450 @@ static int nfa_regtry(nfa_regprog_T *prog, colnr_T col, proftime_T *tm, int *tim
     }
   }
 
-  return 1 + rex.lnum;
+  return 1 + rex->lnum;
+}
+
+// Lazy DFA
+//
+// For a pattern which only uses characters, character classes, collections,
+// groups and ^ and $ the NFA can be turned into a DFA, which looks at each
+// character of the line once.  States are only built for the text that is
+// actually matched, and kept in a cache of limited size.  The DFA only finds
+// out whether there is a match in the line, nfa_regtry() then finds where it
+// is and the submatches.  Items which depend on options or on the position,
+// like \k and \<, are assumed to match, so that a line without a match can be
+// rejected but a line with a match is never missed.
+
+/// Check whether the lazy DFA can run the NFA states reachable from "start".
+static bool dfa_supported(nfa_regprog_T *prog)
+{
+  bool *seen = xcalloc((size_t)prog->nstate, sizeof(*seen));
+  nfa_state_T **stack = xmalloc((size_t)prog->nstate * sizeof(*stack));
+  int sp = 0;
+  bool ok = true;
+
+  stack[sp++] = prog->start;
+  seen[prog->start - prog->state] = true;
+  while (ok && sp > 0) {
+    nfa_state_T *state = stack[--sp];
+    int c = state->c;
+
+    if (c > 0
+        || c == NFA_SPLIT || c == NFA_EMPTY || c == NFA_MATCH
+        || c == NFA_START_COLL || c == NFA_START_NEG_COLL || c == NFA_END_COLL
+        || c == NFA_RANGE_MIN || c == NFA_RANGE_MAX
+        || (c >= NFA_ANY && c <= NFA_NUPPER_IC)
+        || (c >= NFA_CLASS_ALNUM && c <= NFA_CLASS_FNAME)
+        || (c >= NFA_MOPEN && c <= NFA_ZCLOSE9)
+        || c == NFA_NOPEN || c == NFA_NCLOSE
+        || c == NFA_BOL || c == NFA_EOL || c == NFA_BOW || c == NFA_EOW
+        || c == NFA_BOF || c == NFA_EOF || c == NFA_ZSTART || c == NFA_ZEND) {
+      nfa_state_T *next[2] = { state->out, state->out1 };
+      for (int i = 0; i < 2; i++) {
+        if (next[i] != NULL && !seen[next[i] - prog->state]) {
+          seen[next[i] - prog->state] = true;
+          stack[sp++] = next[i];
+        }
+      }
+    } else {
+      // A newline, a backreference, a look-behind, a composing character or
+      // a position like \%23l.
+      ok = false;
+    }
+  }
+
+  xfree(seen);
+  xfree(stack);
+  return ok;
+}
+
+static dfa_T *dfa_new(nfa_regprog_T *prog)
+{
+  dfa_T *dfa = xcalloc(1, sizeof(*dfa));
+  ga_init(&dfa->states, (int)sizeof(dfa_state_T *), 32);
+  dfa->index = (Map(String, int))MAP_INIT;
+  dfa->start[0] = dfa->start[1] = DFA_UNKNOWN;
+  dfa->mark = xcalloc((size_t)prog->nstate, sizeof(*dfa->mark));
+  dfa->stack = xmalloc((size_t)prog->nstate * sizeof(*dfa->stack));
+  dfa->ids = xmalloc((size_t)(prog->nstate + 1) * sizeof(*dfa->ids));
+  dfa->seeds = xmalloc((size_t)(prog->nstate + 1) * sizeof(*dfa->seeds));
+  return dfa;
+}
+
+/// Remove all states from the cache of "dfa".
+static void dfa_flush(dfa_T *dfa)
+{
+  for (int i = 0; i < dfa->states.ga_len; i++) {
+    dfa_state_T *s = ((dfa_state_T **)dfa->states.ga_data)[i];
+    xfree(s->ids);
+    xfree(s);
+  }
+  dfa->states.ga_len = 0;
+  dfa->bytes = 0;
+  map_clear(String, &dfa->index);
+  dfa->start[0] = dfa->start[1] = DFA_UNKNOWN;
+  dfa->flushes++;
+  dfa->scanned = 0;
+}
+
+static void dfa_free(dfa_T *dfa)
+{
+  if (dfa == NULL) {
+    return;
+  }
+  dfa_flush(dfa);
+  ga_clear(&dfa->states);
+  map_destroy(String, &dfa->index);
+  xfree(dfa->mark);
+  xfree(dfa->stack);
+  xfree(dfa->ids);
+  xfree(dfa->seeds);
+  xfree(dfa);
+}
+
+/// Add "state" to the stack of dfa_walk(), unless it was already added.
+static void dfa_push(dfa_T *dfa, nfa_regprog_T *prog, nfa_state_T *state)
+{
+  if (state != NULL && dfa->mark[state - prog->state] != dfa->gen) {
+    dfa->mark[state - prog->state] = dfa->gen;
+    dfa->stack[dfa->sp++] = (int)(state - prog->state);
+  }
+}
+
+/// Follow the states on the stack which don't consume a character, collecting
+/// the ones that do in "dfa->ids".
+///
+/// @param bol  at the start of the line
+/// @param eol  at the end of the line
+///
+/// @return  whether the match state was reached.
+static bool dfa_walk(dfa_T *dfa, nfa_regprog_T *prog, bool bol, bool eol)
+{
+  bool match = false;
+
+  dfa->nids = 0;
+  while (dfa->sp > 0) {
+    int id = dfa->stack[--dfa->sp];
+    nfa_state_T *state = &prog->state[id];
+
+    switch (state->c) {
+    case NFA_MATCH:
+      match = true;
+      break;
+
+    case NFA_SPLIT:
+      dfa_push(dfa, prog, state->out);
+      dfa_push(dfa, prog, state->out1);
+      break;
+
+    case NFA_BOL:
+      if (bol) {
+        dfa_push(dfa, prog, state->out);
+      }
+      break;
+
+    case NFA_EOL:
+      if (eol) {
+        dfa_push(dfa, prog, state->out);
+      }
+      break;
+
+    case NFA_EMPTY:
+    case NFA_NOPEN:
+    case NFA_NCLOSE:
+    case NFA_ZSTART:
+    case NFA_ZEND:
+    // Assume these match.
+    case NFA_BOW:
+    case NFA_EOW:
+    case NFA_BOF:
+    case NFA_EOF:
+      dfa_push(dfa, prog, state->out);
+      break;
+
+    default:
+      if (state->c >= NFA_MOPEN && state->c <= NFA_ZCLOSE9) {
+        dfa_push(dfa, prog, state->out);
+      } else {
+        // Consumes a character.
+        dfa->ids[dfa->nids++] = id;
+      }
+      break;
+    }
+  }
+  return match;
+}
+
+static int dfa_id_cmp(const void *a, const void *b)
+{
+  return *(const int *)a - *(const int *)b;
+}
+
+/// Find or add the DFA state for the NFA states reached from the "n" states
+/// in "dfa->seeds".
+///
+/// @param bol  at the start of the line
+///
+/// @return  index of the state or DFA_FAILED when the cache was flushed too
+///          often.
+static int dfa_closure(dfa_T *dfa, nfa_regprog_T *prog, int n, bool bol)
+{
+  if (dfa->gen >= INT_MAX - 2) {
+    memset(dfa->mark, 0, (size_t)prog->nstate * sizeof(*dfa->mark));
+    dfa->gen = 0;
+  }
+
+  // First find out whether a match ends at the end of the line, then get the
+  // states for when it continues.
+  dfa->gen++;
+  for (int i = 0; i < n; i++) {
+    dfa_push(dfa, prog, dfa->seeds[i]);
+  }
+  bool match_eol = dfa_walk(dfa, prog, bol, true);
+  dfa->gen++;
+  for (int i = 0; i < n; i++) {
+    dfa_push(dfa, prog, dfa->seeds[i]);
+  }
+  bool match = dfa_walk(dfa, prog, bol, false);
+
+  qsort(dfa->ids, (size_t)dfa->nids, sizeof(*dfa->ids), dfa_id_cmp);
+  // The same states may be reached with or without a match, that goes into
+  // the key as well.
+  dfa->ids[dfa->nids++] = -1 - (match ? 1 : 0) - (match_eol ? 2 : 0);
+  String key = { .data = (char *)dfa->ids, .size = (size_t)dfa->nids * sizeof(*dfa->ids) };
+  int idx = map_get(String, int)(&dfa->index, key);
+  if (idx > 0) {
+    return idx - 1;
+  }
+
+  size_t bytes = sizeof(dfa_state_T) + key.size;
+  if (dfa->bytes + bytes > DFA_MAX_BYTES) {
+    // Give up, and release the memory, when the states are hardly reused
+    // before the cache is full: building states is slower than running the
+    // NFA.
+    bool failed = dfa->scanned < (size_t)dfa->states.ga_len * DFA_MIN_SCAN;
+    dfa_flush(dfa);
+    if (failed) {
+      dfa->failed = true;
+      return DFA_FAILED;
+    }
+  }
+  dfa->bytes += bytes;
+
+  dfa_state_T *s = xmalloc(sizeof(*s));
+  s->ids = xmemdup(dfa->ids, key.size);
+  s->nids = dfa->nids - 1;
+  s->match = match;
+  s->match_eol = match_eol;
+  for (int i = 0; i < 256; i++) {
+    s->next[i] = DFA_UNKNOWN;
+  }
+  GA_APPEND(dfa_state_T *, &dfa->states, s);
+  key.data = (char *)s->ids;
+  map_put(String, int)(&dfa->index, key, dfa->states.ga_len);
+  return dfa->states.ga_len - 1;
+}
+
+/// Check whether the character "c" may match the collection starting at
+/// "state".
+static bool dfa_coll_matches(nfa_state_T *state, int c)
+{
+  const bool result_if_matched = (state->c == NFA_START_COLL);
+  bool maybe = false;
+
+  for (state = state->out; state->c != NFA_END_COLL; state = state->out) {
+    if (state->c == NFA_RANGE_MIN) {
+      int c1 = state->val;
+      state = state->out;  // advance to NFA_RANGE_MAX
+      int c2 = state->val;
+      if (c >= c1 && c <= c2) {
+        return result_if_matched;
+      }
+      if (rex->reg_ic) {
+        int c_low = utf_fold(c);
+        for (; c1 <= c2; c1++) {
+          if (utf_fold(c1) == c_low) {
+            return result_if_matched;
+          }
+        }
+      }
+    } else if (state->c == NFA_CLASS_PRINT || state->c == NFA_CLASS_IDENT
+               || state->c == NFA_CLASS_KEYWORD || state->c == NFA_CLASS_FNAME) {
+      // Depends on options.
+      maybe = true;
+    } else if (state->c < 0 ? check_char_class(state->c, c)
+                            : (c == state->c
+                               || (rex->reg_ic && utf_fold(c) == utf_fold(state->c)))) {
+      return result_if_matched;
+    }
+  }
+  return maybe || !result_if_matched;
+}
+
+/// Check whether the character "c", not NUL, may match NFA "state", like
+/// nfa_regmatch() does.
+static bool dfa_char_matches(nfa_state_T *state, int c)
+{
+  switch (state->c) {
+  case NFA_START_COLL:
+  case NFA_START_NEG_COLL:
+    return dfa_coll_matches(state, c);
+
+  case NFA_ANY:
+  // These depend on options.
+  case NFA_IDENT:
+  case NFA_SIDENT:
+  case NFA_KWORD:
+  case NFA_SKWORD:
+  case NFA_FNAME:
+  case NFA_SFNAME:
+  case NFA_PRINT:
+  case NFA_SPRINT:
+    return true;
+
+  case NFA_WHITE:
+    return ascii_iswhite(c);
+  case NFA_NWHITE:
+    return !ascii_iswhite(c);
+  case NFA_DIGIT:
+    return ri_digit(c);
+  case NFA_NDIGIT:
+    return !ri_digit(c);
+  case NFA_HEX:
+    return ri_hex(c);
+  case NFA_NHEX:
+    return !ri_hex(c);
+  case NFA_OCTAL:
+    return ri_octal(c);
+  case NFA_NOCTAL:
+    return !ri_octal(c);
+  case NFA_WORD:
+    return ri_word(c);
+  case NFA_NWORD:
+    return !ri_word(c);
+  case NFA_HEAD:
+    return ri_head(c);
+  case NFA_NHEAD:
+    return !ri_head(c);
+  case NFA_ALPHA:
+    return ri_alpha(c);
+  case NFA_NALPHA:
+    return !ri_alpha(c);
+  case NFA_LOWER:
+    return ri_lower(c);
+  case NFA_NLOWER:
+    return !ri_lower(c);
+  case NFA_UPPER:
+    return ri_upper(c);
+  case NFA_NUPPER:
+    return !ri_upper(c);
+  case NFA_LOWER_IC:
+    return ri_lower(c) || (rex->reg_ic && ri_upper(c));
+  case NFA_NLOWER_IC:
+    return !(ri_lower(c) || (rex->reg_ic && ri_upper(c)));
+  case NFA_UPPER_IC:
+    return ri_upper(c) || (rex->reg_ic && ri_lower(c));
+  case NFA_NUPPER_IC:
+    return !(ri_upper(c) || (rex->reg_ic && ri_lower(c)));
+
+  default:
+    return state->c == c || (rex->reg_ic && utf_fold(c) == utf_fold(state->c));
+  }
+}
+
+/// Get the DFA state after state "si" consumed character "c".
+///
+/// @return  index of the state or DFA_FAILED.
+static int dfa_next(dfa_T *dfa, nfa_regprog_T *prog, int si, int c)
+{
+  dfa_state_T *s = ((dfa_state_T **)dfa->states.ga_data)[si];
+  int n = 0;
+  for (int i = 0; i < s->nids; i++) {
+    nfa_state_T *state = &prog->state[s->ids[i]];
+    if (dfa_char_matches(state, c)) {
+      // A collection continues after the NFA_END_COLL.
+      dfa->seeds[n++] = (state->c == NFA_START_COLL || state->c == NFA_START_NEG_COLL)
+                        ? state->out1->out : state->out;
+    }
+  }
+  // A match may also start at the next character.
+  dfa->seeds[n++] = prog->start;
+
+  int flushes = dfa->flushes;
+  int next = dfa_closure(dfa, prog, n, false);
+  if (next >= 0 && c < 256 && dfa->flushes == flushes) {
+    s->next[c] = (int16_t)next;
+  }
+  return next;
+}
+
+/// Run the lazy DFA of "prog" on "line" from column "col".
+///
+/// @return  false if there is no match, true if there may be one.
+static bool dfa_may_match(nfa_regprog_T *prog, const uint8_t *line, colnr_T col)
+{
+  // A worker thread keeps its own DFA.
+  dfa_T **dfap = rex->reg_worker != NULL ? &rex->reg_worker->dfa : &prog->dfa;
+  if (*dfap == NULL) {
+    *dfap = dfa_new(prog);
+  }
+  dfa_T *dfa = *dfap;
+  if (dfa->failed || rex->reg_icombine) {
+    return true;
+  }
+  if (dfa->ic != rex->reg_ic) {
+    // The cached transitions are only valid for one value of 'ignorecase'.
+    dfa_flush(dfa);
+    dfa->ic = rex->reg_ic;
+  }
+
+  const bool bol = col == 0;
+  int si = dfa->start[bol];
+  if (si == DFA_UNKNOWN) {
+    dfa->seeds[0] = prog->start;
+    si = dfa_closure(dfa, prog, 1, bol);
+    if (si == DFA_FAILED) {
+      return true;
+    }
+    dfa->start[bol] = si;
+  }
+
+  const uint8_t *p = line + col;
+  while (true) {
+    dfa_state_T *s = ((dfa_state_T **)dfa->states.ga_data)[si];
+    if (s->match) {
+      return true;
+    }
+    if (*p == NUL) {
+      return s->match_eol;
+    }
+
+    int c;
+    int len;
+    if (*p < 0x80 && p[1] < 0x80) {  // be quick for ASCII
+      c = *p;
+      len = 1;
+    } else {
+      len = utf_ptr2len((char *)p);
+      if (utfc_ptr2len((char *)p) != len) {
+        // The NFA skips over composing characters in several ways, leave
+        // this line to it.
+        return true;
+      }
+      c = utf_ptr2char((char *)p);
+    }
+
+    int next = c < 256 ? s->next[c] : DFA_UNKNOWN;
+    if (next == DFA_UNKNOWN) {
+      next = dfa_next(dfa, prog, si, c);
+      if (next == DFA_FAILED) {
+        return true;
+      }
+    }
+    si = next;
+    p += len;
+    dfa->scanned += (size_t)len;
+  }
 }
 
 /// Match a regexp against a string ("line" points to the string) or multiple
@@ -15648,14 +16748,14 @@ static int nfa_regexec_both(uint8_t *line, colnr_T startcol, proftime_T *tm, int
   colnr_T col = startcol;
 
   if (REG_MULTI) {
-    prog = (nfa_regprog_T *)rex.reg_mmatch->regprog;
+    prog = (nfa_regprog_T *)rex->reg_mmatch->regprog;
     line = (uint8_t *)reg_getline(0);  // relative to the cursor
-    rex.reg_startpos = rex.reg_mmatch->startpos;
-    rex.reg_endpos = rex.reg_mmatch->endpos;
+    rex->reg_startpos = rex->reg_mmatch->startpos;
+    rex->reg_endpos = rex->reg_mmatch->endpos;
   } else {
-    prog = (nfa_regprog_T *)rex.reg_match->regprog;
-    rex.reg_startp = (uint8_t **)rex.reg_match->startp;
-    rex.reg_endp = (uint8_t **)rex.reg_match->endp;
+    prog = (nfa_regprog_T *)rex->reg_match->regprog;
+    rex->reg_startp = (uint8_t **)rex->reg_match->startp;
+    rex->reg_endp = (uint8_t **)rex->reg_match->endp;
   }
 
   // Be paranoid...
@@ -15664,26 +16764,26 @@ static int nfa_regexec_both(uint8_t *line, colnr_T startcol, proftime_T *tm, int
     goto theend;
   }
 
-  // If pattern contains "\c" or "\C": overrule value of rex.reg_ic
+  // If pattern contains "\c" or "\C": overrule value of rex->reg_ic
   if (prog->regflags & RF_ICASE) {
-    rex.reg_ic = true;
+    rex->reg_ic = true;
   } else if (prog->regflags & RF_NOICASE) {
-    rex.reg_ic = false;
+    rex->reg_ic = false;
   }
 
-  // If pattern contains "\Z" overrule value of rex.reg_icombine
+  // If pattern contains "\Z" overrule value of rex->reg_icombine
   if (prog->regflags & RF_ICOMBINE) {
-    rex.reg_icombine = true;
+    rex->reg_icombine = true;
   }
 
-  rex.line = line;
-  rex.lnum = 0;  // relative to line
+  rex->line = line;
+  rex->lnum = 0;  // relative to line
 
-  rex.nfa_has_zend = prog->has_zend;
-  rex.nfa_has_backref = prog->has_backref;
-  rex.nfa_nsubexpr = prog->nsubexp;
-  rex.nfa_listid = 1;
-  rex.nfa_alt_listid = 2;
+  rex->nfa_has_zend = prog->has_zend;
+  rex->nfa_has_backref = prog->has_backref;
+  rex->nfa_nsubexpr = prog->nsubexp;
+  rex->nfa_listid = 1;
+  rex->nfa_alt_listid = 2;
 #ifdef REGEXP_DEBUG
   nfa_regengine.expr = prog->pattern;
 #endif
@@ -15692,14 +16792,32 @@ static int nfa_regexec_both(uint8_t *line, colnr_T startcol, proftime_T *tm, int
     return 0L;
   }
 
-  rex.need_clear_subexpr = true;
+  rex->need_clear_subexpr = true;
   // Clear the external match subpointers if necessary.
   if (prog->reghasz == REX_SET) {
-    rex.nfa_has_zsubexpr = true;
-    rex.need_clear_zsubexpr = true;
+    rex->nfa_has_zsubexpr = true;
+    rex->need_clear_zsubexpr = true;
   } else {
-    rex.nfa_has_zsubexpr = false;
-    rex.need_clear_zsubexpr = false;
+    rex->nfa_has_zsubexpr = false;
+    rex->need_clear_zsubexpr = false;
+  }
+
+  // When the match must contain one of the "regmust" strings and none is in
+  // the line there is no match.
+  if (prog->nregmust > 0) {
+    int i = 0;
+    while (i < prog->nregmust && !regmust_found((char *)line + col, (char *)prog->regmust[i])) {
+      i++;
+    }
+    if (i == prog->nregmust) {
+      return 0;
+    }
+  }
+
+  // Let the lazy DFA check whether there is a match at all, only find where
+  // it is with the NFA.
+  if (prog->dfa_usable && !dfa_may_match(prog, line, col)) {
+    return 0;
   }
 
   if (prog->regstart != NUL) {
@@ -15711,30 +16829,32 @@ static int nfa_regexec_both(uint8_t *line, colnr_T startcol, proftime_T *tm, int
 
     // If match_text is set it contains the full text that must match.
     // Nothing else to try. Doesn't handle combining chars well.
-    if (prog->match_text != NULL && *prog->match_text != NUL && !rex.reg_icombine) {
+    if (prog->match_text != NULL && *prog->match_text != NUL && !rex->reg_icombine) {
       retval = find_match_text(&col, prog->regstart, prog->match_text);
       if (REG_MULTI) {
-        rex.reg_mmatch->rmm_matchcol = col;
+        rex->reg_mmatch->rmm_matchcol = col;
       } else {
-        rex.reg_match->rm_matchcol = col;
+        rex->reg_match->rm_matchcol = col;
       }
       return retval;
     }
   }
 
   // If the start column is past the maximum column: no need to try.
-  if (rex.reg_maxcol > 0 && col >= rex.reg_maxcol) {
+  if (rex->reg_maxcol > 0 && col >= rex->reg_maxcol) {
     goto theend;
   }
 
-  // Set the "nstate" used by nfa_regcomp() to zero to trigger an error when
-  // it's accidentally used during execution.
-  nstate = 0;
-  for (int i = 0; i < prog->nstate; i++) {
-    prog->state[i].id = i;
-    prog->state[i].lastlist[0] = 0;
-    prog->state[i].lastlist[1] = 0;
+  // The prog is not changed, the list IDs of the states are kept here.
+  if (rex->nfa_lastlist_len < prog->nstate) {
+    for (int i = 0; i < 2; i++) {
+      xfree(rex->nfa_lastlist[i]);
+      rex->nfa_lastlist[i] = xmalloc((size_t)prog->nstate * sizeof(int));
+    }
+    rex->nfa_lastlist_len = prog->nstate;
   }
+  memset(rex->nfa_lastlist[0], 0, (size_t)prog->nstate * sizeof(int));
+  memset(rex->nfa_lastlist[1], 0, (size_t)prog->nstate * sizeof(int));
 
   retval = nfa_regtry(prog, col, tm, timed_out);
 
@@ -15747,21 +16867,21 @@ theend:
     // Make sure the end is never before the start.  Can happen when \zs and
     // \ze are used.
     if (REG_MULTI) {
-      const lpos_T *const start = &rex.reg_mmatch->startpos[0];
-      const lpos_T *const end = &rex.reg_mmatch->endpos[0];
+      const lpos_T *const start = &rex->reg_mmatch->startpos[0];
+      const lpos_T *const end = &rex->reg_mmatch->endpos[0];
 
       if (end->lnum < start->lnum
           || (end->lnum == start->lnum && end->col < start->col)) {
-        rex.reg_mmatch->endpos[0] = rex.reg_mmatch->startpos[0];
+        rex->reg_mmatch->endpos[0] = rex->reg_mmatch->startpos[0];
       }
     } else {
-      if (rex.reg_match->endp[0] < rex.reg_match->startp[0]) {
-        rex.reg_match->endp[0] = rex.reg_match->startp[0];
+      if (rex->reg_match->endp[0] < rex->reg_match->startp[0]) {
+        rex->reg_match->endp[0] = rex->reg_match->startp[0];
       }
 
       // startpos[0] may be set by "\zs", also return the column where
       // the whole pattern matched.
-      rex.reg_match->rm_matchcol = col;
+      rex->reg_match->rm_matchcol = col;
     }
   }
 
@@ -15820,7 +16940,7 @@ static regprog_T *nfa_regcomp(uint8_t *expr, int re_flags)
   size_t prog_size = offsetof(nfa_regprog_T, state) + sizeof(nfa_state_T) * (size_t)nstate;
   prog = xmalloc(prog_size);
   state_ptr = prog->state;
-  prog->re_in_use = false;
+  prog->re_in_use = 0;
 
   // PASS 2
   // Build the NFA
@@ -15831,8 +16951,8 @@ static regprog_T *nfa_regcomp(uint8_t *expr, int re_flags)
   prog->regflags = regflags;
   prog->engine = &nfa_regengine;
   prog->nstate = nstate;
-  prog->has_zend = rex.nfa_has_zend;
-  prog->has_backref = rex.nfa_has_backref;
+  prog->has_zend = nfa_has_zend;
+  prog->has_backref = nfa_has_backref;
   prog->nsubexp = regnpar;
 
   nfa_postprocess(prog);
@@ -15840,11 +16960,23 @@ static regprog_T *nfa_regcomp(uint8_t *expr, int re_flags)
   prog->reganch = nfa_get_reganch(prog->start, 0);
   prog->regstart = nfa_get_regstart(prog->start, 0);
   prog->match_text = nfa_get_match_text(prog->start);
+  if (prog->match_text == NULL) {
+    nfa_get_regmust(prog, postfix, post_ptr);
+  } else {
+    prog->nregmust = 0;
+  }
+  // Literal text is found quicker without the DFA.
+  prog->dfa_usable = prog->match_text == NULL && dfa_supported(prog);
+  prog->dfa = NULL;
 
 #ifdef REGEXP_DEBUG
   nfa_postfix_dump(expr, OK);
   nfa_dump(prog);
 #endif
+  // During execution the ID of a state is its index, see "nfa_lastlist".
+  for (int i = 0; i < prog->nstate; i++) {
+    prog->state[i].id = i;
+  }
   // Remember whether this pattern has any \z specials in it.
   prog->reghasz = re_has_z;
   prog->pattern = xstrdup((char *)expr);
@@ -15875,6 +17007,10 @@ static void nfa_regfree(regprog_T *prog)
   }
 
   xfree(((nfa_regprog_T *)prog)->match_text);
+  for (int i = 0; i < ((nfa_regprog_T *)prog)->nregmust; i++) {
+    xfree(((nfa_regprog_T *)prog)->regmust[i]);
+  }
+  dfa_free(((nfa_regprog_T *)prog)->dfa);
   xfree(((nfa_regprog_T *)prog)->pattern);
   xfree(prog);
 }
@@ -15890,16 +17026,16 @@ static void nfa_regfree(regprog_T *prog)
 /// @return  <= 0 for failure, number of lines contained in the match otherwise.
 static int nfa_regexec_nl(regmatch_T *rmp, uint8_t *line, colnr_T col, bool line_lbr)
 {
-  rex.reg_match = rmp;
-  rex.reg_mmatch = NULL;
-  rex.reg_maxline = 0;
-  rex.reg_line_lbr = line_lbr;
-  rex.reg_buf = curbuf;
-  rex.reg_win = NULL;
-  rex.reg_ic = rmp->rm_ic;
-  rex.reg_icombine = false;
-  rex.reg_nobreak = rmp->regprog->re_flags & RE_NOBREAK;
-  rex.reg_maxcol = 0;
+  rex->reg_match = rmp;
+  rex->reg_mmatch = NULL;
+  rex->reg_maxline = 0;
+  rex->reg_line_lbr = line_lbr;
+  rex->reg_buf = rex->reg_worker != NULL ? rex->reg_worker->buf : curbuf;
+  rex->reg_win = NULL;
+  rex->reg_ic = rmp->rm_ic;
+  rex->reg_icombine = false;
+  rex->reg_nobreak = rmp->regprog->re_flags & RE_NOBREAK;
+  rex->reg_maxcol = 0;
   return nfa_regexec_both(line, col, NULL, NULL);
 }
 
@@ -16012,9 +17148,6 @@ regprog_T *vim_regcomp(const char *expr_arg, int re_flags)
   bt_regengine.expr = expr;
   nfa_regengine.expr = expr;
 #endif
-  // reg_iswordc() uses rex.reg_buf
-  rex.reg_buf = curbuf;
-
   //
   // First try the NFA engine, unless backtracking was requested.
   //
@@ -16073,9 +17206,7 @@ void vim_regfree(regprog_T *prog)
 #if defined(EXITFREE)
 void free_regexp_stuff(void)
 {
-  ga_clear(&regstack);
-  ga_clear(&backpos);
-  xfree(reg_tofree);
+  regexec_free_pool();
   xfree(reg_prev_sub);
 }
 
@@ -16105,29 +17236,16 @@ static void report_re_switch(const char *pat)
 /// @return true if there is a match, false if not.
 static bool vim_regexec_string(regmatch_T *rmp, const char *line, colnr_T col, bool nl)
 {
-  regexec_T rex_save;
-  bool rex_in_use_save = rex_in_use;
-
-  // Cannot use the same prog recursively, it contains state.
-  if (rmp->regprog->re_in_use) {
-    emsg(_(e_recursive));
-    return false;
-  }
-  rmp->regprog->re_in_use = true;
-
-  if (rex_in_use) {
-    // Being called recursively, save the state.
-    rex_save = rex;
-  }
-  rex_in_use = true;
+  regexec_T *const rex_prev = regexec_get();
 
-  rex.reg_startp = NULL;
-  rex.reg_endp = NULL;
-  rex.reg_startpos = NULL;
-  rex.reg_endpos = NULL;
+  rex->reg_startp = NULL;
+  rex->reg_endp = NULL;
+  rex->reg_startpos = NULL;
+  rex->reg_endpos = NULL;
 
+  rmp->regprog->re_in_use++;
   int result = rmp->regprog->engine->regexec_nl(rmp, (uint8_t *)line, col, nl);
-  rmp->regprog->re_in_use = false;
+  rmp->regprog->re_in_use--;
 
   // NFA engine aborted because it's very slow, use backtracking engine instead.
   if (rmp->regprog->re_engine == AUTOMATIC_ENGINE
@@ -16137,23 +17255,28 @@ static bool vim_regexec_string(regmatch_T *rmp, const char *line, colnr_T col, b
     char *pat = xstrdup(((nfa_regprog_T *)rmp->regprog)->pattern);
 
     p_re = BACKTRACKING_ENGINE;
-    vim_regfree(rmp->regprog);
+    regprog_T *prev_prog = rmp->regprog;
     report_re_switch(pat);
     rmp->regprog = vim_regcomp(pat, re_flags);
     if (rmp->regprog != NULL) {
-      rmp->regprog->re_in_use = true;
+      rmp->regprog->re_in_use++;
       result = rmp->regprog->engine->regexec_nl(rmp, (uint8_t *)line, col, nl);
-      rmp->regprog->re_in_use = false;
+      rmp->regprog->re_in_use--;
+    }
+    if (prev_prog->re_in_use > 0) {
+      // An outer match is still using the NFA prog, only this one uses the
+      // backtracking engine.
+      vim_regfree(rmp->regprog);
+      rmp->regprog = prev_prog;
+    } else {
+      vim_regfree(prev_prog);
     }
 
     xfree(pat);
     p_re = save_p_re;
   }
 
-  rex_in_use = rex_in_use_save;
-  if (rex_in_use) {
-    rex = rex_save;
-  }
+  regexec_put(rex_prev);
 
   return result > 0;
 }
@@ -16183,6 +17306,86 @@ bool vim_regexec_nl(regmatch_T *rmp, const char *line, colnr_T col)
   return vim_regexec_string(rmp, line, col, true);
 }
 
+/// Make a worker that matches "prog" against lines in another thread.  Each
+/// thread needs its own worker, several workers can share "prog" because
+/// they do not change it.  "prog" must not be used otherwise or freed while
+/// a worker matches.
+///
+/// @param ic  ignore case, like rmm_ic of regmmatch_T
+/// @param buf  buffer of the lines, for 'iskeyword' and the like
+///
+/// @return  NULL when the matches of "prog" in a line can't be found without
+///          looking at the buffer: the pattern can match a line break, looks
+///          behind or uses a position item like "\%23l" or "\%V".
+regworker_T *vim_regworker_new(regprog_T *prog, bool ic, buf_T *buf)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (prog->regflags & (RF_HASNL | RF_LOOKBH | RF_HASPOS)) {
+    return NULL;
+  }
+  regworker_T *w = xcalloc(1, sizeof(*w));
+  w->prog = prog;
+  w->ic = ic;
+  w->buf = buf;
+  return w;
+}
+
+void vim_regworker_free(regworker_T *w)
+{
+  if (w == NULL) {
+    return;
+  }
+  if (w->prog->engine == &nfa_regengine) {
+    dfa_free(w->dfa);
+  }
+  xfree(w->line);
+  xfree(w);
+}
+
+/// Check whether the "len" bytes of text at "text" contain a match, like
+/// vim_regexec_multi() on a line of the buffer with that text.  "text" does
+/// not need to be NUL terminated, a NUL in it stands for a NL.  Does not give
+/// messages or check for typed keys, can be used in any thread.  A thread
+/// other than the main thread must call regexec_free_pool() before it exits.
+///
+/// @return  kTrue if there is a match, kFalse if not, kNone if it can't be
+///          found out without the main thread, e.g. when the match needs more
+///          than 'maxmempattern'.
+TriState vim_regworker_match(regworker_T *w, const char *text, size_t len)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (len >= w->linesize) {
+    xfree(w->line);
+    w->linesize = MAX(len + 1, 2 * w->linesize);
+    w->line = xmalloc(w->linesize);
+  }
+  for (size_t i = 0; i < len; i++) {
+    w->line[i] = text[i] == NUL ? NL : text[i];
+  }
+  w->line[len] = NUL;
+
+  regexec_T *const rex_prev = regexec_get();
+  rex->reg_startp = NULL;
+  rex->reg_endp = NULL;
+  rex->reg_startpos = NULL;
+  rex->reg_endpos = NULL;
+  rex->reg_worker = w;
+  rex->reg_failed = false;
+
+  // Not counted in "re_in_use", the prog is not changed.
+  regmatch_T regmatch = { .regprog = w->prog, .rm_ic = w->ic };
+  int result = w->prog->engine->regexec_nl(&regmatch, (uint8_t *)w->line, 0, false);
+  const bool failed = rex->reg_failed;
+
+  rex->reg_worker = NULL;
+  regexec_put(rex_prev);
+
+  if (failed || result == NFA_TOO_EXPENSIVE || got_int) {
+    return kNone;
+  }
+  return result > 0 ? kTrue : kFalse;
+}
+
 /// Match a regexp against multiple lines.
 /// "rmp->regprog" must be a compiled regexp as returned by vim_regcomp().
 /// Note: "rmp->regprog" may be freed and changed, even set to NULL.
@@ -16201,24 +17404,11 @@ int vim_regexec_multi(regmmatch_T *rmp, win_T *win, buf_T *buf, linenr_T lnum, c
                       proftime_T *tm, int *timed_out)
   FUNC_ATTR_NONNULL_ARG(1)
 {
-  regexec_T rex_save;
-  bool rex_in_use_save = rex_in_use;
-
-  // Cannot use the same prog recursively, it contains state.
-  if (rmp->regprog->re_in_use) {
-    emsg(_(e_recursive));
-    return false;
-  }
-  rmp->regprog->re_in_use = true;
-
-  if (rex_in_use) {
-    // Being called recursively, save the state.
-    rex_save = rex;
-  }
-  rex_in_use = true;
+  regexec_T *const rex_prev = regexec_get();
 
+  rmp->regprog->re_in_use++;
   int result = rmp->regprog->engine->regexec_multi(rmp, win, buf, lnum, col, tm, timed_out);
-  rmp->regprog->re_in_use = false;
+  rmp->regprog->re_in_use--;
 
   // NFA engine aborted because it's very slow, use backtracking engine instead.
   if (rmp->regprog->re_engine == AUTOMATIC_ENGINE
@@ -16242,21 +17432,25 @@ int vim_regexec_multi(regmmatch_T *rmp, win_T *win, buf_T *buf, linenr_T lnum, c
       // previous one to avoid "regprog" becoming NULL.
       rmp->regprog = prev_prog;
     } else {
-      vim_regfree(prev_prog);
-
-      rmp->regprog->re_in_use = true;
+      rmp->regprog->re_in_use++;
       result = rmp->regprog->engine->regexec_multi(rmp, win, buf, lnum, col, tm, timed_out);
-      rmp->regprog->re_in_use = false;
+      rmp->regprog->re_in_use--;
+
+      if (prev_prog->re_in_use > 0) {
+        // An outer match is still using the NFA prog, only this one uses
+        // the backtracking engine.
+        vim_regfree(rmp->regprog);
+        rmp->regprog = prev_prog;
+      } else {
+        vim_regfree(prev_prog);
+      }
     }
 
     xfree(pat);
     p_re = save_p_re;
   }
 
-  rex_in_use = rex_in_use_save;
-  if (rex_in_use) {
-    rex = rex_save;
-  }
+  regexec_put(rex_prev);
 
   return result <= 0 ? 0 : result;
 }
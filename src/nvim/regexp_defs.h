@@ -79,6 +79,23 @@ typedef struct {
   uint8_t *matches[NSUBEXP];
 } reg_extmatch_T;
 
+enum {
+  /// Maximum number of strings in a regmust_T.
+  REGMUST_MAX = 4,
+};
+
+/// Literal text that every match of a pattern contains: at least one of the
+/// strings in "must".  Set by vim_regmust_get(), vim_regmust_found() checks
+/// a line for it and can be used in any thread.
+typedef struct {
+  int nmust;                      ///< number of strings in "must"
+  const char *must[REGMUST_MAX];  ///< ASCII text, owned by the regprog_T
+  bool ic;                        ///< ignore case
+} regmust_T;
+
+/// Matches a regexp in a thread other than the main thread.
+typedef struct regworker regworker_T;
+
 /// Flags used by vim_regsub() and vim_regsub_both()
 enum {
   REGSUB_COPY      = 1,
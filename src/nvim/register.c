@@ -1911,6 +1911,23 @@ void do_put(int regname, yankreg_T *reg, int dir, int count, int flags)
           i = 1;
         }
 
+        if (!(flags & PUT_FIXINDENT)) {
+          // No indent to fix: append all lines at once.  The last line of a
+          // charwise register was inserted above.
+          size_t n = y_size - i - (y_type == kMTCharWise ? 1 : 0);
+          linenr_T old_line_count = curbuf->b_ml.ml_line_count;
+          int ret = ml_append_lines(curbuf, lnum, y_array + i, n, 0);
+          linenr_T added = curbuf->b_ml.ml_line_count - old_line_count;
+          new_lnum += added;
+          lnum += added;
+          nr_lines += added;
+          if (ret == FAIL) {
+            goto error;
+          }
+          lnum += (linenr_T)(y_size - i - n);
+          nr_lines += (linenr_T)(y_size - i - n);
+          i = y_size;
+        }
         for (; i < y_size; i++) {
           if ((y_type != kMTCharWise || i < y_size - 1)) {
             if (ml_append(lnum, y_array[i].data, 0, false) == FAIL) {
@@ -595,11 +595,13 @@ int searchit(win_T *win, buf_T *buf, pos_T *pos, pos_T *end_pos, Direction dir,
   linenr_T stop_lnum = 0;  // stop after this line number when != 0
   proftime_T *tm = NULL;   // timeout limit or NULL
   int *timed_out = NULL;   // set when timed out or NULL
+  const uint8_t *may_match = NULL;  // lines that may match or NULL
 
   if (extra_arg != NULL) {
     stop_lnum = extra_arg->sa_stop_lnum;
     tm = extra_arg->sa_tm;
     timed_out = &extra_arg->sa_timed_out;
+    may_match = extra_arg->sa_lines;
   }
 
   if (search_regcomp(pat, patlen, NULL, RE_SEARCH, pat_use,
@@ -612,6 +614,13 @@ int searchit(win_T *win, buf_T *buf, pos_T *pos, pos_T *end_pos, Direction dir,
 
   const bool search_from_match_end = vim_strchr(p_cpo, CPO_SEARCH) != NULL;
 
+  // A pattern that matches a line break goes back and forth between lines,
+  // keep them in a view instead of getting them again every time.
+  const bool use_view = re_multiline(regmatch.regprog);
+  if (use_view) {
+    ml_view_open(buf);
+  }
+
   // find the string
   do {  // loop for count
     // When not accepting a match at the start position set "extra_col" to a
@@ -675,8 +684,12 @@ int searchit(win_T *win, buf_T *buf, pos_T *pos, pos_T *end_pos, Direction dir,
 
         // Look for a match somewhere in line "lnum".
         colnr_T col = at_first_line && (options & SEARCH_COL) ? pos->col : 0;
-        nmatched = vim_regexec_multi(&regmatch, win, buf,
-                                     lnum, col, tm, timed_out);
+        if (may_match != NULL && may_match[lnum - 1] == kLineNoMatch) {
+          nmatched = 0;
+        } else {
+          nmatched = vim_regexec_multi(&regmatch, win, buf,
+                                       lnum, col, tm, timed_out);
+        }
         // vim_regexec_multi() may clear "regprog"
         if (regmatch.regprog == NULL) {
           break;
@@ -967,6 +980,9 @@ int searchit(win_T *win, buf_T *buf, pos_T *pos, pos_T *end_pos, Direction dir,
     }
   } while (--count > 0 && found);   // stop after count matches or no match
 
+  if (use_view) {
+    ml_view_close(buf);
+  }
   vim_regfree(regmatch.regprog);
 
   if (!found) {             // did not find it
@@ -996,6 +1012,78 @@ int searchit(win_T *win, buf_T *buf, pos_T *pos, pos_T *end_pos, Direction dir,
   return submatch + 1;
 }
 
+/// Argument of search_line_may_match().
+typedef struct {
+  bool has_must;           ///< "must" is valid
+  regmust_T must;          ///< literal text every match contains
+  regworker_T **workers;   ///< regexp worker for each thread or NULL
+} searchfilter_T;
+
+/// ml_filter_lines() check for search_lines_may_match().
+static uint8_t search_line_may_match(const char *text, size_t len, int thread, void *arg)
+{
+  searchfilter_T *sf = arg;
+  if (sf->has_must && !vim_regmust_found(&sf->must, text, len)) {
+    return kLineNoMatch;
+  }
+  if (sf->workers == NULL) {
+    return kLineMayMatch;
+  }
+  switch (vim_regworker_match(sf->workers[thread], text, len)) {
+  case kTrue:
+    return kLineHasMatch;
+  case kFalse:
+    return kLineNoMatch;
+  case kNone:
+    break;
+  }
+  return kLineMayMatch;
+}
+
+/// Find the lines "lnum1" to "lnum2" of "buf" which contain a match of
+/// "regmatch".  Worker threads run the regexp on the lines of a huge buffer,
+/// the regexp engine then only needs to run in the current thread on the
+/// lines that may match, to find where the match is.
+/// When the regexp can't be used in a worker, e.g. because it matches a line
+/// break or uses "\%V", the workers only check for the literal text that
+/// every match contains.
+///
+/// @return  allocated array with for each line, starting at "lnum1",
+///          kLineNoMatch, kLineMayMatch or kLineHasMatch.  NULL when every
+///          line may match, e.g. because nothing is known about the pattern.
+uint8_t *search_lines_may_match(buf_T *buf, linenr_T lnum1, linenr_T lnum2,
+                                regmmatch_T *regmatch)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (lnum2 - lnum1 + 1 < SEARCH_FILTER_MIN_LINES) {
+    return NULL;
+  }
+  searchfilter_T sf = { .workers = NULL };
+  sf.has_must = vim_regmust_get(regmatch->regprog, regmatch->rmm_ic, &sf.must);
+  const int nthreads = ml_filter_max_threads();
+  regworker_T *w = vim_regworker_new(regmatch->regprog, regmatch->rmm_ic, buf);
+  if (w != NULL) {
+    sf.workers = xmalloc((size_t)nthreads * sizeof(*sf.workers));
+    sf.workers[0] = w;
+    for (int i = 1; i < nthreads; i++) {
+      sf.workers[i] = vim_regworker_new(regmatch->regprog, regmatch->rmm_ic, buf);
+    }
+  } else if (!sf.has_must) {
+    return NULL;
+  }
+
+  uint8_t *lines = xmalloc((size_t)(lnum2 - lnum1 + 1));
+  ml_filter_lines(buf, lnum1, lnum2, search_line_may_match, &sf, lines);
+
+  if (sf.workers != NULL) {
+    for (int i = 0; i < nthreads; i++) {
+      vim_regworker_free(sf.workers[i]);
+    }
+    xfree(sf.workers);
+  }
+  return lines;
+}
+
 void set_search_direction(int cdir)
 {
   spats[0].off.dir = (char)cdir;
@@ -2748,9 +2836,23 @@ static void update_search_stat(int dirc, pos_T *pos, pos_T *cursor_pos, searchst
     if (timeout > 0) {
       start = profile_setlimit(timeout);
     }
+    // For an exact count first find the lines of a huge buffer that may
+    // match, searchit() skips the others.
+    searchit_arg_T sia = { 0 };
+    uint8_t *may_match = NULL;
+    if (maxcount == 0) {
+      regmmatch_T regmatch;
+      emsg_off++;  // searchit() gives the error
+      if (search_regcomp(NULL, 0, NULL, RE_SEARCH, RE_LAST, SEARCH_KEEP, &regmatch) == OK) {
+        may_match = search_lines_may_match(curbuf, 1, curbuf->b_ml.ml_line_count, &regmatch);
+        vim_regfree(regmatch.regprog);
+      }
+      emsg_off--;
+      sia.sa_lines = may_match;
+    }
     while (!got_int && searchit(curwin, curbuf, &lastpos, &endpos,
                                 FORWARD, NULL, 0, 1, SEARCH_KEEP, RE_LAST,
-                                NULL) != FAIL) {
+                                &sia) != FAIL) {
       done_search = true;
       // Stop after passing the time limit.
       if (timeout > 0 && profile_passed_limit(start)) {
@@ -2770,6 +2872,7 @@ static void update_search_stat(int dirc, pos_T *pos, pos_T *cursor_pos, searchst
         break;
       }
     }
+    xfree(may_match);
     if (got_int) {
       cur = -1;  // abort
     }
@@ -67,6 +67,16 @@ enum { SEARCH_STAT_DEF_TIMEOUT = 40, };
 // '[>9999/>9999]': 13 + 1 (NUL)
 enum { SEARCH_STAT_BUF_LEN = 16, };
 
+/// Minimal number of lines for search_lines_may_match() to check them.
+enum { SEARCH_FILTER_MIN_LINES = 10000, };
+
+/// Values of search_lines_may_match() for a line.
+enum {
+  kLineNoMatch = 0,     ///< the line does not contain a match
+  kLineMayMatch = 1,    ///< the regexp engine must check the line
+  kLineHasMatch = 2,    ///< the line contains a match
+};
+
 /// Structure containing offset definition for the last search pattern
 ///
 /// @note Only offset for the last search pattern is used, not for the last
@@ -95,6 +105,8 @@ typedef struct {
   proftime_T *sa_tm;        ///< timeout limit or NULL
   int sa_timed_out;  ///< set when timed out
   int sa_wrapped;    ///< search wrapped around
+  const uint8_t *sa_lines;  ///< when not NULL: for line "lnum" at index
+                            ///< lnum - 1 kLineNoMatch if it can't match
 } searchit_arg_T;
 
 typedef struct {
@@ -1018,6 +1018,15 @@ static void sign_get_placed(buf_T *buf, linenr_T lnum, int id, const char *group
   }
 }
 
+/// Keeps the glyphs of the defined signs when the glyph cache is full.
+void sign_keep_glyphs(void)
+{
+  sign_T *sp;
+  map_foreach_value(&sign_map, sp, {
+    schar_cache_keep_buf(sp->sn_text, SIGN_WIDTH);
+  });
+}
+
 void free_signs(void)
 {
   cstr_t name;
@@ -1281,6 +1281,41 @@ Buffer terminal_buf(const Terminal *term)
   return term->buf_handle;
 }
 
+/// Moves the glyphs of the screen and scrollback cells of the terminals to the
+/// new generation of the glyph cache, see schar_cache_evict_start().
+void terminal_keep_glyphs(void)
+{
+  terminals_keep_glyphs(true);
+}
+
+/// Replaces the glyphs of the screen and scrollback cells of the terminals by
+/// their first codepoint before the glyph cache is cleared.
+void terminal_forget_glyphs(void)
+{
+  terminals_keep_glyphs(false);
+}
+
+static void terminals_keep_glyphs(bool keep)
+{
+  FOR_ALL_BUFFERS(buf) {
+    Terminal *term = buf->terminal;
+    if (term == NULL) {
+      continue;
+    }
+    vterm_screen_keep_glyphs(term->vts, keep);
+    for (size_t i = 0; i < term->sb_current; i++) {
+      ScrollbackLine *sbrow = term->sb_buffer[i];
+      for (size_t col = 0; col < sbrow->cols; col++) {
+        schar_T sc = sbrow->cells[col].schar;
+        if (schar_high(sc)) {
+          sbrow->cells[col].schar = keep ? schar_cache_keep(sc)
+                                         : schar_from_char(schar_get_first_codepoint(sc));
+        }
+      }
+    }
+  }
+}
+
 bool terminal_running(const Terminal *term)
 {
   return !term->closed;
@@ -30,9 +30,11 @@
 #include "nvim/mbyte.h"
 #include "nvim/memory.h"
 #include "nvim/msgpack_rpc/channel.h"
+#include "nvim/os/fs.h"
 #include "nvim/os/input.h"
 #include "nvim/os/os.h"
 #include "nvim/os/os_defs.h"
+#include "nvim/os/time.h"
 #include "nvim/strings.h"
 #include "nvim/tui/input.h"
 #include "nvim/tui/terminfo.h"
@@ -61,9 +63,13 @@
 #define LINUXSET0C "\x1b[?0c"
 #define LINUXSET1C "\x1b[?1c"
 
+/// A run of ECMA-48 REP is used for this many equal cells or more.
+#define REPEAT_MIN 8
+
+/// Columns of a row which may differ from what the terminal shows.
 typedef struct {
-  int top, bot, left, right;
-} Rect;
+  int left, right;
+} Span;
 
 struct TUIData {
   Loop *loop;
@@ -82,7 +88,9 @@ struct TUIData {
   SignalWatcher winch_handle;
   uv_timer_t startup_delay_timer;
   UGrid grid;
-  kvec_t(Rect) invalid_regions;
+  UGrid shown;  ///< what the terminal shows, an attr of -1 means not known
+  Span *damage;  ///< for each row of "grid", the columns which need drawing
+  bool *line_wrap;  ///< for each row, the line continues on the next row
   int row, col;
   int out_fd;
   int pending_resize_events;
@@ -93,6 +101,7 @@ struct TUIData {
   bool can_set_lr_margin;  // smglr
   bool can_scroll;
   bool can_erase_chars;
+  bool can_repeat_char;  ///< ECMA-48 REP
   bool immediate_wrap_after_last_column;
   bool bce;
   bool mouse_enabled;
@@ -100,6 +109,8 @@ struct TUIData {
   bool mouse_enabled_save;
   bool title_enabled;
   bool sync_output;
+  bool sync_open;  ///< a synchronized update (mode 2026) was started
+  bool partial_flush;  ///< flushing a full buffer in the middle of a frame
   bool busy, is_invisible, want_invisible;
   bool set_cursor_color_as_str;
   bool cursor_has_color;
@@ -111,8 +122,17 @@ struct TUIData {
     bool grapheme_clusters : 1;
     bool theme_updates : 1;
     bool resize_events : 1;
+    bool left_and_right_margins : 1;
   } modes;
 
+  /// Scroll region left in the terminal by tui_grid_scroll(), so that the
+  /// next scroll of the same window does not need to set it again.  Reset
+  /// before anything is drawn.
+  struct {
+    bool rows, cols;  ///< "top" and "bot", "left" and "right" are set
+    int top, bot, left, right;
+  } scroll_region;
+
   FILE *screenshot;
   cursorentry_T cursor_shapes[SHAPE_IDX_COUNT];
   HlAttrs clear_attrs;
@@ -140,6 +160,13 @@ struct TUIData {
   int url;  ///< Index of URL currently being printed, if any
   StringBuilder urlbuf;  ///< Re-usable buffer for writing OSC 8 control sequences
   Arena ti_arena;
+  FILE *stats_file;  ///< $NVIM_TUI_STATS, see |tui-stats|
+  struct {
+    uint64_t frames;
+    size_t bytes;  ///< bytes written to the terminal
+    size_t frame_bytes;  ///< "bytes" at the end of the previous frame
+    int rows, cells;  ///< rows drawn and cells printed in this frame
+  } stats;
 };
 
 static bool cursor_style_enabled = false;
@@ -163,7 +190,6 @@ void tui_start(TUIData **tui_p, int *width, int *height, char **term, bool *rgb)
   tui->loop = &main_loop;
   tui->url = -1;
 
-  kv_init(tui->invalid_regions);
   kv_init(tui->urlbuf);
   signal_watcher_init(tui->loop, &tui->winch_handle, tui);
   signal_watcher_start(&tui->winch_handle, sigwinch_cb, SIGWINCH);
@@ -173,6 +199,11 @@ void tui_start(TUIData **tui_p, int *width, int *height, char **term, bool *rgb)
 
   tui->input.tk_ti_hook_fn = tui_tk_ti_getstr;
   ugrid_init(&tui->grid);
+  ugrid_init(&tui->shown);
+  const char *stats_path = os_getenv_noalloc("NVIM_TUI_STATS");
+  if (stats_path) {
+    tui->stats_file = os_fopen(stats_path, "a");
+  }
   tui_terminal_start(tui);
 
   uv_timer_init(&tui->loop->uv, &tui->startup_delay_timer);
@@ -527,6 +558,11 @@ static void terminfo_disable(TUIData *tui)
   }
 
   // Destroy output stuff
+  reset_scroll_region(tui);
+  if (tui->modes.left_and_right_margins) {
+    tui_set_term_mode(tui, kTermModeLeftAndRightMargins, false);
+    tui->modes.left_and_right_margins = false;
+  }
   tui_mode_change(tui, NULL_STRING, SHAPE_IDX_N);
   tui_mouse_off(tui);
   terminfo_out(tui, kTerm_exit_attribute_mode);
@@ -648,6 +684,10 @@ void tui_stop(TUIData *tui)
   signal_watcher_stop(&tui->winch_handle);
   signal_watcher_close(&tui->winch_handle, NULL);
   uv_close((uv_handle_t *)&tui->startup_delay_timer, NULL);
+  if (tui->stats_file) {
+    fclose(tui->stats_file);
+    tui->stats_file = NULL;
+  }
 }
 
 /// Callback function called when the response to the Device Attributes (DA1)
@@ -679,7 +719,9 @@ bool tui_is_stopped(TUIData *tui)
 void tui_free_all_mem(TUIData *tui)
 {
   ugrid_free(&tui->grid);
-  kv_destroy(tui->invalid_regions);
+  ugrid_free(&tui->shown);
+  xfree(tui->damage);
+  xfree(tui->line_wrap);
 
   const char *url;
   set_foreach(&urls, url, {
@@ -731,15 +773,91 @@ static bool attrs_differ(TUIData *tui, int id1, int id2, bool rgb)
   }
 }
 
+/// @return  the foreground or background color printed for "attrs", or -1 for
+///          the default color of the terminal.
+static int attr_color(TUIData *tui, HlAttrs attrs, bool background)
+{
+  int attr = tui->rgb ? attrs.rgb_ae_attr : attrs.cterm_ae_attr;
+  if (tui->rgb && !(attr & (background ? HL_BG_INDEXED : HL_FG_INDEXED))) {
+    int color = background ? attrs.rgb_bg_color : attrs.rgb_fg_color;
+    if (color == -1) {
+      color = background ? tui->clear_attrs.rgb_bg_color : tui->clear_attrs.rgb_fg_color;
+    }
+    return color;
+  }
+  int color = background ? attrs.cterm_bg_color : attrs.cterm_fg_color;
+  if (!color) {
+    color = background ? tui->clear_attrs.cterm_bg_color : tui->clear_attrs.cterm_fg_color;
+  }
+  return color - 1;
+}
+
+static void print_color(TUIData *tui, int attr, int color, bool background)
+{
+  if (color == -1) {
+    return;
+  }
+  if (tui->rgb && !(attr & (background ? HL_BG_INDEXED : HL_FG_INDEXED))) {
+    terminfo_print_num3(tui, background ? kTerm_set_rgb_background : kTerm_set_rgb_foreground,
+                        (color >> 16) & 0xff,  // red
+                        (color >> 8) & 0xff,   // green
+                        color & 0xff);         // blue
+  } else {
+    terminfo_print_num1(tui, background ? kTerm_set_a_background : kTerm_set_a_foreground, color);
+  }
+}
+
+/// Changes only the colors, when that is all that differs between the
+/// current attributes and "attrs".  Setting the default color needs a reset
+/// of all attributes, thus is not done here.
+///
+/// @return  false if the full sequence is needed.
+static bool update_colors(TUIData *tui, int prev_id, HlAttrs attrs, int fg, int bg)
+{
+  if (prev_id < 0) {
+    return false;
+  }
+  HlAttrs prev = kv_A(tui->attrs, (size_t)prev_id);
+  int attr = tui->rgb ? attrs.rgb_ae_attr : attrs.cterm_ae_attr;
+  int prev_attr = tui->rgb ? prev.rgb_ae_attr : prev.cterm_ae_attr;
+  if (attr != prev_attr || attrs.url != prev.url || attrs.rgb_sp_color != prev.rgb_sp_color) {
+    return false;
+  }
+  int prev_fg = attr_color(tui, prev, false);
+  int prev_bg = attr_color(tui, prev, true);
+  if ((fg != prev_fg && fg == -1) || (bg != prev_bg && bg == -1)) {
+    return false;
+  }
+
+  if (fg != prev_fg) {
+    print_color(tui, attr, fg, false);
+  }
+  if (bg != prev_bg) {
+    print_color(tui, attr, bg, true);
+    if (!tui->bce) {
+      tui->can_clear_attr = false;  // see the end of update_attrs()
+    }
+  }
+  // A color which is not the default one was set.
+  tui->default_attr = false;
+  return true;
+}
+
 static void update_attrs(TUIData *tui, int attr_id)
 {
   if (!attrs_differ(tui, attr_id, tui->print_attr_id, tui->rgb)) {
     tui->print_attr_id = attr_id;
     return;
   }
+  int prev_id = tui->print_attr_id;
   tui->print_attr_id = attr_id;
   HlAttrs attrs = kv_A(tui->attrs, (size_t)attr_id);
   int attr = tui->rgb ? attrs.rgb_ae_attr : attrs.cterm_ae_attr;
+  int fg = attr_color(tui, attrs, false);
+  int bg = attr_color(tui, attrs, true);
+  if (update_colors(tui, prev_id, attrs, fg, bg)) {
+    return;
+  }
 
   bool bold = attr & HL_BOLD;
   bool italic = attr & HL_ITALIC;
@@ -839,40 +957,8 @@ static void update_attrs(TUIData *tui, int attr_id)
     }
   }
 
-  int fg, bg;
-  if (tui->rgb && !(attr & HL_FG_INDEXED)) {
-    fg = ((attrs.rgb_fg_color != -1)
-          ? attrs.rgb_fg_color : tui->clear_attrs.rgb_fg_color);
-    if (fg != -1) {
-      terminfo_print_num3(tui, kTerm_set_rgb_foreground,
-                          (fg >> 16) & 0xff,  // red
-                          (fg >> 8) & 0xff,   // green
-                          fg & 0xff);         // blue
-    }
-  } else {
-    fg = (attrs.cterm_fg_color
-          ? attrs.cterm_fg_color - 1 : (tui->clear_attrs.cterm_fg_color - 1));
-    if (fg != -1) {
-      terminfo_print_num1(tui, kTerm_set_a_foreground, fg);
-    }
-  }
-
-  if (tui->rgb && !(attr & HL_BG_INDEXED)) {
-    bg = ((attrs.rgb_bg_color != -1)
-          ? attrs.rgb_bg_color : tui->clear_attrs.rgb_bg_color);
-    if (bg != -1) {
-      terminfo_print_num3(tui, kTerm_set_rgb_background,
-                          (bg >> 16) & 0xff,  // red
-                          (bg >> 8) & 0xff,   // green
-                          bg & 0xff);         // blue
-    }
-  } else {
-    bg = (attrs.cterm_bg_color
-          ? attrs.cterm_bg_color - 1 : (tui->clear_attrs.cterm_bg_color - 1));
-    if (bg != -1) {
-      terminfo_print_num1(tui, kTerm_set_a_background, bg);
-    }
-  }
+  print_color(tui, attr, fg, false);
+  print_color(tui, attr, bg, true);
 
   if (tui->url != attrs.url) {
     if (attrs.url >= 0) {
@@ -981,7 +1067,8 @@ static void cursor_goto(TUIData *tui, int row, int col)
     ugrid_goto(grid, row, col);
     return;
   }
-  if (grid->row == -1) {
+  if (grid->row == -1 || tui->scroll_region.rows || tui->scroll_region.cols) {
+    // Relative motions may scroll or stop at the margins.
     goto safe_move;
   }
   if (0 == col
@@ -1075,7 +1162,7 @@ static void print_spaces(TUIData *tui, int width)
     if (left == 0) {
       break;  // likely: didn't need to flush for sm0l spaces
     }
-    flush_buf(tui);
+    flush_buf_partial(tui);
   }
 
   grid->col += width;
@@ -1128,6 +1215,8 @@ static void clear_region(TUIData *tui, int top, int bot, int left, int right, in
 {
   UGrid *grid = &tui->grid;
 
+  reset_scroll_region(tui);
+
   // Setting the default colors is delayed until after startup to avoid flickering
   // with the default colorscheme background. Consequently, any flush that happens
   // during startup would result in clearing invalidated regions with zeroed
@@ -1137,6 +1226,7 @@ static void clear_region(TUIData *tui, int top, int bot, int left, int right, in
     update_attrs(tui, attr_id);
   } else {
     terminfo_out(tui, kTerm_exit_attribute_mode);
+    tui->print_attr_id = -1;
   }
 
   // Background is set to the default color and the right edge matches the
@@ -1167,46 +1257,71 @@ static void clear_region(TUIData *tui, int top, int bot, int left, int right, in
   }
 }
 
+/// Sets the scroll region, unless the terminal already has it.
 static void set_scroll_region(TUIData *tui, int top, int bot, int left, int right)
 {
   UGrid *grid = &tui->grid;
+  bool fullwidth = left == 0 && right == tui->width - 1;
 
-  terminfo_print_num2(tui, kTerm_change_scroll_region, top, bot);
-  if (left != 0 || right != tui->width - 1) {
-    tui_set_term_mode(tui, kTermModeLeftAndRightMargins, true);
+  // Both DECSTBM and DECSLRM move the cursor home.
+  if (!tui->scroll_region.rows || tui->scroll_region.top != top
+      || tui->scroll_region.bot != bot) {
+    terminfo_print_num2(tui, kTerm_change_scroll_region, top, bot);
+    tui->scroll_region.rows = true;
+    tui->scroll_region.top = top;
+    tui->scroll_region.bot = bot;
+    grid->row = -1;
+  }
+  if (fullwidth ? tui->scroll_region.cols
+      : (!tui->scroll_region.cols || tui->scroll_region.left != left
+         || tui->scroll_region.right != right)) {
+    // DECLRMM stays enabled until the TUI stops, see terminfo_disable().
+    if (!tui->modes.left_and_right_margins) {
+      tui_set_term_mode(tui, kTermModeLeftAndRightMargins, true);
+      tui->modes.left_and_right_margins = true;
+    }
     terminfo_print_num2(tui, kTerm_set_lr_margin, left, right);
+    tui->scroll_region.cols = !fullwidth;
+    tui->scroll_region.left = left;
+    tui->scroll_region.right = right;
+    grid->row = -1;
   }
-  grid->row = -1;
 }
 
-static void reset_scroll_region(TUIData *tui, bool fullwidth)
+/// Resets the scroll region left by tui_grid_scroll().  Must be called
+/// before printing, as text would wrap or scroll within the region.
+static void reset_scroll_region(TUIData *tui)
 {
   UGrid *grid = &tui->grid;
 
-  if (tui->terminfo_ext.reset_scroll_region) {
-    out_len(tui, tui->terminfo_ext.reset_scroll_region);
-  } else {
-    terminfo_print_num2(tui, kTerm_change_scroll_region, 0, tui->height - 1);
+  if (tui->scroll_region.rows) {
+    if (tui->terminfo_ext.reset_scroll_region) {
+      out_len(tui, tui->terminfo_ext.reset_scroll_region);
+    } else {
+      terminfo_print_num2(tui, kTerm_change_scroll_region, 0, tui->height - 1);
+    }
+    tui->scroll_region.rows = false;
+    grid->row = -1;
   }
-  if (!fullwidth) {
+  if (tui->scroll_region.cols) {
     terminfo_print_num2(tui, kTerm_set_lr_margin, 0, tui->width - 1);
-    tui_set_term_mode(tui, kTermModeLeftAndRightMargins, false);
+    tui->scroll_region.cols = false;
+    grid->row = -1;
   }
-  grid->row = -1;
 }
 
 void tui_grid_resize(TUIData *tui, Integer g, Integer width, Integer height)
 {
   UGrid *grid = &tui->grid;
+  reset_scroll_region(tui);
   ugrid_resize(grid, (int)width, (int)height);
-
-  // resize might not always be followed by a clear before flush
-  // so clip the invalid region
-  for (size_t i = 0; i < kv_size(tui->invalid_regions); i++) {
-    Rect *r = &kv_A(tui->invalid_regions, i);
-    r->bot = MIN(r->bot, grid->height);
-    r->right = MIN(r->right, grid->width);
-  }
+  // The terminal reflows or clears its contents when it is resized.
+  ugrid_resize(&tui->shown, (int)width, (int)height);
+  forget_shown(tui, 0, grid->height, 0, grid->width);
+  tui->damage = xrealloc(tui->damage, (size_t)height * sizeof(Span));
+  memset(tui->damage, 0, (size_t)height * sizeof(Span));
+  tui->line_wrap = xrealloc(tui->line_wrap, (size_t)height * sizeof(bool));
+  memset(tui->line_wrap, 0, (size_t)height * sizeof(bool));
 
   if (tui->pending_resize_events == 0 && !tui->is_starting) {
     // Resize the _host_ terminal.
@@ -1222,10 +1337,13 @@ void tui_grid_clear(TUIData *tui, Integer g)
 {
   UGrid *grid = &tui->grid;
   ugrid_clear(grid);
-  // safe to clear cache at this point
-  schar_cache_clear_if_full();
-  kv_size(tui->invalid_regions) = 0;
+  ugrid_clear(&tui->shown);
+  memset(tui->damage, 0, (size_t)grid->height * sizeof(Span));
+  memset(tui->line_wrap, 0, (size_t)grid->height * sizeof(bool));
   clear_region(tui, 0, tui->height, 0, tui->width, 0);
+  // Nothing is known about the part of the grid outside of the terminal.
+  forget_shown(tui, tui->height, grid->height, 0, grid->width);
+  forget_shown(tui, 0, grid->height, tui->width, grid->width);
 }
 
 void tui_grid_cursor_goto(TUIData *tui, Integer grid, Integer row, Integer col)
@@ -1417,8 +1535,6 @@ void tui_grid_scroll(TUIData *tui, Integer g, Integer startrow, Integer endrow,
   bool fullwidth = left == 0 && right == tui->width - 1;
   bool full_screen_scroll = fullwidth && top == 0 && bot == tui->height - 1;
 
-  ugrid_scroll(grid, top, bot, left, right, (int)rows);
-
   bool has_lr_margins = tui->has_left_and_right_margin_mode && tui->can_set_lr_margin;
 
   bool can_scroll = tui->can_scroll
@@ -1427,8 +1543,17 @@ void tui_grid_scroll(TUIData *tui, Integer g, Integer startrow, Integer endrow,
                             && ((left == 0 && right == tui->width - 1) || has_lr_margins)));
 
   if (can_scroll) {
-    // Change terminal scroll region and move cursor to the top
-    if (!full_screen_scroll) {
+    // The terminal must show the lines before they are moved.
+    draw_all_damage(tui);
+  }
+  ugrid_scroll(grid, top, bot, left, right, (int)rows);
+
+  if (can_scroll) {
+    // Change terminal scroll region and move cursor to the top.  The region
+    // is kept for the next scroll, until something is drawn.
+    if (full_screen_scroll) {
+      reset_scroll_region(tui);
+    } else {
       set_scroll_region(tui, top, bot, left, right);
     }
     cursor_goto(tui, top, left);
@@ -1448,18 +1573,24 @@ void tui_grid_scroll(TUIData *tui, Integer g, Integer startrow, Integer endrow,
       }
     }
 
-    // Restore terminal scroll region and cursor
-    if (!full_screen_scroll) {
-      reset_scroll_region(tui, fullwidth);
+
+    ugrid_scroll(&tui->shown, top, bot, left, right, (int)rows);
+    // What the terminal fills the new lines with depends on the terminal.
+    if (rows > 0) {
+      forget_shown(tui, bot - (int)rows + 1, bot + 1, left, right + 1);
+    } else {
+      forget_shown(tui, top, top - (int)rows, left, right + 1);
     }
   } else {
-    // Mark the moved region as invalid for redrawing later
+    // Draw the moved lines later, where they differ from what the terminal shows.
     if (rows > 0) {
       endrow = endrow - rows;
     } else {
       startrow = startrow - rows;
     }
-    invalidate(tui, (int)startrow, (int)endrow, (int)startcol, (int)endcol);
+    for (int row = (int)startrow; row < (int)endrow; row++) {
+      add_damage(tui, row, (int)startcol, (int)endcol);
+    }
   }
 }
 
@@ -1483,12 +1614,35 @@ int32_t tui_add_url(TUIData *tui, const char *url)
   return (int32_t)k;
 }
 
+/// @return  true if "a" and "b" are output the same way.
+static bool hl_attrs_equal(HlAttrs a, HlAttrs b)
+{
+  return a.rgb_ae_attr == b.rgb_ae_attr && a.cterm_ae_attr == b.cterm_ae_attr
+         && a.rgb_fg_color == b.rgb_fg_color && a.rgb_bg_color == b.rgb_bg_color
+         && a.rgb_sp_color == b.rgb_sp_color && a.cterm_fg_color == b.cterm_fg_color
+         && a.cterm_bg_color == b.cterm_bg_color && a.hl_blend == b.hl_blend && a.url == b.url;
+}
+
 void tui_hl_attr_define(TUIData *tui, Integer id, HlAttrs attrs, HlAttrs cterm_attrs, Array info)
 {
   attrs.cterm_ae_attr = cterm_attrs.cterm_ae_attr;
   attrs.cterm_fg_color = cterm_attrs.cterm_fg_color;
   attrs.cterm_bg_color = cterm_attrs.cterm_bg_color;
 
+  if ((size_t)id < kv_size(tui->attrs)) {
+    if (hl_attrs_equal(kv_A(tui->attrs, (size_t)id), attrs)) {
+      return;  // redefined the same way, e.g. when reloading a colorscheme
+    }
+    // The cells with this attr on the terminal may not look like it anymore.
+    UGrid *shown = &tui->shown;
+    for (int row = 0; row < shown->height; row++) {
+      UGRID_FOREACH_CELL(shown, row, 0, shown->width, {
+        if (cell->attr == id) {
+          cell->attr = -1;
+        }
+      });
+    }
+  }
   kv_a(tui->attrs, (size_t)id) = attrs;
 }
 
@@ -1544,8 +1698,6 @@ void tui_ui_send(TUIData *tui, String content)
 /// @see flush_buf
 void tui_flush(TUIData *tui)
 {
-  UGrid *grid = &tui->grid;
-
   size_t nrevents = loop_size(tui->loop);
   if (nrevents > TOO_MANY_EVENTS) {
     WLOG("TUI event-queue flooded (thread_events=%zu); purging", nrevents);
@@ -1558,34 +1710,31 @@ void tui_flush(TUIData *tui)
     tui_busy_stop(tui);  // avoid hidden cursor
   }
 
-  while (kv_size(tui->invalid_regions)) {
-    Rect r = kv_pop(tui->invalid_regions);
-    assert(r.bot <= grid->height && r.right <= grid->width);
+  uint64_t start = tui->stats_file ? os_hrtime() : 0;
+  draw_all_damage(tui);
+  cursor_goto(tui, tui->row, tui->col);
 
-    for (int row = r.top; row < r.bot; row++) {
-      int clear_attr = grid->cells[row][r.right - 1].attr;
-      int clear_col;
-      for (clear_col = r.right; clear_col > 0; clear_col--) {
-        UCell *cell = &grid->cells[row][clear_col - 1];
-        if (!(cell->data == schar_from_ascii(' ')
-              && cell->attr == clear_attr)) {
-          break;
-        }
-      }
+  flush_buf(tui);
 
-      UGRID_FOREACH_CELL(grid, row, r.left, clear_col, {
-        print_cell_at_pos(tui, row, curcol, cell,
-                          curcol < clear_col - 1 && (cell + 1)->data == NUL);
-      });
-      if (clear_col < r.right) {
-        clear_region(tui, row, row + 1, clear_col, r.right, clear_attr);
-      }
-    }
+  // Safe to move the glyphs in use to a new cache at this point, no other
+  // schar_T values are kept between events.
+  if (schar_cache_full()) {
+    schar_cache_evict_start();
+    ugrid_keep_glyphs(&tui->grid);
+    ugrid_keep_glyphs(&tui->shown);
+    schar_cache_evict_finish();
   }
 
-  cursor_goto(tui, tui->row, tui->col);
-
-  flush_buf(tui);
+  if (tui->stats_file) {
+    tui->stats.frames++;
+    fprintf(tui->stats_file, "frame %" PRIu64 ": %zu bytes, %d rows, %d cells, %" PRIu64 " us\n",
+            tui->stats.frames, tui->stats.bytes - tui->stats.frame_bytes, tui->stats.rows,
+            tui->stats.cells, (os_hrtime() - start) / 1000);
+    fflush(tui->stats_file);
+  }
+  tui->stats.frame_bytes = tui->stats.bytes;
+  tui->stats.rows = 0;
+  tui->stats.cells = 0;
 }
 
 /// Dumps termcap info to the messages area, if 'verbose' >= 3.
@@ -1759,65 +1908,189 @@ void tui_raw_line(TUIData *tui, Integer g, Integer linerow, Integer startcol, In
                   const sattr_T *attrs)
 {
   UGrid *grid = &tui->grid;
+  int row = (int)linerow;
   for (Integer c = startcol; c < endcol; c++) {
-    grid->cells[linerow][c].data = chunk[c - startcol];
+    grid->cells[row][c].data = chunk[c - startcol];
     assert((size_t)attrs[c - startcol] < kv_size(tui->attrs));
-    grid->cells[linerow][c].attr = attrs[c - startcol];
+    grid->cells[row][c].attr = attrs[c - startcol];
   }
-  UGRID_FOREACH_CELL(grid, (int)linerow, (int)startcol, (int)endcol, {
-    print_cell_at_pos(tui, (int)linerow, curcol, cell,
-                      curcol < endcol - 1 && (cell + 1)->data == NUL);
-  });
-
   if (clearcol > endcol) {
-    ugrid_clear_chunk(grid, (int)linerow, (int)endcol, (int)clearcol,
-                      (sattr_T)clearattr);
-    clear_region(tui, (int)linerow, (int)linerow + 1, (int)endcol, (int)clearcol,
-                 (int)clearattr);
+    ugrid_clear_chunk(grid, row, (int)endcol, (int)clearcol, (sattr_T)clearattr);
   }
+  add_damage(tui, row, (int)startcol, (int)MAX(endcol, clearcol));
 
-  if (flags & kLineFlagWrap && tui->width == grid->width
-      && linerow + 1 < grid->height) {
-    // Only do line wrapping if the grid width is equal to the terminal
-    // width and the line continuation is within the grid.
+  // Only do line wrapping if the grid width is equal to the terminal
+  // width and the line continuation is within the grid.
+  tui->line_wrap[row] = (flags & kLineFlagWrap) && tui->width == grid->width
+                        && row + 1 < grid->height;
+  if (tui->line_wrap[row]) {
+    // The last char of the row is printed, also when it did not change, and
+    // the next line is printed immediately after it without an intervening
+    // newline, so that the terminal knows the line wraps.
+    add_damage(tui, row, grid->width - 1, grid->width);
+  }
+}
 
-    if (endcol != grid->width) {
-      // Print the last char of the row, if we haven't already done so.
-      int size = grid->cells[linerow][grid->width - 1].data == NUL ? 2 : 1;
-      print_cell_at_pos(tui, (int)linerow, grid->width - size,
-                        &grid->cells[linerow][grid->width - size], size == 2);
-    }
+/// Adds columns "left" to "right" (exclusive) of "row" to the damage.
+static void add_damage(TUIData *tui, int row, int left, int right)
+{
+  Span *d = &tui->damage[row];
+  if (d->left >= d->right) {
+    *d = (Span){ left, right };
+  } else {
+    d->left = MIN(d->left, left);
+    d->right = MAX(d->right, right);
+  }
+}
 
-    // Wrap the cursor over to the next line. The next line will be
-    // printed immediately without an intervening newline.
-    final_column_wrap(tui);
+/// Forgets what the terminal shows in a region, so that it is drawn again
+/// when it is damaged.
+static void forget_shown(TUIData *tui, int top, int bot, int left, int right)
+{
+  UGrid *shown = &tui->shown;
+  bot = MIN(bot, shown->height);
+  right = MIN(right, shown->width);
+  for (int row = top; row < bot; row++) {
+    UGRID_FOREACH_CELL(shown, row, left, right, {
+      cell->attr = -1;
+    });
   }
 }
 
+/// Redraws a region at the next flush, whatever the terminal shows there.
 static void invalidate(TUIData *tui, int top, int bot, int left, int right)
 {
-  Rect *intersects = NULL;
+  forget_shown(tui, top, bot, left, right);
+  bot = MIN(bot, tui->grid.height);
+  right = MIN(right, tui->grid.width);
+  for (int row = top; row < bot && left < right; row++) {
+    add_damage(tui, row, left, right);
+  }
+}
 
-  for (size_t i = 0; i < kv_size(tui->invalid_regions); i++) {
-    Rect *r = &kv_A(tui->invalid_regions, i);
-    // adjacent regions are treated as overlapping
-    if (!(top > r->bot || bot < r->top)
-        && !(left > r->right || right < r->left)) {
-      intersects = r;
-      break;
+/// @return  whether the cells from "col" to "endcol" (exclusive) are ASCII
+///          and use the current attributes.
+static bool same_attr_ascii(TUIData *tui, int row, int col, int endcol)
+{
+  UCell *cells = tui->grid.cells[row];
+  for (; col < endcol; col++) {
+    if (schar_get_ascii(cells[col].data) == 0
+        || attrs_differ(tui, cells[col].attr, tui->print_attr_id, tui->rgb)) {
+      return false;
     }
   }
+  return true;
+}
 
-  if (intersects) {
-    // If top/bot/left/right intersects with a invalid rect, we replace it
-    // by the union
-    intersects->top = MIN(top, intersects->top);
-    intersects->bot = MAX(bot, intersects->bot);
-    intersects->left = MIN(left, intersects->left);
-    intersects->right = MAX(right, intersects->right);
-  } else {
-    // Else just add a new entry;
-    kv_push(tui->invalid_regions, ((Rect) { top, bot, left, right }));
+/// @return  whether the terminal shows "width" cells from "col" as in the grid.
+static bool cell_shown(TUIData *tui, int row, int col, int width)
+{
+  UCell *cell = tui->grid.cells[row] + col;
+  UCell *shown = tui->shown.cells[row] + col;
+  for (int i = 0; i < width; i++) {
+    if (shown[i].attr == -1 || cell[i].data != shown[i].data || cell[i].attr != shown[i].attr) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Draws the damaged part of a row.  Only the cells which differ from what
+/// the terminal shows are printed, a run of equal cells with REP if the
+/// terminal has it, and trailing blank cells are cleared with EL or ECH.
+static void draw_damage(TUIData *tui, int row)
+{
+  UGrid *grid = &tui->grid;
+  UCell *cells = grid->cells[row];
+  int left = tui->damage[row].left;
+  int right = MIN(tui->damage[row].right, grid->width);
+  tui->damage[row] = (Span){ 0, 0 };
+  if (left >= right) {
+    return;
+  }
+  reset_scroll_region(tui);
+  // Include the whole double-width chars at the edges.
+  if (left > 0 && (cells[left].data == NUL || tui->shown.cells[row][left].data == NUL)) {
+    left--;
+  }
+  if (right < grid->width && cells[right].data == NUL) {
+    right++;
+  }
+  tui->stats.rows++;
+
+  bool wrap = tui->line_wrap[row];
+  // Trailing cells which are blank with the same attr as the last one are
+  // cleared at once.
+  int clear_attr = cells[right - 1].attr;
+  int clear_col = right;
+  while (!wrap && clear_col > left && cells[clear_col - 1].data == schar_from_ascii(' ')
+         && cells[clear_col - 1].attr == clear_attr) {
+    clear_col--;
+  }
+
+  int col = left;
+  while (col < clear_col) {
+    UCell *cell = &cells[col];
+    int width = col < clear_col - 1 && (cell + 1)->data == NUL ? 2 : 1;
+    if (cell_shown(tui, row, col, width) && !(wrap && col + width == grid->width)) {
+      col += width;
+      continue;
+    }
+
+    // It is cheaper to print a few unchanged cells than to move over them.
+    if (grid->row == row && grid->col < col && col - grid->col <= 3
+        && same_attr_ascii(tui, row, grid->col, col)) {
+      while (grid->col < col) {
+        print_cell_at_pos(tui, row, grid->col, &cells[grid->col], false);
+        tui->stats.cells++;
+      }
+    }
+
+    // REP must not reach the last column, where terminals differ in wrapping.
+    int count = 1;
+    if (tui->can_repeat_char && width == 1 && schar_get_ascii(cell->data)) {
+      int end = MIN(clear_col, tui->width - 1);
+      while (col + count < end && cells[col + count].data == cell->data
+             && cells[col + count].attr == cell->attr) {
+        count++;
+      }
+    }
+    print_cell_at_pos(tui, row, col, cell, width == 2);
+    tui->stats.cells += width;
+    if (count >= REPEAT_MIN && grid->row == row) {
+      out_printf(tui, 32, "\x1b[%db", count - 1);
+      grid->col += count - 1;
+      tui->stats.cells += count - 1;
+      col += count;
+    } else {
+      col += width;
+    }
+  }
+
+  if (clear_col < right) {
+    // Clear from the first cell which is not blank on the terminal.
+    int from = clear_col;
+    while (from < right && cell_shown(tui, row, from, 1)) {
+      from++;
+    }
+    if (from < right) {
+      clear_region(tui, row, row + 1, from, right, clear_attr);
+      tui->stats.cells += right - from;
+    }
+  }
+
+  memcpy(tui->shown.cells[row] + left, cells + left, (size_t)(right - left) * sizeof(UCell));
+  if (wrap) {
+    // Wrap the cursor over to the next line.
+    final_column_wrap(tui);
+  }
+}
+
+/// Draws all damaged rows.
+static void draw_all_damage(TUIData *tui)
+{
+  for (int row = 0; row < tui->grid.height; row++) {
+    draw_damage(tui, row);
   }
 }
 
@@ -1877,12 +2150,12 @@ static void out(TUIData *tui, const char *str, size_t len)
   size_t available = sizeof(tui->buf) - tui->bufpos;
 
   if (len > available) {
-    flush_buf(tui);
+    flush_buf_partial(tui);
     if (len > sizeof(tui->buf)) {
       // Don't use tui->buf[] when the string to output is too long. #30794
       tui->buf_to_flush = (char *)str;
       tui->bufpos = len;
-      flush_buf(tui);
+      flush_buf_partial(tui);
       return;
     }
   }
@@ -1905,7 +2178,7 @@ void out_printf(TUIData *tui, size_t limit, const char *fmt, ...)
   assert(limit <= sizeof(tui->buf));
   size_t available = sizeof(tui->buf) - tui->bufpos;
   if (available < limit) {
-    flush_buf(tui);
+    flush_buf_partial(tui);
   }
 
   va_list ap;
@@ -1956,7 +2229,7 @@ static void terminfo_print(TUIData *tui, TerminfoDef what, TPVAR *params)
   }
 
   // try again with fresh buffer
-  flush_buf(tui);
+  flush_buf_partial(tui);
   size_t len = terminfo_fmt(tui->buf + tui->bufpos, tui->buf + sizeof(tui->buf), str, params);
   if (len > 0) {
     tui->bufpos += len;
@@ -2391,6 +2664,12 @@ static void augment_terminfo(TUIData *tui, const char *term, int vte_version, in
     tui_enable_extended_underline(tui);
   }
 
+  // ECMA-48 REP.  terminfo has it as "rep", but not the builtin entries.
+  tui->can_repeat_char = !tmux && !screen
+                         && (true_xterm || kitty || weztermv != NULL
+                             || terminfo_is_term_family(term, "foot")
+                             || terminfo_is_term_family(term, "xterm-ghostty"));
+
   if (kitty || (vte_version != 0 && vte_version < 5400)) {
     // Never use modifyOtherKeys in kitty if kitty keyboard protocol query fails.
     // Also don't emit the sequence to enable modifyOtherKeys in old VTE versions.
@@ -2420,7 +2699,10 @@ static bool should_invisible(TUIData *tui)
 static size_t flush_buf_start(TUIData *tui, char *buf, size_t len)
   FUNC_ATTR_NONNULL_ALL
 {
-  if (tui->sync_output && tui->has_sync_mode) {
+  if (tui->sync_open) {
+    return 0;  // still in the frame started by an earlier partial flush
+  } else if (tui->sync_output && tui->has_sync_mode) {
+    tui->sync_open = true;
     return xstrlcpy(buf, "\x1b[?2026h", len);
   } else if (!tui->is_invisible) {
     tui->is_invisible = true;
@@ -2446,11 +2728,16 @@ static size_t flush_buf_start(TUIData *tui, char *buf, size_t len)
 static size_t flush_buf_end(TUIData *tui, char *buf, size_t len)
   FUNC_ATTR_NONNULL_ALL
 {
+  if (tui->partial_flush) {
+    return 0;  // the frame continues, keep the update open and the cursor hidden
+  }
+
   size_t offset = 0;
-  if (tui->sync_output && tui->has_sync_mode) {
+  if (tui->sync_open) {
 #define SYNC_END "\x1b[?2026l"
     memcpy(buf, SYNC_END, sizeof SYNC_END);
     offset += sizeof SYNC_END - 1;
+    tui->sync_open = false;
   }
 
   const char *str = NULL;
@@ -2479,7 +2766,7 @@ static void flush_buf(TUIData *tui)
   char pre[32];
   char post[32];
 
-  if (tui->bufpos <= 0 && tui->is_invisible == should_invisible(tui)) {
+  if (tui->bufpos <= 0 && tui->is_invisible == should_invisible(tui) && !tui->sync_open) {
     return;
   }
 
@@ -2491,6 +2778,7 @@ static void flush_buf(TUIData *tui)
 
   bufs[2].base = post;
   bufs[2].len = UV_BUF_LEN(flush_buf_end(tui, post, sizeof(post)));
+  tui->stats.bytes += bufs[0].len + bufs[1].len + bufs[2].len;
 
   if (tui->screenshot) {
     for (size_t i = 0; i < ARRAY_SIZE(bufs); i++) {
@@ -2508,6 +2796,15 @@ static void flush_buf(TUIData *tui)
   tui->bufpos = 0;
 }
 
+/// Flushes a full buffer in the middle of a frame.  The terminal is not told
+/// that the frame ended, so that it does not show half of it.
+static void flush_buf_partial(TUIData *tui)
+{
+  tui->partial_flush = true;
+  flush_buf(tui);
+  tui->partial_flush = false;
+}
+
 /// Try to get "kbs" code from stty because "the terminfo kbs entry is extremely
 /// unreliable." (Vim, Bash, and tmux also do this.)
 ///
@@ -69,6 +69,16 @@ void ugrid_scroll(UGrid *grid, int top, int bot, int left, int right, int count)
   }
 }
 
+/// Keeps the glyphs of all cells when the glyph cache is full.
+void ugrid_keep_glyphs(UGrid *grid)
+{
+  for (int row = 0; row < grid->height; row++) {
+    UGRID_FOREACH_CELL(grid, row, 0, grid->width, {
+      cell->data = schar_cache_keep(cell->data);
+    });
+  }
+}
+
 static void clear_region(UGrid *grid, int top, int bot, int left, int right, sattr_T attr)
 {
   for (int row = top; row <= bot; row++) {
@@ -678,7 +678,7 @@ Array ui_array(Arena *arena)
   Array all_uis = arena_array(arena, ui_count);
   for (size_t i = 0; i < ui_count; i++) {
     RemoteUI *ui = uis[i];
-    Dict info = arena_dict(arena, 10 + kUIExtCount);
+    Dict info = arena_dict(arena, 12 + kUIExtCount);
     PUT_C(info, "width", INTEGER_OBJ(ui->width));
     PUT_C(info, "height", INTEGER_OBJ(ui->height));
     PUT_C(info, "rgb", BOOLEAN_OBJ(ui->rgb));
@@ -701,6 +701,17 @@ Array ui_array(Arena *arena)
     }
     PUT_C(info, "chan", INTEGER_OBJ((Integer)ui->channel_id));
 
+    if (ui->frame_interval > 0) {
+      PUT_C(info, "frame_interval", INTEGER_OBJ(ui->frame_interval));
+      Dict stats = arena_dict(arena, 5);
+      PUT_C(stats, "frames", INTEGER_OBJ((Integer)ui->frame_stats.frames));
+      PUT_C(stats, "coalesced", INTEGER_OBJ((Integer)ui->frame_stats.coalesced));
+      PUT_C(stats, "backlog_waits", INTEGER_OBJ((Integer)ui->frame_stats.backlog_waits));
+      PUT_C(stats, "max_backlog", INTEGER_OBJ((Integer)ui->frame_stats.max_backlog));
+      PUT_C(stats, "bytes", INTEGER_OBJ((Integer)ui->frame_stats.bytes));
+      PUT_C(info, "frame_stats", DICT_OBJ(stats));
+    }
+
     ADD_C(all_uis, DICT_OBJ(info));
   }
   return all_uis;
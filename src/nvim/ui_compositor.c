@@ -30,10 +30,21 @@
 #include "nvim/ui.h"
 #include "nvim/ui_compositor.h"
 
+typedef kvec_t(ScreenGrid *) GridList;
+
 #include "ui_compositor.c.generated.h"
 
 static int composed_uis = 0;
-kvec_t(ScreenGrid *) layers = KV_INITIAL_VALUE;
+GridList layers = KV_INITIAL_VALUE;
+
+/// For each screen row, the layers which may cover it, bottom to top.  Every
+/// list starts with the default grid.  Only the rows of a layer are updated
+/// when it is placed, moved, raised or removed, so that composing a row does
+/// not need to look at every layer.  Not valid when "row_layers_rows" differs
+/// from the height of the default grid, it is rebuilt when used then.
+static GridList *row_layers = NULL;
+static int row_layers_rows = 0;
+static bool row_layers_valid = false;
 
 static size_t bufsize = 0;
 static schar_T *linebuf;
@@ -63,6 +74,10 @@ void ui_comp_init(void)
 #ifdef EXITFREE
 void ui_comp_free_all_mem(void)
 {
+  for (int row = 0; row < row_layers_rows; row++) {
+    kv_destroy(row_layers[row]);
+  }
+  xfree(row_layers);
   kv_destroy(layers);
   xfree(linebuf);
   xfree(attrbuf);
@@ -81,6 +96,8 @@ void ui_comp_attach(RemoteUI *ui)
 {
   composed_uis++;
   ui->composed = true;
+  // The default grid might have been resized without a composed UI.
+  row_layers_valid = false;
 }
 
 void ui_comp_detach(RemoteUI *ui)
@@ -110,6 +127,7 @@ void ui_comp_layers_adjust(size_t layer_idx, bool raise)
 {
   size_t size = layers.size;
   ScreenGrid *layer = layers.items[layer_idx];
+  row_layers_del(layer);
 
   if (raise) {
     while (layer_idx < size - 1 && layer->zindex > layers.items[layer_idx + 1]->zindex) {
@@ -129,6 +147,7 @@ void ui_comp_layers_adjust(size_t layer_idx, bool raise)
   layers.items[layer_idx] = layer;
   layer->comp_index = layer_idx;
   layer->pending_comp_index_update = true;
+  row_layers_add(layer);
 }
 
 /// Places `grid` at (col,row) position with (width * height) size.
@@ -143,6 +162,9 @@ bool ui_comp_put_grid(ScreenGrid *grid, int row, int col, int height, int width,
   bool moved;
   grid->pending_comp_index_update = true;
 
+  if (grid->comp_index != 0) {
+    row_layers_del(grid);
+  }
   grid->comp_height = height;
   grid->comp_width = width;
   if (grid->comp_index != 0) {
@@ -204,6 +226,7 @@ bool ui_comp_put_grid(ScreenGrid *grid, int row, int col, int height, int width,
     grid->comp_index = insert_at;
     grid->pending_comp_index_update = true;
   }
+  row_layers_add(grid);
   if (moved && valid && ui_comp_should_draw()) {
     compose_area(grid->comp_row, grid->comp_row + grid->rows,
                  grid->comp_col, grid->comp_col + grid->cols);
@@ -223,6 +246,7 @@ void ui_comp_remove_grid(ScreenGrid *grid)
     curgrid = &default_grid;
   }
 
+  row_layers_del(grid);
   for (size_t i = grid->comp_index; i < kv_size(layers) - 1; i++) {
     kv_A(layers, i) = kv_A(layers, i + 1);
     kv_A(layers, i)->comp_index = i;
@@ -259,6 +283,7 @@ bool ui_comp_set_grid(handle_T handle)
 void ui_comp_raise_grid(ScreenGrid *grid, size_t new_index)
 {
   size_t old_index = grid->comp_index;
+  row_layers_del(grid);
   for (size_t i = old_index; i < new_index; i++) {
     kv_A(layers, i) = kv_A(layers, i + 1);
     kv_A(layers, i)->comp_index = i;
@@ -267,6 +292,7 @@ void ui_comp_raise_grid(ScreenGrid *grid, size_t new_index)
   kv_A(layers, new_index) = grid;
   grid->comp_index = new_index;
   grid->pending_comp_index_update = true;
+  row_layers_add(grid);
   for (size_t i = old_index; i < new_index; i++) {
     ScreenGrid *grid2 = kv_A(layers, i);
     int startcol = MAX(grid->comp_col, grid2->comp_col);
@@ -278,6 +304,89 @@ void ui_comp_raise_grid(ScreenGrid *grid, size_t new_index)
   }
 }
 
+/// Rebuilds "row_layers" for the current height of the default grid.
+static void row_layers_build(void)
+{
+  int rows = default_grid.rows;
+  for (int row = rows; row < row_layers_rows; row++) {
+    kv_destroy(row_layers[row]);
+  }
+  row_layers = xrealloc(row_layers, (size_t)rows * sizeof(*row_layers));
+  for (int row = row_layers_rows; row < rows; row++) {
+    kv_init(row_layers[row]);
+  }
+  row_layers_rows = rows;
+
+  for (int row = 0; row < rows; row++) {
+    kv_size(row_layers[row]) = 0;
+    kv_push(row_layers[row], &default_grid);
+  }
+  row_layers_valid = true;
+  for (size_t i = 1; i < kv_size(layers); i++) {
+    row_layers_add(kv_A(layers, i));
+  }
+}
+
+/// Gets the rows of the screen where "grid" can be shown.  The message grid
+/// also covers the separator row above it.
+static void layer_rows(ScreenGrid *grid, int *top, int *bot)
+{
+  *top = MAX(grid->comp_row - (grid == &msg_grid ? 1 : 0), 0);
+  *bot = MIN(grid->comp_row + grid->comp_height, row_layers_rows);
+}
+
+/// Adds "grid" to the rows it covers, according to its stacking order.
+static void row_layers_add(ScreenGrid *grid)
+{
+  if (!row_layers_valid) {
+    return;
+  }
+  int top, bot;
+  layer_rows(grid, &top, &bot);
+  for (int row = top; row < bot; row++) {
+    GridList *list = &row_layers[row];
+    kv_pushp(*list);
+    size_t i = kv_size(*list) - 1;
+    while (i > 1 && kv_A(*list, i - 1)->comp_index > grid->comp_index) {
+      kv_A(*list, i) = kv_A(*list, i - 1);
+      i--;
+    }
+    kv_A(*list, i) = grid;
+  }
+}
+
+/// Removes "grid" from the rows it covers.  Must be called before its
+/// position, height or stacking order is changed.
+static void row_layers_del(ScreenGrid *grid)
+{
+  if (!row_layers_valid) {
+    return;
+  }
+  int top, bot;
+  layer_rows(grid, &top, &bot);
+  for (int row = top; row < bot; row++) {
+    GridList *list = &row_layers[row];
+    for (size_t i = 1; i < kv_size(*list); i++) {
+      if (kv_A(*list, i) == grid) {
+        memmove(&kv_A(*list, i), &kv_A(*list, i + 1),
+                (kv_size(*list) - i - 1) * sizeof(kv_A(*list, i)));
+        kv_size(*list)--;
+        break;
+      }
+    }
+  }
+}
+
+/// @return  the layers which may cover "row", bottom to top.
+static GridList *layers_at_row(int row)
+{
+  if (!row_layers_valid || row_layers_rows != default_grid.rows) {
+    row_layers_build();
+  }
+  // Can happen while resizing, see ui_comp_raw_line().
+  return row < row_layers_rows ? &row_layers[row] : &layers;
+}
+
 void ui_comp_grid_cursor_goto(Integer grid_handle, Integer r, Integer c)
 {
   if (!ui_comp_set_grid((int)grid_handle)) {
@@ -379,11 +488,12 @@ static void compose_line(Integer row, Integer startcol, Integer endcol, LineFlag
                                          + (size_t)startcol];
   sattr_T *bg_attrs = &default_grid.attrs[default_grid.line_offset[row]
                                           + (size_t)startcol];
+  GridList *row_grids = layers_at_row((int)row);
 
   while (col < endcol) {
     int until = 0;
-    for (size_t i = 0; i < kv_size(layers); i++) {
-      ScreenGrid *g = kv_A(layers, i);
+    for (size_t i = 0; i < kv_size(*row_grids); i++) {
+      ScreenGrid *g = kv_A(*row_grids, i);
       // compose_line may have been called after a shrinking operation but
       // before the resize has actually been applied. Therefore, we need to
       // first check to see if any grids have pending updates to width/height,
@@ -589,7 +699,7 @@ void ui_comp_raw_line(Integer grid, Integer row, Integer startcol, Integer endco
     endcol = MIN(endcol, clearcol);
   }
 
-  bool covered = curgrid_covered_above((int)row);
+  bool covered = curgrid_covered_above((int)row, (int)row + 1, (int)startcol, (int)clearcol);
   // TODO(bfredl): eventually should just fix compose_line to respect clearing
   // and optimize it for uncovered lines.
   if (flags & kLineFlagInvalid || covered || curgrid->blending) {
@@ -625,7 +735,13 @@ void ui_comp_msg_set_pos(Integer grid, Integer row, Boolean scrolled, String sep
                          Integer zindex, Integer compindex)
 {
   msg_grid.pending_comp_index_update = true;
+  if (msg_grid.comp_index != 0) {
+    row_layers_del(&msg_grid);
+  }
   msg_grid.comp_row = (int)row;
+  if (msg_grid.comp_index != 0) {
+    row_layers_add(&msg_grid);
+  }
   if (scrolled && row > 0) {
     msg_sep_row = (int)row - 1;
     if (sep_char.data) {
@@ -657,14 +773,32 @@ void ui_comp_msg_set_pos(Integer grid, Integer row, Boolean scrolled, String sep
   msg_was_scrolled = scrolled;
 }
 
-/// check if curgrid is covered on row or above
-///
-/// TODO(bfredl): currently this only handles message row
-static bool curgrid_covered_above(int row)
+/// check if a layer above curgrid covers any of the columns "startcol" to
+/// "endcol" (exclusive) on the rows "startrow" to "endrow" (exclusive)
+static bool curgrid_covered_above(int startrow, int endrow, int startcol, int endcol)
 {
-  bool above_msg = (kv_A(layers, kv_size(layers) - 1) == &msg_grid
-                    && row < msg_current_row - (msg_was_scrolled ? 1 : 0));
-  return kv_size(layers) - (above_msg ? 1 : 0) > curgrid->comp_index + 1;
+  for (int row = startrow; row < endrow; row++) {
+    GridList *row_grids = layers_at_row(row);
+    for (size_t i = kv_size(*row_grids); i-- > 0;) {
+      ScreenGrid *g = kv_A(*row_grids, i);
+      if (g->comp_index <= curgrid->comp_index) {
+        break;
+      }
+      if (g == &msg_grid) {
+        if (row >= msg_current_row - (msg_was_scrolled ? 1 : 0)) {
+          return true;
+        }
+        continue;
+      }
+      int grid_width = MIN(g->cols, g->comp_width);
+      int grid_height = MIN(g->rows, g->comp_height);
+      if (g->comp_row <= row && row < g->comp_row + grid_height
+          && g->comp_col < endcol && startcol < g->comp_col + grid_width) {
+        return true;
+      }
+    }
+  }
+  return false;
 }
 
 void ui_comp_grid_scroll(Integer grid, Integer top, Integer bot, Integer left, Integer right,
@@ -677,7 +811,7 @@ void ui_comp_grid_scroll(Integer grid, Integer top, Integer bot, Integer left, I
   bot += curgrid->comp_row;
   left += curgrid->comp_col;
   right += curgrid->comp_col;
-  bool covered = curgrid_covered_above((int)(bot - MAX(rows, 0)));
+  bool covered = curgrid_covered_above((int)top, (int)bot, (int)left, (int)right);
 
   if (covered || curgrid->blending) {
     // TODO(bfredl):
@@ -706,6 +840,7 @@ void ui_comp_grid_resize(Integer grid, Integer width, Integer height)
 {
   if (grid == 1) {
     ui_composed_call_grid_resize(1, width, height);
+    row_layers_valid = false;
 #ifndef NDEBUG
     chk_width = (int)width;
     chk_height = (int)height;
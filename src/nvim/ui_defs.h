@@ -5,6 +5,8 @@
 #include <stdint.h>
 
 #include "nvim/api/private/defs.h"
+#include "nvim/event/defs.h"
+#include "nvim/map_defs.h"
 #include "nvim/msgpack_rpc/packer_defs.h"
 
 /// Keep in sync with ui_ext_names[] in ui.h
@@ -19,6 +21,7 @@ typedef enum {
   kUIMultigrid,
   kUIHlState,
   kUITermColors,
+  kUIBinaryGrid,
   kUIFloatDebug,
   kUIExtCount,
 } UIExtension;
@@ -61,6 +64,8 @@ typedef struct {
 
 // Fields related to packing
   PackerBuffer packer;
+  ShmStream *shm;  ///< write UI output here instead of the channel, see |ui-shm|
+  bool packer_in_shm;  ///< "packer" points into the "shm" ring
 
   const char *cur_event;  ///< name of current event (might get multiple arglists)
 
@@ -76,6 +81,21 @@ typedef struct {
 
   size_t ncells_pending;  ///< total number of cells since last buffer flush
 
+  PMap(int) binary_grids;  ///< what an ext_binary_grid client has in each grid
+
+  // Frame pacing, see |ui-frame-pacing|.
+  Integer frame_interval;  ///< least time between "flush" events in ms, 0 for no pacing
+  uint64_t last_frame;  ///< os_hrtime() of the last "flush" event
+  bool frame_pending;  ///< "frame_timer" will send the withheld "flush" event
+  TimeWatcher *frame_timer;
+  struct {
+    uint64_t frames;  ///< "flush" events sent
+    uint64_t coalesced;  ///< "flush" events merged into a later one
+    uint64_t backlog_waits;  ///< times a frame waited for the client to read
+    uint64_t bytes;  ///< bytes sent
+    size_t max_backlog;  ///< largest unread output seen
+  } frame_stats;
+
   int hl_id;  // Current highlight for legacy put event.
   Integer cursor_row, cursor_col;  // Intended visible cursor position.
 
@@ -950,6 +950,29 @@ int vterm_screen_get_cell(const VTermScreen *screen, VTermPos pos, VTermScreenCe
   return 1;
 }
 
+/// Moves the glyphs of the screen cells to the new generation of the glyph
+/// cache, see schar_cache_evict_start().  When "keep" is false the glyph cache
+/// is about to be cleared, the glyphs are replaced by their first codepoint.
+void vterm_screen_keep_glyphs(VTermScreen *screen, bool keep)
+{
+  size_t ncells = (size_t)screen->rows * (size_t)screen->cols;
+  for (int bufidx = BUFIDX_PRIMARY; bufidx <= BUFIDX_ALTSCREEN; bufidx++) {
+    ScreenCell *buffer = screen->buffers[bufidx];
+    if (buffer == NULL) {
+      continue;
+    }
+    for (size_t i = 0; i < ncells; i++) {
+      schar_T sc = buffer[i].schar;
+      if (sc == (uint32_t)-1 || !schar_high(sc)) {
+        // Second half of a double-width character, or no glyph in the cache.
+        continue;
+      }
+      buffer[i].schar = keep ? schar_cache_keep(sc)
+                             : schar_from_char(schar_get_first_codepoint(sc));
+    }
+  }
+}
+
 VTermScreen *vterm_obtain_screen(VTerm *vt)
 {
   if (vt->screen) {
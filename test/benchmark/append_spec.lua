@@ -0,0 +1,70 @@
+local n = require('test.functional.testnvim')()
+
+local clear = n.clear
+local exec_lua = n.exec_lua
+
+local N = 1000000
+
+describe('appending lines perf', function()
+  before_each(function()
+    clear()
+
+    exec_lua([[
+      out = {}
+      function start()
+        ts = vim.uv.hrtime()
+      end
+      function stop(name)
+        out[#out+1] = ('%14.6f ms - %s'):format((vim.uv.hrtime() - ts) / 1000000, name)
+      end
+    ]])
+  end)
+
+  after_each(function()
+    for _, line in ipairs(exec_lua([[return out]])) do
+      print(line)
+    end
+  end)
+
+  it('nvim_buf_set_lines with 1M lines', function()
+    exec_lua(function(count)
+      local lines = {}
+      for i = 1, count do
+        lines[i] = ('line %d with some text'):format(i)
+      end
+      vim.api.nvim_buf_set_lines(0, 0, -1, true, { 'first', 'last' })
+
+      start()
+      vim.api.nvim_buf_set_lines(0, 1, 1, true, lines)
+      stop('nvim_buf_set_lines, insert 1M lines')
+    end, N)
+  end)
+
+  it('paste 1M lines', function()
+    exec_lua(function(count)
+      local lines = {}
+      for i = 1, count do
+        lines[i] = ('line %d with some text'):format(i)
+      end
+      vim.fn.setreg('a', lines, 'l')
+      vim.api.nvim_buf_set_lines(0, 0, -1, true, { 'first', 'last' })
+
+      start()
+      vim.cmd('normal! "ap')
+      stop('"ap, 1M lines')
+
+      start()
+      vim.cmd('normal! gg"aP')
+      stop('"aP before the first line, 1M lines')
+    end, N)
+  end)
+
+  it(':read !cmd with 1M lines', function()
+    exec_lua(function(count)
+      vim.o.shelltemp = false
+      start()
+      vim.cmd(('read !%s -l -e "for i = 1, %d do print(i) end"'):format(vim.v.progpath, count))
+      stop(':read !cmd, 1M lines')
+    end, N)
+  end)
+end)
@@ -62,3 +62,141 @@ describe('regexp search', function()
     command('write')
   end)
 end)
+
+describe('regexp search through a log file', function()
+  -- Size of the generated file in Mbyte, e.g. 1024 for a 1 Gbyte file.
+  local size = tonumber(os.getenv('NVIM_BENCH_REGEXP_MB')) or 16
+  local log_file = 'Xbench_regexp.log'
+
+  setup(function()
+    local f = assert(io.open(log_file, 'w'))
+    local levels = { 'info', 'debug', 'warning', 'error' }
+    local i = 0
+    local written = 0
+    while written < size * 1024 * 1024 do
+      local chunk = {}
+      for _ = 1, 10000 do
+        i = i + 1
+        chunk[#chunk + 1] = ('2024-05-%02d 12:%02d:%02d %s: request %d on foo_%s handled in %d ms%s\n'):format(
+          i % 28 + 1,
+          i % 60,
+          i % 59,
+          levels[i % #levels + 1],
+          i,
+          i % 1000 == 0 and 'cache_bar' or 'cache',
+          i % 997,
+          i % 5000 == 0 and ' after timeout' or ''
+        )
+      end
+      local s = table.concat(chunk)
+      f:write(s)
+      written = written + #s
+    end
+    f:close()
+    clear()
+    command('edit ' .. log_file)
+  end)
+
+  teardown(function()
+    os.remove(log_file)
+  end)
+
+  for _, pattern in ipairs({
+    [[\<foo_\w\+bar]],
+    [[error:.*timeout]],
+    [[\c\(warning\|error\): .*ms after]],
+  }) do
+    it(pattern, function()
+      for _, re in ipairs({ 1, 2 }) do
+        local ms = n.exec_lua(function(re_, pattern_)
+          vim.o.regexpengine = re_
+          local ts = vim.uv.hrtime()
+          vim.cmd('silent! %s/' .. pattern_ .. '//gn')
+          return (vim.uv.hrtime() - ts) / 1e6
+        end, re, pattern)
+        print(('%10.2f ms - re=%d, %d Mbyte'):format(ms, re, size))
+      end
+    end)
+  end
+
+  -- Most lines contain the literal text, only the pattern rejects them.
+  local pattern = [[\d\d:\d\d:\d\d warn\a*: request \d*7 on]]
+  for _, cmd in ipairs({
+    'g/' .. pattern .. '/let n += 1',
+    'vimgrep /' .. pattern .. '/j ' .. log_file,
+  }) do
+    it(cmd, function()
+      for _, re in ipairs({ 1, 2 }) do
+        local ms = n.exec_lua(function(re_, cmd_)
+          vim.o.regexpengine = re_
+          vim.g.n = 0
+          local ts = vim.uv.hrtime()
+          vim.cmd('silent ' .. cmd_)
+          return (vim.uv.hrtime() - ts) / 1e6
+        end, re, cmd)
+        print(('%10.2f ms - re=%d, %d Mbyte'):format(ms, re, size))
+      end
+    end)
+  end
+
+  it('searchcount() with maxcount=0', function()
+    for _, re in ipairs({ 1, 2 }) do
+      local ms, total = n.exec_lua(function(re_, pattern_)
+        vim.o.regexpengine = re_
+        local ts = vim.uv.hrtime()
+        local total_ = vim.fn.searchcount({
+          pattern = pattern_,
+          maxcount = 0,
+          timeout = 0,
+          recompute = true,
+        }).total
+        return (vim.uv.hrtime() - ts) / 1e6, total_
+      end, re, pattern)
+      print(('%10.2f ms - re=%d, %d Mbyte, %d matches'):format(ms, re, size, total))
+    end
+  end)
+end)
+
+describe('multi-line regexp search', function()
+  local count = 2000000
+  local text_file = 'Xbench_regexp_multiline.txt'
+
+  setup(function()
+    local f = assert(io.open(text_file, 'w'))
+    -- Every line ends in "foo", only the last "foo" is followed by "bar".
+    for i = 1, count, 10000 do
+      local chunk = {}
+      for j = i, math.min(i + 9999, count) do
+        chunk[#chunk + 1] = ('line %d foo\n'):format(j)
+      end
+      f:write(table.concat(chunk))
+    end
+    f:write('bar\n')
+    f:close()
+  end)
+
+  teardown(function()
+    os.remove(text_file)
+  end)
+
+  for _, changed in ipairs({ false, true }) do
+    it(('/foo\\nbar over %d lines%s'):format(count, changed and ', changed buffer' or ''), function()
+      clear()
+      command('edit ' .. text_file)
+      if changed then
+        -- The lines are in data blocks instead of the file.
+        command('normal! ggx')
+      end
+      for _, re in ipairs({ 1, 2 }) do
+        local ms = n.exec_lua(function(re_)
+          vim.o.regexpengine = re_
+          vim.api.nvim_win_set_cursor(0, { 1, 0 })
+          local ts = vim.uv.hrtime()
+          assert(vim.fn.search([[foo\nbar]], 'W') == count)
+          return (vim.uv.hrtime() - ts) / 1e6
+        end, re)
+        print(('%10.2f ms - re=%d'):format(ms, re))
+      end
+    end)
+  end
+end)
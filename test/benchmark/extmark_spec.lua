@@ -42,4 +42,133 @@ describe('extmark perf', function()
       stop('nvim_buf_clear_namespace')
     ]])
   end)
+
+  it('1M extmarks', function()
+    exec_lua(function()
+      local api = vim.api
+      local lines = {}
+      for i = 1, 100000 do
+        lines[i] = ('local x%d = foo(bar, baz) + qux'):format(i)
+      end
+      api.nvim_buf_set_lines(0, 0, -1, true, lines)
+      local ns = api.nvim_create_namespace('ns')
+
+      start()
+      for row = 0, 99999 do
+        for col = 0, 27, 3 do
+          api.nvim_buf_set_extmark(0, ns, row, col, { end_col = col + 2 })
+        end
+      end
+      stop('nvim_buf_set_extmark, 1M marks')
+
+      math.randomseed(42)
+      start()
+      for _ = 1, 100000 do
+        local row = math.random(0, 99999)
+        api.nvim_buf_get_extmarks(0, ns, { row, 0 }, { row, -1 }, { limit = 10 })
+      end
+      stop('100000 nvim_buf_get_extmarks() on a random line')
+
+      start()
+      for _ = 1, 100000 do
+        local id = math.random(1, 1000000)
+        api.nvim_buf_get_extmark_by_id(0, ns, id, {})
+      end
+      stop('100000 nvim_buf_get_extmark_by_id()')
+
+      start()
+      for _ = 1, 1000 do
+        local row = math.random(0, 99998)
+        api.nvim_buf_set_text(0, row, 4, row, 4, { 'y' })
+        api.nvim_buf_set_lines(0, row, row, true, { 'inserted' })
+      end
+      stop('1000 random edits')
+
+      start()
+      api.nvim_buf_clear_namespace(0, ns, 0, -1)
+      stop('nvim_buf_clear_namespace, 1M marks')
+    end)
+  end)
+
+  it('nvim_buf_set_extmarks with 1M extmarks', function()
+    exec_lua(function()
+      local api = vim.api
+      local lines = {}
+      for i = 1, 100000 do
+        lines[i] = ('local x%d = foo(bar, baz) + qux'):format(i)
+      end
+      api.nvim_buf_set_lines(0, 0, -1, true, lines)
+      local ns = api.nvim_create_namespace('ns')
+
+      local marks = {}
+      for row = 0, 99999 do
+        for col = 0, 27, 3 do
+          marks[#marks + 1] = { row, col, { end_col = col + 2, hl_group = 'Comment' } }
+        end
+      end
+
+      start()
+      for _, m in ipairs(marks) do
+        api.nvim_buf_set_extmark(0, ns, m[1], m[2], m[3])
+      end
+      stop('nvim_buf_set_extmark, 1M marks')
+
+      api.nvim_buf_clear_namespace(0, ns, 0, -1)
+      start()
+      api.nvim_buf_set_extmarks(0, ns, marks)
+      stop('nvim_buf_set_extmarks, 1M marks')
+
+      -- a highlighter updating a part of the buffer
+      local ns2 = api.nvim_create_namespace('ns2')
+      local part = {}
+      for i = 1, 100000 do
+        part[i] = marks[i]
+      end
+      start()
+      api.nvim_buf_set_extmarks(0, ns2, part)
+      stop('nvim_buf_set_extmarks, 100000 marks into 2M keys')
+    end)
+  end)
+
+  it('editing the whole buffer with 200k extmarks', function()
+    exec_lua(function()
+      local api = vim.api
+      local lines = {}
+      for i = 1, 100000 do
+        lines[i] = ('local x%d = foo(bar, baz) + qux'):format(i)
+      end
+      api.nvim_buf_set_lines(0, 0, -1, true, lines)
+      local ns = api.nvim_create_namespace('ns')
+      local marks = {}
+      for row = 0, 99999 do
+        marks[#marks + 1] = { row, 6, { end_col = 10, hl_group = 'Identifier' } }
+        marks[#marks + 1] = { row, 13, { right_gravity = false } }
+      end
+      api.nvim_buf_set_extmarks(0, ns, marks)
+
+      start()
+      vim.cmd('%s/foo/foobar/')
+      stop(':%s on 100000 lines')
+
+      start()
+      vim.cmd('%s/\\<x/y/g')
+      stop(':%s before marks on 100000 lines')
+
+      start()
+      vim.cmd('%s/(bar, baz)/\\r/')
+      stop(':%s splitting 100000 lines')
+
+      start()
+      vim.cmd('undo')
+      stop('undo :%s splitting 100000 lines')
+
+      start()
+      vim.cmd('10,$-10delete')
+      stop('delete 100000 lines')
+
+      start()
+      vim.cmd('undo')
+      stop('undo delete 100000 lines')
+    end)
+  end)
 end)
@@ -0,0 +1,46 @@
+local n = require('test.functional.testnvim')()
+local uv_stream = require('test.client.uv_stream')
+local RpcStream = require('test.client.rpc_stream')
+
+describe('grid_put_linebuf', function()
+  local width, height, count = 400, 100, 200
+
+  it(('%d redraws of mostly unchanged lines in a %dx%d grid'):format(count, width, height), function()
+    n.clear()
+    n.exec([[
+      set number cursorline cursorlineopt=number nowrap
+      call setline(1, map(range(1, 3000), {i -> printf('let s:v%d = "%s" " %s', i, repeat('x', i % 300), repeat('word ', i % 60))}))
+      set filetype=vim
+      syntax on
+    ]])
+
+    local stream = RpcStream.new(uv_stream.SocketStream.open(n.fn.serverstart()))
+    stream:read_start(function() end, function() end, function() end)
+    local attached = false
+    stream:write('nvim_ui_attach', { width, height, { ext_linegrid = true } }, function(err)
+      assert(not err, vim.inspect(err))
+      attached = true
+    end)
+    while not attached do
+      vim.uv.run('once')
+    end
+
+    for _, w in ipairs({
+      { 'unchanged', 'let _ = 0' },
+      { 'move cursor', 'normal! j' },
+      { 'scroll sideways', 'normal! zl' },
+    }) do
+      local ms = n.exec_lua(function(cmd, count_)
+        local ts = vim.uv.hrtime()
+        for _ = 1, count_ do
+          vim.cmd(cmd)
+          -- Draws every line again, only the changed cells are sent.
+          vim.api.nvim__redraw({ valid = false, flush = true })
+        end
+        return (vim.uv.hrtime() - ts) / 1e6
+      end, w[2], count)
+      print(('%10.2f ms - %s'):format(ms, w[1]))
+    end
+    stream:close()
+  end)
+end)
@@ -0,0 +1,69 @@
+local n = require('test.functional.testnvim')()
+
+local clear = n.clear
+local exec_lua = n.exec_lua
+
+describe('line2byte() perf', function()
+  before_each(function()
+    clear()
+
+    exec_lua([[
+      out = {}
+      function start()
+        ts = vim.uv.hrtime()
+      end
+      function stop(name)
+        out[#out+1] = ('%14.6f ms - %s'):format((vim.uv.hrtime() - ts) / 1000000, name)
+      end
+    ]])
+  end)
+
+  after_each(function()
+    for _, line in ipairs(exec_lua([[return out]])) do
+      print(line)
+    end
+  end)
+
+  for _, ff in ipairs({ 'unix', 'dos' }) do
+    it(('random edits and lookups in 1M lines, fileformat=%s'):format(ff), function()
+      exec_lua(function(fileformat)
+        local lines = {}
+        for i = 1, 1000000 do
+          lines[i] = ('line %d'):format(i) .. ('x'):rep(i % 50)
+        end
+        vim.api.nvim_buf_set_lines(0, 0, -1, true, lines)
+        vim.bo.fileformat = fileformat
+        math.randomseed(42)
+
+        start()
+        for _ = 1, 20000 do
+          local count = vim.api.nvim_buf_line_count(0)
+          local lnum = math.random(count)
+          local r = math.random(3)
+          if r == 1 then
+            vim.api.nvim_buf_set_lines(0, lnum - 1, lnum - 1, true, { 'inserted' })
+          elseif r == 2 then
+            vim.api.nvim_buf_set_lines(0, lnum - 1, lnum, true, {})
+          else
+            vim.api.nvim_buf_set_text(0, lnum - 1, 0, lnum - 1, 0, { 'abc' })
+          end
+          vim.fn.line2byte(math.random(count))
+        end
+        stop('20000 random edits, each followed by line2byte()')
+
+        local size = vim.fn.line2byte(vim.api.nvim_buf_line_count(0) + 1)
+        start()
+        for _ = 1, 100000 do
+          vim.fn.byte2line(math.random(size - 1))
+        end
+        stop('100000 byte2line()')
+
+        start()
+        for _ = 1, 100000 do
+          vim.api.nvim_buf_get_offset(0, math.random(vim.api.nvim_buf_line_count(0)) - 1)
+        end
+        stop('100000 nvim_buf_get_offset()')
+      end, ff)
+    end)
+  end
+end)
@@ -0,0 +1,15 @@
+-- Uses the unit test fixture, needs nvim built with unit tests.
+local t = require('test.unit.testutil')
+
+local lib = t.cimport('./test/unit/fixtures/loop.h')
+
+describe('loop_schedule_fast perf', function()
+  it('events/sec with 1, 4 and 16 threads', function()
+    local count = 200000
+    for _, threads in ipairs({ 1, 4, 16 }) do
+      local ns = tonumber(lib.ut_loop_schedule_fast(threads, count))
+      t.neq(0, ns)
+      print(('%14.0f events/sec - %d threads'):format(threads * count / (ns / 1e9), threads))
+    end
+  end)
+end)
@@ -0,0 +1,63 @@
+local t = require('test.testutil')
+local n = require('test.functional.testnvim')()
+
+local clear = n.clear
+local exec_lua = n.exec_lua
+
+-- Sizes in Mbyte, more can be given with $NVIM_BENCH_READFILE_SIZES,
+-- e.g. "100,1024,4096".
+local sizes = vim.split(os.getenv('NVIM_BENCH_READFILE_SIZES') or '100', ',', { trimempty = true })
+
+--- Write a file of about "mbyte" Mbyte with lines of varying length, some
+--- with multibyte characters.
+--- @param fname string
+--- @param mbyte integer
+local function write_file(fname, mbyte)
+  local lines = {}
+  for i = 1, 1000 do
+    local s = ('%08d '):format(i) .. ('abcdefgh '):rep(i % 13)
+    lines[#lines + 1] = i % 7 == 0 and (s .. 'äöü€') or s
+  end
+  local block = table.concat(lines, '\n') .. '\n'
+  local f = assert(io.open(fname, 'wb'))
+  for _ = 1, math.ceil(mbyte * 1024 * 1024 / #block) do
+    f:write(block)
+  end
+  f:close()
+end
+
+describe('readfile perf', function()
+  local fname = t.tmpname(false)
+
+  before_each(function()
+    clear({ args = { '--cmd', 'set noswapfile undolevels=-1' } })
+  end)
+
+  after_each(function()
+    os.remove(fname)
+  end)
+
+  for _, size in ipairs(sizes) do
+    local mbyte = assert(tonumber(size))
+
+    for _, mode in ipairs({ 'read', 'mapped' }) do
+      it(('%d Mbyte file, %s'):format(mbyte, mode), function()
+        write_file(fname, mbyte)
+        local ms = exec_lua(function(file, lfs)
+          vim.o.largefilesize = lfs
+          local ts = vim.uv.hrtime()
+          vim.cmd.edit(file)
+          return (vim.uv.hrtime() - ts) / 1000000
+        end, fname, mode == 'mapped' and 1 or 0)
+        local bytes = vim.uv.fs_stat(fname).size
+        print(
+          ('\n%14.3f ms - %8.1f MB/s - %d lines'):format(
+            ms,
+            bytes / 1024 / 1024 / (ms / 1000),
+            exec_lua('return vim.api.nvim_buf_line_count(0)')
+          )
+        )
+      end)
+    end
+  end
+end)
@@ -0,0 +1,108 @@
+local n = require('test.functional.testnvim')()
+
+local clear = n.clear
+local exec_lua = n.exec_lua
+
+describe('msgpack-rpc perf', function()
+  before_each(function()
+    clear()
+
+    exec_lua([[
+      out = {}
+      function start()
+        ts = vim.uv.hrtime()
+      end
+      function stop(name, bytes)
+        local ms = (vim.uv.hrtime() - ts) / 1000000
+        local rate = bytes and (' (%.1f MB/s)'):format(bytes / 1000 / ms) or ''
+        out[#out+1] = ('%14.6f ms - %s%s'):format(ms, name, rate)
+      end
+      chan = vim.fn.jobstart({ vim.v.progpath, '--clean', '--embed', '--headless' }, { rpc = true })
+      -- wait until the client is up
+      vim.rpcrequest(chan, 'nvim_get_api_info')
+    ]])
+  end)
+
+  after_each(function()
+    exec_lua([[vim.fn.jobstop(chan)]])
+    for _, line in ipairs(exec_lua([[return out]])) do
+      print(line)
+    end
+  end)
+
+  it('nvim_buf_set_lines over a stdio channel', function()
+    exec_lua(function()
+      local lines = {}
+      local bytes = 0
+      for i = 1, 50000 do
+        lines[i] = ('line %d of a file which a formatter replaced'):format(i)
+        bytes = bytes + #lines[i]
+      end
+
+      start()
+      for _ = 1, 20 do
+        vim.rpcrequest(chan, 'nvim_buf_set_lines', 0, 0, -1, true, lines)
+      end
+      stop('20 nvim_buf_set_lines with 50000 lines', 20 * bytes)
+
+      local big = { ('x'):rep(1000000) }
+      start()
+      for _ = 1, 100 do
+        vim.rpcrequest(chan, 'nvim_buf_set_lines', 0, 0, -1, true, big)
+      end
+      stop('100 nvim_buf_set_lines with a 1MB line', 100 * #big[1])
+    end)
+  end)
+
+  it('many small requests over a stdio channel', function()
+    exec_lua(function()
+      start()
+      for i = 1, 20000 do
+        vim.rpcnotify(chan, 'nvim_set_var', 'bench_var', ('value %d which is long enough'):format(i))
+      end
+      vim.rpcrequest(chan, 'nvim_get_var', 'bench_var')
+      stop('20000 nvim_set_var notifications')
+    end)
+  end)
+end)
+
+describe('msgpack-rpc round-trips over a Unix socket', function()
+  local uv_stream = require('test.client.uv_stream')
+  local RpcStream = require('test.client.rpc_stream')
+
+  before_each(function()
+    clear()
+    n.api.nvim_buf_set_lines(0, 0, -1, true, { 'some text' })
+  end)
+
+  --- Sends "count" pipelined requests and waits for all responses.
+  local function run(attributes, count)
+    local stream = RpcStream.new(uv_stream.SocketStream.open(n.fn.serverstart()))
+    local done = 0
+    local function cb()
+      done = done + 1
+    end
+    stream:read_start(function() end, function() end, function() end)
+    stream:write('nvim_set_client_info', { 'bench', {}, 'remote', {}, attributes }, cb)
+    while done < 1 do
+      vim.uv.run('once')
+    end
+
+    local ts = vim.uv.hrtime()
+    for _ = 1, count do
+      stream:write('nvim_buf_get_lines', { 0, 0, 1, true }, cb)
+    end
+    while done < count + 1 do
+      vim.uv.run('once')
+    end
+    local secs = (vim.uv.hrtime() - ts) / 1e9
+    stream:close()
+    return count / secs
+  end
+
+  it('pipelined nvim_buf_get_lines', function()
+    local count = 10000
+    print(('%10.0f round-trips/s - default'):format(run({}, count)))
+    print(('%10.0f round-trips/s - pipeline=readonly'):format(run({ pipeline = 'readonly' }, count)))
+  end)
+end)
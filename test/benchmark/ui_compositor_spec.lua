@@ -0,0 +1,72 @@
+local n = require('test.functional.testnvim')()
+local uv_stream = require('test.client.uv_stream')
+local RpcStream = require('test.client.rpc_stream')
+
+describe('compositor', function()
+  local width, height, count = 160, 50, 500
+
+  --- Attaches a composed UI over a Unix socket, opens "nfloats" overlapping
+  --- floating windows and returns the time taken by each of the workloads.
+  local function run(nfloats)
+    n.clear()
+    n.exec([[
+      set number cursorline nowrap
+      call setline(1, map(range(1, 3000), {i -> printf('let s:v%d = "%s" " %s', i, repeat('x', i % 70), repeat('word ', i % 13))}))
+      set filetype=vim
+      syntax on
+    ]])
+    n.exec_lua(function(nfloats_)
+      for i = 1, nfloats_ do
+        local buf = vim.api.nvim_create_buf(false, true)
+        vim.api.nvim_buf_set_lines(buf, 0, -1, false, { ('float %d'):format(i) })
+        vim.api.nvim_open_win(buf, false, {
+          relative = 'editor',
+          row = (i * 2) % 40,
+          col = (i * 7) % 120,
+          width = 30,
+          height = 8,
+          border = 'single',
+        })
+      end
+    end, nfloats)
+
+    local stream = RpcStream.new(uv_stream.SocketStream.open(n.fn.serverstart()))
+    stream:read_start(function() end, function() end, function() end)
+
+    local done = 0
+    local function request(method, args)
+      local target = done + 1
+      stream:write(method, args, function(err)
+        assert(not err, vim.inspect(err))
+        done = done + 1
+      end)
+      while done < target do
+        vim.uv.run('once')
+      end
+    end
+    request('nvim_ui_attach', { width, height, { ext_linegrid = true } })
+
+    local result = {}
+    for _, w in ipairs({
+      { 'scroll by line', 'exe "normal! \\<C-e>"' },
+      { 'move cursor', 'normal! j' },
+      { 'full redraw', 'redraw!' },
+    }) do
+      local ts = vim.uv.hrtime()
+      for _ = 1, count do
+        request('nvim_command', { w[2] .. ' | redraw' })
+      end
+      result[#result + 1] = { w[1], (vim.uv.hrtime() - ts) / 1e6 }
+    end
+    stream:close()
+    return result
+  end
+
+  it(('%d redraws of a %dx%d grid with 20 floats'):format(count, width, height), function()
+    local plain = run(0)
+    local floats = run(20)
+    for i, r in ipairs(plain) do
+      print(('%10.2f ms - %-16s %10.2f ms with 20 floats'):format(r[2], r[1], floats[i][2]))
+    end
+  end)
+end)
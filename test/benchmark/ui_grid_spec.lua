@@ -0,0 +1,76 @@
+local n = require('test.functional.testnvim')()
+local uv_stream = require('test.client.uv_stream')
+local RpcStream = require('test.client.rpc_stream')
+
+describe('grid_line bytes', function()
+  local width, height = 120, 40
+
+  --- Attaches a UI over a Unix socket and returns the number of bytes it
+  --- received for each of the workloads.
+  local function run(opts)
+    n.clear()
+    n.exec([[
+      set number cursorline nowrap
+      call setline(1, map(range(1, 3000), {i -> printf('let s:v%d = "%s" " %s', i, repeat('x', i % 70), repeat('word ', i % 13))}))
+      set filetype=vim
+      syntax on
+    ]])
+
+    local socket = uv_stream.SocketStream.open(n.fn.serverstart())
+    local bytes = 0
+    local counting = setmetatable({
+      read_start = function(_, cb)
+        socket:read_start(function(data)
+          bytes = bytes + (data and #data or 0)
+          cb(data)
+        end)
+      end,
+    }, { __index = socket })
+    local stream = RpcStream.new(counting)
+    stream:read_start(function() end, function() end, function() end)
+
+    local done = 0
+    local function request(method, args)
+      local target = done + 1
+      stream:write(method, args, function(err)
+        assert(not err, vim.inspect(err))
+        done = done + 1
+      end)
+      while done < target do
+        vim.uv.run('once')
+      end
+    end
+    request('nvim_ui_attach', { width, height, opts })
+
+    local result = {}
+    for _, w in ipairs({
+      { 'scroll by line', 'exe "normal! \\<C-e>"', 500 },
+      { 'scroll by page', 'exe "normal! \\<C-f>"', 60 },
+      { 'move cursor', 'normal! j', 500 },
+      { 'scroll sideways', 'normal! zl', 100 },
+    }) do
+      local before = bytes
+      for _ = 1, w[3] do
+        request('nvim_command', { w[2] .. ' | redraw' })
+      end
+      result[#result + 1] = { w[1], bytes - before }
+    end
+    stream:close()
+    return result
+  end
+
+  it(('for typical workloads in a %dx%d grid'):format(width, height), function()
+    local linegrid = run({ ext_linegrid = true })
+    local binary = run({ ext_binary_grid = true })
+    for i, r in ipairs(linegrid) do
+      print(
+        ('%10d bytes - %-16s %10d bytes with ext_binary_grid (%.0f%%)'):format(
+          r[2],
+          r[1],
+          binary[i][2],
+          100 * binary[i][2] / r[2]
+        )
+      )
+    end
+  end)
+end)
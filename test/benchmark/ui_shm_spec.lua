@@ -0,0 +1,74 @@
+local n = require('test.functional.testnvim')()
+local uv_stream = require('test.client.uv_stream')
+local RpcStream = require('test.client.rpc_stream')
+local ShmStream = require('test.client.shm_stream')
+
+local RING_SIZE = 1024 * 1024
+
+describe('UI redraw transport', function()
+  local width, height, count = 200, 60, 2000
+
+  --- Attaches a UI over a Unix socket, with "shm" optionally, and redraws
+  --- the screen "count" times.
+  local function run(shm)
+    local reader = shm and ShmStream.new(RING_SIZE) or nil
+    n.clear({ io_extra = reader and reader:fds() or nil })
+    n.exec([[
+      set number cursorline
+      call setline(1, map(range(1, 100), {i -> repeat(' word ' .. i, 10)}))
+      syntax on
+      set filetype=vim
+    ]])
+
+    local stream = RpcStream.new(uv_stream.SocketStream.open(n.fn.serverstart()))
+    local flushes = 0
+    local function on_notification(method, args)
+      if method == 'redraw' then
+        for _, ev in ipairs(args[1]) do
+          if ev[1] == 'flush' then
+            flushes = flushes + 1
+          end
+        end
+      end
+    end
+    stream:read_start(function() end, on_notification, function() end)
+    local ring = reader and RpcStream.new(reader)
+    if ring then
+      ring:read_start(function() end, on_notification, function() end)
+    end
+
+    local done = 0
+    local function cb(err)
+      assert(not err, vim.inspect(err))
+      done = done + 1
+    end
+    local opts = { ext_linegrid = true, shm = reader and { 3, 4, 5 } or nil }
+    stream:write('nvim_ui_attach', { width, height, opts }, cb)
+    while done < 1 do
+      vim.uv.run('once')
+    end
+
+    local ts = vim.uv.hrtime()
+    for i = 1, count do
+      stream:write('nvim_command', { 'redraw!' }, cb)
+      while done < i + 1 do
+        vim.uv.run('once')
+      end
+      if reader then
+        reader:drain()
+      end
+    end
+    local ms = (vim.uv.hrtime() - ts) / 1e6
+    assert(flushes >= count)
+    stream:close()
+    if reader then
+      reader:close()
+    end
+    return ms
+  end
+
+  it(('%d full redraws of a %dx%d grid'):format(count, width, height), function()
+    print(('%10.2f ms - Unix socket'):format(run(false)))
+    print(('%10.2f ms - shared memory'):format(run(true)))
+  end)
+end)
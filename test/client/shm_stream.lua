@@ -0,0 +1,114 @@
+---
+--- The UI side of the shared memory ring for "redraw" notifications, see
+--- ":help ui-shm". Can be read by an RpcStream like the other stream types.
+--- Only works on Linux (memfd and eventfd).
+---
+
+local ffi = require('ffi')
+
+ffi.cdef([[
+int memfd_create(const char *name, unsigned int flags);
+int eventfd(unsigned int initval, int flags);
+int ftruncate(int fd, int64_t length);
+void *mmap(void *addr, size_t length, int prot, int flags, int fd, int64_t offset);
+int munmap(void *addr, size_t length);
+int64_t write(int fd, const void *buf, size_t count);
+int close(int fd);
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t size;
+  char pad0[48];
+  volatile uint64_t head;
+  char pad1[56];
+  volatile uint64_t tail;
+  char pad2[56];
+  volatile uint32_t reader_waiting;
+  volatile uint32_t writer_waiting;
+} ShmRingHeader;
+]])
+
+local DATA_OFFSET = 65536
+
+--- @class test.ShmStream
+--- @field fd integer  The shared file.
+--- @field doorbell integer
+--- @field wakeup integer
+--- @field hdr ffi.cdata*
+--- @field data ffi.cdata*
+--- @field size integer  Size of the ring.
+--- @field on_read fun(data: string)?
+local ShmStream = {}
+ShmStream.__index = ShmStream
+
+--- Creates the shared file and the wakeup fds, and fills in the header.
+---
+--- @param size integer  Size of the ring, a power of two of at least 65536.
+--- @param hdr? table  Fields of the header to set instead of the valid ones.
+--- @return test.ShmStream
+function ShmStream.new(size, hdr)
+  local self = setmetatable({ size = size }, ShmStream)
+  self.fd = ffi.C.memfd_create('nvim-ui-shm', 0)
+  assert(self.fd >= 0 and ffi.C.ftruncate(self.fd, DATA_OFFSET + size) == 0)
+  self.doorbell = ffi.C.eventfd(0, 0)
+  self.wakeup = ffi.C.eventfd(0, 0)
+  local map = ffi.C.mmap(nil, DATA_OFFSET + size, 3, 1, self.fd, 0) -- RW, MAP_SHARED
+  self.hdr = ffi.cast('ShmRingHeader *', map)
+  self.data = ffi.cast('char *', map) + DATA_OFFSET
+  self.hdr.magic = 0x4e565348
+  self.hdr.version = 1
+  self.hdr.size = size
+  for k, v in pairs(hdr or {}) do
+    self.hdr[k] = v
+  end
+  return self
+end
+
+--- The fds to pass to the Nvim process, fd 3, 4 and 5 there.
+--- @return integer[]
+function ShmStream:fds()
+  return { self.fd, self.doorbell, self.wakeup }
+end
+
+function ShmStream:read_start(on_read)
+  self.on_read = on_read
+end
+
+function ShmStream:read_stop()
+  self.on_read = nil
+end
+
+function ShmStream:write() end
+
+function ShmStream:close()
+  ffi.C.munmap(self.hdr, DATA_OFFSET + self.size)
+  ffi.C.close(self.fd)
+  ffi.C.close(self.doorbell)
+  ffi.C.close(self.wakeup)
+end
+
+--- @return integer  Bytes Nvim wrote to the ring so far.
+function ShmStream:head()
+  return tonumber(self.hdr.head)
+end
+
+--- Passes everything Nvim wrote so far to the reader, and wakes up Nvim when
+--- it waits for space.
+function ShmStream:drain()
+  local head, tail = tonumber(self.hdr.head), tonumber(self.hdr.tail)
+  while tail < head do
+    local pos = tail % self.size
+    local len = math.min(head - tail, self.size - pos)
+    if self.on_read then
+      self.on_read(ffi.string(self.data + pos, len))
+    end
+    tail = tail + len
+  end
+  self.hdr.tail = tail
+  if self.hdr.writer_waiting ~= 0 then
+    self.hdr.writer_waiting = 0
+    ffi.C.write(self.wakeup, ffi.new('uint64_t[1]', 1), 8)
+  end
+end
+
+return ShmStream
@@ -148,7 +148,8 @@ ProcStream.__index = ProcStream
 ---
 --- @param argv string[]
 --- @param env string[]?
---- @param io_extra uv.uv_pipe_t?
+--- @param io_extra (uv.uv_pipe_t|integer|(uv.uv_pipe_t|integer)[])?  Child fd 3, or a list
+--- of fds from 3 on.
 --- @param on_exit fun(closed: integer?)?  Called after the child process exits.
 --- `closed` is the timestamp (uv.now()) when close() was called, or nil if it wasn't.
 --- @return test.ProcStream
@@ -176,9 +177,15 @@ function ProcStream.spawn(argv, env, io_extra, on_exit)
   for i = 2, #argv do
     args[#args + 1] = argv[i]
   end
+  local stdio = { self._child_stdin, self._child_stdout, self._child_stderr }
+  if type(io_extra) == 'table' then
+    vim.list_extend(stdio, io_extra)
+  else
+    stdio[4] = io_extra
+  end
   --- @diagnostic disable-next-line:missing-fields
   self._proc, self._pid = uv.spawn(prog, {
-    stdio = { self._child_stdin, self._child_stdout, self._child_stderr, io_extra },
+    stdio = stdio,
     args = args,
     --- @diagnostic disable-next-line:assign-type-mismatch
     env = env,
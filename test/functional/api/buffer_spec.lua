@@ -562,6 +562,102 @@ describe('api/buf', function()
     end)
   end)
 
+  describe('appending many lines at once', function()
+    --- Lines of different lengths, some longer than a data block.
+    --- @return string[]
+    local function make_lines(count, tag)
+      local lines = {} --- @type string[]
+      for i = 1, count do
+        lines[i] = tag .. i .. ('x'):rep(i % 97 == 0 and 9000 + i or i % 50)
+      end
+      return lines
+    end
+
+    --- Checks line2byte() and byte2line() of every line against the text.
+    local function check_offsets()
+      exec_lua(function()
+        local off = 1
+        for lnum = 1, vim.fn.line('$') do
+          assert(vim.fn.line2byte(lnum) == off, ('line2byte(%d)'):format(lnum))
+          assert(vim.fn.byte2line(off) == lnum, ('byte2line(%d)'):format(off))
+          off = off + #vim.fn.getline(lnum) + 1
+        end
+        assert(vim.fn.line2byte(vim.fn.line('$') + 1) == off)
+      end)
+    end
+
+    it('in the middle of the buffer, with lines longer than a block', function()
+      local before = make_lines(300, 'a')
+      local added = make_lines(3000, 'b')
+      api.nvim_buf_set_lines(0, 0, -1, true, before)
+      api.nvim_buf_set_lines(0, 150, 150, true, added)
+
+      local expected = vim.list_slice(before, 1, 150)
+      vim.list_extend(expected, added)
+      vim.list_extend(expected, before, 151)
+      eq(expected, api.nvim_buf_get_lines(0, 0, -1, true))
+      check_offsets()
+
+      -- The same text is written to the file and read back.
+      command('write! Xappend_lines')
+      finally(function()
+        os.remove('Xappend_lines')
+      end)
+      command('enew')
+      command('read Xappend_lines')
+      command('1delete')
+      eq(expected, api.nvim_buf_get_lines(0, 0, -1, true))
+      check_offsets()
+    end)
+
+    it('with undo and redo', function()
+      local before = make_lines(200, 'a')
+      api.nvim_buf_set_lines(0, 0, -1, true, before)
+      -- Start a new undo block.
+      command('let &undolevels = &undolevels')
+      local added = make_lines(2000, 'b')
+      api.nvim_buf_set_lines(0, 100, 100, true, added)
+      local after = api.nvim_buf_get_lines(0, 0, -1, true)
+      eq(2200, #after)
+
+      command('undo')
+      eq(before, api.nvim_buf_get_lines(0, 0, -1, true))
+      check_offsets()
+      command('redo')
+      eq(after, api.nvim_buf_get_lines(0, 0, -1, true))
+      check_offsets()
+
+      -- A linewise put appends at once as well.
+      command('let &undolevels = &undolevels')
+      fn.setreg('a', added, 'l')
+      command('0put a')
+      eq(4200, api.nvim_buf_line_count(0))
+      eq(added, api.nvim_buf_get_lines(0, 0, 2000, true))
+      check_offsets()
+      command('undo')
+      eq(after, api.nvim_buf_get_lines(0, 0, -1, true))
+      check_offsets()
+    end)
+
+    it('moves extmarks after the appended lines', function()
+      local before = make_lines(200, 'a')
+      api.nvim_buf_set_lines(0, 0, -1, true, before)
+      local ns = api.nvim_create_namespace('append')
+      local rows = { 0, 99, 100, 101, 199 }
+      for _, row in ipairs(rows) do
+        api.nvim_buf_set_extmark(0, ns, row, 0, {})
+      end
+
+      api.nvim_buf_set_lines(0, 100, 100, true, make_lines(5000, 'b'))
+      local got = {} --- @type integer[]
+      for _, m in ipairs(api.nvim_buf_get_extmarks(0, ns, 0, -1, {})) do
+        got[#got + 1] = m[2]
+      end
+      eq({ 0, 99, 5100, 5101, 5199 }, got)
+      check_offsets()
+    end)
+  end)
+
   describe('deprecated: {get,set,del}_line', function()
     it('works', function()
       eq('', curbuf_depr('get_line', 0))
@@ -208,6 +208,83 @@ describe('API/extmarks', function()
     eq(false, api.nvim_buf_del_extmark(0, ns, 1000))
   end)
 
+  it('nvim_buf_set_extmarks() adds many marks', function()
+    set_extmark(ns, marks[1], 0, 1)
+    local ids = api.nvim_buf_set_extmarks(0, ns, {
+      { 0, 4, { end_col = 5, hl_group = 'Error' } },
+      { 0, 0 },
+      { 0, 2, { right_gravity = false } },
+      { 0, 1 },
+    })
+    eq({ 2, 3, 4, 5 }, ids)
+    eq({
+      { 3, 0, 0 },
+      { 1, 0, 1 },
+      { 5, 0, 1 },
+      { 4, 0, 2 },
+      { 2, 0, 4 },
+    }, get_extmarks(ns, 0, -1))
+    local details = get_extmark_by_id(ns, 2, { details = true })[3]
+    eq({ 0, 5, 'Error' }, { details.end_row, details.end_col, details.hl_group })
+    eq({}, api.nvim_buf_set_extmarks(0, ns, {}))
+
+    -- many marks, added together with the existing ones
+    local items = {}
+    for i = 1, 2000 do
+      items[i] = { 0, i % 6, { end_col = 5 } }
+    end
+    ids = api.nvim_buf_set_extmarks(0, ns, items)
+    eq(2000, #ids)
+    eq(6, ids[1])
+    eq(2005, ids[2000])
+    eq({ 0, 3 }, get_extmark_by_id(ns, ids[3]))
+    eq(2005, #get_extmarks(ns, 0, -1))
+
+    -- marks move with text changes
+    feed('0iab<esc>')
+    eq({ 0, 3 }, get_extmark_by_id(ns, ids[1]))
+    eq({ 0, 3 }, get_extmark_by_id(ns, marks[1]))
+
+    -- nothing is added when an item is invalid
+    eq(
+      "Invalid 'col': out of range",
+      pcall_err(api.nvim_buf_set_extmarks, 0, ns, { { 0, 0 }, { 0, 100 } })
+    )
+    eq(
+      'Invalid marks item: expected [line, col, opts] Array',
+      pcall_err(api.nvim_buf_set_extmarks, 0, ns, { 1 })
+    )
+    eq(
+      "Invalid 'col': expected Integer, got String",
+      pcall_err(api.nvim_buf_set_extmarks, 0, ns, { { 0, 'a' } })
+    )
+    eq(
+      'cannot use \'id\' or \'ephemeral\' with nvim_buf_set_extmarks',
+      pcall_err(api.nvim_buf_set_extmarks, 0, ns, { { 0, 0, { id = 100 } } })
+    )
+    eq(
+      "Invalid 'virt_text_pos': 'foo'",
+      pcall_err(api.nvim_buf_set_extmarks, 0, ns, {
+        { 0, 0, { virt_text = { { 'foo' } } } },
+        { 0, 0, { virt_text_pos = 'foo' } },
+      })
+    )
+    eq(
+      "Invalid 'opts': expected Dict, got String",
+      pcall_err(api.nvim_buf_set_extmarks, 0, ns, { { 0, 0, 'a' } })
+    )
+    eq(2005, #get_extmarks(ns, 0, -1))
+
+    -- empty opts, also as an empty Lua table
+    eq({ 2006 }, api.nvim_buf_set_extmarks(0, ns, { { 0, 0, vim.empty_dict() } }))
+    eq(
+      { 2007 },
+      exec_lua(function(ns_)
+        return vim.api.nvim_buf_set_extmarks(0, ns_, { { 0, 0, {} } })
+      end, ns)
+    )
+  end)
+
   it('can clear a specific namespace range', function()
     set_extmark(ns, 1, 0, 1)
     set_extmark(ns2, 1, 0, 1)
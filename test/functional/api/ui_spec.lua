@@ -1,12 +1,17 @@
 local t = require('test.testutil')
 local n = require('test.functional.testnvim')()
 local Screen = require('test.functional.ui.screen')
+local uv_stream = require('test.client.uv_stream')
+local RpcStream = require('test.client.rpc_stream')
+local ShmStream = require('test.client.shm_stream')
 
 local clear = n.clear
 local command = n.command
 local eq = t.eq
+local neq = t.neq
 local eval = n.eval
 local exec = n.exec
+local exec_lua = n.exec_lua
 local feed = n.feed
 local api = n.api
 local request = n.request
@@ -60,6 +65,14 @@ describe('nvim_ui_attach()', function()
       "Invalid 'stdout_tty': expected Boolean, got String",
       pcall_err(api.nvim_ui_attach, 80, 24, { stdout_tty = 'foo' })
     )
+    eq(
+      "Invalid 'frame_interval': expected Integer, got String",
+      pcall_err(api.nvim_ui_attach, 80, 24, { frame_interval = 'foo' })
+    )
+    eq(
+      "Invalid 'frame_interval': 5000",
+      pcall_err(api.nvim_ui_attach, 80, 24, { frame_interval = 5000 })
+    )
 
     eq('UI not attached to channel: 1', pcall_err(request, 'nvim_ui_try_resize', 40, 10))
     eq('UI not attached to channel: 1', pcall_err(request, 'nvim_ui_set_option', 'rgb', true))
@@ -71,6 +84,37 @@ describe('nvim_ui_attach()', function()
       pcall_err(request, 'nvim_ui_attach', 40, 10, { rgb = false })
     )
   end)
+
+  it('frame_interval coalesces frames', function()
+    local screen = Screen.new(20, 4, { frame_interval = 200 })
+    exec([[
+      for i in range(1, 50)
+        call setline(1, 'line ' .. i)
+        redraw
+      endfor
+    ]])
+    screen:expect([[
+      ^line 50             |
+      {1:~                   }|*2
+                          |
+    ]])
+    local ui = api.nvim_list_uis()[1]
+    eq(200, ui.frame_interval)
+    local stats = ui.frame_stats
+    eq(true, stats.frames < 10, vim.inspect(stats))
+    eq(true, stats.coalesced >= 40, vim.inspect(stats))
+    eq(true, stats.bytes > 0, vim.inspect(stats))
+
+    -- Pacing stops when the option is reset.
+    api.nvim_ui_set_option('frame_interval', 0)
+    feed('iabc<Esc>')
+    screen:expect([[
+      ab^cline 50          |
+      {1:~                   }|*2
+                          |
+    ]])
+    eq(nil, api.nvim_list_uis()[1].frame_stats)
+  end)
 end)
 
 describe('nvim_ui_send', function()
@@ -206,3 +250,211 @@ it('autocmds VimSuspend/VimResume #22041', function()
   screen:attach()
   eq({ 's', 'r', 's', 'r', 's', 'r', 's', 'r' }, eval('g:ev'))
 end)
+
+describe("nvim_ui_attach() 'shm'", function()
+  before_each(function()
+    t.skip(not t.is_os('linux'), 'needs memfd_create() and eventfd()')
+  end)
+
+  --- @param fd integer
+  local function fd_target(fd)
+    return exec_lua(function(fd_)
+      return vim.uv.fs_readlink('/proc/self/fd/' .. fd_)
+    end, fd)
+  end
+
+  it('validation', function()
+    clear()
+    eq(
+      "Invalid 'shm': expected Array, got Integer",
+      pcall_err(api.nvim_ui_attach, 80, 24, { shm = 3 })
+    )
+    eq(
+      'shm must be [fd, doorbell_fd, wakeup_fd]',
+      pcall_err(api.nvim_ui_attach, 80, 24, { shm = { 3, 4 } })
+    )
+    eq("Invalid 'shm fd': -1", pcall_err(api.nvim_ui_attach, 80, 24, { shm = { 3, 4, -1 } }))
+    eq(
+      'invalid shm doorbell or wakeup fd',
+      pcall_err(api.nvim_ui_attach, 80, 24, { shm = { 100, 101, 102 } })
+    )
+
+    for _, case in ipairs({
+      { { magic = 0 }, 'invalid shm header' },
+      { { version = 2 }, 'invalid shm header' },
+      { { size = 65536 + 4096 }, 'invalid shm ring size' },
+      { { size = 2 * 65536 }, 'invalid shm ring size' },
+    }) do
+      local reader = ShmStream.new(65536, case[1])
+      clear({ io_extra = reader:fds() })
+      eq('anon_inode:[eventfd]', fd_target(4))
+      eq(case[2], pcall_err(api.nvim_ui_attach, 80, 24, { shm = { 3, 4, 5 } }))
+      -- The wakeup fds are closed also when failing.
+      neq('anon_inode:[eventfd]', fd_target(4))
+      neq('anon_inode:[eventfd]', fd_target(5))
+      eq({}, api.nvim_list_uis())
+      reader:close()
+    end
+
+    local reader = ShmStream.new(65536)
+    clear({ io_extra = reader:fds() })
+    local _ = Screen.new(20, 5)
+    eq(
+      'shm can only be set by nvim_ui_attach',
+      pcall_err(api.nvim_ui_set_option, 'shm', { 3, 4, 5 })
+    )
+    reader:close()
+  end)
+
+  --- @return string[]
+  local function lines(count, width)
+    local chars = 'abcdefghijklmnopqrstuvwxyz'
+    local res = {} --- @type string[]
+    for i = 1, count do
+      local line = ('line %d '):format(i)
+      for c = #line + 1, width - 1 do
+        local j = (c * i) % #chars + 1
+        line = line .. chars:sub(j, j)
+      end
+      res[i] = line
+    end
+    return res
+  end
+
+  --- Attaches a "width" x "height" UI which reads the "redraw" notifications
+  --- from a ring of "size" bytes. The buffer has lines which fill the screen.
+  ---
+  --- @return test.ShmStream reader
+  --- @return fun(cmd: string) command  Runs "cmd" through the channel of the UI.
+  --- @return fun(frame: string) wait  Reads from the ring until "frame" is
+  ---   the first row of the screen.
+  --- @return string[] rows  The screen as of the last "flush".
+  --- @return string[] frames  The first row of the screen at every "flush".
+  local function attach_shm(size, width, height, opts)
+    local reader = ShmStream.new(size)
+    clear({ io_extra = reader:fds() })
+    api.nvim_buf_set_lines(0, 0, -1, true, lines(height - 1, width))
+    local stream = RpcStream.new(uv_stream.SocketStream.open(n.fn.serverstart()))
+    local grid = {} --- @type string[][]
+    local rows = {} --- @type string[]
+    local frames = {} --- @type string[]
+
+    local function on_notification(method, args)
+      eq('redraw', method)
+      for _, ev in ipairs(args[1]) do
+        for i = 2, #ev do
+          local a = ev[i]
+          if ev[1] == 'grid_resize' or ev[1] == 'grid_clear' then
+            for r = 1, height do
+              grid[r] = {}
+              for c = 1, width do
+                grid[r][c] = ' '
+              end
+            end
+          elseif ev[1] == 'grid_line' then
+            local row, col = a[2] + 1, a[3] + 1
+            for _, cell in ipairs(a[4]) do
+              for _ = 1, cell[3] or 1 do
+                grid[row][col] = cell[1]
+                col = col + 1
+              end
+            end
+          elseif ev[1] == 'flush' then
+            for r = 1, height do
+              rows[r] = vim.trim(table.concat(grid[r]))
+            end
+            table.insert(frames, rows[1])
+          end
+        end
+      end
+    end
+    stream:read_start(function() end, function() end, function() end)
+    RpcStream.new(reader):read_start(function() end, on_notification, function() end)
+
+    local function request(method, args)
+      local done, err = false, nil
+      stream:write(method, args, function(e)
+        done, err = true, e
+      end)
+      while not done do
+        uv.run('once')
+      end
+      eq(nil, err)
+    end
+
+    local function wait(frame)
+      local deadline = uv.now() + 10000
+      while frames[#frames] ~= frame do
+        reader:drain()
+        uv.sleep(1)
+        uv.update_time()
+        assert(uv.now() < deadline, 'timeout waiting for ' .. frame)
+      end
+    end
+
+    opts = vim.tbl_extend('error', { ext_linegrid = true, shm = { 3, 4, 5 } }, opts or {})
+    request('nvim_ui_attach', { width, height, opts })
+    wait(lines(1, width)[1])
+    return reader, function(cmd)
+      request('nvim_command', { cmd })
+    end, wait, rows, frames
+  end
+
+  --- @return string[]
+  local function screen_lines(rows)
+    return vim.list_slice(rows, 2, #rows - 1)
+  end
+
+  it('continues the msgpack stream across the end of the ring', function()
+    local width, height = 80, 24
+    local reader, command_, wait, rows = attach_shm(65536, width, height)
+    for i = 1, 200 do
+      command_(('call setline(1, "frame %d") | redraw!'):format(i))
+      wait(('frame %d'):format(i))
+    end
+    eq(true, reader:head() > 2 * 65536)
+    eq(vim.list_slice(lines(height - 1, width), 2), screen_lines(rows))
+    reader:close()
+  end)
+
+  it('keeps the redraws in order while the ring is full', function()
+    local width, height = 200, 60
+    local reader, command_, wait, rows, frames = attach_shm(65536, width, height)
+    local nframes = #frames
+    -- Every frame is a large part of the ring, so most of them wait in Nvim.
+    for i = 1, 8 do
+      command_(('call setline(1, "frame %d") | redraw!'):format(i))
+    end
+    eq(1, reader.hdr.writer_waiting)
+    wait('frame 8')
+
+    local expected, seen = {}, {} --- @type string[], string[]
+    for i = 1, 8 do
+      expected[i] = ('frame %d'):format(i)
+    end
+    for i = nframes + 1, #frames do
+      if frames[i] ~= seen[#seen] then
+        table.insert(seen, frames[i])
+      end
+    end
+    eq(expected, seen)
+    eq(vim.list_slice(lines(height - 1, width), 2), screen_lines(rows))
+    reader:close()
+  end)
+
+  it('counts the data waiting for the ring as backlog for frame pacing', function()
+    local width, height = 200, 60
+    local reader, command_, wait, rows = attach_shm(65536, width, height, { frame_interval = 1 })
+    for i = 1, 8 do
+      command_(('call setline(1, "frame %d") | redraw!'):format(i))
+    end
+    t.retry(nil, 1000, function()
+      local stats = api.nvim_list_uis()[1].frame_stats
+      eq(true, stats.max_backlog > 0)
+      eq(true, stats.backlog_waits > 0)
+    end)
+    wait('frame 8')
+    eq(vim.list_slice(lines(height - 1, width), 2), screen_lines(rows))
+    reader:close()
+  end)
+end)
@@ -2788,6 +2788,52 @@ describe('API', function()
     end)
   end)
 
+  describe('"pipeline" client attribute', function()
+    it('handles read-only requests in order with other requests', function()
+      local uv_stream = require('test.client.uv_stream')
+      local RpcStream = require('test.client.rpc_stream')
+      local stream = RpcStream.new(uv_stream.SocketStream.open(fn.serverstart()))
+      local results = {}
+      local function cb(err, res)
+        results[#results + 1] = err or res
+      end
+      stream:read_start(function() end, function() end, function() end)
+
+      stream:write(
+        'nvim_set_client_info',
+        { 'pipelined', {}, 'remote', {}, { pipeline = 'readonly' } },
+        cb
+      )
+      for i = 1, 3 do
+        stream:write('nvim_buf_get_lines', { 0, 0, -1, true }, cb)
+        stream:write('nvim_buf_line_count', { 0 }, cb)
+        stream:write('nvim_buf_set_lines', { 0, -1, -1, true, { 'line ' .. i } }, cb)
+      end
+      stream:write('nvim_buf_get_lines', { 0, 0, -1, true }, cb)
+      t.retry(nil, 10000, function()
+        uv.run('nowait')
+        eq(11, #results)
+      end)
+      local chans = api.nvim_list_chans()
+      eq({ pipeline = 'readonly' }, chans[#chans].client.attributes)
+      stream:close()
+
+      eq({
+        NIL,
+        { '' },
+        1,
+        NIL,
+        { '', 'line 1' },
+        2,
+        NIL,
+        { '', 'line 1', 'line 2' },
+        3,
+        NIL,
+        { '', 'line 1', 'line 2', 'line 3' },
+      }, results)
+    end)
+  end)
+
   describe('nvim_call_atomic', function()
     it('works', function()
       api.nvim_buf_set_lines(0, 0, -1, true, { 'first' })
@@ -3171,6 +3217,7 @@ describe('API', function()
       local expected = {
         {
           chan = 1,
+          ext_binary_grid = false,
           ext_cmdline = false,
           ext_hlstate = false,
           ext_linegrid = screen._options.ext_linegrid or false,
@@ -1,5 +1,6 @@
 local t = require('test.testutil')
 local n = require('test.functional.testnvim')()
+local uv_stream = require('test.client.uv_stream')
 
 local clear, eq, eval, next_msg, ok, source = n.clear, t.eq, n.eval, n.next_msg, t.ok, n.source
 local command, fn, api = n.command, n.fn, n.api
@@ -503,3 +504,50 @@ describe('loopback', function()
     eq(chans - 1, eval('len(nvim_list_chans())'))
   end)
 end)
+
+describe('msgpack-rpc strings from the read buffer', function()
+  before_each(clear)
+
+  --- Connects to Nvim, returns a function which sends raw data.
+  local function connect()
+    local stream = uv_stream.SocketStream.open(fn.serverstart())
+    return function(data)
+      stream:write(data)
+      vim.uv.run('nowait')
+    end
+  end
+
+  it('are valid when a request continues in the next read', function()
+    local send = connect()
+    local lines = { ('a'):rep(1000), ('b'):rep(1000), ('c'):rep(1000) }
+    local msg = vim.mpack.encode({ 2, 'nvim_buf_set_lines', { 0, 0, -1, true, lines } })
+    -- The first string is in the first read, the second one is split.
+    send(msg:sub(1, 1500))
+    sleep(100)
+    send(msg:sub(1501))
+    retry(nil, 5000, function()
+      eq(lines, api.nvim_buf_get_lines(0, 0, -1, true))
+    end)
+  end)
+
+  it('are valid when a queued request runs after more reads', function()
+    local send = connect()
+    -- While Nvim is busy the requests below arrive, more than fit in one
+    -- read, and wait in the queue of the channel.
+    send(vim.mpack.encode({ 2, 'nvim_exec_lua', { 'vim.uv.sleep(300)', {} } }))
+    sleep(50)
+    local lines, data = {}, {} --- @type string[], string[]
+    for i = 1, 30 do
+      lines[i] = string.char(97 + i % 26):rep(5000 + i)
+      local args = { 0, i - 1, i == 1 and -1 or i - 1, true, { lines[i] } }
+      data[i] = vim.mpack.encode({ 2, 'nvim_buf_set_lines', args })
+    end
+    local all = table.concat(data)
+    for i = 1, #all, 7000 do
+      send(all:sub(i, i + 6999))
+    end
+    retry(nil, 5000, function()
+      eq(lines, api.nvim_buf_get_lines(0, 0, -1, true))
+    end)
+  end)
+end)
@@ -313,6 +313,61 @@ describe('fileio', function()
       <erwrite-forced" [noeol] 1L, 6B written |
     ]])
   end)
+
+  it('edits a buffer backed by a file mapping', function()
+    clear()
+    -- More than 'largefilesize' Mbyte, the buffer is backed by a mapping.
+    local lines = {}
+    for i = 1, 30000 do
+      lines[i] = ('%d %s'):format(i, ('x'):rep(40))
+    end
+    local fname = 'Xtest-mapped-file'
+    write_file(fname, table.concat(lines, '\n') .. '\n', true)
+    finally(function()
+      os.remove(fname)
+    end)
+    command('set largefilesize=1 noswapfile')
+    command('edit ' .. fname)
+
+    -- Only the changed lines move out of the mapping.
+    local expected = vim.deepcopy(lines)
+    fn.setline(100, 'changed')
+    expected[100] = 'changed'
+    fn.deletebufline('%', 200)
+    table.remove(expected, 200)
+    fn.append(300, { 'one', 'two' })
+    table.insert(expected, 301, 'one')
+    table.insert(expected, 302, 'two')
+    command('20000delete')
+    table.remove(expected, 20000)
+    fn.setline(#expected, 'last')
+    expected[#expected] = 'last'
+
+    eq(#expected, fn.line('$'))
+    eq(expected, fn.getline(1, '$'))
+    local byte = 1
+    for i = 1, #expected do
+      if i % 997 == 1 or (i >= 98 and i <= 304) then
+        eq(byte, fn.line2byte(i))
+      end
+      byte = byte + #expected[i] + 1
+    end
+    eq(byte, fn.line2byte(#expected + 1))
+
+    command('undo 0')
+    eq(lines, fn.getline(1, '$'))
+
+    -- A file truncated by another program does not make Nvim crash, the
+    -- lines beyond its end are empty.
+    fn.setline(5, 'changed')
+    write_file(fname, 'short\n', true)
+    sleep(20)
+    eq(30000, fn.line('$'))
+    eq('changed', fn.getline(5))
+    eq('', fn.getline(20000))
+    eq('', fn.getline(30000))
+    assert_alive()
+  end)
 end)
 
 describe('tmpdir', function()
@@ -14,3 +14,181 @@ describe('search (/)', function()
     eq([[Vim:E951: \% value too large]], pcall_err(command, '/\\v%2147483648c'))
   end)
 end)
+
+describe('regexp with required literal text', function()
+  before_each(clear)
+
+  it('finds the same matches with each engine', function()
+    local lines = { 'no match here', 'x foo_abc_bar', 'error: TIMEOUT', 'x\u{212a} yz', 'bar1' }
+    for _, re in ipairs({ 1, 2 }) do
+      command('set re=' .. re)
+      for _, c in ipairs({
+        { [[\<foo_\w\+bar]], 'foo_abc_bar' },
+        { [[\cerror:.*timeout]], 'error: TIMEOUT' },
+        { [[error:.*timeout]], '' },
+        { [[\cxk.*yz]], 'x\u{212a} yz' },
+        { [[\(foo\|bar\)\d]], 'bar1' },
+        { [[\(foo\|baz\)\d]], '' },
+      }) do
+        local found = ''
+        for _, line in ipairs(lines) do
+          found = found .. n.fn.matchstr(line, c[1])
+        end
+        eq(c[2], found, ('re=%d %s'):format(re, c[1]))
+      end
+    end
+  end)
+
+  it('applies the current value of ignorecase', function()
+    n.api.nvim_buf_set_lines(0, 0, -1, true, { 'Foo_1', 'foo_2', 'bar_3', 'FOO_' })
+    local function count()
+      return n.fn.searchcount({ pattern = [[f\a\+_\d]], recompute = true, maxcount = 0 }).total
+    end
+    for _, re in ipairs({ 0, 1, 2 }) do
+      command('set re=' .. re)
+      command('set noignorecase')
+      eq(1, count())
+      command('set ignorecase')
+      eq(2, count())
+      command('set noignorecase')
+      eq(1, count())
+    end
+  end)
+
+  it('falls back to the NFA when the lazy DFA needs too many states', function()
+    -- Unanchored, "a[ab]\{10}c" needs a DFA state for every combination of
+    -- the last 11 characters, "b[ab]\{3}c" fits in the cache.
+    local cases = {
+      { [[a[ab]\{10}c]], 'a' .. ('[ab]'):rep(10) .. 'c', 0 },
+      { [[b[ab]\{3}c]], 'b' .. ('[ab]'):rep(3) .. 'c', 0 },
+    }
+    local lines, seed = {}, 1
+    for i = 1, 300 do
+      local line = ''
+      for _ = 1, 200 do
+        seed = seed * 16807 % 2147483647
+        local v = seed % 40
+        line = line .. (v == 0 and 'c' or v % 2 == 1 and 'a' or 'b')
+      end
+      lines[i] = line
+      for _, c in ipairs(cases) do
+        c[3] = c[3] + (line:find(c[2]) and 1 or 0)
+      end
+    end
+    n.api.nvim_buf_set_lines(0, 0, -1, true, lines)
+    for _, re in ipairs({ 1, 2 }) do
+      command('set re=' .. re)
+      for _, c in ipairs(cases) do
+        command('let g:n = 0 | g/' .. c[1] .. '/let g:n += 1')
+        eq(c[3], n.eval('g:n'), ('re=%d %s'):format(re, c[1]))
+      end
+    end
+  end)
+end)
+
+describe('multi-line search', function()
+  before_each(clear)
+
+  it('finds matches spanning lines far apart', function()
+    local lines = {}
+    for i = 1, 200 do
+      lines[i] = ('line %d foo'):format(i)
+    end
+    lines[20] = 'key 42'
+    lines[70] = 'key 42 again'
+    lines[150] = 'start'
+    lines[199] = 'bar end'
+    n.api.nvim_buf_set_lines(0, 0, -1, true, lines)
+    for _, re in ipairs({ 1, 2 }) do
+      command('set re=' .. re)
+      for _, c in ipairs({
+        { [[foo\nbar]], { 198, 10 } },
+        { [[start\_.\{-}\nbar end]], { 150, 1 } },
+        { [[key \(\d\+\)\n\_.\{-}key \1 again]], { 20, 1 } },
+        { [[\(line 12 \)\@<=foo\n]], { 12, 9 } },
+        { [[\(foo\n\)\@<=start]], { 150, 1 } },
+      }) do
+        n.fn.cursor(1, 1)
+        eq(c[2], n.fn.searchpos(c[1], 'cnW'), ('re=%d %s'):format(re, c[1]))
+      end
+      -- The buffer is changed between searches.
+      n.fn.cursor(1, 1)
+      eq(198, n.fn.search([[foo\nbar]], 'W'))
+      n.fn.setline(199, 'baz end')
+      n.fn.cursor(1, 1)
+      eq(0, n.fn.search([[foo\nbar]], 'W'))
+      n.fn.setline(199, 'bar end')
+    end
+  end)
+end)
+
+describe('search in a huge buffer', function()
+  local nlines = 100000
+  local fname = 'Xsearch_huge.txt'
+  local lines = {}
+
+  setup(function()
+    for i = 1, nlines do
+      local parts = { tostring(i) }
+      if i % 7 == 0 then
+        parts[#parts + 1] = 'error: 5'
+      end
+      if i % 11 == 0 then
+        parts[#parts + 1] = 'Error: 6'
+      end
+      if i % 13 == 0 then
+        parts[#parts + 1] = 'error: x'
+      end
+      if i % 17 == 0 then
+        parts[#parts + 1] = 'o\u{212a}'
+      end
+      lines[i] = table.concat(parts, ' ')
+    end
+    t.write_file(fname, table.concat(lines, '\n') .. '\n', true)
+  end)
+
+  teardown(function()
+    os.remove(fname)
+  end)
+
+  local function count(pred)
+    local c = 0
+    for i = 1, nlines do
+      c = c + (pred(i) and 1 or 0)
+    end
+    return c
+  end
+
+  for _, lfs in ipairs({ 0, 1 }) do
+    it(('finds all matches with searchcount(), :global and :vimgrep, lfs=%d'):format(lfs), function()
+      clear()
+      command('set largefilesize=' .. lfs)
+      command('edit ' .. fname)
+      for _, re in ipairs({ 1, 2 }) do
+        command('set re=' .. re)
+        for _, c in ipairs({
+          { [[error: \d]], false, count(function(i) return i % 7 == 0 end) },
+          { [[error: \d]], true, count(function(i) return i % 7 == 0 or i % 11 == 0 end) },
+          { 'ok', true, count(function(i) return i % 17 == 0 end) },
+          { 'ok', false, 0 },
+          -- no literal text, only the regexp can tell
+          { [[^\d\+$]], false, count(function(i) return lines[i]:match('^%d+$') end) },
+          { [[\k\+ x$]], false, count(function(i) return lines[i]:match(' x$') end) },
+          -- not matched in the threads
+          { [[\%>50000lerror: 5]], false, count(function(i) return i > 50000 and i % 7 == 0 end) },
+          { [[\(: \)\@<=5]], false, count(function(i) return i % 7 == 0 end) },
+        }) do
+          local msg = ('re=%d ic=%s %s'):format(re, c[2], c[1])
+          command(c[2] and 'set ignorecase' or 'set noignorecase')
+          n.fn.setreg('/', c[1])
+          eq(c[3], n.fn.searchcount({ recompute = true, maxcount = 0, timeout = 0 }).total, msg)
+          n.exec('let g:n = 0 | silent g/' .. c[1] .. '/let g:n += 1')
+          eq(c[3], n.eval('g:n'), msg)
+          n.fn.setqflist({})
+          command('silent! vimgrep /' .. c[1] .. '/j %')
+          eq(c[3], #n.fn.getqflist(), msg)
+        end
+      end
+    end)
+  end
+end)
@@ -7,6 +7,7 @@ local eq, eval, expect, exec = t.eq, n.eval, n.expect, n.exec
 local assert_alive = n.assert_alive
 local clear = n.clear
 local command = n.command
+local exec_lua = n.exec_lua
 local feed = n.feed
 local fn = n.fn
 local neq = t.neq
@@ -132,6 +133,58 @@ describe("preserve and (R)ecover with custom 'directory'", function()
     test_recover(swappath1)
   end)
 
+  it('renames a swapfile written by the swap writer thread with :saveas', function()
+    local testfile2 = 'Xtest_recover_file2'
+    finally(function()
+      os.remove(testfile2)
+    end)
+    local function swapname()
+      exec('redir => g:swapname | silent swapname | redir END')
+      return eval('g:swapname'):match('[^\n]*$')
+    end
+    local function stat(path)
+      return uv.fs_stat(path) or { size = 0, mtime = {} }
+    end
+
+    exec(init)
+    command('set updatetime=10')
+    command('edit! ' .. testfile)
+    exec_lua(function()
+      local lines = {}
+      for i = 1, 20000 do
+        lines[i] = ('line %d'):format(i)
+      end
+      vim.api.nvim_buf_set_lines(0, 0, -1, true, lines)
+    end)
+    -- Waiting for input does the idle sync, the blocks are written by the
+    -- swap writer thread.
+    local swappath1 = swapname()
+    retry(nil, nil, function()
+      ok(stat(swappath1).size > 100000)
+    end)
+
+    command('saveas ' .. testfile2)
+    local swappath2 = swapname()
+    neq(swappath1, swappath2)
+    eq(nil, uv.fs_stat(swappath1))
+    local mtime = stat(swappath2).mtime
+    command('1,100delete')
+    retry(nil, nil, function()
+      neq(mtime, stat(swappath2).mtime)
+    end)
+    eq(0, vim.uv.kill(eval('getpid()'), 'sigkill'))
+
+    local nvim2 =
+      n.new_session(false, { args = { '-u', 'NONE', '-i', 'NONE', '--embed' }, merge = false })
+    set_session(nvim2)
+    exec(init)
+    command('autocmd SwapExists * let v:swapchoice = "r"')
+    command('silent edit! ' .. testfile2)
+    eq(19900, fn.line('$'))
+    eq('line 101', fn.getline(1))
+    eq('line 20000', fn.getline('$'))
+  end)
+
   it('manual :recover with multiple swapfiles', function()
     local swappath1 = setup_swapname()
     eq('.swp', swappath1:match('%.[^.]+$'))
@@ -636,3 +689,42 @@ describe('quitting swapfile dialog on startup stops TUI properly', function()
     end)
   end)
 end)
+
+describe("'memcompress'", function()
+  before_each(function()
+    clear({ args = { '--cmd', 'set noswapfile memcompress=64' } })
+  end)
+
+  it('compresses text that was not used recently', function()
+    exec_lua(function()
+      local lines = {}
+      for i = 1, 50000 do
+        lines[i] = ('line %d with some text'):format(i)
+      end
+      vim.api.nvim_buf_set_lines(0, 0, -1, true, lines)
+    end)
+    local stats = api.nvim__stats()
+    ok(stats.memfile_compressed > 0)
+    ok(stats.memfile_compressed < stats.memfile_compressed_raw / 2)
+    eq('line 1 with some text', fn.getline(1))
+    eq('line 50000 with some text', fn.getline(50000))
+
+    command('%s/some/more/')
+    eq('line 25000 with more text', fn.getline(25000))
+    ok(api.nvim__stats().memfile_compressed > 0)
+
+    command('bwipe!')
+    eq(0, api.nvim__stats().memfile_compressed)
+    eq(0, api.nvim__stats().memfile_compressed_raw)
+  end)
+
+  it('must be zero or at least 64', function()
+    eq(
+      'Vim(set):E487: Argument must be positive: memcompress=-1',
+      pcall_err(command, 'set memcompress=-1')
+    )
+    eq('Vim(set):E474: Invalid argument: memcompress=63', pcall_err(command, 'set memcompress=63'))
+    command('set memcompress=0')
+    eq(0, api.nvim_get_option_value('memcompress', {}))
+  end)
+end)
@@ -181,6 +181,26 @@ describe(':write', function()
     vim.uv.fs_symlink(fname_bak .. ('/xxxxx'):rep(20), fname)
     eq("Vim(write):E166: Can't open linked file for writing", pcall_err(command, 'write!'))
   end)
+
+  for _, opts in ipairs({ 'backupcopy=yes', 'backupcopy=no nowritebackup', 'backupcopy=no' }) do
+    it('writes a buffer backed by a file mapping over that file, ' .. opts, function()
+      -- More than 'largefilesize' Mbyte, the buffer is backed by a mapping.
+      local lines = {}
+      for i = 1, 30000 do
+        lines[i] = ('%d %s'):format(i, ('x'):rep(40))
+      end
+      write_file(fname, table.concat(lines, '\n') .. '\n', true)
+      command('set largefilesize=1 ' .. opts)
+      command('edit ' .. fname)
+      command('write!')
+      eq(lines, fn.readfile(fname))
+      -- The buffer does not read its text from the file any more.
+      write_file(fname, 'changed\n', true)
+      eq(30000, fn.line('$'))
+      eq(lines[20000], fn.getline(20000))
+      eq(lines[30000], fn.getline(30000))
+    end)
+  end
 end)
 
 describe(':update', function()
@@ -1773,6 +1773,32 @@ describe('lua stdlib', function()
     assert_alive()
   end)
 
+  it('vim.regex used again while it is matching', function()
+    local res = exec_lua(function()
+      -- Too long for the NFA engine, it switches to the backtracking engine.
+      local re = vim.regex([[\(a\+\)b]])
+      local long = ('a'):rep(200000) .. 'b'
+      local busy = false
+      local inner = {} --- @type any[]
+      local timer = assert(vim.uv.new_timer())
+      -- Invoked by the breakcheck of the match below.
+      timer:start(0, 1, function()
+        table.insert(inner, { busy, pcall(re.match_str, re, 'xxaab') })
+      end)
+      busy = true
+      local outer = { re:match_str(long) }
+      busy = false
+      timer:close()
+      return { outer = outer, inner = inner, again = { re:match_str('xab') } }
+    end)
+    eq({ 0, 200001 }, res.outer)
+    eq({ 1, 3 }, res.again)
+    eq(true, #res.inner > 0)
+    for _, r in ipairs(res.inner) do
+      eq({ true, true, 2, 5 }, r)
+    end
+  end)
+
   it('vim.defer_fn', function()
     eq(
       false,
@@ -691,6 +691,32 @@ describe(':terminal buffer', function()
     end)
   end)
 
+  it('keeps its glyphs when evicting the glyph cache', function()
+    local screen = Screen.new(50, 12)
+    local chan = api.nvim_open_term(0, {})
+    -- Glyphs which are too long to be stored in the cell, the first lines go
+    -- to the scrollback.
+    local lines = {}
+    for i = 1, 30 do
+      lines[i] = ('%d %s'):format(i, string.char(97 + i % 26, 0xcc, 0x80 + i, 0xcc, 0xa3))
+    end
+    api.nvim_chan_send(chan, table.concat(lines, '\r\n'))
+    retry(nil, nil, function()
+      eq(lines, api.nvim_buf_get_lines(0, 0, -1, true))
+    end)
+
+    api.nvim__evict_glyph_cache()
+    -- Lines come back from the scrollback and go to it again, their cells are
+    -- read again.
+    screen:try_resize(50, 20)
+    screen:try_resize(50, 6)
+    api.nvim_chan_send(chan, '\r\n')
+    retry(nil, nil, function()
+      eq(lines, api.nvim_buf_get_lines(0, 0, 30, true))
+    end)
+    assert_alive()
+  end)
+
   it('handles extended grapheme clusters', function()
     local screen = Screen.new(50, 7)
     feed 'i'
@@ -110,6 +110,41 @@ describe('TUI', function()
     feed_data(':')
     screen:expect(s1)
   end)
+
+  it('draws only damaged cells, with REP, and writes $NVIM_TUI_STATS', function()
+    clear()
+    local statsfile = 'Xtest-tui-stats'
+    finally(function()
+      os.remove(statsfile)
+    end)
+    local env = { NVIM_TUI_STATS = statsfile, XTERM_VERSION = 'XTerm(390)' }
+    for k, v in pairs(env_notermguicolors) do
+      env[k] = v
+    end
+    local screen = tt.setup_child_nvim({ '--clean' }, { env = env })
+    feed_data(':call setline(1, repeat("-", 20) .. "x" .. repeat("=", 12))\r')
+    screen:expect({ any = ('%-'):rep(19) .. 'x' .. ('='):rep(12) })
+    feed_data('3|rX')
+    screen:expect({ any = '%-%-%^?X' .. ('%-'):rep(17) .. 'x' .. ('='):rep(12) })
+    retry(nil, nil, function()
+      local stats = read_file(statsfile) or ''
+      ok(stats:find('^frame 1: %d+ bytes, %d+ rows, %d+ cells, %d+ us\n') ~= nil, 'stats', stats)
+    end)
+  end)
+
+  it('scrolls a vertical split within margins', function()
+    clear()
+    local screen = tt.setup_child_nvim({ '--clean' }, { env = env_notermguicolors })
+    feed_data(':call setline(1, map(range(1, 100), "printf(\'line %d\', v:val)"))\r')
+    feed_data(':vsplit\r')
+    screen:expect({ any = 'line 1 +│line 1 ' })
+    feed_data('\5\5\5')
+    screen:expect({ any = 'line 4 +│line 1 .*line 5 +│line 2 ' })
+    feed_data('\25')
+    screen:expect({ any = 'line 3 +│line 1 .*line 4 +│line 2 ' })
+    feed_data('\23lG')
+    screen:expect({ any = 'line 3 +│line 9[0-9] ' })
+  end)
 end)
 
 describe('TUI :detach', function()
@@ -2182,6 +2217,7 @@ describe('TUI', function()
     local expected = {
       {
         chan = ui_chan,
+        ext_binary_grid = false,
         ext_cmdline = false,
         ext_hlstate = false,
         ext_linegrid = true,
@@ -568,8 +568,8 @@ end
 --- @field merge? boolean
 --- Environment variables
 --- @field env? table<string,string>
---- Used for stdin_fd, see `:help ui-option`
---- @field io_extra? uv.uv_pipe_t
+--- Used for stdin_fd and shm, see `:help ui-option`
+--- @field io_extra? uv.uv_pipe_t|integer|(uv.uv_pipe_t|integer)[]
 
 --- @private
 ---
@@ -578,8 +578,8 @@ end
 --- @param ... string Nvim CLI args, or `test.session.Opts` table.
 --- @return string[]
 --- @return string[]?
---- @return uv.uv_pipe_t?
---- @overload fun(opts: test.session.Opts): string[], string[]?, uv.uv_pipe_t?
+--- @return uv.uv_pipe_t|integer|(uv.uv_pipe_t|integer)[]?
+--- @overload fun(opts: test.session.Opts): string[], string[]?, uv.uv_pipe_t|integer|(uv.uv_pipe_t|integer)[]?
 function M._new_argv(...)
   --- @type test.session.Opts|string
   local opts = select(1, ...)
@@ -596,7 +596,7 @@ function M._new_argv(...)
   end
 
   local new_args --- @type string[]
-  local io_extra --- @type uv.uv_pipe_t?
+  local io_extra --- @type uv.uv_pipe_t|integer|(uv.uv_pipe_t|integer)[]?
   local env --- @type string[]? List of "key=value" env vars.
 
   if type(opts) ~= 'table' then
@@ -0,0 +1,130 @@
+local t = require('test.testutil')
+local n = require('test.functional.testnvim')()
+local Screen = require('test.functional.ui.screen')
+
+local clear = n.clear
+local command = n.command
+local feed = n.feed
+local api = n.api
+local eq = t.eq
+local pcall_err = t.pcall_err
+
+describe('ext_binary_grid', function()
+  local screen
+
+  before_each(function()
+    clear()
+    screen = Screen.new(20, 5, { ext_binary_grid = true })
+    command([[call setline(1, map(range(1, 10), '"line " .. v:val'))]])
+  end)
+
+  it('draws and scrolls', function()
+    screen:expect([[
+      ^line 1              |
+      line 2              |
+      line 3              |
+      line 4              |
+                          |
+    ]])
+    feed('<C-e>')
+    screen:expect([[
+      ^line 2              |
+      line 3              |
+      line 4              |
+      line 5              |
+                          |
+    ]])
+    feed('<C-y>')
+    screen:expect([[
+      line 1              |
+      ^line 2              |
+      line 3              |
+      line 4              |
+                          |
+    ]])
+    feed('G')
+    screen:expect([[
+      line 7              |
+      line 8              |
+      line 9              |
+      ^line 10             |
+                          |
+    ]])
+  end)
+
+  it('updates changed cells', function()
+    feed('wiX<Esc>')
+    screen:expect([[
+      line ^X1             |
+      line 2              |
+      line 3              |
+      line 4              |
+                          |
+    ]])
+    feed('jdd')
+    screen:expect([[
+      line X1             |
+      ^line 3              |
+      line 4              |
+      line 5              |
+                          |
+    ]])
+    command('call setline(1, "馬a馬")')
+    screen:expect([[
+      馬a馬               |
+      ^line 3              |
+      line 4              |
+      line 5              |
+                          |
+    ]])
+    feed('kx')
+    screen:expect([[
+      ^a馬                 |
+      line 3              |
+      line 4              |
+      line 5              |
+                          |
+    ]])
+  end)
+
+  it('redraws cells after their glyphs moved in the glyph cache', function()
+    -- Glyphs which are too long to be stored in the cell, one per line.
+    local function glyph(i)
+      return string.char(97 + i % 26, 0xcc, 0x80 + i % 64, 0xcc, 0x80 + i % 61 + 3)
+    end
+    local lines = {}
+    for i = 1, 30 do
+      lines[i] = glyph(i)
+    end
+    api.nvim_buf_set_lines(0, 0, -1, true, lines)
+    n.exec([[
+      for i in range(4)
+        exe "normal! \<C-e>"
+        redraw
+      endfor
+    ]])
+    local pad = (' '):rep(19)
+    local function expect(l1, l2)
+      local rows = { '^' .. l1, l2, lines[7], lines[8] }
+      screen:expect(table.concat(rows, pad .. '|\n') .. pad .. '|\n' .. pad .. ' |')
+    end
+    expect(lines[5], lines[6])
+
+    -- The shown glyphs get new indexes, the evicted ones are reused for the
+    -- next glyphs.  A cell which gets such a glyph must still be sent.
+    api.nvim__evict_glyph_cache()
+    screen:expect_unchanged()
+    local new1, new2 = glyph(40), glyph(41)
+    api.nvim_buf_set_lines(0, 5, 6, true, { new1 })
+    expect(lines[5], new1)
+    api.nvim_buf_set_lines(0, 4, 5, true, { new2 })
+    expect(new2, new1)
+  end)
+
+  it('cannot be changed after attaching', function()
+    eq(
+      'ext_binary_grid option cannot be changed',
+      pcall_err(api.nvim_ui_set_option, 'ext_binary_grid', false)
+    )
+  end)
+end)
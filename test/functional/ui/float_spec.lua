@@ -509,6 +509,107 @@ describe('float window', function()
     assert_alive()
   end)
 
+  it('is composed correctly when overlapping floats move, resize and hide', function()
+    local screen = Screen.new(60, 20)
+    exec_lua(function()
+      local lines = {} --- @type string[]
+      for i = 1, 100 do
+        lines[i] = ('%d '):format(i) .. ('abcdefghij'):rep(6)
+      end
+      vim.api.nvim_buf_set_lines(0, 0, -1, true, lines)
+    end)
+    local wins = exec_lua(function()
+      local wins = {} --- @type integer[]
+      for i = 1, 3 do
+        local buf = vim.api.nvim_create_buf(false, true)
+        local lines = {} --- @type string[]
+        for j = 1, 8 do
+          lines[j] = tostring(i):rep(30)
+        end
+        vim.api.nvim_buf_set_lines(buf, 0, -1, true, lines)
+        wins[i] = vim.api.nvim_open_win(buf, false, {
+          relative = 'editor',
+          row = 2 * i,
+          col = 6 * i,
+          width = 20,
+          height = 6,
+          border = i == 2 and 'single' or nil,
+        })
+      end
+      return wins
+    end)
+
+    -- screenstring() finds the float at each cell by looking at all the
+    -- layers, not at the layers the compositor keeps for each row.
+    local function check()
+      command('redraw')
+      local expected = exec_lua(function()
+        local rows = {} --- @type string[]
+        for row = 1, vim.o.lines - 1 do
+          local cells = {} --- @type string[]
+          for col = 1, vim.o.columns do
+            cells[col] = vim.fn.screenstring(row, col)
+          end
+          rows[row] = table.concat(cells)
+        end
+        return rows
+      end)
+      screen:expect(function()
+        local rows = {} --- @type string[]
+        for row = 1, #expected do
+          local cells = {} --- @type string[]
+          for col, cell in ipairs(screen._grids[1].rows[row]) do
+            cells[col] = cell.text
+          end
+          rows[row] = table.concat(cells)
+        end
+        eq(expected, rows)
+      end)
+    end
+
+    check()
+    -- move a float over another one
+    api.nvim_win_set_config(wins[1], { relative = 'editor', row = 7, col = 20 })
+    check()
+    api.nvim_win_set_config(wins[2], { width = 35, height = 3 })
+    check()
+    api.nvim_win_set_config(wins[3], { hide = true })
+    check()
+    -- scrolling and changing text below the floats
+    command('exe "normal! 3\\<C-e>"')
+    check()
+    api.nvim_buf_set_lines(0, 8, 10, true, { 'changed' })
+    check()
+    -- raise a float and change text in the one below it
+    api.nvim_win_set_config(wins[1], { zindex = 60 })
+    api.nvim_buf_set_lines(api.nvim_win_get_buf(wins[2]), 0, 1, true, { 'below' })
+    check()
+    api.nvim_win_set_config(wins[3], { hide = false, relative = 'editor', row = 15, col = 45 })
+    check()
+    screen:try_resize(50, 14)
+    check()
+
+    math.randomseed(42)
+    for _ = 1, 30 do
+      local win = wins[math.random(#wins)]
+      local r = math.random(4)
+      if r == 1 then
+        local row, col = math.random(0, 12), math.random(0, 40)
+        api.nvim_win_set_config(win, { relative = 'editor', row = row, col = col })
+      elseif r == 2 then
+        api.nvim_win_set_config(win, { width = math.random(5, 30), height = math.random(1, 8) })
+      elseif r == 3 then
+        api.nvim_win_set_config(win, { hide = not api.nvim_win_get_config(win).hide })
+      else
+        api.nvim_win_set_config(win, { zindex = math.random(40, 60) })
+      end
+      check()
+    end
+
+    api.nvim_win_close(wins[2], true)
+    check()
+  end)
+
   describe('with only one tabpage,', function()
     local float_opts = { relative = 'editor', row = 1, col = 1, width = 1, height = 1 }
     local old_buf, old_win
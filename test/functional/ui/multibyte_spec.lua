@@ -222,6 +222,42 @@ describe('multibyte rendering', function()
     })
   end)
 
+  it('keeps the shown glyphs when evicting the glyph cache', function()
+    screen:try_resize(20, 4)
+    -- Glyphs which are too long to be stored in the cell, one per line.
+    local lines = {}
+    for i = 0, 99 do
+      lines[#lines + 1] = string.char(97 + i % 26, 0xcc, 0x80 + i % 64, 0xcc, 0x80 + i % 61 + 3)
+    end
+    api.nvim_buf_set_lines(0, 0, -1, true, lines)
+    n.exec([[
+      for i in range(100)
+        exe "normal! \<C-e>"
+        redraw
+      endfor
+      normal! gg
+      redraw
+    ]])
+    local pad = (' '):rep(19)
+    screen:expect(
+      ('^%s%s|\n%s%s|\n%s%s|\n%s |'):format(lines[1], pad, lines[2], pad, lines[3], pad, pad)
+    )
+    local before = api.nvim__stats()
+    t.ok(before.glyph_cache_size >= 100)
+    t.ok(before.glyph_cache_hits > 0)
+
+    api.nvim__evict_glyph_cache()
+    screen:expect_unchanged()
+    local after = api.nvim__stats()
+    t.eq(3, after.glyph_cache_size)
+    t.eq(before.glyph_cache_evictions + 1, after.glyph_cache_evictions)
+    t.eq(before.glyph_cache_evicted + before.glyph_cache_size - 3, after.glyph_cache_evicted)
+    -- The grid still refers to the right glyphs.
+    for row = 1, 3 do
+      t.eq(lines[row], fn.screenstring(row, 1))
+    end
+  end)
+
   it('works with arabic input and arabicshape', function()
     command('set arabic')
 
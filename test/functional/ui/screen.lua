@@ -165,6 +165,7 @@ local function _init_colors()
 end
 
 --- @class test.functional.ui.screen.Opts
+--- @field ext_binary_grid? boolean
 --- @field ext_linegrid? boolean
 --- @field ext_multigrid? boolean
 --- @field ext_newgrid? boolean
@@ -1305,6 +1306,64 @@ function Screen:_handle_grid_line(grid, row, col, items, wrap)
   end
 end
 
+--- Decodes the operations of ext_binary_grid, see ":help ui-binary-grid".
+function Screen:_handle_grid_line_bin(grid, row, col, data, wrap)
+  assert(self._options.ext_binary_grid)
+  local line = self._grids[grid].rows[row + 1]
+  local colpos = col + 1
+  local hl_id = 0
+  local pos = 1
+  line.wrap = wrap
+
+  local function varint()
+    local val, mul = 0, 1
+    local b
+    repeat
+      b = data:byte(pos)
+      pos = pos + 1
+      val = val + (b % 0x80) * mul
+      mul = mul * 0x80
+    until b < 0x80
+    return val
+  end
+  local function text()
+    local b = data:byte(pos)
+    if b < 0x80 then
+      pos = pos + 1
+      return string.char(b)
+    end
+    local len = b - 0x80
+    local s = data:sub(pos + 1, pos + len)
+    pos = pos + 1 + len
+    return s
+  end
+  local function put(s)
+    local cell = line[colpos]
+    cell.text = s
+    cell.hl_id = hl_id
+    colpos = colpos + 1
+  end
+
+  while pos <= #data do
+    local val = varint()
+    local kind, count = val % 4, math.floor(val / 4)
+    if kind == 0 then
+      colpos = colpos + count
+    elseif kind == 1 then
+      hl_id = count
+    elseif kind == 2 then
+      for _ = 1, count do
+        put(text())
+      end
+    else
+      local s = text()
+      for _ = 1, count do
+        put(s)
+      end
+    end
+  end
+end
+
 function Screen:_handle_bell()
   self.bell = true
 end
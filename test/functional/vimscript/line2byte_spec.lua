@@ -0,0 +1,78 @@
+local n = require('test.functional.testnvim')()
+
+local clear = n.clear
+local exec_lua = n.exec_lua
+
+describe('line2byte() and byte2line()', function()
+  before_each(clear)
+
+  for _, opts in ipairs({
+    'fileformat=unix',
+    'fileformat=dos',
+    'fileformat=unix noeol nofixeol',
+    'fileformat=dos noeol nofixeol',
+  }) do
+    it('agree with the text after changes across chunks, ' .. opts, function()
+      exec_lua(function(opts_)
+        vim.cmd('set ' .. opts_)
+        local eol = vim.o.fileformat == 'dos' and 2 or 1
+
+        --- Compares the offsets of all lines with the sum of the line lengths.
+        local function check(round)
+          local count = vim.api.nvim_buf_line_count(0)
+          local off = 1
+          for lnum = 1, count do
+            local len = #vim.fn.getline(lnum)
+            local msg = ('round %d, line %d'):format(round, lnum)
+            assert(vim.fn.line2byte(lnum) == off, msg)
+            assert(vim.fn.byte2line(off) == lnum, msg)
+            assert(vim.fn.byte2line(off + len) == lnum, msg)
+            off = off + len + eol
+          end
+          local size = vim.o.eol and off or off - eol
+          assert(vim.fn.line2byte(count + 1) == size, ('round %d, size'):format(round))
+          assert(vim.fn.byte2line(off) == -1, ('round %d, end'):format(round))
+        end
+
+        local lines = {} --- @type string[]
+        for i = 1, 3000 do
+          lines[i] = ('line %d '):format(i) .. ('x'):rep(i % 37)
+        end
+        vim.api.nvim_buf_set_lines(0, 0, -1, true, lines)
+        check(0)
+
+        math.randomseed(42)
+        for round = 1, 40 do
+          local count = vim.api.nvim_buf_line_count(0)
+          local lnum = math.random(count)
+          local r = round % 5
+          if r == 0 then
+            -- More lines than fit in a chunk.
+            local added = {} --- @type string[]
+            for i = 1, math.random(500, 1200) do
+              added[i] = ('added %d '):format(i) .. ('y'):rep(i % 11)
+            end
+            vim.api.nvim_buf_set_lines(0, lnum - 1, lnum - 1, true, added)
+          elseif r == 1 then
+            -- Deleting many lines joins chunks.
+            local last = math.min(count - 1, lnum + math.random(300, 900))
+            vim.api.nvim_buf_set_lines(0, lnum - 1, last, true, {})
+          elseif r == 2 then
+            for _ = 1, 50 do
+              local l = math.random(vim.api.nvim_buf_line_count(0)) - 1
+              vim.api.nvim_buf_set_text(0, l, 0, l, 0, { ('z'):rep(math.random(10)) })
+            end
+          elseif r == 3 then
+            vim.cmd(('%d,%djoin'):format(lnum, math.min(count, lnum + math.random(5, 50))))
+          else
+            for _ = 1, 50 do
+              local l = math.random(vim.api.nvim_buf_line_count(0))
+              vim.api.nvim_buf_set_lines(0, l - 1, l - 1, true, { 'single' })
+            end
+          end
+          check(round)
+        end
+      end, opts)
+    end)
+  end
+end)
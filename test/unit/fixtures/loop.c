@@ -0,0 +1,77 @@
+#include <stdint.h>
+#include <uv.h>
+
+#include "loop.h"
+
+#include "nvim/event/defs.h"
+#include "nvim/event/loop.h"
+#include "nvim/memory.h"
+#include "nvim/os/time.h"
+
+typedef struct {
+  Loop *loop;
+  int id;
+  int count;
+} Producer;
+
+static int *last_seq;  // last sequence number got from each producer
+static int64_t received;
+static int64_t out_of_order;
+
+static void count_event(void **argv)
+{
+  int id = (int)(intptr_t)argv[0];
+  int seq = (int)(intptr_t)argv[1];
+  if (seq != last_seq[id] + 1) {
+    out_of_order++;
+  }
+  last_seq[id] = seq;
+  received++;
+}
+
+static void producer_main(void *arg)
+{
+  Producer *p = arg;
+  for (int i = 0; i < p->count; i++) {
+    loop_schedule_fast(p->loop, event_create(count_event, (void *)(intptr_t)p->id,
+                                             (void *)(intptr_t)i));
+  }
+}
+
+/// Schedules "count" events on a new loop from each of "nthreads" threads,
+/// and processes them on the calling thread.
+///
+/// @return  time taken in nanoseconds, or zero when an event was lost or
+///          the events of a thread were not processed in order.
+uint64_t ut_loop_schedule_fast(int nthreads, int count)
+{
+  Loop loop;
+  loop_init(&loop, NULL);
+  uv_thread_t *threads = xmalloc((size_t)nthreads * sizeof(*threads));
+  Producer *producers = xmalloc((size_t)nthreads * sizeof(*producers));
+  last_seq = xmalloc((size_t)nthreads * sizeof(*last_seq));
+  received = 0;
+  out_of_order = 0;
+
+  uint64_t start = os_hrtime();
+  for (int i = 0; i < nthreads; i++) {
+    last_seq[i] = -1;
+    producers[i] = (Producer){ &loop, i, count };
+    uv_thread_create(&threads[i], producer_main, &producers[i]);
+  }
+  int64_t total = (int64_t)nthreads * count;
+  while (received < total) {
+    loop_poll_events(&loop, 10);
+  }
+  uint64_t elapsed = os_hrtime() - start;
+
+  for (int i = 0; i < nthreads; i++) {
+    uv_thread_join(&threads[i]);
+  }
+  loop_close(&loop, false);
+  xfree(threads);
+  xfree(producers);
+  XFREE_CLEAR(last_seq);
+
+  return out_of_order == 0 && received == total ? elapsed : 0;
+}
@@ -0,0 +1,3 @@
+#include <stdint.h>
+
+uint64_t ut_loop_schedule_fast(int nthreads, int count);
@@ -0,0 +1,82 @@
+local t = require('test.unit.testutil')
+local itp = t.gen_itp(it)
+
+local ffi = t.ffi
+local eq = t.eq
+
+local grid = t.cimport('./src/nvim/grid.h')
+
+describe('grid_cells_diff', function()
+  local size = 100
+  local chars1 = ffi.new('schar_T[?]', size)
+  local attrs1 = ffi.new('sattr_T[?]', size)
+  local chars2 = ffi.new('schar_T[?]', size)
+  local attrs2 = ffi.new('sattr_T[?]', size)
+
+  --- Compares the cells one by one.
+  local function expected(start, end_)
+    local first, last = end_, start
+    for i = start, end_ - 1 do
+      if chars1[i] ~= chars2[i] or attrs1[i] ~= attrs2[i] then
+        first = math.min(first, i)
+        last = i + 1
+      end
+    end
+    return { first, last }
+  end
+
+  local function diff(start, end_)
+    local first = ffi.new('int[1]')
+    local last = ffi.new('int[1]')
+    grid.grid_cells_diff(chars1, attrs1, chars2, attrs2, start, end_, first, last)
+    return { first[0], last[0] }
+  end
+
+  itp('finds the same cells with each implementation', function()
+    local max = grid.grid_set_cell_cmp(grid.kCellCmpAVX2)
+    for impl = grid.kCellCmpScalar, max do
+      eq(impl, grid.grid_set_cell_cmp(impl))
+      math.randomseed(42)
+      for _ = 1, 2000 do
+        local len = math.random(0, size)
+        for i = 0, len - 1 do
+          chars1[i] = math.random(0, 0x7fffffff)
+          attrs1[i] = math.random(-1, 100)
+          chars2[i] = chars1[i]
+          attrs2[i] = attrs1[i]
+        end
+        for _ = 1, math.random(0, 3) do
+          if len > 0 then
+            local i = math.random(0, len - 1)
+            if math.random(0, 1) == 0 then
+              chars2[i] = chars2[i] + 1
+            else
+              attrs2[i] = attrs2[i] + 1
+            end
+          end
+        end
+        local start = math.random(0, len)
+        eq(expected(start, len), diff(start, len))
+      end
+    end
+  end)
+
+  itp('finds changes at the edges of vector-sized blocks', function()
+    local max = grid.grid_set_cell_cmp(grid.kCellCmpAVX2)
+    for impl = grid.kCellCmpScalar, max do
+      grid.grid_set_cell_cmp(impl)
+      for i = 0, size - 1 do
+        chars1[i], chars2[i] = 32, 32
+        attrs1[i], attrs2[i] = 0, 0
+      end
+      eq({ size, 0 }, diff(0, size))
+      for _, col in ipairs({ 0, 3, 4, 7, 8, 15, 16, size - 1 }) do
+        attrs2[col] = 1
+        eq({ col, col + 1 }, diff(0, size))
+        -- Cells before "start" are not compared.
+        eq(col == 0 and { size, 1 } or { col, col + 1 }, diff(1, size))
+        attrs2[col] = 0
+      end
+    end
+  end)
+end)
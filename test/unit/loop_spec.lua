@@ -0,0 +1,15 @@
+local t = require('test.unit.testutil')
+local itp = t.gen_itp(it)
+
+local neq = t.neq
+
+local lib = t.cimport('./test/unit/fixtures/loop.h')
+
+describe('loop_schedule_fast', function()
+  itp('gets all events of many threads, in order', function()
+    -- More events than the ring has room for, some go to thread_events.
+    for _, threads in ipairs({ 1, 4, 16 }) do
+      neq(0, tonumber(lib.ut_loop_schedule_fast(threads, 2000)))
+    end
+  end)
+end)
@@ -0,0 +1,65 @@
+local t = require('test.unit.testutil')
+local itp = t.gen_itp(it)
+
+local ffi = t.ffi
+local eq = t.eq
+local neq = t.neq
+
+local lib = t.cimport('./src/nvim/lz4.h')
+
+describe('lz4', function()
+  --- Compress and uncompress "s", check that the result is "s" again.
+  --- @return integer compressed size
+  local function roundtrip(s)
+    local cap = #s + math.floor(#s / 255) + 16
+    local buf = ffi.new('char[?]', cap)
+    local size = lib.lz4_compress(s, #s, buf, cap)
+    neq(0, tonumber(size))
+    local out = ffi.new('char[?]', #s + 1)
+    eq(true, lib.lz4_decompress(buf, size, out, #s))
+    eq(s, ffi.string(out, #s))
+    -- a wrong size is detected
+    if #s > 0 then
+      eq(false, lib.lz4_decompress(buf, size, out, #s - 1))
+    end
+    return tonumber(size)
+  end
+
+  itp('compresses and uncompresses', function()
+    roundtrip('')
+    roundtrip('a')
+    roundtrip('abcdefghijklm')
+    roundtrip(('x'):rep(100))
+    roundtrip(('abc'):rep(1000))
+    local lines = {}
+    for i = 1, 500 do
+      lines[i] = ('line %d with some text'):format(i)
+    end
+    roundtrip(table.concat(lines, '\n'))
+    local bytes = {}
+    math.randomseed(42)
+    for i = 1, 5000 do
+      bytes[i] = string.char(math.random(0, 255))
+    end
+    roundtrip(table.concat(bytes))
+  end)
+
+  itp('makes repeated text smaller', function()
+    local s = ('some text '):rep(400)
+    assert(roundtrip(s) < #s / 10)
+  end)
+
+  itp('fails when the result does not fit', function()
+    local s = 'abcdefghijklmnopqrstuvwxyz'
+    local buf = ffi.new('char[?]', #s)
+    eq(0, tonumber(lib.lz4_compress(s, #s, buf, #s - 1)))
+  end)
+
+  itp('rejects invalid data', function()
+    local out = ffi.new('char[?]', 16)
+    -- match offset before the start
+    eq(false, lib.lz4_decompress('\x10a\x05\x00', 4, out, 5))
+    -- literals beyond the end of the input
+    eq(false, lib.lz4_decompress('\x50ab', 3, out, 5))
+  end)
+end)
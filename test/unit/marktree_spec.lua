@@ -393,6 +393,91 @@ describe('marktree', function()
     eq(0, tree[0].n_keys)
   end)
 
+  itp('works with marktree_put_many', function()
+    -- items are { row, col, gravity, end_row, end_col, end_gravity }
+    local function put_many(tree, items)
+      local pairs = ffi.new('MTPair[?]', #items)
+      local ids = {}
+      for i, item in ipairs(items) do
+        last_id = last_id + 1
+        local p = pairs[i - 1]
+        p.start.pos.row = item[1]
+        p.start.pos.col = item[2]
+        p.start.ns = ns
+        p.start.id = last_id
+        p.start.flags = item[3] and 0x4000 or 0 -- MT_FLAG_RIGHT_GRAVITY
+        p.end_pos.row = item[4] or -1
+        p.end_pos.col = item[5] or -1
+        p.end_right_gravity = item[6] or false
+        ids[i] = last_id
+      end
+      lib.marktree_put_many(tree, pairs, #items)
+      return ids
+    end
+
+    local tree = ffi.new('MarkTree[1]') -- zero initialized by luajit
+    local iter = ffi.new('MarkTreeIter[1]')
+    local shadow = {}
+    math.randomseed(42)
+
+    -- into an empty tree, then few marks (put one by one), then many marks
+    -- merged with the existing ones
+    for _, count in ipairs({ 1000, 100, 2000 }) do
+      local items = {}
+      for i = 1, count do
+        items[i] = { math.random(0, 50), math.random(0, 50), math.random(2) == 1 }
+      end
+      local ids = put_many(tree, items)
+      for i, id in ipairs(ids) do
+        shadow[id] = items[i]
+      end
+      lib.marktree_check(tree)
+      shadoworder(tree, shadow, iter)
+    end
+    eq(3100, tonumber(tree[0].n_keys))
+
+    for i = 1, 500 do
+      local id = next(shadow)
+      lib.marktree_lookup_ns(tree, ns, id, false, iter)
+      lib.marktree_del_itr(tree, iter, false)
+      shadow[id] = nil
+      if i % 100 == 0 then
+        lib.marktree_check(tree)
+        shadoworder(tree, shadow, iter)
+      end
+    end
+
+    -- pairs are intersected like with marktree_put()
+    local tree2 = ffi.new('MarkTree[1]')
+    local pair_ids = {}
+    for i = 1, 200 do
+      table.insert(pair_ids, put(tree2, 1, i, false, 2, 200 - i, false))
+    end
+    for _ = 1, 3 do
+      local items = {}
+      for i = 1, 1000 do
+        local row, col = math.random(0, 30), math.random(0, 30)
+        if i % 3 == 0 then
+          items[i] = { row, col, math.random(2) == 1 }
+        else
+          local end_row = row + math.random(0, 3)
+          local end_col = end_row == row and col + math.random(0, 5) or math.random(0, 30)
+          items[i] = { row, col, math.random(2) == 1, end_row, end_col, math.random(2) == 1 }
+          table.insert(pair_ids, last_id + i)
+        end
+      end
+      put_many(tree2, items)
+      check_intersections(tree2)
+    end
+
+    for i, id in ipairs(pair_ids) do
+      if i % 3 == 0 then
+        lib.marktree_del_pair_test(tree2, ns, id)
+      end
+    end
+    check_intersections(tree2)
+  end)
+
   itp('works with intersections and marktree_splice', function()
     local tree = ffi.new('MarkTree[1]') -- zero initialized by luajit
 
@@ -413,6 +498,63 @@ describe('marktree', function()
     end
   end)
 
+  itp('keeps both ends of paired marks when splicing', function()
+    local tree = ffi.new('MarkTree[1]') -- zero initialized by luajit
+    local iter = ffi.new('MarkTreeIter[1]')
+    -- start and end positions of each pair, in the format of shadowsplice()
+    local starts, ends = {}, {}
+    math.randomseed(13)
+
+    for _ = 1, 2000 do
+      local row, col = math.random(0, 40), math.random(0, 40)
+      local end_row = row + math.random(0, 5)
+      local end_col = end_row == row and col + math.random(0, 10) or math.random(0, 40)
+      local gravity, end_gravity = math.random(2) == 1, math.random(2) == 1
+      local id = put(tree, row, col, gravity, end_row, end_col, end_gravity)
+      starts[id] = { row, col, gravity }
+      ends[id] = { end_row, end_col, end_gravity }
+    end
+
+    local function check()
+      check_intersections(tree)
+      for id, pos in pairs(starts) do
+        local mark = lib.marktree_lookup_ns(tree, ns, id, false, iter)
+        eq({ pos[1], pos[2] }, { mark.pos.row, mark.pos.col }, id)
+        mark = lib.marktree_lookup_ns(tree, ns, id, true, iter)
+        eq({ ends[id][1], ends[id][2] }, { mark.pos.row, mark.pos.col }, id)
+      end
+    end
+
+    local function splice(start, old, new)
+      lib.marktree_splice(tree, start[1], start[2], old[1], old[2], new[1], new[2])
+      shadowsplice(starts, start, old, new)
+      shadowsplice(ends, start, old, new)
+      check()
+    end
+
+    check()
+    -- delete lines with only one end of many pairs inside
+    splice({ 10, 5 }, { 3, 0 }, { 0, 0 })
+    -- insert lines and split a line
+    splice({ 5, 0 }, { 0, 0 }, { 4, 0 })
+    splice({ 30, 7 }, { 0, 0 }, { 1, 0 })
+    -- replace text within a line and across lines
+    splice({ 15, 3 }, { 0, 20 }, { 0, 2 })
+    splice({ 20, 10 }, { 2, 5 }, { 0, 3 })
+    -- join lines
+    splice({ 12, 40 }, { 1, 0 }, { 0, 0 })
+
+    for _ = 1, 50 do
+      local start = { math.random(0, 45), math.random(0, 45) }
+      local old = { math.random(0, 3), math.random(0, 20) }
+      local new = { math.random(0, 3), math.random(0, 20) }
+      splice(start, old, new)
+    end
+
+    -- delete most of the text, moving the ends of every pair
+    splice({ 0, 0 }, { 40, 0 }, { 2, 4 })
+  end)
+
   itp('marktree_move should preserve key order', function()
     local tree = ffi.new('MarkTree[1]') -- zero initialized by luajit
     local iter = ffi.new('MarkTreeIter[1]')